@@ -0,0 +1,159 @@
+/****************************************************************************//**
+ * @file aggregator.cpp
+ * @author Gonzalo Puy.
+ * @date Jun 2025
+ * @brief Gateway aggregator.
+ *******************************************************************************/
+
+#include <netinet/in.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "aggregator.h"
+#include "telemetry_frame.h"
+
+//=====[Declaration of private defines]==========================================
+
+#define AGGREGATOR_BATCHES_MAX      64      /**< Batches read per update, so the bot runs under a flood. */
+
+//=====[Implementations of public methods]=======================================
+
+namespace Gateway {
+
+  Aggregator::Aggregator(BotApi &api, size_t capacity)
+    : table(capacity)
+    , bot(api, table)
+    , socketFd(-1)
+    , port(0)
+    , counters()
+    {}
+
+  Aggregator::~Aggregator()
+  {
+    if (socketFd >= 0) {
+      close(socketFd);
+    }
+  }
+
+  bool Aggregator::open(uint16_t port)
+  {
+    const int receiveBuffer = AGGREGATOR_RECEIVE_BUFFER;
+    struct sockaddr_in address;
+    socklen_t addressLength = sizeof(address);
+
+    socketFd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+    if (socketFd < 0) {
+      return false;
+    }
+
+    // Capped by net.core.rmem_max, which is fine.
+    setsockopt(socketFd, SOL_SOCKET, SO_RCVBUF, &receiveBuffer, sizeof(receiveBuffer));
+
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(port);
+
+    if ((bind(socketFd, (const struct sockaddr *) &address, sizeof(address)) != 0) ||
+        (getsockname(socketFd, (struct sockaddr *) &address, &addressLength) != 0)) {
+      close(socketFd);
+      socketFd = -1;
+      return false;
+    }
+
+    this->port = ntohs(address.sin_port);
+    return true;
+  }
+
+  void Aggregator::update(uint64_t now, int timeout)
+  {
+    if (socketFd >= 0) {
+      _receive(now, timeout);
+    }
+
+    bot.update(now);
+  }
+
+  void Aggregator::ingest(const char *datagram, uint64_t now)
+  {
+    telemetry_frame_t frame;
+    uint8_t previousState;
+
+    if (!Module::TelemetryFrame::parse(datagram, frame)) {
+      counters.badFrames++;
+      return;
+    }
+
+    switch (table.update(frame, (uint32_t) (now / 1000), previousState)) {
+      case FLEET_UPDATE_NEW:
+      case FLEET_UPDATE_CHANGED:
+      case FLEET_UPDATE_SAME: {
+        // New monitors start as OK, so a new one that is low is told right away.
+        const uint8_t state = table.find(frame.deviceId)->state;
+
+        counters.frames++;
+        if (state != previousState) {
+          counters.stateChanges++;
+          bot.notifyState(frame.deviceId, state);
+        }
+        break;
+      }
+      case FLEET_UPDATE_OLD:
+        counters.oldFrames++;
+        break;
+      case FLEET_UPDATE_FULL:
+        counters.refusedFrames++;
+        break;
+    }
+  }
+
+//=====[Implementations of private methods]======================================
+
+  /**
+  * @brief Reads the pending datagrams in batches and applies them.
+  * @param now Gateway time [ms].
+  * @param timeout Time [ms] to wait for the first datagram.
+  * @return size_t Datagrams read.
+  */
+  size_t Aggregator::_receive(uint64_t now, int timeout)
+  {
+    char buffers[AGGREGATOR_BATCH_SIZE][AGGREGATOR_FRAME_SIZE];
+    struct mmsghdr messages[AGGREGATOR_BATCH_SIZE];
+    struct iovec vectors[AGGREGATOR_BATCH_SIZE];
+    struct pollfd descriptor = { socketFd, POLLIN, 0 };
+    size_t total = 0;
+
+    if (poll(&descriptor, 1, timeout) <= 0) {
+      return 0;
+    }
+
+    for (int batch = 0; batch < AGGREGATOR_BATCHES_MAX; batch++) {
+      memset(messages, 0, sizeof(messages));
+      for (int i = 0; i < AGGREGATOR_BATCH_SIZE; i++) {
+        vectors[i].iov_base = buffers[i];
+        vectors[i].iov_len = AGGREGATOR_FRAME_SIZE - 1;
+        messages[i].msg_hdr.msg_iov = &vectors[i];
+        messages[i].msg_hdr.msg_iovlen = 1;
+      }
+
+      const int received = recvmmsg(socketFd, messages, AGGREGATOR_BATCH_SIZE, MSG_DONTWAIT, nullptr);
+      if (received <= 0) {
+        break;
+      }
+
+      for (int i = 0; i < received; i++) {
+        if (messages[i].msg_hdr.msg_flags & MSG_TRUNC) {
+          counters.badFrames++;
+          continue;
+        }
+        buffers[i][messages[i].msg_len] = '\0';
+        ingest(buffers[i], now);
+      }
+      total += (size_t) received;
+    }
+
+    return total;
+  }
+
+} // namespace Gateway
@@ -0,0 +1,110 @@
+/****************************************************************************//**
+ * @file aggregator.h
+ * @author Gonzalo Puy.
+ * @date Jun 2025
+ * @brief Gateway aggregator header file.
+ *
+ * Receives the UDP telemetry frames of the monitors in gateway mode, keeps
+ * their latest state in the fleet table and runs the fleet bot.
+ *******************************************************************************/
+
+#ifndef AGGREGATOR_H
+#define AGGREGATOR_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "bot_api.h"
+#include "fleet_bot.h"
+#include "fleet_table.h"
+
+//=========================[Module Defines]=====================================
+
+#define AGGREGATOR_BATCH_SIZE       64          /**< Datagrams read per system call. */
+#define AGGREGATOR_RECEIVE_BUFFER   (4 << 20)   /**< Socket receive buffer [bytes], absorbs bursts while the bot waits on Telegram. */
+#define AGGREGATOR_FRAME_SIZE       128         /**< Longest datagram taken as a frame. */
+
+//===========================[Module Types]=====================================
+
+/**
+ * @struct aggregator_counters_t
+ * @brief Frames received by the aggregator.
+ */
+typedef struct aggregator_counters {
+  uint64_t frames;            /**< Frames applied to the table. */
+  uint64_t badFrames;         /**< Datagrams that are not a frame. */
+  uint64_t oldFrames;         /**< Repeated or out of order frames. */
+  uint64_t refusedFrames;     /**< Frames of new monitors with the table full. */
+  uint64_t stateChanges;      /**< Tank state changes, new monitors not low included. */
+} aggregator_counters_t;
+
+namespace Gateway {
+
+  /**
+  * @class Aggregator
+  * @brief Single threaded gateway: frames and the bot are served from one loop.
+  */
+  class Aggregator {
+
+  public:
+
+    /**
+    * @brief Constructor.
+    * @param api Bot API access of the fleet bot.
+    * @param capacity Monitors tracked at most.
+    */
+    Aggregator(BotApi &api, size_t capacity);
+
+    ~Aggregator();
+    Aggregator(const Aggregator&) = delete;
+    Aggregator& operator=(const Aggregator&) = delete;
+
+    /**
+    * @brief Opens the UDP socket the monitors send to.
+    * @param port UDP port, 0 for any free one.
+    * @return true if open, false otherwise.
+    */
+    bool open(uint16_t port);
+
+    /**
+    * @brief Port the frames are received on, once open.
+    */
+    uint16_t getPort() const { return port; }
+
+    /**
+    * @brief Applies the frames received, waiting for them up to a timeout, then
+    *        runs the fleet bot.
+    * @param now Gateway time [ms].
+    * @param timeout Time [ms] to wait for the first frame.
+    */
+    void update(uint64_t now, int timeout);
+
+    /**
+    * @brief Applies a single datagram.
+    * @param datagram Datagram, null terminated.
+    * @param now Gateway time [ms].
+    */
+    void ingest(const char *datagram, uint64_t now);
+
+    const FleetTable &getTable() const { return table; }
+
+    FleetBot &getBot() { return bot; }
+
+    const FleetBot &getBot() const { return bot; }
+
+    const aggregator_counters_t &getCounters() const { return counters; }
+
+  private:
+
+    size_t _receive(uint64_t now, int timeout);
+
+    FleetTable table;                 /**< Latest state of every monitor. */
+    FleetBot bot;                     /**< Telegram bot of the fleet. */
+    int socketFd;                     /**< UDP socket, -1 until open. */
+    uint16_t port;                    /**< UDP port, 0 until open. */
+    aggregator_counters_t counters;   /**< Frames received. */
+
+  }; // class Aggregator
+
+} // namespace Gateway
+
+#endif // AGGREGATOR_H
@@ -0,0 +1,39 @@
+/****************************************************************************//**
+ * @file bot_api.h
+ * @author Gonzalo Puy.
+ * @date Jun 2025
+ * @brief Telegram Bot API access of the gateway.
+ *******************************************************************************/
+
+#ifndef BOT_API_H
+#define BOT_API_H
+
+#include <string>
+
+namespace Gateway {
+
+  /**
+  * @class BotApi
+  * @brief Calls Bot API methods, so the fleet bot runs the same against
+  *        Telegram and against the load test.
+  */
+  class BotApi {
+
+  public:
+
+    virtual ~BotApi() = default;
+
+    /**
+    * @brief Calls a method and waits for the answer.
+    * @param method Bot API method, e.g. "getUpdates".
+    * @param form URL encoded parameters.
+    * @param response Output: body of the answer.
+    * @return true if the method was answered with 200, false otherwise.
+    */
+    virtual bool call(const char *method, const std::string &form, std::string &response) = 0;
+
+  }; // class BotApi
+
+} // namespace Gateway
+
+#endif // BOT_API_H
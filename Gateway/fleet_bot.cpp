@@ -0,0 +1,371 @@
+/****************************************************************************//**
+ * @file fleet_bot.cpp
+ * @author Gonzalo Puy.
+ * @date Jun 2025
+ * @brief Fleet bot.
+ *******************************************************************************/
+
+#include <algorithm>
+#include <stdlib.h>
+#include <ArduinoJson.h>
+#include "fleet_bot.h"
+
+//=====[Declaration of private defines]==========================================
+
+#define FLEET_STATE_NONE    0xFF    /**< No alert waiting for a monitor. */
+
+//=====[Declaration of private functions]========================================
+
+static const char *unitName(char unit);
+static const char *alertText(uint8_t state);
+
+//=====[Implementations of public methods]=======================================
+
+namespace Gateway {
+
+  FleetBot::FleetBot(BotApi &api, FleetView &fleet)
+    : api(api)
+    , fleet(fleet)
+    , toldStates(FLEET_DEVICE_ID_COUNT, TANK_LEVEL_OK)
+    , pendingStates(FLEET_DEVICE_ID_COUNT, FLEET_STATE_NONE)
+    , lastUpdateId(0)
+    , nextPoll(0)
+    , counters()
+    {}
+
+  void FleetBot::update(uint64_t now)
+  {
+    if (now < nextPoll) {
+      return;
+    }
+
+    nextPoll = now + FLEET_BOT_POLL_INTERVAL;
+    _poll(now);
+    _sendAlerts();
+  }
+
+  void FleetBot::notifyState(uint16_t deviceId, uint8_t state)
+  {
+    if (pendingStates[deviceId] == FLEET_STATE_NONE) {
+      if (state != toldStates[deviceId]) {
+        pendingStates[deviceId] = state;
+        pendingDevices.push_back(deviceId);
+      }
+      return;
+    }
+
+    // Back to what the users were told last: nothing to tell anymore.
+    if (state == toldStates[deviceId]) {
+      pendingStates[deviceId] = FLEET_STATE_NONE;
+      pendingDevices.erase(std::find(pendingDevices.begin(), pendingDevices.end(), deviceId));
+    } else {
+      pendingStates[deviceId] = state;
+    }
+  }
+
+  void FleetBot::handleMessage(const std::string &fromId, const std::string &fromName, const std::string &text, uint64_t now)
+  {
+    const size_t commandEnd = text.find(' ');
+    const std::string command = text.substr(0, commandEnd);
+    const std::string params = (commandEnd == std::string::npos) ? "" : text.substr(commandEnd + 1);
+
+    counters.messages++;
+    _beginReply(fromId);
+
+    if (command == COMMAND_START_STR) {
+      _commandStart(fromId, fromName);
+    } else if (_findUser(fromId) < 0) {
+      reply.Format(ERROR_INVALID_USER_STR, fromName.c_str());
+    } else if (command == COMMAND_END_STR) {
+      _commandEnd(fromId, fromName);
+    } else if (command == COMMAND_TANK_STATUS_STR) {
+      _commandStatus(params.c_str(), now);
+    } else {
+      reply.Format(ERROR_INVALID_COMMAND_STR, command.c_str());
+    }
+
+    _send();
+  }
+
+//=====[Implementations of private methods]======================================
+
+  /**
+  * @brief Requests the messages received since the last poll and handles them.
+  * @param now Gateway time [ms].
+  */
+  void FleetBot::_poll(uint64_t now)
+  {
+    // Only the fields read below are kept, the rest of the update is skipped while parsing.
+    static JsonDocument filter;
+    if (filter["ok"].isNull()) {
+      filter["ok"] = true;
+      filter["result"][0]["update_id"] = true;
+      filter["result"][0]["message"]["text"] = true;
+      filter["result"][0]["message"]["from"]["id"] = true;
+      filter["result"][0]["message"]["from"]["first_name"] = true;
+    }
+
+    counters.polls++;
+
+    // Unlike a monitor, the gateway has the memory to take every update since the last one.
+    if (!api.call("getUpdates", "offset=" + std::to_string(lastUpdateId + 1) + "&timeout=0", response)) {
+      counters.pollFailures++;
+      return;
+    }
+
+    JsonDocument doc;
+    DeserializationError error = deserializeJson(doc, response, DeserializationOption::Filter(filter));
+    if (error || !doc["ok"]) {
+      counters.pollFailures++;
+      return;
+    }
+
+    JsonArray results = doc["result"];
+
+    for (size_t i = 0; i < results.size(); i++) {
+      JsonObject update = results[i];
+      JsonObject messageObj = update["message"];
+      const unsigned long long updateId = update["update_id"] | 0ULL;
+
+      if (updateId <= lastUpdateId) {
+        continue;
+      }
+      lastUpdateId = updateId;
+
+      // Stickers, photos and the like have no text.
+      if (messageObj["text"].isNull()) {
+        continue;
+      }
+
+      const char *text = messageObj["text"];
+      const unsigned long long fromId = messageObj["from"]["id"];
+      const char *fromName = messageObj["from"]["first_name"];
+
+      handleMessage(std::to_string(fromId), (fromName != nullptr) ? fromName : "", text, now);
+    }
+  }
+
+  /**
+  * @brief Sends the queued alerts as a single message to every user. They stay
+  *        queued if it fails for any of them, and are sent again on the next poll.
+  */
+  void FleetBot::_sendAlerts()
+  {
+    const size_t count = std::min(pendingDevices.size(), (size_t) FLEET_BOT_ALERTS_MAX);
+    bool isDelivered = true;
+
+    if (count == 0) {
+      return;
+    }
+
+    for (const user_t &user : users) {
+      _beginReply(user.id);
+
+      for (size_t i = 0; i < count; i++) {
+        const uint16_t deviceId = pendingDevices[i];
+
+        reply.Format(FLEET_DEVICE_STR, deviceId);
+        reply.Append(alertText(pendingStates[deviceId]));
+        reply.Append("\n\n");
+      }
+
+      if (_send()) {
+        counters.alertMessages++;
+      } else {
+        isDelivered = false;
+      }
+    }
+
+    if (!isDelivered) {
+      return;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+      const uint16_t deviceId = pendingDevices[i];
+
+      toldStates[deviceId] = pendingStates[deviceId];
+      pendingStates[deviceId] = FLEET_STATE_NONE;
+    }
+    pendingDevices.erase(pendingDevices.begin(), pendingDevices.begin() + count);
+  }
+
+  /**
+  * @brief Registers the user.
+  */
+  void FleetBot::_commandStart(const std::string &fromId, const std::string &fromName)
+  {
+    if ((_findUser(fromId) >= 0) || (users.size() == FLEET_BOT_USERS_MAX)) {
+      reply.Format(START_COMMAND_USER_REGISTER_FAIL_RESPONSE_STR, fromName.c_str());
+      return;
+    }
+
+    users.push_back({ fromId, fromName });
+    reply.Format(START_COMMAND_USER_REGISTERED_RESPONSE_STR, fromName.c_str());
+  }
+
+  /**
+  * @brief Unregisters the user.
+  */
+  void FleetBot::_commandEnd(const std::string &fromId, const std::string &fromName)
+  {
+    users.erase(users.begin() + _findUser(fromId));
+    reply.Format(END_COMMAND_USR_REMOVED_RESPONSE_STR, fromName.c_str());
+  }
+
+  /**
+  * @brief Writes the status of the fleet, or of a single monitor.
+  * @param deviceText Monitor ID, empty for the whole fleet.
+  * @param now Gateway time [ms].
+  */
+  void FleetBot::_commandStatus(const char *deviceText, uint64_t now)
+  {
+    if (deviceText[0] != '\0') {
+      char *end;
+      const long deviceId = strtol(deviceText, &end, 10);
+
+      if ((*end != '\0') || (deviceId < 0) || (deviceId >= FLEET_DEVICE_ID_COUNT)) {
+        reply.Format(ERROR_INVALID_PARAMETERS_STR, COMMAND_TANK_STATUS_STR);
+        return;
+      }
+
+      fleet_entry_t entry;
+
+      if (fleet.getEntry((uint16_t) deviceId, entry)) {
+        _writeDeviceStatus(entry, now);
+      } else {
+        reply.Format(FLEET_ERROR_NO_DEVICE_STR, (int) deviceId);
+      }
+      return;
+    }
+
+    fleet_summary_t summary;
+
+    fleet.getSummary((uint32_t) (now / 1000), FLEET_BOT_SILENCE, summary);
+
+    const uint32_t lowCount = summary.stateCount[TANK_LEVEL_LOW];
+
+    reply.Format(FLEET_STATUS_STR, (int) summary.devices, (int) lowCount, (int) summary.stateCount[TANK_LEVEL_UNKNOWN],
+                 (int) summary.silent);
+
+    if (lowCount == 0) {
+      return;
+    }
+
+    reply.Append(FLEET_STATUS_LOW_LIST_STR);
+    for (uint32_t i = 0; i < summary.lowListed; i++) {
+      if (i > 0) {
+        reply.Append(", ");
+      }
+      reply.AppendInt(summary.lowIds[i]);
+    }
+
+    if (lowCount > summary.lowListed) {
+      reply.Format(FLEET_STATUS_MORE_STR, (int) (lowCount - summary.lowListed));
+    }
+  }
+
+  /**
+  * @brief Writes the status of a monitor as the monitor bot would, with the time
+  *        left counted down since its last frame.
+  * @param entry Monitor.
+  * @param now Gateway time [ms].
+  */
+  void FleetBot::_writeDeviceStatus(const fleet_entry_t &entry, uint64_t now)
+  {
+    const uint32_t silence = (uint32_t) (now / 1000) - entry.lastSeen;
+
+    reply.Format(FLEET_DEVICE_STR, entry.deviceId);
+
+    if (entry.state == TANK_LEVEL_LOW) {
+      reply.Append(STATUS_COMMAND_RESPONSE_ALERT_ON);
+    } else if (!entry.tankRegistered) {
+      reply.Append(ERROR_NO_TANK_STR);
+    } else if (entry.timeLeft < 0) {
+      reply.Append(ERROR_STATUS_COMMAND_STR);
+    } else {
+      const float pressure = entry.pressureCenti / 100.0f;
+      const float gasFlow = entry.gasFlowCenti / 100.0f;
+      const int time = std::max(0, entry.timeLeft - (int) (silence / 60));
+
+      if (time >= 60) {
+        reply.Format(STATUS_COMMAND_RESPONSE_HOURS_STR, pressure, unitName(entry.unit), gasFlow, time / 60, time % 60);
+      } else {
+        reply.Format(STATUS_COMMAND_RESPONSE_MINUTES_STR, pressure, unitName(entry.unit), gasFlow, time);
+      }
+    }
+
+    if (silence > FLEET_BOT_SILENCE) {
+      reply.Format(FLEET_SILENT_STR, (int) (silence / 60));
+    }
+  }
+
+  /**
+  * @brief Starts a sendMessage form for a chat. The text goes right after.
+  */
+  void FleetBot::_beginReply(const std::string &chatId)
+  {
+    reply.Clear();
+    reply.Append("chat_id=");
+    reply.Append(chatId.c_str());
+    reply.Append("&text=");
+    reply.SetUrlEncoding(true);
+  }
+
+  /**
+  * @brief Sends the message started with _beginReply.
+  * @return true if Telegram took it, false otherwise.
+  */
+  bool FleetBot::_send()
+  {
+    if (api.call("sendMessage", reply.c_str(), response)) {
+      return true;
+    }
+
+    counters.sendFailures++;
+    return false;
+  }
+
+  /**
+  * @brief Finds a registered user.
+  * @return int Index in users, -1 if not registered.
+  */
+  int FleetBot::_findUser(const std::string &fromId) const
+  {
+    for (size_t i = 0; i < users.size(); i++) {
+      if (users[i].id == fromId) {
+        return (int) i;
+      }
+    }
+
+    return -1;
+  }
+
+} // namespace Gateway
+
+//=====[Implementations of private functions]====================================
+
+/**
+* @brief Unit name of the first letter sent in frames, as the monitor bot writes it.
+*/
+static const char *unitName(char unit)
+{
+  if (unit == 'B') {
+    return "BAR";
+  } else if (unit == 'P') {
+    return "PSI";
+  }
+
+  return "Unknown";
+}
+
+/**
+* @brief Alert text of a tank state.
+*/
+static const char *alertText(uint8_t state)
+{
+  if (state == TANK_LEVEL_LOW) {
+    return ALERT_TANK_EMPTY;
+  }
+
+  return (state == TANK_LEVEL_OK) ? ALERT_TANK_OK : ALERT_TANK_UNKNOWN;
+}
@@ -0,0 +1,181 @@
+/****************************************************************************//**
+ * @file fleet_bot.h
+ * @author Gonzalo Puy.
+ * @date Jun 2025
+ * @brief Fleet bot header file.
+ *
+ * Single Telegram bot of the gateway, in place of one bot per monitor. It
+ * answers /status for the whole fleet or for one monitor by ID, and tells
+ * the users about every monitor whose tank changes state. Replies and alerts
+ * use the texts of the monitor bot (telegram_bot_lib.h).
+ *******************************************************************************/
+
+#ifndef FLEET_BOT_H
+#define FLEET_BOT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "bot_api.h"
+#include "fleet_table.h"
+#include "fleet_view.h"
+#include "telegram_bot_lib.h"
+
+//=========================[Module Defines]=====================================
+
+#define FLEET_BOT_POLL_INTERVAL     1000        /**< Time [ms] between two getUpdates. */
+#define FLEET_BOT_SILENCE           (15 * 60)   /**< Time [s] without frames for a monitor to be silent, three heartbeats. */
+#define FLEET_BOT_USERS_MAX         64          /**< Registered users. */
+#define FLEET_BOT_ALERTS_MAX        48          /**< Alerts per message, the rest go in the next one. */
+#define FLEET_BOT_MESSAGE_SIZE      4096        /**< Telegram message limit. */
+
+//===========================[Module Texts]=====================================
+
+/**
+ * @brief Monitor a reply or alert is about.
+ */
+constexpr Util::MessageTemplate<int> FLEET_DEVICE_STR = "[Device %d]\n";
+
+/**
+ * @brief Reply to /status without a monitor ID.
+ */
+constexpr Util::MessageTemplate<int, int, int, int> FLEET_STATUS_STR = "[Fleet Status]"
+                                                                    "\nDevices: %d"
+                                                                    "\nLow: %d"
+                                                                    "\nUnknown: %d"
+                                                                    "\nSilent: %d";
+
+/**
+ * @brief Start of the list of monitors with a low tank, in a fleet /status.
+ */
+const char FLEET_STATUS_LOW_LIST_STR[]                            = "\n\nLow tanks: ";
+
+/**
+ * @brief Monitors with a low tank left out of the list.
+ */
+constexpr Util::MessageTemplate<int> FLEET_STATUS_MORE_STR        = " and %d more";
+
+/**
+ * @brief Error for /status with an ID that never reported.
+ */
+constexpr Util::MessageTemplate<int> FLEET_ERROR_NO_DEVICE_STR    = "[ERROR]\nDevice %d is not reporting.";
+
+/**
+ * @brief Time since the last frame of a silent monitor.
+ */
+constexpr Util::MessageTemplate<int> FLEET_SILENT_STR             = "\n\n(no telemetry for %d min)";
+
+//===========================[Module Types]=====================================
+
+/**
+ * @struct fleet_bot_counters_t
+ * @brief Activity of the fleet bot.
+ */
+typedef struct fleet_bot_counters {
+  uint32_t polls;             /**< getUpdates sent. */
+  uint32_t pollFailures;      /**< getUpdates not answered. */
+  uint32_t messages;          /**< Messages received. */
+  uint32_t alertMessages;     /**< Alert messages sent, one per user. */
+  uint32_t sendFailures;      /**< sendMessage not answered. */
+} fleet_bot_counters_t;
+
+namespace Gateway {
+
+  /**
+  * @class FleetBot
+  * @brief Telegram bot multiplexing the monitors of the fleet.
+  *
+  * Runs from the gateway loop: update() polls Telegram and sends the alerts
+  * queued by notifyState(). Only the latest state of a monitor is worth
+  * telling, so a change back to what the users were told last drops the
+  * queued one, as the monitor AlertQueue does.
+  */
+  class FleetBot {
+
+  public:
+
+    /**
+    * @brief Constructor.
+    * @param api Bot API access.
+    * @param fleet Monitors read by /status.
+    */
+    FleetBot(BotApi &api, FleetView &fleet);
+
+    /**
+    * @brief Polls for new messages and sends the queued alerts when due.
+    * @param now Gateway time [ms].
+    */
+    void update(uint64_t now);
+
+    /**
+    * @brief Queues an alert for a monitor whose tank changed state.
+    * @param deviceId Monitor ID.
+    * @param state New tank_state_t.
+    */
+    void notifyState(uint16_t deviceId, uint8_t state);
+
+    /**
+    * @brief Handles a message and sends the reply.
+    * @param fromId Telegram user ID, also the chat ID.
+    * @param fromName First name of the user.
+    * @param text Text of the message.
+    * @param now Gateway time [ms].
+    */
+    void handleMessage(const std::string &fromId, const std::string &fromName, const std::string &text, uint64_t now);
+
+    /**
+    * @brief Checks if alerts are waiting to be sent.
+    */
+    bool hasPendingAlerts() const { return !pendingDevices.empty(); }
+
+    size_t getUserCount() const { return users.size(); }
+
+    const fleet_bot_counters_t &getCounters() const { return counters; }
+
+  private:
+
+    /**
+    * @struct user_t
+    * @brief Registered user.
+    */
+    typedef struct user {
+      std::string id;         /**< Telegram user ID. */
+      std::string name;       /**< First name. */
+    } user_t;
+
+    void _poll(uint64_t now);
+
+    void _sendAlerts();
+
+    void _commandStart(const std::string &fromId, const std::string &fromName);
+
+    void _commandEnd(const std::string &fromId, const std::string &fromName);
+
+    void _commandStatus(const char *deviceText, uint64_t now);
+
+    void _writeDeviceStatus(const fleet_entry_t &entry, uint64_t now);
+
+    void _beginReply(const std::string &chatId);
+
+    bool _send();
+
+    int _findUser(const std::string &fromId) const;
+
+    BotApi &api;                                /**< Bot API access. */
+    FleetView &fleet;                           /**< Monitors reported on. */
+    std::vector<user_t> users;                  /**< Registered users. */
+    std::vector<uint8_t> toldStates;            /**< Tank state the users were told last, per device ID. */
+    std::vector<uint8_t> pendingStates;         /**< Tank state waiting to be told, per device ID. */
+    std::vector<uint16_t> pendingDevices;       /**< Device IDs with an alert waiting, in arrival order. */
+    std::string response;                       /**< Last Bot API answer. */
+    Util::TextBuffer<FLEET_BOT_MESSAGE_SIZE * 3> reply;   /**< Form of the message being sent, URL encoding may triple it. */
+    unsigned long long lastUpdateId;            /**< Last update handled. */
+    uint64_t nextPoll;                          /**< Gateway time [ms] of the next getUpdates. */
+    fleet_bot_counters_t counters;              /**< Activity. */
+
+  }; // class FleetBot
+
+} // namespace Gateway
+
+#endif // FLEET_BOT_H
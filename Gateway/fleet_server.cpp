@@ -0,0 +1,607 @@
+/****************************************************************************//**
+ * @file fleet_server.cpp
+ * @author Gonzalo Puy.
+ * @date Jun 2025
+ * @brief Multi-threaded fleet server.
+ *******************************************************************************/
+
+#include <chrono>
+#include <errno.h>
+#include <netinet/in.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <unordered_map>
+#include "fleet_server.h"
+#include "tank_estimator.h"
+
+//=====[Declaration of private defines]==========================================
+
+#define FLEET_SERVER_RECEIVE_BUFFER     (4 << 20)   /**< Socket receive buffer [bytes] of every UDP socket. */
+#define FLEET_SERVER_BATCHES_MAX        64          /**< recvmmsg calls per event, so TCP is served under a flood. */
+#define FLEET_SERVER_EVENTS             64          /**< Events taken per epoll_wait. */
+#define FLEET_SERVER_STREAM_SIZE        4096        /**< Bytes read from a connection per event. */
+#define FLEET_SERVER_IDLE_SPINS         64          /**< Empty passes of a worker before it sleeps. */
+#define FLEET_SERVER_IDLE_SLEEP         50          /**< Sleep [us] of an idle worker, bounds the latency it adds. */
+
+//=====[Declaration of private functions]========================================
+
+static uint64_t steadyNs();
+static void bump(std::atomic<uint64_t> &counter, uint64_t count = 1);
+static int openSocket(int type, uint16_t port, uint16_t &boundPort);
+
+//=====[Implementations of public methods]=======================================
+
+namespace Gateway {
+
+  FleetServer::worker::worker(size_t capacity)
+    : table(capacity)
+    , frames(0)
+    , oldFrames(0)
+    , refusedFrames(0)
+    , stateChanges(0)
+  {
+    for (std::atomic<uint64_t> &bucket : latency) {
+      bucket.store(0, std::memory_order_relaxed);
+    }
+  }
+
+  FleetServer::FleetServer(BotApi &api, const fleet_server_config_t &config)
+    : config(config)
+    , bot(api, *this)
+    , isRunning(false)
+    , stopFd(-1)
+    , udpPort(0)
+    , tcpPort(0)
+    , serial(0)
+    {}
+
+  FleetServer::~FleetServer()
+  {
+    stop();
+  }
+
+  bool FleetServer::start()
+  {
+    if ((config.ioThreads == 0) || (config.workers == 0) || !threads.empty()) {
+      return false;
+    }
+
+    const size_t shardCapacity = (config.capacity + config.workers - 1) / config.workers;
+
+    for (size_t w = 0; w < config.workers; w++) {
+      workers.emplace_back(new worker_t(shardCapacity));
+    }
+    for (size_t io = 0; io < config.ioThreads; io++) {
+      ioCounters.emplace_back(new io_counters_t());
+      for (size_t w = 0; w < config.workers; w++) {
+        items.emplace_back(new item_queue_t());
+      }
+    }
+
+    stopFd = eventfd(0, EFD_NONBLOCK);
+    if (stopFd < 0) {
+      stop();
+      return false;
+    }
+
+    for (size_t io = 0; io < config.ioThreads; io++) {
+      if (!_openSockets(io)) {
+        stop();
+        return false;
+      }
+    }
+
+    isRunning.store(true);
+    for (size_t io = 0; io < config.ioThreads; io++) {
+      threads.emplace_back(&FleetServer::_runIo, this, io);
+    }
+    for (size_t w = 0; w < config.workers; w++) {
+      threads.emplace_back(&FleetServer::_runWorker, this, w);
+    }
+
+    return true;
+  }
+
+  void FleetServer::stop()
+  {
+    isRunning.store(false);
+    if (stopFd >= 0) {
+      eventfd_write(stopFd, 1);
+    }
+
+    for (std::thread &thread : threads) {
+      thread.join();
+    }
+    threads.clear();
+
+    for (int fd : udpFds) {
+      close(fd);
+    }
+    for (int fd : tcpFds) {
+      close(fd);
+    }
+    udpFds.clear();
+    tcpFds.clear();
+
+    if (stopFd >= 0) {
+      close(stopFd);
+      stopFd = -1;
+    }
+  }
+
+  void FleetServer::update(uint64_t now, int timeout)
+  {
+    size_t changes = 0;
+    alert_t alert;
+
+    for (std::unique_ptr<worker_t> &worker : workers) {
+      while (worker->alerts.pop(alert)) {
+        bot.notifyState(alert.deviceId, alert.state);
+        changes++;
+      }
+    }
+
+    bot.update(now);
+
+    if ((changes == 0) && (timeout > 0)) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(timeout));
+    }
+  }
+
+  bool FleetServer::getEntry(uint16_t deviceId, fleet_entry_t &entry)
+  {
+    const query_t query = { ++serial, deviceId, 0, 0 };
+    answer_t answer;
+
+    if (!_ask(deviceId % config.workers, query, answer) || !answer.isFound) {
+      return false;
+    }
+
+    entry = answer.entry;
+    return true;
+  }
+
+  void FleetServer::getSummary(uint32_t now, uint32_t silence, fleet_summary_t &summary)
+  {
+    answer_t answer;
+
+    memset(&summary, 0, sizeof(summary));
+
+    for (size_t w = 0; w < workers.size(); w++) {
+      const query_t query = { ++serial, -1, now, silence };
+
+      // A shard that does not answer is left out rather than holding up the bot.
+      if (!_ask(w, query, answer)) {
+        continue;
+      }
+
+      summary.devices += answer.summary.devices;
+      summary.silent += answer.summary.silent;
+      for (int state = TANK_LEVEL_OK; state <= TANK_LEVEL_UNKNOWN; state++) {
+        summary.stateCount[state] += answer.summary.stateCount[state];
+      }
+      for (uint32_t i = 0; (i < answer.summary.lowListed) && (summary.lowListed < FLEET_VIEW_LIST_MAX); i++) {
+        summary.lowIds[summary.lowListed++] = answer.summary.lowIds[i];
+      }
+    }
+  }
+
+  uint32_t FleetServer::getLatencyPercentile(double percentile) const
+  {
+    uint64_t counts[FLEET_SERVER_LATENCY_BUCKETS] = { 0 };
+    uint64_t total = 0;
+    uint64_t seen = 0;
+
+    for (const std::unique_ptr<worker_t> &worker : workers) {
+      for (size_t bucket = 0; bucket < FLEET_SERVER_LATENCY_BUCKETS; bucket++) {
+        counts[bucket] += worker->latency[bucket].load(std::memory_order_relaxed);
+      }
+    }
+    for (uint64_t count : counts) {
+      total += count;
+    }
+
+    const uint64_t target = (uint64_t) ((double) total * percentile / 100.0 + 0.5);
+
+    for (size_t bucket = 0; bucket < FLEET_SERVER_LATENCY_BUCKETS; bucket++) {
+      seen += counts[bucket];
+      if ((seen >= target) && (seen > 0)) {
+        return (uint32_t) (bucket + 1);
+      }
+    }
+
+    return 0;
+  }
+
+  fleet_server_counters_t FleetServer::getCounters() const
+  {
+    fleet_server_counters_t counters;
+
+    memset(&counters, 0, sizeof(counters));
+
+    for (const std::unique_ptr<worker_t> &worker : workers) {
+      counters.frames += worker->frames.load(std::memory_order_relaxed);
+      counters.oldFrames += worker->oldFrames.load(std::memory_order_relaxed);
+      counters.refusedFrames += worker->refusedFrames.load(std::memory_order_relaxed);
+      counters.stateChanges += worker->stateChanges.load(std::memory_order_relaxed);
+    }
+    for (const std::unique_ptr<io_counters_t> &io : ioCounters) {
+      counters.badFrames += io->badFrames.load(std::memory_order_relaxed);
+      counters.droppedFrames += io->droppedFrames.load(std::memory_order_relaxed);
+      counters.connections += io->connections.load(std::memory_order_relaxed);
+    }
+
+    return counters;
+  }
+
+//=====[Implementations of private methods]======================================
+
+  /**
+  * @brief Opens the UDP socket and the TCP listener of an I/O thread. The first
+  *        thread binds the configured ports, the others join the ports it got.
+  * @param io I/O thread.
+  * @return true if both are open, false otherwise.
+  */
+  bool FleetServer::_openSockets(size_t io)
+  {
+    const int udpFd = openSocket(SOCK_DGRAM, (io == 0) ? config.udpPort : udpPort, udpPort);
+    if (udpFd < 0) {
+      return false;
+    }
+    udpFds.push_back(udpFd);
+
+    const int tcpFd = openSocket(SOCK_STREAM, (io == 0) ? config.tcpPort : tcpPort, tcpPort);
+    if (tcpFd < 0) {
+      return false;
+    }
+    tcpFds.push_back(tcpFd);
+
+    return true;
+  }
+
+  /**
+  * @brief Event loop of an I/O thread: datagrams, new connections and lines.
+  * @param io I/O thread.
+  */
+  void FleetServer::_runIo(size_t io)
+  {
+    std::unordered_map<int, connection_t> connections;
+    struct epoll_event events[FLEET_SERVER_EVENTS];
+    struct epoll_event event;
+    const int epollFd = epoll_create1(0);
+
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    for (int fd : { udpFds[io], tcpFds[io], stopFd }) {
+      event.data.fd = fd;
+      epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event);
+    }
+
+    while (isRunning.load(std::memory_order_relaxed)) {
+      const int count = epoll_wait(epollFd, events, FLEET_SERVER_EVENTS, -1);
+
+      for (int i = 0; i < count; i++) {
+        const int fd = events[i].data.fd;
+
+        if (fd == udpFds[io]) {
+          _receiveDatagrams(io);
+        } else if (fd == tcpFds[io]) {
+          const int connectionFd = accept4(fd, nullptr, nullptr, SOCK_NONBLOCK);
+
+          if (connectionFd >= 0) {
+            event.data.fd = connectionFd;
+            epoll_ctl(epollFd, EPOLL_CTL_ADD, connectionFd, &event);
+            connections[connectionFd] = connection_t();
+            bump(ioCounters[io]->connections);
+          }
+        } else if ((fd != stopFd) && !_receiveStream(io, fd, connections[fd])) {
+          epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+          close(fd);
+          connections.erase(fd);
+        }
+      }
+    }
+
+    for (auto &connection : connections) {
+      close(connection.first);
+    }
+    close(epollFd);
+  }
+
+  /**
+  * @brief Reads the pending datagrams in batches and queues their frames.
+  * @param io I/O thread.
+  */
+  void FleetServer::_receiveDatagrams(size_t io)
+  {
+    char buffers[FLEET_SERVER_BATCH_SIZE][FLEET_SERVER_FRAME_SIZE];
+    struct mmsghdr messages[FLEET_SERVER_BATCH_SIZE];
+    struct iovec vectors[FLEET_SERVER_BATCH_SIZE];
+
+    for (int batch = 0; batch < FLEET_SERVER_BATCHES_MAX; batch++) {
+      memset(messages, 0, sizeof(messages));
+      for (int i = 0; i < FLEET_SERVER_BATCH_SIZE; i++) {
+        vectors[i].iov_base = buffers[i];
+        vectors[i].iov_len = FLEET_SERVER_FRAME_SIZE - 1;
+        messages[i].msg_hdr.msg_iov = &vectors[i];
+        messages[i].msg_hdr.msg_iovlen = 1;
+      }
+
+      const int received = recvmmsg(udpFds[io], messages, FLEET_SERVER_BATCH_SIZE, MSG_DONTWAIT, nullptr);
+      if (received <= 0) {
+        return;
+      }
+
+      const uint64_t now = steadyNs();
+
+      for (int i = 0; i < received; i++) {
+        if (messages[i].msg_hdr.msg_flags & MSG_TRUNC) {
+          bump(ioCounters[io]->badFrames);
+          continue;
+        }
+        buffers[i][messages[i].msg_len] = '\0';
+        _push(io, buffers[i], now);
+      }
+    }
+  }
+
+  /**
+  * @brief Reads from a connection and queues the frames of the lines completed.
+  * @param io I/O thread.
+  * @param fd Connection.
+  * @param connection Line being received.
+  * @return false once the connection is closed, true otherwise.
+  */
+  bool FleetServer::_receiveStream(size_t io, int fd, connection_t &connection)
+  {
+    char buffer[FLEET_SERVER_STREAM_SIZE];
+    const ssize_t length = read(fd, buffer, sizeof(buffer));
+
+    if (length == 0) {
+      return false;
+    } else if (length < 0) {
+      return (errno == EAGAIN) || (errno == EINTR);
+    }
+
+    const uint64_t now = steadyNs();
+
+    for (ssize_t i = 0; i < length; i++) {
+      const char received = buffer[i];
+
+      if (received == '\n') {
+        if (connection.isOverflow) {
+          bump(ioCounters[io]->badFrames);
+        } else {
+          connection.line[connection.length] = '\0';
+          _push(io, connection.line, now);
+        }
+        connection.length = 0;
+        connection.isOverflow = false;
+      } else if (received == '\r') {
+        continue;
+      } else if (connection.length < (FLEET_SERVER_FRAME_SIZE - 1)) {
+        connection.line[connection.length++] = received;
+      } else {
+        connection.isOverflow = true;
+      }
+    }
+
+    return true;
+  }
+
+  /**
+  * @brief Parses a frame and queues it to the worker of its monitor. Like the
+  *        socket buffers, a full queue sheds the frame rather than stalling.
+  * @param io I/O thread.
+  * @param text Frame, null terminated.
+  * @param received Steady clock [ns] when read.
+  */
+  void FleetServer::_push(size_t io, const char *text, uint64_t received)
+  {
+    item_t item;
+
+    if (!Module::TelemetryFrame::parse(text, item.frame)) {
+      bump(ioCounters[io]->badFrames);
+      return;
+    }
+
+    item.received = received;
+    if (!items[io * config.workers + (item.frame.deviceId % config.workers)]->push(item)) {
+      bump(ioCounters[io]->droppedFrames);
+    }
+  }
+
+  /**
+  * @brief Worker loop: takes the frames queued by every I/O thread in turn and
+  *        answers the bot between passes.
+  * @param index Worker.
+  */
+  void FleetServer::_runWorker(size_t index)
+  {
+    worker_t &worker = *workers[index];
+    size_t idlePasses = 0;
+    item_t item;
+
+    while (isRunning.load(std::memory_order_relaxed)) {
+      size_t taken = 0;
+
+      for (size_t io = 0; io < config.ioThreads; io++) {
+        item_queue_t &queue = *items[io * config.workers + index];
+
+        for (size_t i = 0; (i < FLEET_SERVER_BATCH_SIZE) && queue.pop(item); i++) {
+          _evaluate(worker, item);
+          taken++;
+        }
+      }
+
+      _answer(worker);
+
+      if (taken > 0) {
+        idlePasses = 0;
+      } else if (++idlePasses < FLEET_SERVER_IDLE_SPINS) {
+        std::this_thread::yield();
+      } else {
+        std::this_thread::sleep_for(std::chrono::microseconds(FLEET_SERVER_IDLE_SLEEP));
+      }
+    }
+  }
+
+  /**
+  * @brief Evaluates the tank state of a frame with the monitor thresholds,
+  *        applies it to the shard and queues the state change to the bot.
+  * @param worker Worker of the monitor.
+  * @param item Frame.
+  */
+  void FleetServer::_evaluate(worker_t &worker, const item_t &item)
+  {
+    telemetry_frame_t frame = item.frame;
+    uint8_t previousState;
+
+    // The state sent is only taken as is when the unit is unknown.
+    if ((frame.unit == 'B') || (frame.unit == 'P')) {
+      frame.state = Module::TankEstimator::getState(frame.pressureCenti / 100.0f,
+                                                    (frame.unit == 'B') ? TANK_UNIT_BAR : TANK_UNIT_PSI);
+    }
+
+    switch (worker.table.update(frame, (uint32_t) (item.received / 1000000000ULL), previousState)) {
+      case FLEET_UPDATE_NEW:
+      case FLEET_UPDATE_CHANGED:
+      case FLEET_UPDATE_SAME: {
+        // New monitors start as OK, so a new one that is low is told right away.
+        const alert_t alert = { frame.deviceId, worker.table.find(frame.deviceId)->state };
+
+        bump(worker.frames);
+        if (alert.state != previousState) {
+          bump(worker.stateChanges);
+          // Alerts are never shed, the worker waits for the bot instead.
+          while (!worker.alerts.push(alert) && isRunning.load(std::memory_order_relaxed)) {
+            std::this_thread::yield();
+          }
+        }
+        break;
+      }
+      case FLEET_UPDATE_OLD:
+        bump(worker.oldFrames);
+        break;
+      case FLEET_UPDATE_FULL:
+        bump(worker.refusedFrames);
+        break;
+    }
+
+    const uint64_t elapsed = (steadyNs() - item.received) / 1000;
+
+    bump(worker.latency[(elapsed < FLEET_SERVER_LATENCY_BUCKETS) ? elapsed : (FLEET_SERVER_LATENCY_BUCKETS - 1)]);
+  }
+
+  /**
+  * @brief Answers the queries of the bot from the shard of a worker.
+  * @param worker Worker.
+  */
+  void FleetServer::_answer(worker_t &worker)
+  {
+    query_t query;
+    answer_t answer;
+
+    while (worker.queries.pop(query)) {
+      answer.serial = query.serial;
+      if (query.deviceId >= 0) {
+        answer.isFound = worker.table.getEntry((uint16_t) query.deviceId, answer.entry);
+      } else {
+        worker.table.getSummary(query.now, query.silence, answer.summary);
+      }
+      worker.answers.push(answer);
+    }
+  }
+
+  /**
+  * @brief Asks a worker and waits for its answer, bot thread only.
+  * @param index Worker.
+  * @param query Query, with a new serial.
+  * @param answer Output: the answer.
+  * @return true if answered in time, false otherwise.
+  */
+  bool FleetServer::_ask(size_t index, const query_t &query, answer_t &answer)
+  {
+    worker_t &worker = *workers[index];
+    const uint64_t deadline = steadyNs() + (uint64_t) FLEET_SERVER_QUERY_TIMEOUT * 1000000ULL;
+
+    if (!isRunning.load(std::memory_order_relaxed) || !worker.queries.push(query)) {
+      return false;
+    }
+
+    while (steadyNs() < deadline) {
+      if (!worker.answers.pop(answer)) {
+        std::this_thread::yield();
+      } else if (answer.serial == query.serial) {
+        return true;
+      }
+    }
+
+    return false;
+  }
+
+} // namespace Gateway
+
+//=====[Implementations of private functions]====================================
+
+/**
+* @brief Monotonic time [ns], the clock of the gateway.
+*/
+static uint64_t steadyNs()
+{
+  return (uint64_t) std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+* @brief Adds to a counter written by a single thread, and read by any.
+*/
+static void bump(std::atomic<uint64_t> &counter, uint64_t count)
+{
+  counter.store(counter.load(std::memory_order_relaxed) + count, std::memory_order_relaxed);
+}
+
+/**
+* @brief Opens a nonblocking socket on a port shared with the other I/O threads.
+* @param type SOCK_DGRAM or SOCK_STREAM.
+* @param port Port, 0 for any free one.
+* @param boundPort Output: port bound.
+* @return int Socket, -1 on error.
+*/
+static int openSocket(int type, uint16_t port, uint16_t &boundPort)
+{
+  const int enable = 1;
+  const int receiveBuffer = FLEET_SERVER_RECEIVE_BUFFER;
+  struct sockaddr_in address;
+  socklen_t addressLength = sizeof(address);
+  const int fd = socket(AF_INET, type | SOCK_NONBLOCK, 0);
+
+  if (fd < 0) {
+    return -1;
+  }
+
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+  setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &enable, sizeof(enable));
+  if (type == SOCK_DGRAM) {
+    // Capped by net.core.rmem_max, which is fine.
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &receiveBuffer, sizeof(receiveBuffer));
+  }
+
+  memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_ANY);
+  address.sin_port = htons(port);
+
+  if ((bind(fd, (const struct sockaddr *) &address, sizeof(address)) != 0) ||
+      ((type == SOCK_STREAM) && (listen(fd, SOMAXCONN) != 0)) ||
+      (getsockname(fd, (struct sockaddr *) &address, &addressLength) != 0)) {
+    close(fd);
+    return -1;
+  }
+
+  boundPort = ntohs(address.sin_port);
+  return fd;
+}
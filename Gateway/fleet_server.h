@@ -0,0 +1,259 @@
+/****************************************************************************//**
+ * @file fleet_server.h
+ * @author Gonzalo Puy.
+ * @date Jun 2025
+ * @brief Multi-threaded fleet server header file.
+ *
+ * Gateway for fleets too big for the single loop of the aggregator. I/O
+ * threads each run an epoll loop over their own UDP socket and TCP listener,
+ * sharing the ports through SO_REUSEPORT, and parse the frames. Workers each
+ * own the monitors of a shard of the device IDs, and evaluate the tank state
+ * of every frame as the monitor would. The fleet bot runs on the thread that
+ * calls update(). Threads only talk through SPSC queues:
+ *
+ *   I/O thread i --frames--> worker w      one queue per (i, w) pair
+ *   worker w --state changes--> bot
+ *   bot --queries--> worker w --answers--> bot, for /status
+ *******************************************************************************/
+
+#ifndef FLEET_SERVER_H
+#define FLEET_SERVER_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "bot_api.h"
+#include "fleet_bot.h"
+#include "fleet_table.h"
+#include "fleet_view.h"
+#include "spsc_queue.h"
+#include "telemetry_frame.h"
+
+//=========================[Module Defines]=====================================
+
+#define FLEET_SERVER_FRAME_SIZE         128     /**< Longest datagram or line taken as a frame. */
+#define FLEET_SERVER_BATCH_SIZE         64      /**< Datagrams read per system call, frames taken per queue and pass. */
+#define FLEET_SERVER_QUEUE_SIZE         4096    /**< Frames queued from an I/O thread to a worker. */
+#define FLEET_SERVER_ALERT_QUEUE_SIZE   16384   /**< State changes queued from a worker to the bot. */
+#define FLEET_SERVER_QUERY_QUEUE_SIZE   4       /**< Queries queued from the bot to a worker, one at a time is used. */
+#define FLEET_SERVER_LATENCY_BUCKETS    4096    /**< Evaluation latency buckets of 1 us, the last one takes the rest. */
+#define FLEET_SERVER_QUERY_TIMEOUT      100     /**< Longest wait [ms] of the bot for a worker. */
+
+//===========================[Module Types]=====================================
+
+/**
+ * @struct fleet_server_config_t
+ * @brief Ports and threads of the fleet server.
+ */
+typedef struct fleet_server_config {
+  uint16_t udpPort;           /**< UDP port of the frames, 0 for any free one. */
+  uint16_t tcpPort;           /**< TCP port of the frames, one per line, 0 for any free one. */
+  size_t ioThreads;           /**< I/O threads, one per core serving the network. */
+  size_t workers;             /**< Worker threads, one per shard. */
+  size_t capacity;            /**< Monitors tracked at most, split evenly between the shards. */
+} fleet_server_config_t;
+
+/**
+ * @struct fleet_server_counters_t
+ * @brief Frames received by the fleet server, summed over its threads.
+ */
+typedef struct fleet_server_counters {
+  uint64_t frames;            /**< Frames applied to the shards. */
+  uint64_t badFrames;         /**< Datagrams or lines that are not a frame. */
+  uint64_t oldFrames;         /**< Repeated or out of order frames. */
+  uint64_t refusedFrames;     /**< Frames of new monitors with the shard full. */
+  uint64_t droppedFrames;     /**< Frames dropped with the queue to the worker full. */
+  uint64_t stateChanges;      /**< Tank state changes, new monitors not low included. */
+  uint64_t connections;       /**< TCP connections accepted. */
+} fleet_server_counters_t;
+
+namespace Gateway {
+
+  /**
+  * @class FleetServer
+  * @brief Gateway sharded over threads, serving the fleet bot as a FleetView.
+  */
+  class FleetServer : public FleetView {
+
+  public:
+
+    /**
+    * @brief Constructor, no thread runs until start().
+    * @param api Bot API access of the fleet bot.
+    * @param config Ports and threads.
+    */
+    FleetServer(BotApi &api, const fleet_server_config_t &config);
+
+    ~FleetServer();
+    FleetServer(const FleetServer&) = delete;
+    FleetServer& operator=(const FleetServer&) = delete;
+
+    /**
+    * @brief Opens the sockets and starts the I/O threads and the workers.
+    * @return true if running, false otherwise.
+    */
+    bool start();
+
+    /**
+    * @brief Stops and joins every thread, then closes the sockets.
+    */
+    void stop();
+
+    /**
+    * @brief Ports the frames are received on, once started.
+    */
+    uint16_t getUdpPort() const { return udpPort; }
+
+    uint16_t getTcpPort() const { return tcpPort; }
+
+    /**
+    * @brief Hands the state changes to the fleet bot and runs it. Waits up to a
+    *        timeout when there were none.
+    * @param now Gateway time [ms], from the steady clock as the frames are.
+    * @param timeout Time [ms] to wait when idle.
+    */
+    void update(uint64_t now, int timeout);
+
+    bool getEntry(uint16_t deviceId, fleet_entry_t &entry) override;
+
+    void getSummary(uint32_t now, uint32_t silence, fleet_summary_t &summary) override;
+
+    /**
+    * @brief Evaluation latency, from the frame read off the socket to its tank
+    *        state evaluated in the worker.
+    * @param percentile Percentile, from 0 to 100.
+    * @return uint32_t Latency [us] under which that share of the frames was evaluated.
+    */
+    uint32_t getLatencyPercentile(double percentile) const;
+
+    /**
+    * @brief Gets the activity so far, summed over the threads.
+    */
+    fleet_server_counters_t getCounters() const;
+
+    FleetBot &getBot() { return bot; }
+
+    const FleetBot &getBot() const { return bot; }
+
+  private:
+
+    /**
+    * @struct item_t
+    * @brief Frame on its way from an I/O thread to a worker.
+    */
+    typedef struct item {
+      telemetry_frame_t frame;    /**< Parsed frame. */
+      uint64_t received;          /**< Steady clock [ns] when read off the socket. */
+    } item_t;
+
+    /**
+    * @struct alert_t
+    * @brief State change on its way from a worker to the bot.
+    */
+    typedef struct alert {
+      uint16_t deviceId;          /**< Monitor ID. */
+      uint8_t state;              /**< New tank_state_t. */
+    } alert_t;
+
+    /**
+    * @struct query_t
+    * @brief Request of the bot to a worker.
+    */
+    typedef struct query {
+      uint32_t serial;            /**< Matches the answer, late answers are dropped. */
+      int32_t deviceId;           /**< Monitor asked for, -1 for a summary of the shard. */
+      uint32_t now;               /**< Gateway time [s], for a summary. */
+      uint32_t silence;           /**< Silence [s], for a summary. */
+    } query_t;
+
+    /**
+    * @struct answer_t
+    * @brief Answer of a worker to the bot.
+    */
+    typedef struct answer {
+      uint32_t serial;            /**< Serial of the query. */
+      bool isFound;               /**< The monitor asked for reported. */
+      fleet_entry_t entry;        /**< Its entry. */
+      fleet_summary_t summary;    /**< Summary of the shard. */
+    } answer_t;
+
+    /**
+    * @struct io_counters_t
+    * @brief Activity of an I/O thread, written by it alone.
+    */
+    typedef struct io_counters {
+      std::atomic<uint64_t> badFrames;
+      std::atomic<uint64_t> droppedFrames;
+      std::atomic<uint64_t> connections;
+    } io_counters_t;
+
+    /**
+    * @struct connection_t
+    * @brief TCP connection of an I/O thread, with the line being received.
+    */
+    typedef struct connection {
+      char line[FLEET_SERVER_FRAME_SIZE];     /**< Line so far. */
+      size_t length;                          /**< Length of line. */
+      bool isOverflow;                        /**< The line is too long, skipped up to its end. */
+    } connection_t;
+
+    /**
+    * @struct worker_t
+    * @brief Shard of the fleet and its queues to and from the bot.
+    */
+    typedef struct worker {
+      explicit worker(size_t capacity);
+
+      FleetTable table;                                           /**< Monitors of the shard. */
+      SpscQueue<alert_t, FLEET_SERVER_ALERT_QUEUE_SIZE> alerts;   /**< State changes to the bot. */
+      SpscQueue<query_t, FLEET_SERVER_QUERY_QUEUE_SIZE> queries;  /**< Queries from the bot. */
+      SpscQueue<answer_t, FLEET_SERVER_QUERY_QUEUE_SIZE> answers; /**< Answers to the bot. */
+      std::atomic<uint64_t> frames;
+      std::atomic<uint64_t> oldFrames;
+      std::atomic<uint64_t> refusedFrames;
+      std::atomic<uint64_t> stateChanges;
+      std::atomic<uint64_t> latency[FLEET_SERVER_LATENCY_BUCKETS];  /**< Frames per evaluation latency [us]. */
+    } worker_t;
+
+    typedef SpscQueue<item_t, FLEET_SERVER_QUEUE_SIZE> item_queue_t;
+
+    bool _openSockets(size_t io);
+
+    void _runIo(size_t io);
+
+    void _receiveDatagrams(size_t io);
+
+    bool _receiveStream(size_t io, int fd, connection_t &connection);
+
+    void _runWorker(size_t index);
+
+    void _push(size_t io, const char *text, uint64_t received);
+
+    void _evaluate(worker_t &worker, const item_t &item);
+
+    void _answer(worker_t &worker);
+
+    bool _ask(size_t index, const query_t &query, answer_t &answer);
+
+    fleet_server_config_t config;                       /**< Ports and threads. */
+    FleetBot bot;                                       /**< Telegram bot of the fleet. */
+    std::vector<std::unique_ptr<worker_t>> workers;     /**< Shards, by device ID modulo their count. */
+    std::vector<std::unique_ptr<item_queue_t>> items;   /**< Frame queues, io * workers + worker. */
+    std::vector<std::unique_ptr<io_counters_t>> ioCounters;  /**< Activity of every I/O thread. */
+    std::vector<int> udpFds;                            /**< UDP socket of every I/O thread. */
+    std::vector<int> tcpFds;                            /**< TCP listener of every I/O thread. */
+    std::vector<std::thread> threads;                   /**< I/O threads, then workers. */
+    std::atomic<bool> isRunning;                        /**< Cleared to stop the threads. */
+    int stopFd;                                         /**< eventfd waking the epoll loops to stop. */
+    uint16_t udpPort;                                   /**< UDP port, 0 until started. */
+    uint16_t tcpPort;                                   /**< TCP port, 0 until started. */
+    uint32_t serial;                                    /**< Serial of the last query. */
+
+  }; // class FleetServer
+
+} // namespace Gateway
+
+#endif // FLEET_SERVER_H
@@ -0,0 +1,140 @@
+/****************************************************************************//**
+ * @file fleet_table.cpp
+ * @author Gonzalo Puy.
+ * @date Jun 2025
+ * @brief Fleet table.
+ *******************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include "fleet_table.h"
+
+//=====[Declaration of private defines]==========================================
+
+#define FLEET_TABLE_ALIGNMENT   64      /**< Cache line size. */
+
+//=====[Implementations of public methods]=======================================
+
+namespace Gateway {
+
+  FleetTable::FleetTable(size_t capacity)
+    : count(0)
+  {
+    // Slots are 16 bits and 0 stands for no entry.
+    this->capacity = (capacity < FLEET_DEVICE_ID_COUNT) ? capacity : (FLEET_DEVICE_ID_COUNT - 1);
+
+    const size_t bytes = this->capacity * sizeof(fleet_entry_t);
+    const size_t alignedBytes = (bytes + FLEET_TABLE_ALIGNMENT - 1) & ~((size_t) FLEET_TABLE_ALIGNMENT - 1);
+
+    entries = (fleet_entry_t *) aligned_alloc(FLEET_TABLE_ALIGNMENT, (alignedBytes > 0) ? alignedBytes : FLEET_TABLE_ALIGNMENT);
+    slots = (uint16_t *) calloc(FLEET_DEVICE_ID_COUNT, sizeof(uint16_t));
+
+    if ((entries == nullptr) || (slots == nullptr)) {
+      abort();
+    }
+
+    memset(stateCount, 0, sizeof(stateCount));
+  }
+
+  FleetTable::~FleetTable()
+  {
+    free(entries);
+    free(slots);
+  }
+
+  fleet_update_t FleetTable::update(const telemetry_frame_t &frame, uint32_t now, uint8_t &previousState)
+  {
+    const uint8_t state = (frame.state > TANK_LEVEL_UNKNOWN) ? (uint8_t) TANK_LEVEL_UNKNOWN : frame.state;
+    const uint16_t slot = slots[frame.deviceId];
+    fleet_entry_t *entry;
+    fleet_update_t result;
+
+    if (slot == 0) {
+      if (count == capacity) {
+        return FLEET_UPDATE_FULL;
+      }
+
+      entry = &entries[count];
+      memset(entry, 0, sizeof(fleet_entry_t));
+      entry->deviceId = frame.deviceId;
+      entry->state = TANK_LEVEL_OK;
+      slots[frame.deviceId] = (uint16_t) (++count);
+      stateCount[TANK_LEVEL_OK]++;
+      result = FLEET_UPDATE_NEW;
+    } else {
+      entry = &entries[slot - 1];
+
+      const int32_t gap = (int32_t) (frame.sequence - entry->sequence);
+      const bool isRestart = (frame.sequence < FLEET_SEQUENCE_RESTART) && (entry->sequence >= FLEET_SEQUENCE_RESTART);
+
+      if ((gap <= 0) && !isRestart) {
+        return FLEET_UPDATE_OLD;
+      }
+
+      entry->lostFrames += isRestart ? 0 : (uint32_t) (gap - 1);
+      result = (state != entry->state) ? FLEET_UPDATE_CHANGED : FLEET_UPDATE_SAME;
+    }
+
+    previousState = entry->state;
+    stateCount[entry->state]--;
+    stateCount[state]++;
+
+    entry->sequence = frame.sequence;
+    entry->lastSeen = now;
+    entry->pressureCenti = frame.pressureCenti;
+    entry->gasFlowCenti = frame.gasFlowCenti;
+    entry->timeLeft = frame.timeLeft;
+    entry->state = state;
+    entry->unit = frame.unit;
+    entry->tankRegistered = frame.tankRegistered;
+
+    return result;
+  }
+
+  const fleet_entry_t *FleetTable::find(uint16_t deviceId) const
+  {
+    const uint16_t slot = slots[deviceId];
+
+    return (slot == 0) ? nullptr : &entries[slot - 1];
+  }
+
+  size_t FleetTable::getSilentCount(uint32_t now, uint32_t silence) const
+  {
+    size_t silent = 0;
+
+    for (size_t i = 0; i < count; i++) {
+      silent += ((now - entries[i].lastSeen) > silence) ? 1 : 0;
+    }
+
+    return silent;
+  }
+
+  bool FleetTable::getEntry(uint16_t deviceId, fleet_entry_t &entry)
+  {
+    const fleet_entry_t *found = find(deviceId);
+
+    if (found != nullptr) {
+      entry = *found;
+    }
+
+    return (found != nullptr);
+  }
+
+  void FleetTable::getSummary(uint32_t now, uint32_t silence, fleet_summary_t &summary)
+  {
+    summary.devices = (uint32_t) count;
+    summary.silent = (uint32_t) getSilentCount(now, silence);
+    summary.lowListed = 0;
+
+    for (int state = TANK_LEVEL_OK; state <= TANK_LEVEL_UNKNOWN; state++) {
+      summary.stateCount[state] = (uint32_t) stateCount[state];
+    }
+
+    for (size_t i = 0; (i < count) && (summary.lowListed < FLEET_VIEW_LIST_MAX); i++) {
+      if (entries[i].state == TANK_LEVEL_LOW) {
+        summary.lowIds[summary.lowListed++] = entries[i].deviceId;
+      }
+    }
+  }
+
+} // namespace Gateway
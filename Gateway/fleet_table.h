@@ -0,0 +1,146 @@
+/****************************************************************************//**
+ * @file fleet_table.h
+ * @author Gonzalo Puy.
+ * @date Jun 2025
+ * @brief Fleet table header file.
+ *
+ * Latest telemetry of every monitor behind the gateway, updated from the
+ * frames as they arrive and read by the fleet bot.
+ *******************************************************************************/
+
+#ifndef FLEET_TABLE_H
+#define FLEET_TABLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "fleet_view.h"
+#include "tank_types.h"
+#include "telemetry_frame.h"
+
+//=========================[Module Defines]=====================================
+
+#define FLEET_TABLE_CAPACITY        4096    /**< Monitors tracked by default. */
+#define FLEET_DEVICE_ID_COUNT       65536   /**< Device IDs are 16 bits. */
+#define FLEET_SEQUENCE_RESTART      4       /**< A sequence this low after a higher one means the monitor restarted. */
+
+//===========================[Module Types]=====================================
+
+/**
+ * @enum fleet_update_t
+ * @brief Outcome of a frame applied to the table.
+ */
+typedef enum fleet_update {
+  FLEET_UPDATE_NEW = 0,     /**< First frame of the monitor. */
+  FLEET_UPDATE_CHANGED,     /**< The tank state changed. */
+  FLEET_UPDATE_SAME,        /**< Same tank state, values refreshed. */
+  FLEET_UPDATE_OLD,         /**< Repeated or out of order frame, ignored. */
+  FLEET_UPDATE_FULL         /**< New monitor with the table full, ignored. */
+} fleet_update_t;
+
+/**
+ * @struct fleet_entry_t
+ * @brief Latest telemetry of a monitor. Half a cache line, so an update
+ *        touches a single line. Values stay fixed point, as in the frame.
+ */
+typedef struct fleet_entry {
+  uint32_t sequence;        /**< Sequence of the last frame applied. */
+  uint32_t lastSeen;        /**< Gateway time [s] of the last frame applied. */
+  uint32_t lostFrames;      /**< Frames missing from the sequence. */
+  int32_t pressureCenti;    /**< Pressure x 100, in the unit below. */
+  int32_t gasFlowCenti;     /**< Gas flow x 100 [L/min]. */
+  int32_t timeLeft;         /**< Minutes until the tank goes low when last seen, -1 if unknown. */
+  uint16_t deviceId;        /**< Monitor ID. */
+  uint8_t state;            /**< tank_state_t of the monitor. */
+  char unit;                /**< First letter of the pressure unit: B, P or U. */
+  bool tankRegistered;      /**< Indicates whether a tank has been registered. */
+  uint8_t reserved[3];      /**< Pads the entry to 32 bytes. */
+} fleet_entry_t;
+
+static_assert(sizeof(fleet_entry_t) == 32, "fleet_entry_t must stay half a cache line");
+
+namespace Gateway {
+
+  /**
+  * @class FleetTable
+  * @brief Fixed capacity table of monitors, in order of arrival.
+  *
+  * Entries are packed in a single 64 byte aligned array, found through a
+  * direct map from device ID to slot, so an update is a lookup and a store
+  * with no hashing or allocation. Scans for /status walk the array in order.
+  * Counts per tank state are kept as frames arrive. Not thread safe: a table
+  * is read and written by a single thread.
+  */
+  class FleetTable : public FleetView {
+
+  public:
+
+    /**
+    * @brief Constructs an empty table.
+    * @param capacity Monitors tracked at most.
+    */
+    explicit FleetTable(size_t capacity = FLEET_TABLE_CAPACITY);
+
+    ~FleetTable();
+    FleetTable(const FleetTable&) = delete;
+    FleetTable& operator=(const FleetTable&) = delete;
+
+    /**
+    * @brief Applies a frame.
+    * @param frame Frame received.
+    * @param now Gateway time [s].
+    * @param previousState Output: tank state before the frame, TANK_LEVEL_OK for a new monitor.
+    * @return fleet_update_t What the frame changed.
+    */
+    fleet_update_t update(const telemetry_frame_t &frame, uint32_t now, uint8_t &previousState);
+
+    /**
+    * @brief Finds a monitor.
+    * @param deviceId Monitor ID.
+    * @return const fleet_entry_t* Its entry, nullptr if it never reported.
+    */
+    const fleet_entry_t *find(uint16_t deviceId) const;
+
+    /**
+    * @brief Entry at a slot, slots go from 0 to size() - 1 in order of arrival.
+    */
+    const fleet_entry_t &at(size_t slot) const { return entries[slot]; }
+
+    /**
+    * @brief Number of monitors that reported.
+    */
+    size_t size() const { return count; }
+
+    /**
+    * @brief Number of monitors the table can track.
+    */
+    size_t getCapacity() const { return capacity; }
+
+    /**
+    * @brief Number of monitors in a tank state.
+    */
+    size_t getStateCount(tank_state_t state) const { return stateCount[state]; }
+
+    /**
+    * @brief Number of monitors not heard of for a while.
+    * @param now Gateway time [s].
+    * @param silence Time [s] without a frame for a monitor to count.
+    */
+    size_t getSilentCount(uint32_t now, uint32_t silence) const;
+
+    bool getEntry(uint16_t deviceId, fleet_entry_t &entry) override;
+
+    void getSummary(uint32_t now, uint32_t silence, fleet_summary_t &summary) override;
+
+  private:
+
+    fleet_entry_t *entries;                   /**< Entries in order of arrival. */
+    uint16_t *slots;                          /**< Slot + 1 of every device ID, 0 if it never reported. */
+    size_t capacity;                          /**< Length of entries. */
+    size_t count;                             /**< Entries in use. */
+    size_t stateCount[TANK_LEVEL_UNKNOWN + 1];  /**< Entries per tank state. */
+
+  }; // class FleetTable
+
+} // namespace Gateway
+
+#endif // FLEET_TABLE_H
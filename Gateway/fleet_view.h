@@ -0,0 +1,67 @@
+/****************************************************************************//**
+ * @file fleet_view.h
+ * @author Gonzalo Puy.
+ * @date Jun 2025
+ * @brief Read access to the fleet, for the fleet bot.
+ *******************************************************************************/
+
+#ifndef FLEET_VIEW_H
+#define FLEET_VIEW_H
+
+#include <stdint.h>
+#include "tank_types.h"
+
+//=========================[Module Defines]=====================================
+
+#define FLEET_VIEW_LIST_MAX     20      /**< Monitors with a low tank listed in a summary. */
+
+//===========================[Module Types]=====================================
+
+struct fleet_entry;
+
+/**
+ * @struct fleet_summary_t
+ * @brief State of the whole fleet.
+ */
+typedef struct fleet_summary {
+  uint32_t devices;                                 /**< Monitors that reported. */
+  uint32_t stateCount[TANK_LEVEL_UNKNOWN + 1];      /**< Monitors per tank state. */
+  uint32_t silent;                                  /**< Monitors not heard of for a while. */
+  uint32_t lowListed;                               /**< Length of lowIds. */
+  uint16_t lowIds[FLEET_VIEW_LIST_MAX];             /**< Some of the monitors with a low tank. */
+} fleet_summary_t;
+
+namespace Gateway {
+
+  /**
+  * @class FleetView
+  * @brief Latest state of the monitors, wherever it is kept: a single table, or
+  *        tables owned by other threads.
+  */
+  class FleetView {
+
+  public:
+
+    virtual ~FleetView() = default;
+
+    /**
+    * @brief Copies the entry of a monitor.
+    * @param deviceId Monitor ID.
+    * @param entry Output: its entry.
+    * @return true if the monitor reported, false otherwise.
+    */
+    virtual bool getEntry(uint16_t deviceId, struct fleet_entry &entry) = 0;
+
+    /**
+    * @brief Summarizes the fleet.
+    * @param now Gateway time [s].
+    * @param silence Time [s] without a frame for a monitor to be silent.
+    * @param summary Output: the summary.
+    */
+    virtual void getSummary(uint32_t now, uint32_t silence, fleet_summary_t &summary) = 0;
+
+  }; // class FleetView
+
+} // namespace Gateway
+
+#endif // FLEET_VIEW_H
@@ -0,0 +1,186 @@
+/****************************************************************************//**
+ * @file gateway_main.cpp
+ * @author Gonzalo Puy.
+ * @date Jun 2025
+ * @brief Gateway service: one Telegram bot for every monitor in gateway mode.
+ *
+ * Build from the repository root, with ArduinoJson next to the sources:
+ *   g++ -std=c++14 -O2 -IGateway -Iarduinojson/src -ISrc/Utils -ISrc/oxygen_monitor/Modules/Telegram_bot \
+ *       -ISrc/oxygen_monitor/Modules/tank_monitor -ISrc/oxygen_monitor/Modules/telemetry \
+ *       -pthread Gateway/aggregator.cpp Gateway/fleet_bot.cpp Gateway/fleet_server.cpp Gateway/fleet_table.cpp \
+ *       Gateway/http_bot_api.cpp Gateway/gateway_main.cpp Src/oxygen_monitor/Modules/telemetry/telemetry_frame.cpp \
+ *       Src/oxygen_monitor/Modules/tank_monitor/tank_estimator.cpp \
+ *       Src/oxygen_monitor/Modules/tank_monitor/tank_catalogue.cpp Src/Utils/crc.cpp \
+ *       Src/Utils/text_writer.cpp -o o2_gateway
+ *
+ * Run next to a local Bot API server (telegram-bot-api --local), which
+ * serves plain HTTP on port 8081:
+ *   O2_BOT_TOKEN=<token> ./o2_gateway --port 5005 --api 127.0.0.1:8081
+ *
+ * With --threads N the frames are taken by the fleet server instead, with N
+ * I/O threads and N workers, over UDP and over TCP on the same port number.
+ *******************************************************************************/
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include "aggregator.h"
+#include "fleet_server.h"
+#include "http_bot_api.h"
+#include "telemetry_frame.h"
+
+//=====[Declaration of private defines]==========================================
+
+#define GATEWAY_API_DEFAULT         "127.0.0.1:8081"
+#define GATEWAY_WAIT_TIME           100         /**< Longest wait [ms] for frames before the bot runs. */
+#define GATEWAY_SERVER_WAIT_TIME    10          /**< Longest wait [ms] of the bot for state changes, with the fleet server. */
+#define GATEWAY_REPORT_INTERVAL     60000       /**< Time [ms] between two activity reports. */
+
+//=====[Declaration of private functions]========================================
+
+static uint64_t gatewayTime();
+static void report(const Gateway::Aggregator &aggregator);
+static void report(Gateway::FleetServer &server);
+static int runServer(Gateway::BotApi &botApi, int port, int capacity, int threads, const std::string &api);
+
+//=====[Main function]==========================================================
+
+int main(int argc, char **argv)
+{
+  const char *token = getenv("O2_BOT_TOKEN");
+  std::string api = GATEWAY_API_DEFAULT;
+  int port = TELEMETRY_GATEWAY_PORT;
+  int capacity = FLEET_TABLE_CAPACITY;
+  int threads = 0;
+
+  for (int i = 1; (i + 1) < argc; i += 2) {
+    if (strcmp(argv[i], "--port") == 0) {
+      port = atoi(argv[i + 1]);
+    } else if (strcmp(argv[i], "--api") == 0) {
+      api = argv[i + 1];
+    } else if (strcmp(argv[i], "--capacity") == 0) {
+      capacity = atoi(argv[i + 1]);
+    } else if (strcmp(argv[i], "--threads") == 0) {
+      threads = atoi(argv[i + 1]);
+    } else if (strcmp(argv[i], "--token") == 0) {
+      token = argv[i + 1];
+    }
+  }
+
+  const size_t colon = api.find(':');
+
+  if ((token == nullptr) || (colon == std::string::npos) || (capacity <= 0) || (threads < 0)) {
+    fprintf(stderr, "Usage: O2_BOT_TOKEN=<token> o2_gateway [--port %d] [--api %s] [--capacity %d] [--threads 0]\n",
+            TELEMETRY_GATEWAY_PORT, GATEWAY_API_DEFAULT, FLEET_TABLE_CAPACITY);
+    return 2;
+  }
+
+  Gateway::HttpBotApi botApi(api.substr(0, colon), (uint16_t) atoi(api.c_str() + colon + 1), token);
+
+  if (threads > 0) {
+    return runServer(botApi, port, capacity, threads, api);
+  }
+
+  Gateway::Aggregator aggregator(botApi, (size_t) capacity);
+
+  if (!aggregator.open((uint16_t) port)) {
+    perror("o2_gateway: UDP port");
+    return 1;
+  }
+
+  printf("o2_gateway: frames on UDP %u, Bot API at %s, %zu monitors at most\n", aggregator.getPort(), api.c_str(),
+         aggregator.getTable().getCapacity());
+
+  uint64_t nextReport = gatewayTime() + GATEWAY_REPORT_INTERVAL;
+
+  for (;;) {
+    aggregator.update(gatewayTime(), GATEWAY_WAIT_TIME);
+
+    if (gatewayTime() >= nextReport) {
+      nextReport += GATEWAY_REPORT_INTERVAL;
+      report(aggregator);
+    }
+  }
+}
+
+//=====[Implementations of private functions]====================================
+
+/**
+* @brief Monotonic gateway time [ms].
+*/
+static uint64_t gatewayTime()
+{
+  return (uint64_t) std::chrono::duration_cast<std::chrono::milliseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+* @brief Runs the fleet server until killed.
+* @return int Exit code, only on error.
+*/
+static int runServer(Gateway::BotApi &botApi, int port, int capacity, int threads, const std::string &api)
+{
+  const fleet_server_config_t config = { (uint16_t) port, (uint16_t) port, (size_t) threads, (size_t) threads,
+                                         (size_t) capacity };
+  Gateway::FleetServer server(botApi, config);
+
+  if (!server.start()) {
+    perror("o2_gateway: UDP or TCP port");
+    return 1;
+  }
+
+  printf("o2_gateway: frames on UDP %u and TCP %u, Bot API at %s, %d threads\n", server.getUdpPort(),
+         server.getTcpPort(), api.c_str(), threads);
+
+  uint64_t nextReport = gatewayTime() + GATEWAY_REPORT_INTERVAL;
+
+  for (;;) {
+    server.update(gatewayTime(), GATEWAY_SERVER_WAIT_TIME);
+
+    if (gatewayTime() >= nextReport) {
+      nextReport += GATEWAY_REPORT_INTERVAL;
+      report(server);
+    }
+  }
+}
+
+/**
+* @brief Prints the activity so far.
+*/
+static void report(const Gateway::Aggregator &aggregator)
+{
+  const aggregator_counters_t &frames = aggregator.getCounters();
+  const fleet_bot_counters_t &bot = aggregator.getBot().getCounters();
+  const Gateway::FleetTable &table = aggregator.getTable();
+
+  printf("o2_gateway: %zu monitors (%zu low, %zu unknown), frames %llu, bad %llu, old %llu, refused %llu, "
+         "messages %u, alerts %u, poll failures %u, send failures %u\n",
+         table.size(), table.getStateCount(TANK_LEVEL_LOW), table.getStateCount(TANK_LEVEL_UNKNOWN),
+         (unsigned long long) frames.frames, (unsigned long long) frames.badFrames,
+         (unsigned long long) frames.oldFrames, (unsigned long long) frames.refusedFrames,
+         bot.messages, bot.alertMessages, bot.pollFailures, bot.sendFailures);
+  fflush(stdout);
+}
+
+/**
+* @brief Prints the activity of the fleet server so far.
+*/
+static void report(Gateway::FleetServer &server)
+{
+  const fleet_server_counters_t frames = server.getCounters();
+  const fleet_bot_counters_t &bot = server.getBot().getCounters();
+  fleet_summary_t summary;
+
+  server.getSummary((uint32_t) (gatewayTime() / 1000), FLEET_BOT_SILENCE, summary);
+
+  printf("o2_gateway: %u monitors (%u low, %u unknown), frames %llu, bad %llu, old %llu, refused %llu, dropped %llu, "
+         "connections %llu, p99 evaluation %u us, messages %u, alerts %u, poll failures %u, send failures %u\n",
+         summary.devices, summary.stateCount[TANK_LEVEL_LOW], summary.stateCount[TANK_LEVEL_UNKNOWN],
+         (unsigned long long) frames.frames, (unsigned long long) frames.badFrames,
+         (unsigned long long) frames.oldFrames, (unsigned long long) frames.refusedFrames,
+         (unsigned long long) frames.droppedFrames, (unsigned long long) frames.connections,
+         server.getLatencyPercentile(99), bot.messages, bot.alertMessages, bot.pollFailures, bot.sendFailures);
+  fflush(stdout);
+}
@@ -0,0 +1,151 @@
+/****************************************************************************//**
+ * @file http_bot_api.cpp
+ * @author Gonzalo Puy.
+ * @date Jun 2025
+ * @brief Bot API over plain HTTP.
+ *******************************************************************************/
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include "http_bot_api.h"
+
+//=====[Declaration of private functions]========================================
+
+static bool decodeChunked(const std::string &body, std::string &decoded);
+
+//=====[Implementations of public methods]=======================================
+
+namespace Gateway {
+
+  HttpBotApi::HttpBotApi(const std::string &host, uint16_t port, const std::string &token)
+    : host(host)
+    , port(port)
+    , token(token)
+    {}
+
+  bool HttpBotApi::call(const char *method, const std::string &form, std::string &response)
+  {
+    const int socketFd = _connect();
+
+    response.clear();
+    if (socketFd < 0) {
+      return false;
+    }
+
+    const std::string request = "POST /bot" + token + "/" + method + " HTTP/1.1\r\n"
+                                "Host: " + host + "\r\n"
+                                "Content-Type: application/x-www-form-urlencoded\r\n"
+                                "Content-Length: " + std::to_string(form.length()) + "\r\n"
+                                "Connection: close\r\n\r\n" + form;
+    size_t sent = 0;
+
+    while (sent < request.length()) {
+      const ssize_t written = send(socketFd, request.data() + sent, request.length() - sent, MSG_NOSIGNAL);
+      if (written <= 0) {
+        close(socketFd);
+        return false;
+      }
+      sent += (size_t) written;
+    }
+
+    // The server closes the connection once the answer is out.
+    std::string answer;
+    char buffer[4096];
+    ssize_t received;
+
+    while ((received = recv(socketFd, buffer, sizeof(buffer), 0)) > 0) {
+      answer.append(buffer, (size_t) received);
+    }
+    close(socketFd);
+
+    const size_t headerEnd = answer.find("\r\n\r\n");
+    if ((received < 0) || (headerEnd == std::string::npos) || (answer.compare(0, 9, "HTTP/1.1 ") != 0)) {
+      return false;
+    }
+
+    const std::string header = answer.substr(0, headerEnd);
+    const std::string body = answer.substr(headerEnd + 4);
+
+    if (header.find("Transfer-Encoding: chunked") != std::string::npos) {
+      if (!decodeChunked(body, response)) {
+        return false;
+      }
+    } else {
+      response = body;
+    }
+
+    return (atoi(answer.c_str() + 9) == 200);
+  }
+
+//=====[Implementations of private methods]======================================
+
+  /**
+  * @brief Opens a connection to the server, with the timeouts set.
+  * @return int Socket, -1 on failure.
+  */
+  int HttpBotApi::_connect()
+  {
+    const int socketFd = socket(AF_INET, SOCK_STREAM, 0);
+    const struct timeval timeout = { HTTP_BOT_API_TIMEOUT_MS / 1000, (HTTP_BOT_API_TIMEOUT_MS % 1000) * 1000 };
+    struct sockaddr_in address;
+
+    if (socketFd < 0) {
+      return -1;
+    }
+
+    // Also bounds connect() on Linux.
+    setsockopt(socketFd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(socketFd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+
+    if ((inet_pton(AF_INET, host.c_str(), &address.sin_addr) != 1) ||
+        (connect(socketFd, (const struct sockaddr *) &address, sizeof(address)) != 0)) {
+      close(socketFd);
+      return -1;
+    }
+
+    return socketFd;
+  }
+
+} // namespace Gateway
+
+//=====[Implementations of private functions]====================================
+
+/**
+* @brief Joins the chunks of a chunked body.
+* @param body Chunked body.
+* @param decoded Output: body.
+* @return true if the body ends with the last chunk, false otherwise.
+*/
+static bool decodeChunked(const std::string &body, std::string &decoded)
+{
+  size_t cursor = 0;
+
+  decoded.clear();
+
+  for (;;) {
+    const size_t lineEnd = body.find("\r\n", cursor);
+    if (lineEnd == std::string::npos) {
+      return false;
+    }
+
+    const size_t length = strtoul(body.c_str() + cursor, nullptr, 16);
+    if (length == 0) {
+      return true;
+    }
+    if ((lineEnd + 2 + length) > body.length()) {
+      return false;
+    }
+
+    decoded.append(body, lineEnd + 2, length);
+    cursor = lineEnd + 2 + length + 2;
+  }
+}
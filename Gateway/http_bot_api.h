@@ -0,0 +1,55 @@
+/****************************************************************************//**
+ * @file http_bot_api.h
+ * @author Gonzalo Puy.
+ * @date Jun 2025
+ * @brief Bot API over plain HTTP header file.
+ *
+ * Talks to a local Bot API server (telegram-bot-api, which serves plain HTTP
+ * on localhost) or to a TLS proxy in front of api.telegram.org, so the
+ * gateway needs no TLS library of its own.
+ *******************************************************************************/
+
+#ifndef HTTP_BOT_API_H
+#define HTTP_BOT_API_H
+
+#include <stdint.h>
+#include <string>
+#include "bot_api.h"
+
+//=========================[Module Defines]=====================================
+
+#define HTTP_BOT_API_TIMEOUT_MS     5000    /**< Connect, send and receive timeout. */
+
+namespace Gateway {
+
+  /**
+  * @class HttpBotApi
+  * @brief Bot API calls as HTTP/1.1 POST requests, one connection each.
+  */
+  class HttpBotApi : public BotApi {
+
+  public:
+
+    /**
+    * @brief Constructor.
+    * @param host IPv4 address of the Bot API server.
+    * @param port Port of the Bot API server.
+    * @param token Bot token.
+    */
+    HttpBotApi(const std::string &host, uint16_t port, const std::string &token);
+
+    bool call(const char *method, const std::string &form, std::string &response) override;
+
+  private:
+
+    int _connect();
+
+    const std::string host;     /**< IPv4 address of the Bot API server. */
+    const uint16_t port;        /**< Port of the Bot API server. */
+    const std::string token;    /**< Bot token. */
+
+  }; // class HttpBotApi
+
+} // namespace Gateway
+
+#endif // HTTP_BOT_API_H
@@ -0,0 +1,113 @@
+/****************************************************************************//**
+ * @file spsc_queue.h
+ * @author Gonzalo Puy.
+ * @date Jun 2025
+ * @brief Lock-free single producer, single consumer queue.
+ *
+ * Hands items from one thread to another without locks or system calls. The
+ * producer and the consumer each own one index and keep a copy of the other
+ * one, read again only when the queue looks full or empty, so in steady state
+ * neither side touches the cache line the other one writes.
+ *******************************************************************************/
+
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <atomic>
+#include <stddef.h>
+
+//=========================[Module Defines]=====================================
+
+#define SPSC_QUEUE_LINE     64      /**< Cache line size. */
+
+namespace Gateway {
+
+  /**
+  * @class SpscQueue
+  * @brief Bounded ring of N items, N a power of two.
+  *
+  * push() may only be called from one thread and pop() from one other thread.
+  * Items are copied in and out, so they should be small and trivially copyable.
+  */
+  template<typename T, size_t N>
+  class SpscQueue {
+
+    static_assert((N >= 2) && ((N & (N - 1)) == 0), "SpscQueue size must be a power of two");
+
+  public:
+
+    SpscQueue()
+      : head(0)
+      , cachedTail(0)
+      , tail(0)
+      , cachedHead(0)
+      {}
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    /**
+    * @brief Adds an item, producer thread only.
+    * @return true if added, false if the queue is full.
+    */
+    bool push(const T &item)
+    {
+      const size_t position = head.load(std::memory_order_relaxed);
+
+      if ((position - cachedTail) == N) {
+        cachedTail = tail.load(std::memory_order_acquire);
+        if ((position - cachedTail) == N) {
+          return false;
+        }
+      }
+
+      items[position & (N - 1)] = item;
+      head.store(position + 1, std::memory_order_release);
+      return true;
+    }
+
+    /**
+    * @brief Takes the oldest item, consumer thread only.
+    * @return true if taken, false if the queue is empty.
+    */
+    bool pop(T &item)
+    {
+      const size_t position = tail.load(std::memory_order_relaxed);
+
+      if (position == cachedHead) {
+        cachedHead = head.load(std::memory_order_acquire);
+        if (position == cachedHead) {
+          return false;
+        }
+      }
+
+      item = items[position & (N - 1)];
+      tail.store(position + 1, std::memory_order_release);
+      return true;
+    }
+
+    /**
+    * @brief Items in the queue, exact only from the consumer thread.
+    */
+    size_t size() const
+    {
+      return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+    }
+
+  private:
+
+    // Padding rather than alignas, so no over-aligned new is needed before C++17.
+    char padStart[SPSC_QUEUE_LINE];
+    std::atomic<size_t> head;       /**< Next position written, owned by the producer. */
+    size_t cachedTail;              /**< Last tail seen by the producer. */
+    char padProducer[SPSC_QUEUE_LINE - sizeof(std::atomic<size_t>) - sizeof(size_t)];
+    std::atomic<size_t> tail;       /**< Next position read, owned by the consumer. */
+    size_t cachedHead;              /**< Last head seen by the consumer. */
+    char padConsumer[SPSC_QUEUE_LINE - sizeof(std::atomic<size_t>) - sizeof(size_t)];
+    T items[N];                     /**< Ring of items. */
+
+  }; // class SpscQueue
+
+} // namespace Gateway
+
+#endif // SPSC_QUEUE_H
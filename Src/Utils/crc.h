@@ -0,0 +1,42 @@
+/*!****************************************************************************
+ * @file crc.h
+ * @brief Declaration of CRC-32 used to validate records stored in flash
+ * @author Gonzalo Puy
+ * @date Jun 2025
+ *******************************************************************************/
+
+#ifndef CRC_H
+#define CRC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace Util {
+
+    class Crc32
+    {
+        public:
+
+            /**
+            * @brief Compute the CRC-32 (IEEE 802.3) of a buffer.
+            *
+            * Table driven by nibbles, so it only needs a 64 byte table.
+            *
+            * @param data Buffer.
+            * @param size Buffer size in bytes.
+            * @param crc Result of a previous call, to continue over several buffers.
+            * @return CRC-32 of the data.
+            */
+            static uint32_t Compute(const void* data, size_t size, uint32_t crc = 0);
+
+        private:
+
+            Crc32() {};
+            ~Crc32() = default;
+            Crc32(const Crc32&) = delete;
+            Crc32& operator=(const Crc32&) = delete;
+    };
+
+} // namespace Util
+
+#endif // CRC_H
@@ -46,6 +46,14 @@ void Delay::Start(tick_t durationValue )
    mDuration = durationValue;
 }
 
+//-----------------------------------------------------------------------------
+void Delay::Restart(tick_t durationValue)
+{
+   mDuration = durationValue;
+   mStartTime = Tick::GetTickCounter();
+   mIsRunning = true;
+}
+
 //----static-------------------------------------------------------------------
 void Tick::Init() 
 {
@@ -11,8 +11,11 @@
 #include "mbed.h"
 
 #define DELAY_5_MINUTES         300000
-#define DELAY_10_SECONDS        10000
+#define DELAY_1_MINUTE          60000
+#define DELAY_20_SECONDS        20000
 #define DELAY_15_SECONDS        15000
+#define DELAY_10_SECONDS        10000
+#define DELAY_8_SECONDS         8000
 #define DELAY_5_SECONDS         5000
 #define DELAY_4_SECONDS         4000
 #define DELAY_3_SECONDS         3000
@@ -39,13 +42,19 @@ namespace Util {
             */
             void Start(tick_t duration);
 
+            /**
+            * @brief Start the delay now with a new duration.
+            * @param duration The new duration for the delay.
+            */
+            void Restart(tick_t duration);
+
             /**
             * @brief Constructor for Delay class.
             * @param duration Initial duration for the delay.
             */
             Delay(tick_t duration) 
-                : mDuration(duration) 
-                , mStartTime(0)
+                : mStartTime(0)
+                , mDuration(duration) 
                 , mIsRunning(false)
                 {}
             
@@ -0,0 +1,48 @@
+/*!****************************************************************************
+ * @file log_messages.h
+ * @brief Catalogue of log messages. Format strings live here and records only
+ *        carry their ID.
+ * @author Gonzalo Puy
+ * @date Jun 2025
+ *******************************************************************************/
+
+#ifndef LOG_MESSAGES_H
+#define LOG_MESSAGES_H
+
+/**
+ * @brief Log message catalogue.
+ *
+ * Each entry is X(name, (argument types), format). Supported conversions are
+ * the ones of Util::MessageTemplate: %d (int), %.Nf (float) and %s (const char*).
+ * Strings are copied into the record, truncated to LOG_MAX_STRING_LENGTH.
+ */
+#define LOG_MESSAGES(X) \
+    X(LOG_DROPPED,                  (int),                      "Log - [%d] records dropped") \
+    X(INIT_TICK,                    (),                         "Init TICK") \
+    X(INIT_WIFI_COM,                (),                         "Init WifiCom") \
+    X(INIT_TELEGRAM_BOT,            (),                         "Init Telegram BOT") \
+    X(INIT_TANK_MONITOR,            (),                         "Init TankMonitor") \
+    X(INIT_TELEMETRY,               (int),                      "Init Telemetry - Device [%d]") \
+    X(INIT_CONFIG_STORE,            (),                         "Init ConfigStore") \
+    X(CONFIG_STORE_RESTORED,        (int),                      "ConfigStore - Restored record [%d]") \
+    X(CONFIG_STORE_WRITE_ERROR,     (),                         "ConfigStore - Write: [ERROR]") \
+    X(PRESSURE_GAUGE_READ,          (float),                    "PressureGauge - Analog read: [%.2f]") \
+    X(TANK_MONITOR_READING,         (float),                    "TankMonitor - Last reading: [%.2f]") \
+    X(TANK_MONITOR_THRESHOLD,       (),                         "TankMonitor - Threshold crossed, reading now") \
+    X(TANK_CATALOGUE_LOADED,        (int),                      "TankMonitor - Flash catalogue: [%d] types") \
+    X(TANK_CATALOGUE_INVALID,       (),                         "TankMonitor - Flash catalogue: [INVALID], using built-in") \
+    X(WIFI_COM_CONNECTION_ERROR,    (),                         "WifiCom - Conection: [ERROR]") \
+    X(WIFI_COM_CONNECTION_OK,       (),                         "WifiCom - Conection: [OK]") \
+    X(WIFI_COM_LINK_LOST,           (),                         "WifiCom - Link: [LOST], reconnecting") \
+    X(WIFI_COM_LINK_DOWN,           (int),                      "WifiCom - Link: [DOWN], reason [%d]") \
+    X(WIFI_COM_BAUD_RATE,           (int, int),                 "WifiCom - UART: [%d] baud, flow control [%d]") \
+    X(WIFI_COM_BAUD_FALLBACK,       (int),                      "WifiCom - UART: no answer at [%d] baud, back to the base rate") \
+    X(WIFI_COM_ENDPOINTS_LOST,      (),                         "WifiCom - Endpoints lost by the module, registering again") \
+    X(WIFI_COM_BODY_TRUNCATED,      (int),                      "WifiCom - Response body truncated to [%d] bytes") \
+    X(WIFI_COM_IP_CHANGED,          (const char*),              "WifiCom - IP changed: [%s]") \
+    X(WIFI_COM_UPDATE_DROPPED,      (int),                      "WifiCom - Pushed update dropped, [%d] not read yet") \
+    X(WIFI_COM_FRAME_DROPPED,       (int),                      "WifiCom - Frame longer than [%d] bytes dropped") \
+    X(TELEGRAM_BOT_WEBHOOK_ERROR,   (),                         "TelegramBot - setWebhook: [ERROR]") \
+    X(TELEGRAM_BOT_MESSAGE,         (const char*, const char*), "TelegramBot - Message received: [%s] from %s")
+
+#endif // LOG_MESSAGES_H
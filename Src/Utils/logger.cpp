@@ -0,0 +1,247 @@
+/*!****************************************************************************
+ * @file logger.cpp
+ * @brief Implementation of deferred, leveled, binary logging module
+ * @author Gonzalo Puy
+ * @date Jun 2025
+ *******************************************************************************/
+
+#include "logger.h"
+
+#include <cstdio>
+#include "delay.h"
+#include "mbed.h"
+
+namespace Util {
+
+//=====[Declaration and initialization of private global variables]============
+
+#define LOG_MESSAGE_FORMAT(name, types, format) format,
+static const char* const LOG_FORMATS[LOG_ID_COUNT] = {
+    LOG_MESSAGES(LOG_MESSAGE_FORMAT)
+};
+#undef LOG_MESSAGE_FORMAT
+
+static const char LOG_LEVEL_CHARS[] = { '-', 'E', 'W', 'I', 'D' };
+
+static const size_t LOG_LINE_SIZE = 160;
+
+static_assert((LOG_BUFFER_SIZE & (LOG_BUFFER_SIZE - 1)) == 0, "LOG_BUFFER_SIZE must be a power of two");
+
+constexpr log_level_t Log::mCompileLevels[LOG_MODULE_COUNT];
+
+log_level_t Log::mLevels[LOG_MODULE_COUNT] = {
+    LOG_COMPILE_LEVEL_SYSTEM,
+    LOG_COMPILE_LEVEL_PRESSURE_GAUGE,
+    LOG_COMPILE_LEVEL_TANK_MONITOR,
+    LOG_COMPILE_LEVEL_WIFI_COM,
+    LOG_COMPILE_LEVEL_TELEGRAM_BOT
+};
+
+uint8_t  Log::mBuffer[LOG_BUFFER_SIZE];
+uint32_t Log::mHead = 0;
+uint32_t Log::mTail = 0;
+uint32_t Log::mDropped = 0;
+
+//=====[Implementations of public methods]=====================================
+
+//----static-------------------------------------------------------------------
+void Log::SetLevel(log_module_t module, log_level_t level)
+{
+    if (module < LOG_MODULE_COUNT)
+    {
+        mLevels[module] = level;
+    }
+}
+
+//----static-------------------------------------------------------------------
+void Log::Drain(size_t maxRecords)
+{
+    uint8_t record[LOG_MAX_RECORD_SIZE];
+    TextBuffer<LOG_LINE_SIZE> line;
+
+    if (mDropped != 0)
+    {
+        core_util_critical_section_enter();
+        const int dropped = (int) mDropped;
+        mDropped = 0;
+        core_util_critical_section_exit();
+
+        LOG_WARN(LOG_MODULE_SYSTEM, LOG_LOG_DROPPED, dropped);
+    }
+
+    while (maxRecords-- > 0)
+    {
+        const size_t length = _Pop(record);
+
+        if (length == 0) break;
+
+        line.Clear();
+        _Expand(line, record, length);
+        fwrite(line.c_str(), 1, line.Length(), stdout);
+    }
+}
+
+//=====[Implementations of private methods]====================================
+
+//----static-------------------------------------------------------------------
+size_t Log::_EncodeHeader(uint8_t* record, log_module_t module, log_level_t level, log_message_id_t id)
+{
+    const uint32_t timestamp = (uint32_t) Tick::GetTickCounter();
+
+    record[1] = (uint8_t) ((level << 4) | module);
+    record[2] = (uint8_t) id;
+    record[3] = (uint8_t) (id >> 8);
+    memcpy(&record[4], &timestamp, sizeof(timestamp));
+
+    return LOG_HEADER_SIZE;
+}
+
+//----static-------------------------------------------------------------------
+void Log::_Encode(uint8_t* record, size_t& length, int value)
+{
+    const int32_t raw = value;
+    memcpy(&record[length], &raw, sizeof(raw));
+    length += sizeof(raw);
+}
+
+//----static-------------------------------------------------------------------
+void Log::_Encode(uint8_t* record, size_t& length, float value)
+{
+    memcpy(&record[length], &value, sizeof(value));
+    length += sizeof(value);
+}
+
+//----static-------------------------------------------------------------------
+void Log::_Encode(uint8_t* record, size_t& length, const char* value)
+{
+    size_t stringLength = strlen(value);
+
+    if (stringLength > LOG_MAX_STRING_LENGTH) stringLength = LOG_MAX_STRING_LENGTH;
+
+    record[length++] = (uint8_t) stringLength;
+    memcpy(&record[length], value, stringLength);
+    length += stringLength;
+}
+
+//----static-------------------------------------------------------------------
+void Log::_Push(const uint8_t* record, size_t length)
+{
+    core_util_critical_section_enter();
+
+    if ((LOG_BUFFER_SIZE - (mHead - mTail)) < length)
+    {
+        mDropped++;
+    }
+    else
+    {
+        mBuffer[mHead++ & (LOG_BUFFER_SIZE - 1)] = (uint8_t) length;
+
+        for (size_t i = 1; i < length; i++)
+        {
+            mBuffer[mHead++ & (LOG_BUFFER_SIZE - 1)] = record[i];
+        }
+    }
+
+    core_util_critical_section_exit();
+}
+
+//----static-------------------------------------------------------------------
+size_t Log::_Pop(uint8_t* record)
+{
+    size_t length = 0;
+
+    core_util_critical_section_enter();
+
+    if (mHead != mTail)
+    {
+        length = mBuffer[mTail & (LOG_BUFFER_SIZE - 1)];
+
+        for (size_t i = 0; i < length; i++)
+        {
+            record[i] = mBuffer[mTail++ & (LOG_BUFFER_SIZE - 1)];
+        }
+    }
+
+    core_util_critical_section_exit();
+
+    return length;
+}
+
+//----static-------------------------------------------------------------------
+void Log::_Expand(TextWriter& line, const uint8_t* record, size_t length)
+{
+    const uint8_t level = record[1] >> 4;
+    const uint16_t id = (uint16_t) (record[2] | (record[3] << 8));
+    uint32_t timestamp;
+    size_t index = LOG_HEADER_SIZE;
+
+    memcpy(&timestamp, &record[4], sizeof(timestamp));
+
+    line.AppendInt((int32_t) timestamp);
+    line.Append(' ');
+    line.Append(LOG_LEVEL_CHARS[(level <= LOG_LEVEL_DEBUG) ? level : LOG_LEVEL_NONE]);
+    line.Append(' ');
+
+    if (id >= LOG_ID_COUNT)
+    {
+        line.Append("Unknown log message\r\n");
+        return;
+    }
+
+    // Arguments are decoded following the conversions of the catalogue format.
+    const char* format = LOG_FORMATS[id];
+
+    while (*format != '\0')
+    {
+        if ((format[0] != '%') || (format[1] == '%'))
+        {
+            if (format[0] == '%') format++;
+            line.Append(*format++);
+            continue;
+        }
+
+        int decimals = 6;
+        format++;
+
+        if (*format == '.')
+        {
+            format++;
+            decimals = 0;
+
+            while ((*format >= '0') && (*format <= '9'))
+            {
+                decimals = (decimals * 10) + (*format++ - '0');
+            }
+        }
+
+        if (*format == 'd' && (index + 4 <= length))
+        {
+            int32_t value;
+            memcpy(&value, &record[index], sizeof(value));
+            index += sizeof(value);
+            line.AppendInt(value);
+        }
+        else if (*format == 'f' && (index + 4 <= length))
+        {
+            float value;
+            memcpy(&value, &record[index], sizeof(value));
+            index += sizeof(value);
+            line.AppendFloat(value, decimals);
+        }
+        else if (*format == 's' && (index < length))
+        {
+            size_t stringLength = record[index++];
+
+            while ((stringLength-- > 0) && (index < length))
+            {
+                line.Append((char) record[index++]);
+            }
+        }
+
+        format++;
+    }
+
+    line.Append("\r\n");
+}
+
+} // namespace Util
@@ -0,0 +1,240 @@
+/*!****************************************************************************
+ * @file logger.h
+ * @brief Declaration of deferred, leveled, binary logging module
+ * @author Gonzalo Puy
+ * @date Jun 2025
+ *******************************************************************************/
+
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "log_messages.h"
+#include "text_writer.h"
+
+/** @brief Size in bytes of the log ring buffer. Must be a power of two. */
+#ifndef LOG_BUFFER_SIZE
+#define LOG_BUFFER_SIZE         1024
+#endif
+
+/** @brief Maximum characters kept from a string argument. */
+#define LOG_MAX_STRING_LENGTH   32
+
+/** @brief Maximum number of arguments of a log message. */
+#define LOG_MAX_ARGUMENTS       3
+
+/** @brief Size of the record header: length, level/module, ID and timestamp. */
+#define LOG_HEADER_SIZE         8
+
+/** @brief Maximum size of a single encoded record. */
+#define LOG_MAX_RECORD_SIZE     (LOG_HEADER_SIZE + (LOG_MAX_ARGUMENTS * (LOG_MAX_STRING_LENGTH + 1)))
+
+/** @brief Default level compiled in for every module. */
+#ifndef LOG_COMPILE_LEVEL
+#define LOG_COMPILE_LEVEL       LOG_LEVEL_INFO
+#endif
+
+/** @brief Per module compile-time levels. Default to LOG_COMPILE_LEVEL. */
+#ifndef LOG_COMPILE_LEVEL_SYSTEM
+#define LOG_COMPILE_LEVEL_SYSTEM            LOG_COMPILE_LEVEL
+#endif
+#ifndef LOG_COMPILE_LEVEL_PRESSURE_GAUGE
+#define LOG_COMPILE_LEVEL_PRESSURE_GAUGE    LOG_COMPILE_LEVEL
+#endif
+#ifndef LOG_COMPILE_LEVEL_TANK_MONITOR
+#define LOG_COMPILE_LEVEL_TANK_MONITOR      LOG_COMPILE_LEVEL
+#endif
+#ifndef LOG_COMPILE_LEVEL_WIFI_COM
+#define LOG_COMPILE_LEVEL_WIFI_COM          LOG_COMPILE_LEVEL
+#endif
+#ifndef LOG_COMPILE_LEVEL_TELEGRAM_BOT
+#define LOG_COMPILE_LEVEL_TELEGRAM_BOT      LOG_COMPILE_LEVEL
+#endif
+
+/**
+ * @enum log_level_t
+ * @brief Log severity levels. A message is kept if its level is lower or equal
+ *        than the module level.
+ */
+typedef enum log_level {
+    LOG_LEVEL_NONE  = 0,    /**< Nothing is logged. */
+    LOG_LEVEL_ERROR = 1,    /**< Errors. */
+    LOG_LEVEL_WARN  = 2,    /**< Recoverable problems. */
+    LOG_LEVEL_INFO  = 3,    /**< Normal operation events. */
+    LOG_LEVEL_DEBUG = 4     /**< Detailed, high rate information. */
+} log_level_t;
+
+/**
+ * @enum log_module_t
+ * @brief Modules with their own log level.
+ */
+typedef enum log_module {
+    LOG_MODULE_SYSTEM = 0,          /**< System and initialization. */
+    LOG_MODULE_PRESSURE_GAUGE,      /**< PressureGauge driver. */
+    LOG_MODULE_TANK_MONITOR,        /**< TankMonitor module. */
+    LOG_MODULE_WIFI_COM,            /**< WifiCom driver. */
+    LOG_MODULE_TELEGRAM_BOT,        /**< TelegramBot module. */
+    LOG_MODULE_COUNT
+} log_module_t;
+
+/**
+ * @enum log_message_id_t
+ * @brief Interned IDs of the log catalogue (see log_messages.h).
+ */
+#define LOG_MESSAGE_ID(name, types, format) LOG_ID_##name,
+typedef enum log_message_id {
+    LOG_MESSAGES(LOG_MESSAGE_ID)
+    LOG_ID_COUNT
+} log_message_id_t;
+#undef LOG_MESSAGE_ID
+
+namespace Util {
+
+    /**
+    * @brief Log message of the catalogue: interned ID bound to its argument types.
+    */
+    template <typename... Args>
+    class LogMessage
+    {
+        public:
+
+            template <size_t N>
+            constexpr LogMessage(log_message_id_t id, const char (&format)[N])
+                : mId(id)
+                , mTemplate(format)
+                {}
+
+            constexpr log_message_id_t Id() const { return mId; }
+
+        private:
+
+            log_message_id_t mId;
+            MessageTemplate<Args...> mTemplate;  /**< Only used to check the format at compile time. */
+    };
+
+    class Log
+    {
+        public:
+
+            /**
+            * @brief Check if a level is compiled in for a module.
+            */
+            static constexpr bool IsCompiledIn(log_module_t module, log_level_t level)
+            {
+                return (level <= mCompileLevels[module]);
+            }
+
+            /**
+            * @brief Check if a level is enabled at runtime for a module.
+            */
+            static bool IsEnabled(log_module_t module, log_level_t level)
+            {
+                return (level <= mLevels[module]);
+            }
+
+            /**
+            * @brief Set the runtime level of a module. Levels above the compile-time
+            *        level of the module have no effect.
+            */
+            static void SetLevel(log_module_t module, log_level_t level);
+
+            /**
+            * @brief Encode a record and push it into the ring buffer.
+            *
+            * Only the ID, level, module, timestamp and raw arguments are stored;
+            * formatting is deferred to Drain(). If there is no room, the record is
+            * dropped and counted.
+            */
+            template <typename... Args>
+            static void Write(log_module_t module, log_level_t level, const LogMessage<Args...>& message,
+                              typename NonDeduced<Args>::type... args)
+            {
+                static_assert(sizeof...(Args) <= LOG_MAX_ARGUMENTS, "Too many arguments for a log message");
+
+                uint8_t record[LOG_MAX_RECORD_SIZE];
+                size_t length = _EncodeHeader(record, module, level, message.Id());
+
+                _EncodeArguments(record, length, args...);
+                _Push(record, length);
+            }
+
+            /**
+            * @brief Expand and print pending records on the console.
+            *
+            * Meant to be called from the superloop when nothing else is pending.
+            *
+            * @param maxRecords Maximum number of records to print in this call.
+            */
+            static void Drain(size_t maxRecords);
+
+        private:
+
+            Log() {};
+            ~Log() = default;
+            Log(const Log&) = delete;
+            Log& operator=(const Log&) = delete;
+
+            static size_t _EncodeHeader(uint8_t* record, log_module_t module, log_level_t level, log_message_id_t id);
+
+            static void _EncodeArguments(uint8_t* record, size_t& length) {}
+
+            template <typename T, typename... Rest>
+            static void _EncodeArguments(uint8_t* record, size_t& length, T arg, Rest... rest)
+            {
+                _Encode(record, length, arg);
+                _EncodeArguments(record, length, rest...);
+            }
+
+            static void _Encode(uint8_t* record, size_t& length, int value);
+            static void _Encode(uint8_t* record, size_t& length, float value);
+            static void _Encode(uint8_t* record, size_t& length, const char* value);
+
+            static void _Push(const uint8_t* record, size_t length);
+            static size_t _Pop(uint8_t* record);
+            static void _Expand(TextWriter& line, const uint8_t* record, size_t length);
+
+            static constexpr log_level_t mCompileLevels[LOG_MODULE_COUNT] = {
+                LOG_COMPILE_LEVEL_SYSTEM,
+                LOG_COMPILE_LEVEL_PRESSURE_GAUGE,
+                LOG_COMPILE_LEVEL_TANK_MONITOR,
+                LOG_COMPILE_LEVEL_WIFI_COM,
+                LOG_COMPILE_LEVEL_TELEGRAM_BOT
+            };
+
+            static log_level_t mLevels[LOG_MODULE_COUNT];
+            static uint8_t  mBuffer[LOG_BUFFER_SIZE];
+            static uint32_t mHead;
+            static uint32_t mTail;
+            static uint32_t mDropped;
+    };
+
+} // namespace Util
+
+/**
+ * @brief Catalogue entries as Util::LogMessage constants, named LOG_<name>.
+ */
+#define LOG_UNPAREN(...) __VA_ARGS__
+#define LOG_MESSAGE_DEFINITION(name, types, format) \
+    constexpr Util::LogMessage<LOG_UNPAREN types> LOG_##name { LOG_ID_##name, format };
+LOG_MESSAGES(LOG_MESSAGE_DEFINITION)
+#undef LOG_MESSAGE_DEFINITION
+
+/**
+ * @brief Log a catalogue message. Disabled levels are removed at compile time
+ *        and cost a single comparison at runtime.
+ */
+#define LOG(module, level, message, ...) \
+    do { \
+        if (Util::Log::IsCompiledIn(module, level) && Util::Log::IsEnabled(module, level)) { \
+            Util::Log::Write(module, level, message, ##__VA_ARGS__); \
+        } \
+    } while (0)
+
+#define LOG_ERROR(module, message, ...) LOG(module, LOG_LEVEL_ERROR, message, ##__VA_ARGS__)
+#define LOG_WARN(module, message, ...)  LOG(module, LOG_LEVEL_WARN, message, ##__VA_ARGS__)
+#define LOG_INFO(module, message, ...)  LOG(module, LOG_LEVEL_INFO, message, ##__VA_ARGS__)
+#define LOG_DEBUG(module, message, ...) LOG(module, LOG_LEVEL_DEBUG, message, ##__VA_ARGS__)
+
+#endif // LOGGER_H
@@ -0,0 +1,76 @@
+/*!****************************************************************************
+ * @file metric_names.h
+ * @brief Catalogue of runtime metrics.
+ * @author Gonzalo Puy
+ * @date Jun 2025
+ *******************************************************************************/
+
+#ifndef METRIC_NAMES_H
+#define METRIC_NAMES_H
+
+/**
+ * @brief Counters, as X(name, exported name, help).
+ */
+#define METRIC_COUNTERS(X) \
+    X(WIFI_BYTES_OUT,           "wifi_bytes_out_total",             "Bytes sent to the WiFi module") \
+    X(WIFI_BYTES_IN,            "wifi_bytes_in_total",              "Bytes received from the WiFi module") \
+    X(WIFI_CONNECTIONS,         "wifi_connections_total",           "Successful WiFi connections") \
+    X(WIFI_TIMEOUT_STATUS,      "wifi_timeouts_status_total",       "Status command timeouts") \
+    X(WIFI_TIMEOUT_CONNECT,     "wifi_timeouts_connect_total",      "Connect command timeouts") \
+    X(WIFI_TIMEOUT_GET,         "wifi_timeouts_get_total",          "GET request timeouts") \
+    X(WIFI_TIMEOUT_POST,        "wifi_timeouts_post_total",         "POST request timeouts") \
+    X(WIFI_TIMEOUT_BROADCAST,   "wifi_timeouts_broadcast_total",    "Broadcast request timeouts") \
+    X(WIFI_TIMEOUT_TELEMETRY,   "wifi_timeouts_telemetry_total",    "Telemetry frame timeouts") \
+    X(WIFI_LINK_LOST,           "wifi_link_lost_total",             "Links brought up again after repeated request failures") \
+    X(WIFI_EVENTS,              "wifi_events_total",                "Event frames pushed by the WiFi module") \
+    X(WIFI_BAUD_FALLBACKS,      "wifi_baud_fallbacks_total",        "Fast UART rate switches that got no answer") \
+    X(WIFI_BODY_CHUNKS,         "wifi_body_chunks_total",           "HTTP body chunks streamed by the WiFi module") \
+    X(WIFI_BODY_TRUNCATED,      "wifi_body_truncated_total",        "HTTP bodies longer than the receive buffer") \
+    X(WIFI_HTTP_BYTES_RECEIVED, "wifi_http_bytes_received_total",   "HTTP body bytes received over the air, compressed or not") \
+    X(WIFI_HTTP_BODY_BYTES,     "wifi_http_body_bytes_total",       "HTTP body bytes streamed to the monitor, once inflated") \
+    X(WIFI_UPDATES,             "wifi_updates_total",               "Updates pushed to the WiFi module webhook") \
+    X(WIFI_UPDATES_DROPPED,     "wifi_updates_dropped_total",       "Pushed updates dropped, too many not read yet") \
+    X(WIFI_STALE_RESPONSES,     "wifi_stale_responses_total",       "Late responses of previous commands dropped") \
+    X(WIFI_RX_FRAMES_DROPPED,   "wifi_rx_frames_dropped_total",     "Frames from the WiFi module longer than the receive buffer") \
+    X(BOT_POLLS,                "bot_polls_total",                  "Telegram getUpdates requests") \
+    X(BOT_POLL_TIMEOUTS,        "bot_poll_timeouts_total",          "Telegram getUpdates requests without answer") \
+    X(BOT_MESSAGES_RECEIVED,    "bot_messages_received_total",      "Telegram messages processed") \
+    X(BOT_ALERTS,               "bot_alerts_total",                 "Alert broadcasts started") \
+    X(BOT_ALERT_RETRIES,        "bot_alert_retries_total",          "Alert broadcast retries") \
+    X(BOT_ALERTS_QUEUED,        "bot_alerts_queued_total",          "Alerts and state changes queued for the users") \
+    X(TELEMETRY_FRAMES,         "telemetry_frames_total",           "Telemetry frames sent to the gateway") \
+    X(TANK_SAMPLES,             "tank_samples_total",               "Pressure samples taken") \
+    X(TANK_STATE_TRANSITIONS,   "tank_state_transitions_total",     "Tank state changes") \
+    X(TANK_THRESHOLD_CROSSINGS, "tank_threshold_crossings_total",   "Low pressure threshold crossings seen by the watchdog") \
+    X(CONFIG_WRITES,            "config_writes_total",              "Configuration records written to flash") \
+    X(CONFIG_WRITE_ERRORS,      "config_write_errors_total",        "Configuration records that failed to write")
+
+/**
+ * @brief Gauges, as X(name, exported name, help).
+ */
+#define METRIC_GAUGES(X) \
+    X(TANK_PRESSURE,            "tank_pressure",                    "Last pressure reading in the configured unit") \
+    X(TANK_TIME_LEFT,           "tank_time_left_minutes",           "Estimated minutes until the tank goes low, -1 if unknown") \
+    X(TANK_STATE,               "tank_state",                       "Tank state: 0 OK, 1 LOW, 2 UNKNOWN") \
+    X(BOT_USERS,                "bot_registered_users",             "Registered Telegram users") \
+    X(WIFI_LINK_HEALTH,         "wifi_link_health",                 "Link health score, 0 to 100") \
+    X(WIFI_BAUD_RATE,           "wifi_baud_rate",                   "UART baud rate in use with the WiFi module") \
+    X(WIFI_RSSI,                "wifi_rssi_dbm",                    "Signal strength reported by the WiFi module [dBm]") \
+    X(BOOT_FIRST_READING,       "boot_first_reading_ms",            "Time from boot to the first reading in a configured unit [ms], 0 until then") \
+    X(BOOT_LINK_READY,          "boot_link_ready_ms",               "Time from boot to the ESP32 associated [ms], 0 until then") \
+    X(BOOT_FIRST_MESSAGE,       "boot_first_message_ms",            "Time from boot to the first Telegram answer [ms], 0 until then")
+
+/**
+ * @brief Histograms with power of two buckets, as X(name, exported name, help).
+ */
+#define METRIC_HISTOGRAMS(X) \
+    X(WIFI_REQUEST_LATENCY,     "wifi_request_latency_ms",          "Time from command sent to WiFi module answer [ms]") \
+    X(WIFI_FIRST_CHUNK_LATENCY, "wifi_first_chunk_latency_ms",      "Time from command sent to the first body chunk [ms]") \
+    X(WIFI_SEND_STALL,          "wifi_send_stall_us",               "Superloop time spent queueing a command for the WiFi module [us]") \
+    X(WIFI_TX_TIME,             "wifi_tx_time_us",                  "Time from command queued to its last byte handed to the UART [us]") \
+    X(WIFI_HTTP_TRANSFER_SIZE,  "wifi_http_transfer_bytes",         "HTTP body bytes received over the air per request") \
+    X(WIFI_HTTP_TRANSFER_TIME,  "wifi_http_transfer_time_ms",       "Time from HTTP request sent to its body streamed [ms]") \
+    X(BOT_ALERT_LATENCY,        "bot_alert_latency_ms",             "Time from alert queued to every user notified [ms]") \
+    X(BOT_ALERT_DRAIN_LATENCY,  "bot_alert_drain_latency_ms",       "Time from link up to every user notified of the alerts held while down [ms]")
+
+#endif // METRIC_NAMES_H
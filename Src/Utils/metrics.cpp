@@ -0,0 +1,183 @@
+/*!****************************************************************************
+ * @file metrics.cpp
+ * @brief Implementation of runtime metrics registry
+ * @author Gonzalo Puy
+ * @date Jun 2025
+ *******************************************************************************/
+
+#include "metrics.h"
+
+#include <cstdio>
+
+namespace Util {
+
+//=====[Declaration and initialization of private global variables]============
+
+typedef struct metric_info {
+    const char* name;
+    const char* help;
+} metric_info_t;
+
+#define METRIC_INFO(name, exportedName, help) { exportedName, help },
+
+static const metric_info_t COUNTER_INFO[METRIC_COUNTER_COUNT] = {
+    METRIC_COUNTERS(METRIC_INFO)
+};
+
+static const metric_info_t GAUGE_INFO[METRIC_GAUGE_COUNT] = {
+    METRIC_GAUGES(METRIC_INFO)
+};
+
+static const metric_info_t HISTOGRAM_INFO[METRIC_HISTOGRAM_COUNT] = {
+    METRIC_HISTOGRAMS(METRIC_INFO)
+};
+
+#undef METRIC_INFO
+
+static const int NO_DUMP = -1;
+
+static const size_t DUMP_BUFFER_SIZE = 1024;
+
+static TextBuffer<DUMP_BUFFER_SIZE> dumpBuffer;      /**< Static to keep the dump off the main stack. */
+
+uint32_t             Metrics::mCounters[METRIC_COUNTER_COUNT];
+float                Metrics::mGauges[METRIC_GAUGE_COUNT];
+Metrics::histogram_t Metrics::mHistograms[METRIC_HISTOGRAM_COUNT];
+int                  Metrics::mDumpIndex = NO_DUMP;
+
+//=====[Declaration of private functions]======================================
+
+static void writeHeader(TextWriter& writer, const metric_info_t& info, const char* type);
+
+//=====[Implementations of public methods]=====================================
+
+//----static-------------------------------------------------------------------
+void Metrics::WriteSummary(TextWriter& writer)
+{
+    for (int i = 0; i < METRIC_COUNTER_COUNT; i++)
+    {
+        writer.Append(COUNTER_INFO[i].name);
+        writer.Append(' ');
+        writer.AppendInt((int32_t) mCounters[i]);
+        writer.Append('\n');
+    }
+
+    for (int i = 0; i < METRIC_GAUGE_COUNT; i++)
+    {
+        writer.Append(GAUGE_INFO[i].name);
+        writer.Append(' ');
+        writer.AppendFloat(mGauges[i], 2);
+        writer.Append('\n');
+    }
+
+    for (int i = 0; i < METRIC_HISTOGRAM_COUNT; i++)
+    {
+        const histogram_t& histogram = mHistograms[i];
+
+        writer.Append(HISTOGRAM_INFO[i].name);
+        writer.Append(" count ");
+        writer.AppendInt((int32_t) histogram.count);
+        writer.Append(" avg ");
+        writer.AppendInt((histogram.count != 0) ? (int32_t) (histogram.sum / histogram.count) : 0);
+        writer.Append('\n');
+    }
+}
+
+//----static-------------------------------------------------------------------
+void Metrics::RequestDump()
+{
+    mDumpIndex = 0;
+}
+
+//----static-------------------------------------------------------------------
+void Metrics::DrainDump()
+{
+    if (mDumpIndex == NO_DUMP) return;
+
+    int index = mDumpIndex++;
+    dumpBuffer.Clear();
+
+    if (index < METRIC_COUNTER_COUNT)
+    {
+        const metric_info_t& info = COUNTER_INFO[index];
+
+        writeHeader(dumpBuffer, info, "counter");
+        dumpBuffer.Append(info.name);
+        dumpBuffer.Append(' ');
+        dumpBuffer.AppendInt((int32_t) mCounters[index]);
+        dumpBuffer.Append('\n');
+    }
+    else if ((index -= METRIC_COUNTER_COUNT) < METRIC_GAUGE_COUNT)
+    {
+        const metric_info_t& info = GAUGE_INFO[index];
+
+        writeHeader(dumpBuffer, info, "gauge");
+        dumpBuffer.Append(info.name);
+        dumpBuffer.Append(' ');
+        dumpBuffer.AppendFloat(mGauges[index], 2);
+        dumpBuffer.Append('\n');
+    }
+    else if ((index -= METRIC_GAUGE_COUNT) < METRIC_HISTOGRAM_COUNT)
+    {
+        const metric_info_t& info = HISTOGRAM_INFO[index];
+        const histogram_t& histogram = mHistograms[index];
+        uint32_t cumulative = 0;
+
+        writeHeader(dumpBuffer, info, "histogram");
+
+        for (int bucket = 0; bucket < METRIC_HISTOGRAM_BUCKETS; bucket++)
+        {
+            cumulative += histogram.buckets[bucket];
+
+            dumpBuffer.Append(info.name);
+            dumpBuffer.Append("_bucket{le=\"");
+            if (bucket < METRIC_HISTOGRAM_BUCKETS - 1)
+            {
+                dumpBuffer.AppendInt((int32_t) (1UL << bucket));
+            }
+            else
+            {
+                dumpBuffer.Append("+Inf");
+            }
+            dumpBuffer.Append("\"} ");
+            dumpBuffer.AppendInt((int32_t) cumulative);
+            dumpBuffer.Append('\n');
+        }
+
+        dumpBuffer.Append(info.name);
+        dumpBuffer.Append("_sum ");
+        dumpBuffer.AppendInt((int32_t) histogram.sum);
+        dumpBuffer.Append('\n');
+        dumpBuffer.Append(info.name);
+        dumpBuffer.Append("_count ");
+        dumpBuffer.AppendInt((int32_t) histogram.count);
+        dumpBuffer.Append('\n');
+    }
+    else
+    {
+        mDumpIndex = NO_DUMP;
+        return;
+    }
+
+    fwrite(dumpBuffer.c_str(), 1, dumpBuffer.Length(), stdout);
+}
+
+//=====[Implementations of private functions]==================================
+
+/**
+* @brief Write the Prometheus HELP and TYPE lines of a metric.
+*/
+static void writeHeader(TextWriter& writer, const metric_info_t& info, const char* type)
+{
+    writer.Append("# HELP ");
+    writer.Append(info.name);
+    writer.Append(' ');
+    writer.Append(info.help);
+    writer.Append("\n# TYPE ");
+    writer.Append(info.name);
+    writer.Append(' ');
+    writer.Append(type);
+    writer.Append('\n');
+}
+
+} // namespace Util
@@ -0,0 +1,132 @@
+/*!****************************************************************************
+ * @file metrics.h
+ * @brief Declaration of runtime metrics registry
+ * @author Gonzalo Puy
+ * @date Jun 2025
+ *******************************************************************************/
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "metric_names.h"
+#include "text_writer.h"
+
+/** @brief Number of buckets of every histogram. Bucket i counts values <= 2^i, the last one is +Inf. */
+#define METRIC_HISTOGRAM_BUCKETS    17
+
+#define METRIC_ID(name, exportedName, help) METRIC_##name,
+
+/**
+ * @enum metric_counter_t
+ * @brief Counter IDs (see metric_names.h).
+ */
+typedef enum metric_counter {
+    METRIC_COUNTERS(METRIC_ID)
+    METRIC_COUNTER_COUNT
+} metric_counter_t;
+
+/**
+ * @enum metric_gauge_t
+ * @brief Gauge IDs (see metric_names.h).
+ */
+typedef enum metric_gauge {
+    METRIC_GAUGES(METRIC_ID)
+    METRIC_GAUGE_COUNT
+} metric_gauge_t;
+
+/**
+ * @enum metric_histogram_t
+ * @brief Histogram IDs (see metric_names.h).
+ */
+typedef enum metric_histogram {
+    METRIC_HISTOGRAMS(METRIC_ID)
+    METRIC_HISTOGRAM_COUNT
+} metric_histogram_t;
+
+#undef METRIC_ID
+
+namespace Util {
+
+    class Metrics
+    {
+        public:
+
+            /**
+            * @brief Add to a counter.
+            */
+            static void Increment(metric_counter_t counter, uint32_t value = 1)
+            {
+                mCounters[counter] += value;
+            }
+
+            /**
+            * @brief Set the value of a gauge.
+            */
+            static void Set(metric_gauge_t gauge, float value)
+            {
+                mGauges[gauge] = value;
+            }
+
+            /**
+            * @brief Record a value in a histogram.
+            */
+            static void Observe(metric_histogram_t histogram, uint32_t value)
+            {
+                // Smallest i so that value <= 2^i.
+                uint32_t bucket = (value <= 1) ? 0 : (32 - __builtin_clz(value - 1));
+
+                if (bucket >= METRIC_HISTOGRAM_BUCKETS) bucket = METRIC_HISTOGRAM_BUCKETS - 1;
+
+                mHistograms[histogram].buckets[bucket]++;
+                mHistograms[histogram].sum += value;
+                mHistograms[histogram].count++;
+            }
+
+            /**
+            * @brief Return the value of a counter.
+            */
+            static uint32_t Get(metric_counter_t counter) { return mCounters[counter]; }
+
+            /**
+            * @brief Write a short human readable summary of every metric.
+            */
+            static void WriteSummary(TextWriter& writer);
+
+            /**
+            * @brief Request a Prometheus text dump of every metric over the debug UART.
+            *
+            * The dump is done by DrainDump, one metric per call.
+            */
+            static void RequestDump();
+
+            /**
+            * @brief Print the next metric of a requested dump, if any.
+            *
+            * Meant to be called from the superloop.
+            */
+            static void DrainDump();
+
+        private:
+
+            Metrics() {};
+            ~Metrics() = default;
+            Metrics(const Metrics&) = delete;
+            Metrics& operator=(const Metrics&) = delete;
+
+            typedef struct histogram {
+                uint32_t buckets[METRIC_HISTOGRAM_BUCKETS];
+                uint32_t sum;
+                uint32_t count;
+            } histogram_t;
+
+            static uint32_t    mCounters[METRIC_COUNTER_COUNT];
+            static float       mGauges[METRIC_GAUGE_COUNT];
+            static histogram_t mHistograms[METRIC_HISTOGRAM_COUNT];
+            static int         mDumpIndex;
+    };
+
+} // namespace Util
+
+#endif // METRICS_H
@@ -0,0 +1,86 @@
+/*!****************************************************************************
+ * @file profiler.cpp
+ * @brief Implementation of cycle counting profiler for hot paths
+ * @author Gonzalo Puy
+ * @date Jun 2025
+ *******************************************************************************/
+
+#include "profiler.h"
+
+#if PROFILING_ENABLED
+
+#include <cstdio>
+#include <string.h>
+#include "text_writer.h"
+
+namespace Util {
+
+//=====[Declaration and initialization of private global variables]============
+
+#define PROFILE_ZONE_NAME(name, exportedName) exportedName,
+static const char* const ZONE_NAMES[PROFILE_ZONE_COUNT] = {
+    PROFILE_ZONES(PROFILE_ZONE_NAME)
+};
+#undef PROFILE_ZONE_NAME
+
+static const int NO_DUMP = -1;
+
+static const size_t DUMP_LINE_SIZE = 128;
+
+Profiler::zone_stats_t Profiler::mZones[PROFILE_ZONE_COUNT];
+int                    Profiler::mDumpIndex = NO_DUMP;
+
+//=====[Implementations of public methods]=====================================
+
+//----static-------------------------------------------------------------------
+void Profiler::Init()
+{
+    CycleCounter::Init();
+    Reset();
+}
+
+//----static-------------------------------------------------------------------
+void Profiler::Reset()
+{
+    memset(mZones, 0, sizeof(mZones));
+}
+
+//----static-------------------------------------------------------------------
+void Profiler::RequestDump()
+{
+    mDumpIndex = 0;
+}
+
+//----static-------------------------------------------------------------------
+void Profiler::DrainDump()
+{
+    if (mDumpIndex == NO_DUMP) return;
+
+    if (mDumpIndex >= PROFILE_ZONE_COUNT)
+    {
+        mDumpIndex = NO_DUMP;
+        return;
+    }
+
+    const int index = mDumpIndex++;
+    const zone_stats_t& stats = mZones[index];
+    TextBuffer<DUMP_LINE_SIZE> line;
+
+    line.Append("profile ");
+    line.Append(ZONE_NAMES[index]);
+    line.Append(" calls ");
+    line.AppendInt((int32_t) stats.calls);
+    line.Append(" min ");
+    line.AppendInt((int32_t) stats.min);
+    line.Append(" avg ");
+    line.AppendInt((stats.calls != 0) ? (int32_t) (stats.total / stats.calls) : 0);
+    line.Append(" max ");
+    line.AppendInt((int32_t) stats.max);
+    line.Append(" cycles\r\n");
+
+    fwrite(line.c_str(), 1, line.Length(), stdout);
+}
+
+} // namespace Util
+
+#endif // PROFILING_ENABLED
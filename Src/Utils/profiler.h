@@ -0,0 +1,216 @@
+/*!****************************************************************************
+ * @file profiler.h
+ * @brief Declaration of cycle counting profiler for hot paths
+ * @author Gonzalo Puy
+ * @date Jun 2025
+ *******************************************************************************/
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+/**
+ * @brief Enable profiling zones. Define as 1 (e.g. in mbed_app.json macros)
+ *        to build them in; otherwise every PROFILE_* macro expands to nothing.
+ */
+#ifndef PROFILING_ENABLED
+#define PROFILING_ENABLED       0
+#endif
+
+/**
+ * @brief Profiling zones, as X(name, exported name).
+ */
+#define PROFILE_ZONES(X) \
+    X(SUPERLOOP,                "superloop") \
+    X(TANK_MONITOR_UPDATE,      "tank_monitor_update") \
+    X(WIFI_COM_UPDATE,          "wifi_com_update") \
+    X(WIFI_COM_RX_DRAIN,        "wifi_com_rx_drain") \
+    X(WIFI_COM_SEND,            "wifi_com_send") \
+    X(TELEGRAM_BOT_UPDATE,      "telegram_bot_update") \
+    X(TELEGRAM_BOT_GET_MESSAGE, "telegram_bot_get_message") \
+    X(TELEGRAM_BOT_PARSE,       "telegram_bot_parse_message") \
+    X(LOG_DRAIN,                "log_drain")
+
+#include <stddef.h>
+#include <stdint.h>
+#include "mbed.h"
+
+#if !defined(__CORTEX_M)
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <time.h>
+#endif
+#endif
+
+namespace Util {
+
+    typedef uint32_t cycles_t;
+
+    class CycleCounter
+    {
+        public:
+
+            /**
+            * @brief Enable the cycle counter.
+            */
+            static void Init()
+            {
+#if defined(__CORTEX_M)
+                CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+                DWT->CYCCNT = 0;
+                DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+            }
+
+            /**
+            * @brief Return the current cycle count.
+            *
+            * DWT CYCCNT on target. On a host build, the TSC or a nanosecond
+            * clock is used instead, truncated to 32 bits.
+            */
+            static cycles_t Get()
+            {
+#if defined(__CORTEX_M)
+                return DWT->CYCCNT;
+#elif defined(__x86_64__) || defined(__i386__)
+                return (cycles_t) __rdtsc();
+#else
+                struct timespec now;
+                clock_gettime(CLOCK_MONOTONIC, &now);
+                return (cycles_t) ((now.tv_sec * 1000000000ULL) + now.tv_nsec);
+#endif
+            }
+
+        private:
+
+            CycleCounter() {};
+            ~CycleCounter() = default;
+            CycleCounter(const CycleCounter&) = delete;
+            CycleCounter& operator=(const CycleCounter&) = delete;
+    };
+
+} // namespace Util
+
+#if PROFILING_ENABLED
+
+#define PROFILE_ZONE_ID(name, exportedName) PROFILE_ZONE_##name,
+
+/**
+ * @enum profile_zone_t
+ * @brief Profiling zone IDs.
+ */
+typedef enum profile_zone {
+    PROFILE_ZONES(PROFILE_ZONE_ID)
+    PROFILE_ZONE_COUNT
+} profile_zone_t;
+
+#undef PROFILE_ZONE_ID
+
+namespace Util {
+
+    class Profiler
+    {
+        public:
+
+            /**
+            * @brief Enable the cycle counter and clear every zone.
+            */
+            static void Init();
+
+            /**
+            * @brief Add a sample to a zone.
+            */
+            static void Record(profile_zone_t zone, cycles_t cycles)
+            {
+                zone_stats_t& stats = mZones[zone];
+
+                if ((stats.calls == 0) || (cycles < stats.min)) stats.min = cycles;
+                if (cycles > stats.max) stats.max = cycles;
+                stats.total += cycles;
+                stats.calls++;
+            }
+
+            /**
+            * @brief Clear every zone.
+            */
+            static void Reset();
+
+            /**
+            * @brief Request a dump of the zone table over the debug UART.
+            *
+            * The dump is done by DrainDump, one zone per call.
+            */
+            static void RequestDump();
+
+            /**
+            * @brief Print the next zone of a requested dump, if any.
+            *
+            * Meant to be called from the superloop.
+            */
+            static void DrainDump();
+
+        private:
+
+            Profiler() {};
+            ~Profiler() = default;
+            Profiler(const Profiler&) = delete;
+            Profiler& operator=(const Profiler&) = delete;
+
+            typedef struct zone_stats {
+                cycles_t min;
+                cycles_t max;
+                uint64_t total;
+                uint32_t calls;
+            } zone_stats_t;
+
+            static zone_stats_t mZones[PROFILE_ZONE_COUNT];
+            static int          mDumpIndex;
+    };
+
+    /**
+    * @brief Record the cycles spent between construction and destruction.
+    */
+    class ProfileScope
+    {
+        public:
+
+            explicit ProfileScope(profile_zone_t zone)
+                : mZone(zone)
+                , mStart(CycleCounter::Get())
+                {}
+
+            ~ProfileScope()
+            {
+                Profiler::Record(mZone, CycleCounter::Get() - mStart);
+            }
+
+            ProfileScope(const ProfileScope&) = delete;
+            ProfileScope& operator=(const ProfileScope&) = delete;
+
+        private:
+
+            profile_zone_t mZone;
+            cycles_t       mStart;
+    };
+
+} // namespace Util
+
+#define PROFILE_CONCAT_(a, b)       a##b
+#define PROFILE_CONCAT(a, b)        PROFILE_CONCAT_(a, b)
+
+/** @brief Profile the rest of the enclosing scope as the given zone. */
+#define PROFILE_ZONE(zone)          Util::ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(PROFILE_ZONE_##zone)
+#define PROFILE_INIT()              Util::Profiler::Init()
+#define PROFILE_REQUEST_DUMP()      Util::Profiler::RequestDump()
+#define PROFILE_DRAIN_DUMP()        Util::Profiler::DrainDump()
+
+#else
+
+#define PROFILE_ZONE(zone)          do {} while (0)
+#define PROFILE_INIT()              do {} while (0)
+#define PROFILE_REQUEST_DUMP()      do {} while (0)
+#define PROFILE_DRAIN_DUMP()        do {} while (0)
+
+#endif // PROFILING_ENABLED
+
+#endif // PROFILER_H
@@ -0,0 +1,275 @@
+/*!****************************************************************************
+ * @file text_writer.cpp
+ * @brief Implementation of fixed buffer text writer
+ * @author Gonzalo Puy
+ * @date Jun 2025
+ *******************************************************************************/
+
+#include "text_writer.h"
+
+#include <cmath>
+
+namespace Util {
+
+//=====[Declaration and initialization of private global variables]============
+
+static const char HEX_DIGITS[] = "0123456789ABCDEF";
+
+static const uint32_t POWERS_OF_TEN[] = { 1, 10, 100, 1000, 10000, 100000, 1000000 };
+
+static const int MAX_FLOAT_DECIMALS = 6;
+
+static const int DEFAULT_FLOAT_DECIMALS = 6;
+
+static const float FLOAT_INTEGER_LIMIT = 4294967296.0f;   // First value past the uint32_t integer part
+
+//=====[Implementations of public methods]=====================================
+
+//-----------------------------------------------------------------------------
+const char* FormatMismatch()
+{
+    return nullptr;
+}
+
+//-----------------------------------------------------------------------------
+void TextWriter::Clear()
+{
+    mLength = 0;
+    mBuffer[0] = '\0';
+    mIsUrlEncoding = false;
+    mIsOverflowed = false;
+}
+
+//-----------------------------------------------------------------------------
+void TextWriter::SetUrlEncoding(bool isEnabled)
+{
+    mIsUrlEncoding = isEnabled;
+}
+
+//-----------------------------------------------------------------------------
+void TextWriter::Append(char character)
+{
+    const bool isUnreserved = ((character >= 'a') && (character <= 'z'))
+                           || ((character >= 'A') && (character <= 'Z'))
+                           || ((character >= '0') && (character <= '9'))
+                           || (character == '-') || (character == '.') || (character == '_');
+
+    if (!mIsUrlEncoding || isUnreserved)
+    {
+        _AppendRaw(character);
+    }
+    else if (character == ' ')
+    {
+        _AppendRaw('+');
+    }
+    else
+    {
+        // '~' and '|' are always escaped here, so a message can never break the WiFi module framing.
+        const uint8_t value = (uint8_t) character;
+
+        // A truncated escape would corrupt whatever follows: all three bytes or none.
+        if (mLength + 3 >= mSize)
+        {
+            mIsOverflowed = true;
+            return;
+        }
+
+        _AppendRaw('%');
+        _AppendRaw(HEX_DIGITS[value >> 4]);
+        _AppendRaw(HEX_DIGITS[value & 0x0F]);
+    }
+}
+
+//-----------------------------------------------------------------------------
+void TextWriter::Append(const char* text)
+{
+    while (*text != '\0')
+    {
+        Append(*text++);
+    }
+}
+
+//-----------------------------------------------------------------------------
+void TextWriter::AppendInt(int32_t value)
+{
+    uint32_t magnitude = (uint32_t) value;
+
+    if (value < 0)
+    {
+        Append('-');
+        magnitude = 0U - magnitude;
+    }
+
+    _AppendDigits(magnitude, 1);
+}
+
+//-----------------------------------------------------------------------------
+void TextWriter::AppendFloat(float value, int decimals)
+{
+    if (decimals < 0) decimals = 0;
+    if (decimals > MAX_FLOAT_DECIMALS) decimals = MAX_FLOAT_DECIMALS;
+
+    if (std::isnan(value))
+    {
+        Append("nan");
+        return;
+    }
+
+    if (value < 0.0f)
+    {
+        Append('-');
+        value = -value;
+    }
+
+    // The integer part would not fit: exponent form, as %e prints it.
+    if (value >= FLOAT_INTEGER_LIMIT)
+    {
+        _AppendExponent(value, decimals);
+        return;
+    }
+
+    // Split before scaling so large integer parts do not overflow the fraction math.
+    uint32_t integerPart = (uint32_t) value;
+    uint32_t fractionPart = (uint32_t) (((value - (float) integerPart) * (float) POWERS_OF_TEN[decimals]) + 0.5f);
+
+    if (fractionPart >= POWERS_OF_TEN[decimals])
+    {
+        integerPart++;
+        fractionPart -= POWERS_OF_TEN[decimals];
+    }
+
+    _AppendDigits(integerPart, 1);
+
+    if (decimals > 0)
+    {
+        Append('.');
+        _AppendDigits(fractionPart, decimals);
+    }
+}
+
+//=====[Implementations of private methods]====================================
+
+//-----------------------------------------------------------------------------
+void TextWriter::_AppendExponent(float value, int decimals)
+{
+    int exponent = 0;
+
+    if (std::isinf(value))
+    {
+        Append("inf");
+        return;
+    }
+
+    while (value >= 10.0f)
+    {
+        value /= 10.0f;
+        exponent++;
+    }
+
+    // Rounding the mantissa up to 10 moves it to the next power.
+    if ((value + (0.5f / (float) POWERS_OF_TEN[decimals])) >= 10.0f)
+    {
+        value /= 10.0f;
+        exponent++;
+    }
+
+    AppendFloat(value, decimals);
+    Append("e+");
+    _AppendDigits((uint32_t) exponent, 2);
+}
+
+//-----------------------------------------------------------------------------
+const char* TextWriter::_AppendLiteral(const char* format)
+{
+    while (*format != '\0')
+    {
+        if (format[0] == '%')
+        {
+            if (format[1] != '%') break;
+            format++;
+        }
+
+        Append(*format++);
+    }
+
+    return format;
+}
+
+//-----------------------------------------------------------------------------
+const char* TextWriter::_AppendArgument(const char* format, int value)
+{
+    // Format was checked at compile time: "%d"
+    AppendInt(value);
+    return format + 2;
+}
+
+//-----------------------------------------------------------------------------
+const char* TextWriter::_AppendArgument(const char* format, float value)
+{
+    // Format was checked at compile time: "%f" or "%.Nf"
+    int decimals = DEFAULT_FLOAT_DECIMALS;
+
+    format++;
+
+    if (*format == '.')
+    {
+        format++;
+        decimals = 0;
+
+        while ((*format >= '0') && (*format <= '9'))
+        {
+            decimals = (decimals * 10) + (*format++ - '0');
+        }
+    }
+
+    AppendFloat(value, decimals);
+    return format + 1;
+}
+
+//-----------------------------------------------------------------------------
+const char* TextWriter::_AppendArgument(const char* format, const char* value)
+{
+    // Format was checked at compile time: "%s"
+    Append(value);
+    return format + 2;
+}
+
+//-----------------------------------------------------------------------------
+void TextWriter::_AppendRaw(char character)
+{
+    if (mLength + 1 < mSize)
+    {
+        mBuffer[mLength++] = character;
+        mBuffer[mLength] = '\0';
+    }
+    else
+    {
+        mIsOverflowed = true;
+    }
+}
+
+//-----------------------------------------------------------------------------
+void TextWriter::_AppendDigits(uint32_t value, int minDigits)
+{
+    char digits[10];
+    int count = 0;
+
+    do
+    {
+        digits[count++] = (char) ('0' + (value % 10));
+        value /= 10;
+    } while (value != 0);
+
+    while (count < minDigits)
+    {
+        _AppendRaw('0');
+        minDigits--;
+    }
+
+    while (count > 0)
+    {
+        _AppendRaw(digits[--count]);
+    }
+}
+
+} // namespace Util
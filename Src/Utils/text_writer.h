@@ -0,0 +1,220 @@
+/*!****************************************************************************
+ * @file text_writer.h
+ * @brief Declaration of fixed buffer text writer and typed message templates
+ * @author Gonzalo Puy
+ * @date Jun 2025
+ *******************************************************************************/
+
+#ifndef TEXT_WRITER_H
+#define TEXT_WRITER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace Util {
+
+    /**
+    * @brief Maps an argument type to the printf-like conversion it must match.
+    */
+    template <typename T> struct FormatKind;
+    template <> struct FormatKind<int>         { static constexpr char value = 'd'; };
+    template <> struct FormatKind<float>       { static constexpr char value = 'f'; };
+    template <> struct FormatKind<const char*> { static constexpr char value = 's'; };
+
+    /**
+    * @brief Checks at compile time that a format string matches a list of conversions.
+    *
+    * Supported conversions are %d, %s, %f and %.Nf. "%%" prints a literal '%'.
+    *
+    * @param format Format string.
+    * @param kinds Expected conversions, in order, null terminated (e.g. "fsd").
+    * @return True if every conversion matches its argument, false otherwise.
+    */
+    constexpr bool FormatMatches(const char* format, const char* kinds)
+    {
+        while (*format != '\0')
+        {
+            if (*format++ != '%') continue;
+
+            if (*format == '%')
+            {
+                format++;
+                continue;
+            }
+
+            while ((*format == '.') || ((*format >= '0') && (*format <= '9'))) format++;
+
+            if ((*kinds == '\0') || (*format != *kinds)) return false;
+
+            format++;
+            kinds++;
+        }
+
+        return (*kinds == '\0');
+    }
+
+    /**
+    * @brief Not constexpr on purpose: reaching it while building a MessageTemplate
+    *        turns a format/argument mismatch into a compile error.
+    */
+    const char* FormatMismatch();
+
+    /**
+    * @brief Message format string bound to the exact argument types it expects.
+    *
+    * Declaring a template as constexpr validates its format string at compile
+    * time, and TextWriter::Format only accepts arguments convertible to Args.
+    */
+    template <typename... Args>
+    class MessageTemplate
+    {
+        public:
+
+            template <size_t N>
+            constexpr MessageTemplate(const char (&format)[N])
+                : mFormat(FormatMatches(format, mKinds) ? format : FormatMismatch())
+                {}
+
+            constexpr const char* Format() const { return mFormat; }
+
+        private:
+
+            static constexpr char mKinds[] = { FormatKind<Args>::value..., '\0' };
+            const char* mFormat;
+    };
+
+    template <typename... Args>
+    constexpr char MessageTemplate<Args...>::mKinds[];
+
+    /**
+    * @brief Used to keep template arguments out of type deduction.
+    */
+    template <typename T> struct NonDeduced { typedef T type; };
+
+    class TextWriter
+    {
+        public:
+
+            /**
+            * @brief Constructor for TextWriter class.
+            * @param buffer Storage used for the text, owned by the caller.
+            * @param size Size of buffer in bytes, including the null terminator.
+            */
+            TextWriter(char* buffer, size_t size)
+                : mBuffer(buffer)
+                , mSize(size)
+                , mLength(0)
+                , mIsUrlEncoding(false)
+                , mIsOverflowed(false)
+                { mBuffer[0] = '\0'; }
+
+            ~TextWriter() = default;
+            TextWriter(const TextWriter&) = delete;
+            TextWriter& operator=(const TextWriter&) = delete;
+
+            /**
+            * @brief Empty the text and disable URL encoding.
+            */
+            void Clear();
+
+            /**
+            * @brief Enable or disable URL encoding (application/x-www-form-urlencoded)
+            *        of everything written from now on.
+            * @param isEnabled True to encode, false to write raw text.
+            */
+            void SetUrlEncoding(bool isEnabled);
+
+            /**
+            * @brief Append a single character.
+            */
+            void Append(char character);
+
+            /**
+            * @brief Append a null terminated string.
+            */
+            void Append(const char* text);
+
+            /**
+            * @brief Append an integer in decimal.
+            */
+            void AppendInt(int32_t value);
+
+            /**
+            * @brief Append a float with a fixed number of decimals.
+            * @param value Value to print. From 2^32 in magnitude up, it is printed
+            *              in exponent form (e.g. 1.50e+10).
+            * @param decimals Number of decimals (0 to 6).
+            */
+            void AppendFloat(float value, int decimals);
+
+            /**
+            * @brief Append a message template with its arguments, in a single pass.
+            */
+            template <typename... Args>
+            void Format(const MessageTemplate<Args...>& message, typename NonDeduced<Args>::type... args)
+            {
+                _Format(message.Format(), args...);
+            }
+
+            /**
+            * @brief Return the text written so far, null terminated.
+            */
+            const char* c_str() const { return mBuffer; }
+
+            /**
+            * @brief Return the length of the text written so far.
+            */
+            size_t Length() const { return mLength; }
+
+            /**
+            * @brief Return true if some text did not fit in the buffer and was dropped.
+            */
+            bool IsOverflowed() const { return mIsOverflowed; }
+
+        private:
+
+            void _Format(const char* format) { _AppendLiteral(format); }
+
+            template <typename T, typename... Rest>
+            void _Format(const char* format, T arg, Rest... rest)
+            {
+                format = _AppendLiteral(format);
+                format = _AppendArgument(format, arg);
+                _Format(format, rest...);
+            }
+
+            const char* _AppendLiteral(const char* format);
+            const char* _AppendArgument(const char* format, int value);
+            const char* _AppendArgument(const char* format, float value);
+            const char* _AppendArgument(const char* format, const char* value);
+            void _AppendRaw(char character);
+            void _AppendDigits(uint32_t value, int minDigits);
+            void _AppendExponent(float value, int decimals);
+
+            char*  mBuffer;
+            size_t mSize;
+            size_t mLength;
+            bool   mIsUrlEncoding;
+            bool   mIsOverflowed;
+    };
+
+    /**
+    * @brief TextWriter that carries its own storage.
+    */
+    template <size_t N>
+    class TextBuffer : public TextWriter
+    {
+        public:
+
+            TextBuffer()
+                : TextWriter(mStorage, N)
+                {}
+
+        private:
+
+            char mStorage[N];
+    };
+
+} // namespace Util
+
+#endif // TEXT_WRITER_H
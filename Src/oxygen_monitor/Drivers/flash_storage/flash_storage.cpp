@@ -0,0 +1,169 @@
+/********************************************************************************
+ * @file flash_storage.cpp
+ * @brief Flash storage driver. Internal flash through FlashIAP, or a RAM stand-in
+ *        on host builds.
+ * @author Gonzalo Puy.
+ * @date Jun 2025
+ *******************************************************************************/
+
+#include <stdint.h>
+#include <string.h>
+#include "flash_storage.h"
+
+#if !DEVICE_FLASH
+
+//=====[Declaration and initialization of private global variables]==============
+
+static uint8_t host_flash[FLASH_STORAGE_SLOT_COUNT][FLASH_STORAGE_HOST_SLOT_SIZE];  /**< Stand-in flash contents. */
+static bool host_flash_is_erased = false;       /**< Erased once, on the first use. */
+static size_t host_power_cut = SIZE_MAX;        /**< Bytes programmed by the next write, SIZE_MAX for all. */
+
+#endif
+
+//====================[Implementations of public methods]========================
+
+namespace Drivers {
+
+#if DEVICE_FLASH
+
+  FlashStorage::FlashStorage()
+    : isReady(false)
+  {
+  }
+
+  bool FlashStorage::init()
+  {
+    const uint32_t configured[FLASH_STORAGE_SLOT_COUNT] = { FLASH_STORAGE_SLOT_0_ADDRESS, FLASH_STORAGE_SLOT_1_ADDRESS };
+
+    isReady = false;
+
+    if (flash.init() != 0) {
+      return false;
+    }
+
+    // Default to the last two sectors, counted from the end of the flash.
+    const uint32_t flashEnd = flash.get_flash_start() + flash.get_flash_size();
+    const uint32_t lastSector = flashEnd - flash.get_sector_size(flashEnd - 1);
+
+    slotAddress[1] = (configured[1] != 0) ? configured[1] : lastSector;
+    slotAddress[0] = (configured[0] != 0) ? configured[0] : lastSector - flash.get_sector_size(lastSector - 1);
+    pageSize = flash.get_page_size();
+
+    for (int slot = 0; slot < FLASH_STORAGE_SLOT_COUNT; slot++) {
+      slotSize[slot] = flash.get_sector_size(slotAddress[slot]);
+    }
+
+    isReady = (pageSize <= FLASH_STORAGE_MAX_PAGE_SIZE) && (slotAddress[0] != slotAddress[1]);
+
+#if defined(MBED_APP_START) && defined(MBED_APP_SIZE)
+    // Never erase the firmware, the linker only keeps it below MBED_APP_START + MBED_APP_SIZE.
+    for (int slot = 0; slot < FLASH_STORAGE_SLOT_COUNT; slot++) {
+      if ((slotAddress[slot] < (uint32_t) (MBED_APP_START + MBED_APP_SIZE)) &&
+          ((slotAddress[slot] + slotSize[slot]) > (uint32_t) MBED_APP_START)) {
+        isReady = false;
+      }
+    }
+#endif
+
+    return isReady;
+  }
+
+  bool FlashStorage::read(int slot, void *buffer, size_t size)
+  {
+    if (!isReady || (slot < 0) || (slot >= FLASH_STORAGE_SLOT_COUNT) || (size > slotSize[slot])) {
+      return false;
+    }
+
+    return (flash.read(buffer, slotAddress[slot], size) == 0);
+  }
+
+  bool FlashStorage::write(int slot, const void *data, size_t size)
+  {
+    if (!isReady || (slot < 0) || (slot >= FLASH_STORAGE_SLOT_COUNT) || (size > slotSize[slot])) {
+      return false;
+    }
+
+    const uint8_t *bytes = static_cast<const uint8_t*>(data);
+    const size_t body = size - (size % pageSize);
+
+    if (flash.erase(slotAddress[slot], slotSize[slot]) != 0) {
+      return false;
+    }
+
+    if ((body > 0) && (flash.program(bytes, slotAddress[slot], body) != 0)) {
+      return false;
+    }
+
+    // Last partial page, padded with erased bytes.
+    if (body < size) {
+      uint8_t page[FLASH_STORAGE_MAX_PAGE_SIZE];
+
+      memset(page, flash.get_erase_value(), pageSize);
+      memcpy(page, bytes + body, size - body);
+      if (flash.program(page, slotAddress[slot] + body, pageSize) != 0) {
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+#else
+
+  FlashStorage::FlashStorage()
+    : isReady(false)
+  {
+  }
+
+  bool FlashStorage::init()
+  {
+    if (!host_flash_is_erased) {
+      memset(host_flash, 0xFF, sizeof(host_flash));
+      host_flash_is_erased = true;
+    }
+
+    isReady = true;
+
+    return isReady;
+  }
+
+  bool FlashStorage::read(int slot, void *buffer, size_t size)
+  {
+    if (!isReady || (slot < 0) || (slot >= FLASH_STORAGE_SLOT_COUNT) || (size > FLASH_STORAGE_HOST_SLOT_SIZE)) {
+      return false;
+    }
+
+    memcpy(buffer, host_flash[slot], size);
+
+    return true;
+  }
+
+  bool FlashStorage::write(int slot, const void *data, size_t size)
+  {
+    if (!isReady || (slot < 0) || (slot >= FLASH_STORAGE_SLOT_COUNT) || (size > FLASH_STORAGE_HOST_SLOT_SIZE)) {
+      return false;
+    }
+
+    const uint8_t *bytes = static_cast<const uint8_t*>(data);
+    const size_t programmed = (host_power_cut < size) ? host_power_cut : size;
+
+    // Erase, then program. Programming can only clear bits, like real flash.
+    memset(host_flash[slot], 0xFF, FLASH_STORAGE_HOST_SLOT_SIZE);
+
+    for (size_t i = 0; i < programmed; i++) {
+      host_flash[slot][i] &= bytes[i];
+    }
+
+    host_power_cut = SIZE_MAX;
+
+    return (programmed == size);
+  }
+
+  void FlashStorage::hostCutPower(size_t programmed)
+  {
+    host_power_cut = programmed;
+  }
+
+#endif
+
+} // namespace Drivers
@@ -0,0 +1,113 @@
+/********************************************************************************
+ * @file flash_storage.h
+ * @brief Flash storage driver header file.
+ * @author Gonzalo Puy.
+ * @date Jun 2025
+ *******************************************************************************/
+
+#ifndef FLASH_STORAGE_H
+#define FLASH_STORAGE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "mbed.h"
+
+//=========================[Driver Defines]=====================================
+
+/** @brief Number of flash slots, one record is kept per slot. */
+#define FLASH_STORAGE_SLOT_COUNT          2
+
+/**
+ * @brief Start address of each slot. Each one must be a whole erase sector not used
+ *        by the firmware. 0 uses the last two sectors of the internal flash, kept
+ *        out of the application by target.mbed_app_size in mbed_app.json.
+ */
+#ifndef FLASH_STORAGE_SLOT_0_ADDRESS
+#define FLASH_STORAGE_SLOT_0_ADDRESS      0
+#endif
+
+#ifndef FLASH_STORAGE_SLOT_1_ADDRESS
+#define FLASH_STORAGE_SLOT_1_ADDRESS      0
+#endif
+
+/** @brief Largest program unit supported, in bytes. */
+#define FLASH_STORAGE_MAX_PAGE_SIZE       32
+
+/** @brief Slot size of the host stand-in, used when the target has no flash API. */
+#define FLASH_STORAGE_HOST_SLOT_SIZE      2048
+
+namespace Drivers {
+  /**
+  * @class FlashStorage
+  * @brief Reads and rewrites whole records in dedicated flash slots.
+  *
+  * A write erases the slot and programs the record from start to end. If power is
+  * lost in between, the slot is left with an erased or partial record, so callers
+  * must validate records and never write over the only valid one.
+  *
+  * On targets without a flash API (host builds) a RAM stand-in with the same
+  * erase and program semantics is used. Like the flash, its contents are shared
+  * by every instance, and a write can be cut short to test power losses.
+  */
+  class FlashStorage {
+  public:
+
+    /**
+    * @brief Constructs a FlashStorage object.
+    */
+    FlashStorage();
+
+    /**
+    * @brief Initializes the flash and locates the slots.
+    * @retval true if the slots are usable, false otherwise. Slots overlapping
+    *         the application region (MBED_APP_START, MBED_APP_SIZE) are not.
+    */
+    bool init();
+
+    /**
+    * @brief Reads the start of a slot.
+    * @param slot Slot index, below FLASH_STORAGE_SLOT_COUNT.
+    * @param buffer Destination buffer.
+    * @param size Bytes to read.
+    * @retval true if read, false on error.
+    */
+    bool read(int slot, void *buffer, size_t size);
+
+    /**
+    * @brief Erases a slot and programs a record at its start.
+    *
+    * Blocks for the whole erase, which may take seconds on big sectors. The CPU
+    * stalls meanwhile, so peripherals must not need servicing during the call.
+    *
+    * @param slot Slot index, below FLASH_STORAGE_SLOT_COUNT.
+    * @param data Record to program.
+    * @param size Record size, at most the slot size.
+    * @retval true if written, false on error.
+    */
+    bool write(int slot, const void *data, size_t size);
+
+#if !DEVICE_FLASH
+    /**
+    * @brief Cuts the power during the next write of the stand-in: the slot is
+    *        erased, then only the first bytes of the record are programmed.
+    * @param programmed Bytes programmed before the cut, 0 leaves the slot erased.
+    */
+    static void hostCutPower(size_t programmed);
+#endif
+
+  private:
+
+    bool isReady;                                         /**< Slots located and usable. */
+
+#if DEVICE_FLASH
+    FlashIAP flash;                                       /**< Internal flash interface. */
+    uint32_t slotAddress[FLASH_STORAGE_SLOT_COUNT];       /**< Start address of every slot. */
+    uint32_t slotSize[FLASH_STORAGE_SLOT_COUNT];          /**< Erase size of every slot. */
+    uint32_t pageSize;                                    /**< Program unit. */
+#endif
+
+  }; // class FlashStorage
+
+} // namespace Drivers
+
+#endif // FLASH_STORAGE_H
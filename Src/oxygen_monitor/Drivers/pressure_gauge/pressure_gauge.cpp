@@ -4,8 +4,14 @@
  * @author Gonzalo Puy.
  * @date Jun 2024
  *******************************************************************************/
+#include <algorithm>
 #include "mbed.h" 
 #include "pressure_gauge.h"
+#include "logger.h"
+
+//=====[Declaration and initialization of private global variables]==============
+
+static Drivers::PressureGauge *watchdog_gauge = nullptr;   /**< Gauge served by the watchdog interrupt. */
 
 //====================[Implementations of public methods]========================
 
@@ -19,30 +25,79 @@ namespace Drivers {
   void PressureGauge::init()
   {
     lastReading = 0.0;
+    lastVoltage = MIN_READING_VALUE;
     ref = 3.3f;
     unit = UNIT_UNKNOWN;
+    thresholdRaw = 0;
+    isWatchdogArmed = false;
+    isBelowThreshold = false;
+    isThresholdCrossed = false;
+
+    // The watchdog ADC and its interrupt belong to the first gauge initialized.
+    // Any other one (e.g. the benchmark's) only reads its pin.
+    if ((watchdog_gauge != nullptr) && (watchdog_gauge != this)) {
+      return;
+    }
+    watchdog_gauge = this;
+
+#if PRESSURE_WATCHDOG_HW
+    ADC_ChannelConfTypeDef channel = {};
+    ADC_AnalogWDGConfTypeDef watchdog = {};
+
+    // Continuous conversions on a second ADC, compared against the window in hardware.
+    // Only the watchdog interrupt is enabled, no CPU is used while inside the window.
+    __HAL_RCC_ADC2_CLK_ENABLE();
+    watchdogAdc.Instance = PRESSURE_WATCHDOG_ADC;
+    watchdogAdc.Init.ClockPrescaler = ADC_CLOCK_SYNC_PCLK_DIV4;
+    watchdogAdc.Init.Resolution = ADC_RESOLUTION_12B;
+    watchdogAdc.Init.ScanConvMode = DISABLE;
+    watchdogAdc.Init.ContinuousConvMode = ENABLE;
+    watchdogAdc.Init.DiscontinuousConvMode = DISABLE;
+    watchdogAdc.Init.ExternalTrigConvEdge = ADC_EXTERNALTRIGCONVEDGE_NONE;
+    watchdogAdc.Init.ExternalTrigConv = ADC_SOFTWARE_START;
+    watchdogAdc.Init.DataAlign = ADC_DATAALIGN_RIGHT;
+    watchdogAdc.Init.NbrOfConversion = 1;
+    watchdogAdc.Init.DMAContinuousRequests = DISABLE;
+    watchdogAdc.Init.EOCSelection = ADC_EOC_SINGLE_CONV;
+    HAL_ADC_Init(&watchdogAdc);
+
+    channel.Channel = PRESSURE_WATCHDOG_CHANNEL;
+    channel.Rank = 1;
+    channel.SamplingTime = ADC_SAMPLETIME_480CYCLES;
+    HAL_ADC_ConfigChannel(&watchdogAdc, &channel);
+
+    watchdog.WatchdogMode = ADC_ANALOGWATCHDOG_SINGLE_REG;
+    watchdog.Channel = PRESSURE_WATCHDOG_CHANNEL;
+    watchdog.HighThreshold = ADC_FULL_SCALE;
+    watchdog.LowThreshold = 0;
+    watchdog.ITMode = ENABLE;
+    HAL_ADC_AnalogWDGConfig(&watchdogAdc, &watchdog);
+
+    NVIC_SetVector(ADC_IRQn, (uint32_t) &PressureGauge::_watchdogIrq);
+    NVIC_EnableIRQ(ADC_IRQn);
+    HAL_ADC_Start(&watchdogAdc);
+#endif
+
+    _programWindow();
   }
 
   void PressureGauge::update()
   {
-    float pressure;
     float analog_reading = _pin.read();
     float voltage = analog_reading * ref;
-    printf("PressureGauge - Analog read: [%.2f]\n\r", voltage);
+    LOG_DEBUG(LOG_MODULE_PRESSURE_GAUGE, LOG_PRESSURE_GAUGE_READ, voltage);
     if (voltage < MIN_READING_VALUE) {
       voltage = MIN_READING_VALUE;
     }
 
-    if (unit == UNIT_BAR) {
-      pressure = (voltage - MIN_READING_VALUE) * (MAX_PRESS_VALUE_BAR / (MAX_READING_VALUE - MIN_READING_VALUE));
-    } else if (unit == UNIT_PSI) {
-      pressure = (voltage - MIN_READING_VALUE) * (MAX_PRESS_VALUE_PSI / (MAX_READING_VALUE - MIN_READING_VALUE));
-    } else {
-      pressure = 0;
-    }
-    
-    lastReading = pressure;
+    lastVoltage = voltage;
+    lastReading = _convert(voltage);
 
+#if !PRESSURE_WATCHDOG_HW
+    if (watchdog_gauge == this) {
+      simulateWatchdogSample(voltage);
+    }
+#endif
   }
 
   float PressureGauge::getLastReading()
@@ -53,6 +108,7 @@ namespace Drivers {
   void PressureGauge::setUnit(unit_t fUnit)
   {
     unit = fUnit;
+    lastReading = _convert(lastVoltage);
   }
 
   bool PressureGauge::isUnitSet()
@@ -65,4 +121,125 @@ namespace Drivers {
     return unit;
   }
 
+  void PressureGauge::setThreshold(float threshold)
+  {
+    core_util_critical_section_enter();
+
+    isWatchdogArmed = isUnitSet();
+
+    if (isWatchdogArmed) {
+      const float maxPressure = (unit == UNIT_BAR) ? MAX_PRESS_VALUE_BAR : MAX_PRESS_VALUE_PSI;
+      const float voltage = MIN_READING_VALUE + threshold * ((MAX_READING_VALUE - MIN_READING_VALUE) / maxPressure);
+
+      thresholdRaw = (uint16_t) ((voltage / ref) * ADC_FULL_SCALE);
+      isBelowThreshold = (lastVoltage < voltage);
+    }
+
+    _programWindow();
+
+    core_util_critical_section_exit();
+  }
+
+  bool PressureGauge::hasThresholdCrossed()
+  {
+    if (!isThresholdCrossed) {
+      return false;
+    }
+
+    isThresholdCrossed = false;
+
+    return true;
+  }
+
+#if !PRESSURE_WATCHDOG_HW
+  void PressureGauge::simulateWatchdogSample(float voltage)
+  {
+    PressureGauge *gauge = watchdog_gauge;
+
+    if (gauge == nullptr) {
+      return;
+    }
+
+    const uint16_t sample = (uint16_t) ((voltage / gauge->ref) * ADC_FULL_SCALE);
+
+    if ((sample < gauge->windowLow) || (sample > gauge->windowHigh)) {
+      _watchdogIrq();
+    }
+  }
+#endif
+
+//====================[Implementations of private methods]=======================
+
+  /**
+  * @brief Converts a sensor voltage to pressure in the configured unit.
+  * @param voltage Sensor voltage, already clamped to MIN_READING_VALUE.
+  * @return float Pressure, or 0 if no unit is set.
+  */
+  float PressureGauge::_convert(float voltage)
+  {
+    if (unit == UNIT_BAR) {
+      return (voltage - MIN_READING_VALUE) * (MAX_PRESS_VALUE_BAR / (MAX_READING_VALUE - MIN_READING_VALUE));
+    } else if (unit == UNIT_PSI) {
+      return (voltage - MIN_READING_VALUE) * (MAX_PRESS_VALUE_PSI / (MAX_READING_VALUE - MIN_READING_VALUE));
+    }
+
+    return 0;
+  }
+
+  /**
+  * @brief Programs the watchdog window for the side of the threshold the pressure is on.
+  *
+  * Above the threshold the window is [threshold, full scale], below it it is
+  * [0, threshold + hysteresis]. A disarmed watchdog gets the whole range.
+  */
+  void PressureGauge::_programWindow()
+  {
+    const uint32_t hysteresis = (uint32_t) ((PRESSURE_WATCHDOG_HYSTERESIS / ref) * ADC_FULL_SCALE);
+
+    if (!isWatchdogArmed) {
+      windowLow = 0;
+      windowHigh = ADC_FULL_SCALE;
+    } else if (isBelowThreshold) {
+      windowLow = 0;
+      windowHigh = (uint16_t) std::min<uint32_t>(thresholdRaw + hysteresis, ADC_FULL_SCALE);
+    } else {
+      windowLow = thresholdRaw;
+      windowHigh = ADC_FULL_SCALE;
+    }
+
+#if PRESSURE_WATCHDOG_HW
+    if (watchdog_gauge == this) {
+      watchdogAdc.Instance->LTR = windowLow;
+      watchdogAdc.Instance->HTR = windowHigh;
+    }
+#endif
+  }
+
+  /**
+  * @brief Watchdog interrupt. The pressure left the window: flags the crossing
+  *        and flips the window, so the interrupt stops until it crosses back.
+  */
+  void PressureGauge::_watchdogIrq()
+  {
+    PressureGauge *gauge = watchdog_gauge;
+
+    if (gauge == nullptr) {
+      return;
+    }
+
+#if PRESSURE_WATCHDOG_HW
+    if (!__HAL_ADC_GET_FLAG(&gauge->watchdogAdc, ADC_FLAG_AWD)) {
+      return;
+    }
+#endif
+
+    gauge->isBelowThreshold = !gauge->isBelowThreshold;
+    gauge->_programWindow();
+    gauge->isThresholdCrossed = true;
+
+#if PRESSURE_WATCHDOG_HW
+    __HAL_ADC_CLEAR_FLAG(&gauge->watchdogAdc, ADC_FLAG_AWD);
+#endif
+  }
+
 }; // namespace Drivers
\ No newline at end of file
@@ -30,6 +30,31 @@
 /** @brief Maximum measurable pressure in psi, depends on sensor model. */
 #define MAX_PRESS_VALUE_PSI 3000  // [psi]
 
+/** @brief Full scale count of the 12 bit ADC. */
+#define ADC_FULL_SCALE      4095
+
+/**
+ * @brief Threshold crossings detected by the ADC analog watchdog. Only STM32F4
+ *        targets have it, elsewhere a stand-in checks the samples taken by
+ *        update(), so crossings are only seen on the periodic samples.
+ */
+#ifndef PRESSURE_WATCHDOG_HW
+#if defined(TARGET_STM32F4)
+#define PRESSURE_WATCHDOG_HW      1
+#else
+#define PRESSURE_WATCHDOG_HW      0
+#endif
+#endif
+
+/** @brief ADC converting continuously for the watchdog. AnalogIn keeps ADC1 for reads. */
+#define PRESSURE_WATCHDOG_ADC     ADC2
+
+/** @brief Watchdog channel. A1 (PC_0) is ADC123_IN10 on the NUCLEO-F429ZI. */
+#define PRESSURE_WATCHDOG_CHANNEL ADC_CHANNEL_10
+
+/** @brief Hysteresis of the watchdog window [V], keeps noise from toggling it. */
+#define PRESSURE_WATCHDOG_HYSTERESIS  0.02f
+
 namespace Drivers {
   /**
   * @class PressureGauge
@@ -62,6 +87,8 @@ namespace Drivers {
     * @brief Initializes the pressure gauge system.
     *
     * Should be called once before use. Typically used to configure internal references.
+    * The threshold watchdog is only set up for the first gauge initialized, there
+    * is one watchdog ADC.
     */
     void init();
 
@@ -80,6 +107,9 @@ namespace Drivers {
 
     /**
     * @brief Sets the pressure unit for conversion and display.
+    *
+    * The last reading is converted to the new unit without reading the ADC again.
+    *
     * @param fUnit Unit to be used (BAR or PSI).
     */
     void setUnit(unit_t fUnit);
@@ -97,12 +127,55 @@ namespace Drivers {
     */
     unit_t get_unit();  
 
+    /**
+    * @brief Arms the threshold watchdog.
+    *
+    * The ADC compares every conversion against a window around the threshold in
+    * hardware, and interrupts only when the pressure crosses it. The window is
+    * then flipped to catch the crossing back. Disarmed while no unit is set.
+    *
+    * @param threshold Pressure threshold in the configured unit.
+    */
+    void setThreshold(float threshold);
+
+    /**
+    * @brief Checks and clears the crossing flag set by the watchdog.
+    * @retval true if the threshold was crossed since the last call.
+    */
+    bool hasThresholdCrossed();
+
+#if !PRESSURE_WATCHDOG_HW
+    /**
+    * @brief Feeds a sensor voltage to the watchdog stand-in, as if converted by
+    *        the ADC. Crossings are reported to the gauge that owns the watchdog
+    *        as the hardware one does. update() feeds its own samples.
+    * @param voltage Sensor voltage [V].
+    */
+    static void simulateWatchdogSample(float voltage);
+#endif
+
   private:
 
+    float _convert(float voltage);
+
+    void _programWindow();
+
+    static void _watchdogIrq();
+
     AnalogIn _pin;        /**< Analog input pin used to read sensor. */
     unit_t unit;          /**< Configured unit for pressure value. */
     float lastReading;   /**< Last computed pressure value based on sensor reading. */
+    float lastVoltage;    /**< Last sensor voltage, kept to convert it again on unit changes. */
     float ref;            /**< ADC reference voltage (typically 3.3V on Nucleo boards). */
+    uint16_t thresholdRaw;                /**< Watchdog threshold in ADC counts. */
+    bool isWatchdogArmed;                 /**< Watchdog programmed with a threshold. */
+    volatile bool isBelowThreshold;       /**< Side of the threshold the window is waiting to leave. */
+    volatile bool isThresholdCrossed;     /**< Set by the watchdog, cleared by hasThresholdCrossed(). */
+    volatile uint16_t windowLow;          /**< Lower bound of the watchdog window [counts]. */
+    volatile uint16_t windowHigh;         /**< Upper bound of the watchdog window [counts]. */
+#if PRESSURE_WATCHDOG_HW
+    ADC_HandleTypeDef watchdogAdc;        /**< ADC running the analog watchdog. */
+#endif
 
   }; // Class PreassureGauge
 
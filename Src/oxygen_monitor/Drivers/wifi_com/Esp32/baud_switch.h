@@ -0,0 +1,132 @@
+/********************************************************************************
+ * @file baud_switch.h
+ * @brief UART rate negotiation of the ESP32 bridge. Free of the Arduino core,
+ *        so it is checked on the host as well.
+ * @author Gonzalo Puy.
+ * @date Jun 2025
+ *******************************************************************************/
+
+#ifndef BAUD_SWITCH_H
+#define BAUD_SWITCH_H
+
+#include <atomic>
+#include <stdint.h>
+
+// ---------------------------------------------------------------------------------------
+// The baud command is acknowledged at the current rate, and the acknowledge carries the
+// switch: the writer changes the rate right after writing it, and only then. Responses
+// queued ahead of it, from the workers or events, still go out at the old rate. The new
+// rate is confirmed by the next command read, otherwise the bridge goes back to the
+// base rate, the one the Nucleo boots at.
+//
+// The reader task asks for switches and reads commands, the writer task applies them,
+// loop() times them out.
+class BaudSwitch
+{
+public:
+    BaudSwitch(uint32_t baseRate, uint32_t maxRate, unsigned long confirmTimeout)
+    : baseRate(baseRate), maxRate(maxRate), confirmTimeout(confirmTimeout), requestedRate(0),
+      isRequestedFlowControl(false), rate(baseRate), isFlowControl(false), isPendingFlowControl(false),
+      pendingCount(0), isConfirmed(true), switchTime(0)
+    {
+    }
+
+    // Baud command. false if the rate is not supported.
+    bool request(uint32_t baudRate, bool isFlowControlled)
+    {
+        if ((baudRate < baseRate) || (baudRate > maxRate))
+            return false;
+
+        requestedRate = baudRate;
+        isRequestedFlowControl = isFlowControlled;
+
+        return true;
+    }
+
+    // Reader, queueing the result of a command: the switch its acknowledge carries,
+    // 0 for none.
+    uint32_t takeRequest()
+    {
+        const uint32_t baudRate = requestedRate;
+
+        if (baudRate != 0)
+        {
+            isPendingFlowControl = isRequestedFlowControl;
+            pendingCount++;
+            requestedRate = 0;
+        }
+
+        return baudRate;
+    }
+
+    // Writer, once a response is out with the switch it carries. true if the UART has to
+    // switch to getRate() now.
+    bool onSent(uint32_t switchBaud, unsigned long now)
+    {
+        if (switchBaud == 0)
+            return false;
+
+        rate = switchBaud;
+        isFlowControl = isPendingFlowControl;
+        switchTime = now;
+        isConfirmed = false;
+        pendingCount--;
+
+        return true;
+    }
+
+    // Reader, a command read at the current rate.
+    void onCommand()
+    {
+        isConfirmed = true;
+    }
+
+    // Reader, a frame that is no command. true if the UART has to go back to the base
+    // rate: garbage above it means the Nucleo restarted and talks at the base rate.
+    bool onGarbage()
+    {
+        if ((rate == baseRate) || (pendingCount != 0))
+            return false;
+
+        return _Fallback();
+    }
+
+    // loop(). true if the UART has to go back to the base rate: the Nucleo didn't
+    // follow the switch.
+    bool update(unsigned long now)
+    {
+        if (isConfirmed || ((now - switchTime) < confirmTimeout))
+            return false;
+
+        return _Fallback();
+    }
+
+    uint32_t getRate() const { return rate; }
+    bool isFlowControlled() const { return isFlowControl; }
+    bool isSwitchPending() const { return (pendingCount != 0); }
+
+private:
+    bool _Fallback()
+    {
+        rate = baseRate;
+        isFlowControl = false;
+        isConfirmed = true;
+
+        return true;
+    }
+
+    const uint32_t baseRate;
+    const uint32_t maxRate;
+    const unsigned long confirmTimeout;  // [ms] Wait for a command at a new rate
+
+    uint32_t requestedRate;              // Asked by the baud command being run, reader only
+    bool isRequestedFlowControl;
+    volatile uint32_t rate;              // Rate in use
+    volatile bool isFlowControl;
+    volatile bool isPendingFlowControl;  // Flow control of the switch on its way to the writer
+    std::atomic<int> pendingCount;       // Acknowledges queued with a switch, not written yet
+    volatile bool isConfirmed;           // A command was read since the last switch
+    volatile unsigned long switchTime;   // [ms]
+};
+
+#endif // BAUD_SWITCH_H
@@ -13,14 +13,43 @@ const char COMMAND_POST_STR[]         = "post";
 const char COMMAND_GET_STR[]          = "get";
 const char COMMAND_STATUS_STR[]       = "status";
 const char COMMAND_ACCESSPOINT_STR[]  = "accesspoint";
+const char COMMAND_BROADCAST_STR[]    = "broadcast";
+const char COMMAND_LOG_LEVEL_STR[]    = "loglevel";
+const char COMMAND_TELEMETRY_STR[]    = "telemetry";
+const char COMMAND_BAUD_STR[]         = "baud";
+const char COMMAND_FILL_STR[]         = "fill";
+const char COMMAND_ENDPOINT_STR[]     = "endpoint";   // endpoint|<id>|<url>
+const char COMMAND_WEBHOOK_STR[]      = "webhook";    // webhook|<port>[|<secret>], port 0 stops it
+const char COMMAND_HOLD_STR[]         = "hold";       // hold|<ms>, nothing is sent for <ms> after the answer, 0 resumes
 
 const char RESULT_ERROR[]             = "ERROR";
 const char RESULT_OK[]                = "OK";
 const char RESULT_CONNECTED[]         = "CONNECTED";
 const char RESULT_NOT_CONNECTED[]     = "NOT_CONNECTED";
+const char RESULT_CONNECTING[]        = "CONNECTING";
 const char RESULT_AP_WAITING[]        = "AP_WAITING";
+const char RESULT_NO_ENDPOINT[]       = "NO_ENDPOINT";
+
+// Unsolicited frames pushed by the ESP32: !<event>|<p1>|<p2>~
+const char EVENT_LINK_UP_STR[]        = "linkup";     // !linkup|<ip>|<rssi>
+const char EVENT_LINK_DOWN_STR[]      = "linkdown";   // !linkdown|<reason>
+const char EVENT_RSSI_STR[]           = "rssi";       // !rssi|<dBm>
+const char EVENT_IP_STR[]             = "ip";         // !ip|<ip>
+const char EVENT_UPDATE_STR[]         = "update";     // !update|<JSON body pushed to the webhook>, '~' as \u007e
 
 const char PARAM_SEPARATOR_CHAR       = '|';
 const char STOP_CHAR                  = '~';
+const char LIST_SEPARATOR_CHAR        = ',';
+const char REQUEST_ID_CHAR            = '@';
+const char EVENT_CHAR                 = '!';
+
+// HTTP bodies are streamed before the result, as [@<id>|]*<length>|<length raw bytes>,
+// without stop character: the bytes may hold any character.
+const char CHUNK_CHAR                 = '*';
+
+// A server parameter "#<id>" stands for the URL registered with the endpoint command.
+// The ID is a single character, '0' + index.
+const char ENDPOINT_CHAR              = '#';
+const unsigned int ENDPOINT_COUNT_MAX = 8;
 
 #endif // COMMANDS_H
\ No newline at end of file
@@ -2,118 +2,490 @@
 #include <functional>
 #include <HTTPClient.h>
 #include <map>
+#include <Preferences.h>
 #include <vector>
 #include <WiFi.h>
-#include <ArduinoJson.h>
+#include <WiFiUdp.h>
+#include <WebServer.h>
+#include "esp32/rom/miniz.h"
 
+#include "baud_switch.h"
 #include "commands.h"
+#include "gzip_header.h"
 
 #define RXD2 16
 #define TXD2 17
+#define RTS2 18     // To the Nucleo CTS
+#define CTS2 19     // From the Nucleo RTS
 #define LED_WIFI_STATUS 2
 #define MAX_PARAMS 10
 
-#define DEBUG_PRINTLN(format, ...) \
-    Serial.printf(format "\r\n", ##__VA_ARGS__)
+#define HTTP_WORKER_COUNT       2       // Requests served at the same time
+#define HTTP_WORKER_STACK_SIZE  12288   // TLS handshakes need a big stack
+#define UART_TASK_STACK_SIZE    4096
+#define JOB_QUEUE_LENGTH        8
+#define RESPONSE_QUEUE_LENGTH   8
+
+#define FAST_CONNECT_TIMEOUT    1500    // [ms] Association with the cached BSSID, channel and lease
+#define FULL_CONNECT_TIMEOUT    8000    // [ms] Association with scan and DHCP, per network
+
+#define RSSI_EVENT_INTERVAL     10000   // [ms] Signal strength check period
+#define RSSI_EVENT_THRESHOLD    5       // [dB] Change reported to the Nucleo
+#define EVENT_QUEUE_TIMEOUT     100     // [ms] Wait for room in the response queue
+
+#define BASE_BAUD_RATE          115200  // UART rate at boot, and the fallback
+#define BAUD_CONFIRM_TIMEOUT    1000    // [ms] Wait for a command at a new rate before going back
+#define MAX_BAUD_RATE           5000000 // Highest rate taken by the baud command
+#define FLOW_CONTROL_THRESHOLD  64      // RX FIFO bytes at which RTS is released
+#define HOLD_TIME_MAX           10000   // [ms] Longest hold asked by the hold command
+#define FILL_SIZE_MAX           8192    // Longest fill command answer
+#define STREAM_CHUNK_SIZE       256     // Largest body chunk sent to the Nucleo
+#define GZIP_HEAP_MIN           65536   // Largest free heap block needed to allocate the inflate buffers, 43 KB
+#define WEBHOOK_BODY_MAX        2048    // Longest update accepted by the webhook, as much as the Nucleo keeps
+#define WEBHOOK_POLL_INTERVAL   5       // [ms] Wait between checks for webhook clients
+#define WEBHOOK_SECRET_HEADER   "X-Telegram-Bot-Api-Secret-Token"
+
+#define DEBUG_LEVEL_ERROR   1
+#define DEBUG_LEVEL_INFO    2
+#define DEBUG_LEVEL_VERBOSE 3
+
+// Highest level compiled in. Runtime level can be lowered with the loglevel command.
+#ifndef DEBUG_LEVEL
+#define DEBUG_LEVEL DEBUG_LEVEL_INFO
+#endif
+
+int debugLevel = DEBUG_LEVEL;
+
+#define DEBUG_LOG(level, format, ...) \
+    do { if (((level) <= DEBUG_LEVEL) && ((level) <= debugLevel)) Serial.printf(format "\r\n", ##__VA_ARGS__); } while (0)
+
+#define DEBUG_PRINTLN(format, ...) DEBUG_LOG(DEBUG_LEVEL_INFO, format, ##__VA_ARGS__)
+#define DEBUG_ERROR(format, ...)   DEBUG_LOG(DEBUG_LEVEL_ERROR, format, ##__VA_ARGS__)
+#define DEBUG_VERBOSE(format, ...) DEBUG_LOG(DEBUG_LEVEL_VERBOSE, format, ##__VA_ARGS__)
 
 
 // Map of the possible commands and their associated function
+// Commands in commandsMap answer right away and run in the UART reader task. Commands in
+// workerCommandsMap block on the network and run in the worker pool.
 using CommandFunction = std::function<String(const std::array<String, MAX_PARAMS>&, size_t)>;
 std::map<String, CommandFunction> commandsMap;
+std::map<String, CommandFunction> workerCommandsMap;
+
+// A command waiting for a worker. Queues hold pointers, String can't be copied as bytes.
+struct Job
+{
+    String id;
+    std::array<String, MAX_PARAMS> params;
+    size_t paramCount;
+    CommandFunction function;
+};
+
+// A result waiting for the UART writer, tagged with the ID of its request.
+// Body chunks go out length prefixed, ahead of the result of their request.
+struct Response
+{
+    String id;
+    String result;
+    bool isChunk;
+    uint32_t holdTime;      // [ms] Nothing is sent for this long once the result is out
+    uint32_t switchBaud;    // UART rate switched to once the result is out, 0 for none
+};
+
+QueueHandle_t jobQueue;
+QueueHandle_t responseQueue;
 
 // Functions declarations
 String CommandConnectToWiFi(const std::array<String, MAX_PARAMS>& params, size_t paramCount);
 String CommandPostToServer(const std::array<String, MAX_PARAMS>& params, size_t paramCount);
 String CommandGet(const std::array<String, MAX_PARAMS>& params, size_t paramCount);
 String CommandStatus(const std::array<String, MAX_PARAMS>& params, size_t paramCount);
+String CommandBroadcast(const std::array<String, MAX_PARAMS>& params, size_t paramCount);
+String CommandLogLevel(const std::array<String, MAX_PARAMS>& params, size_t paramCount);
+String CommandTelemetry(const std::array<String, MAX_PARAMS>& params, size_t paramCount);
+String CommandBaud(const std::array<String, MAX_PARAMS>& params, size_t paramCount);
+String CommandFill(const std::array<String, MAX_PARAMS>& params, size_t paramCount);
+String CommandEndpoint(const std::array<String, MAX_PARAMS>& params, size_t paramCount);
+String CommandWebhook(const std::array<String, MAX_PARAMS>& params, size_t paramCount);
+String CommandHold(const std::array<String, MAX_PARAMS>& params, size_t paramCount);
+
+void UartReaderTask(void *arg);
+void WorkerTask(void *arg);
+void UartWriterTask(void *arg);
+void WebhookTask(void *arg);
+
+// Job run by the current worker, so commands can stream their body under its request ID.
+static thread_local const Job *workerJob = nullptr;
+
+// Inflate state and window of a gzip body, 43 KB. A single set, allocated on first use
+// and kept: one worker inflates at a time, the other one gets identity bodies meanwhile.
+struct GzipBuffers
+{
+    tinfl_decompressor inflator;
+    uint8_t window[TINFL_LZ_DICT_SIZE];
+};
+
+GzipBuffers *gzipBuffers = nullptr;
+SemaphoreHandle_t gzipMutex;
+
+GzipBuffers *_AcceptGzip(HTTPClient &http);
+void _ReleaseGzip(GzipBuffers *buffers);
+String _StreamBody(HTTPClient &http, const char *command, unsigned long startTime, GzipBuffers *buffers);
 
 std::array<String, MAX_PARAMS> _ParseParameters(const String &input, size_t &paramCount);
+void _QueueResponse(const String &id, const String &result, uint32_t holdTime = 0, uint32_t switchBaud = 0);
 bool _IsConnected();
+bool _IsConnecting();
+
+// Networks of the last connect command, in order of preference.
+struct Network
+{
+    String ssid;
+    String password;
+};
+
+// Last association, kept in flash. Reusing BSSID, channel and lease skips the scan
+// and DHCP, which take most of the association time.
+struct LinkCache
+{
+    bool isValid;
+    String ssid;
+    uint8_t bssid[6];
+    int32_t channel;
+    uint32_t ip;
+    uint32_t gateway;
+    uint32_t subnet;
+    uint32_t dns;
+};
+
+#define CONNECT_ATTEMPT_CACHED  -1      // Attempt with the link cache, before the networks
+
+std::vector<Network> networks;
+LinkCache linkCache;
+Preferences preferences;
+SemaphoreHandle_t networksMutex;
+
+// Set by the connect command, association then runs in the background, driven by loop().
+volatile bool isConnectRequested = false;
+volatile bool isConnectRestarted = false;
+int connectAttempt;
+unsigned long connectAttemptStart;
+
+void _UpdateConnection();
+bool _StartConnectAttempt(int attempt);
+void _LoadLinkCache();
+void _SaveLinkCache();
+void _ClearLinkCache();
+
+// Link state as last reported to the Nucleo.
+bool isLinkUpReported = false;
+int32_t lastReportedRssi = 0;
+unsigned long lastRssiCheck = 0;
+
+void _OnWiFiEvent(WiFiEvent_t event, WiFiEventInfo_t info);
+void _UpdateRssi();
+bool _QueueEvent(const char *event, const String &params);
+
+// UART rate requested by the baud command, applied by the writer once the acknowledge is out.
+// Only confirmed when a command is read at the new rate, otherwise loop() goes back to the base rate.
+BaudSwitch baudSwitch(BASE_BAUD_RATE, MAX_BAUD_RATE, BAUD_CONFIRM_TIMEOUT);
+
+void _SetBaudRate(uint32_t baudRate, bool isFlowControlled);
+void _UpdateBaudRate();
+
+// Hold asked by the hold command, the Nucleo can't read the UART for a while (flash erase).
+// Results and events wait in the response queue meanwhile. Set by the reader task only.
+uint32_t requestedHoldTime = 0;
+volatile unsigned long uartHoldStart = 0;
+volatile uint32_t uartHoldTime = 0;
+
+// URLs registered by the Nucleo, so requests carry a 1 byte ID instead of URL and token.
+// Lost on reset: the Nucleo registers them again when it reads NO_ENDPOINT.
+std::array<String, ENDPOINT_COUNT_MAX> endpoints;
+SemaphoreHandle_t endpointsMutex;
+
+bool _ResolveServer(const String &server, String &url);
+String _Redacted(const String &server);
+
+// Local HTTP server receiving updates pushed by Telegram, through a TLS proxy, or by a LAN
+// relay. Each one goes to the Nucleo as an update event, with no getUpdates polling at all.
+// Port and secret are set by the webhook command, the server runs in its own task.
+WebServer webhookServer;
+uint16_t webhookPort = 0;
+String webhookSecret;
+SemaphoreHandle_t webhookMutex;
+
+void _OnWebhookRequest();
 
 // ---------------------------------------------------------------------------------------
 void setup() 
 {
     Serial.begin(115200);
-    Serial2.begin(115200, SERIAL_8N1, RXD2, TXD2);
+    Serial2.begin(BASE_BAUD_RATE, SERIAL_8N1, RXD2, TXD2);
 
     pinMode(LED_WIFI_STATUS,OUTPUT);
 
+    networksMutex = xSemaphoreCreateMutex();
+    endpointsMutex = xSemaphoreCreateMutex();
+    webhookMutex = xSemaphoreCreateMutex();
+    gzipMutex = xSemaphoreCreateMutex();
+    _LoadLinkCache();
+    WiFi.onEvent(_OnWiFiEvent);
+
     commandsMap[COMMAND_CONNECT_STR]        = CommandConnectToWiFi;
-    commandsMap[COMMAND_POST_STR]           = CommandPostToServer;
-    commandsMap[COMMAND_GET_STR]            = CommandGet;
     commandsMap[COMMAND_STATUS_STR]         = CommandStatus;
+    commandsMap[COMMAND_LOG_LEVEL_STR]      = CommandLogLevel;
+    commandsMap[COMMAND_BAUD_STR]           = CommandBaud;
+    commandsMap[COMMAND_FILL_STR]           = CommandFill;
+    commandsMap[COMMAND_ENDPOINT_STR]       = CommandEndpoint;
+    commandsMap[COMMAND_WEBHOOK_STR]        = CommandWebhook;
+    commandsMap[COMMAND_HOLD_STR]           = CommandHold;
+
+    workerCommandsMap[COMMAND_POST_STR]       = CommandPostToServer;
+    workerCommandsMap[COMMAND_GET_STR]        = CommandGet;
+    workerCommandsMap[COMMAND_BROADCAST_STR]  = CommandBroadcast;
+    workerCommandsMap[COMMAND_TELEMETRY_STR]  = CommandTelemetry;
+
+    jobQueue = xQueueCreate(JOB_QUEUE_LENGTH, sizeof(Job*));
+    responseQueue = xQueueCreate(RESPONSE_QUEUE_LENGTH, sizeof(Response*));
+
+    xTaskCreate(UartWriterTask, "uart_writer", UART_TASK_STACK_SIZE, NULL, 2, NULL);
+    for (int i = 0; i < HTTP_WORKER_COUNT; i++)
+        xTaskCreate(WorkerTask, "http_worker", HTTP_WORKER_STACK_SIZE, NULL, 1, NULL);
+    xTaskCreate(UartReaderTask, "uart_reader", UART_TASK_STACK_SIZE, NULL, 2, NULL);
+    xTaskCreate(WebhookTask, "webhook", UART_TASK_STACK_SIZE, NULL, 1, NULL);
 }
 
 // ---------------------------------------------------------------------------------------
 void loop()
 {
     digitalWrite(LED_WIFI_STATUS, (_IsConnected()) ? HIGH : LOW);
-    
-    if (Serial2.available()) 
+    _UpdateConnection();
+    _UpdateRssi();
+    _UpdateBaudRate();
+    delay(50);
+}
+
+// ---------------------------------------------------------------------------------------
+// Reads frames from the Nucleo. A frame may start with "@<id>|", the ID is sent back
+// with the result so the Nucleo can tell which request a result belongs to.
+void UartReaderTask(void *arg)
+{
+    for (;;)
     {
-        String commandExecutionResult;
+        if (!Serial2.available())
+        {
+            vTaskDelay(1);
+            continue;
+        }
 
         String strReceived = Serial2.readStringUntil(STOP_CHAR);
+        String id;
+
         strReceived.trim();
-        DEBUG_PRINTLN("Command and parameters received \n\r[%s]", strReceived.c_str());
+
+        if (strReceived.startsWith(String(REQUEST_ID_CHAR)))
+        {
+            int index = strReceived.indexOf(PARAM_SEPARATOR_CHAR);
+
+            if (index < 0)
+                index = strReceived.length();
+
+            id = strReceived.substring(1, index);
+            strReceived = strReceived.substring(index + 1);
+        }
 
         size_t paramCount = 0;
         std::array<String, MAX_PARAMS> params = _ParseParameters(strReceived, paramCount);
         String cmd = params[0];
 
+        // Parameters hold the WiFi password, bot tokens in URLs and the webhook secret.
+        DEBUG_VERBOSE("Command [%s] received, [%u] bytes", cmd.c_str(), strReceived.length());
+
         if (commandsMap.find(cmd) != commandsMap.end()) 
         {
-            CommandFunction commandFunction = commandsMap[cmd];
-            commandExecutionResult = commandFunction(params, paramCount);
+            baudSwitch.onCommand();
 
-            Serial2.flush();
-            Serial2.print(commandExecutionResult.c_str());
-            Serial2.print(STOP_CHAR);
+            String result = commandsMap[cmd](params, paramCount);
 
-            DEBUG_PRINTLN("Result = [%s] sent to Nucleo Board", commandExecutionResult.c_str());
+            // The hold and the rate switch start once their acknowledge is out, not before
+            // results already queued.
+            _QueueResponse(id, result, requestedHoldTime, baudSwitch.takeRequest());
+            requestedHoldTime = 0;
         } 
+        else if (workerCommandsMap.find(cmd) != workerCommandsMap.end())
+        {
+            baudSwitch.onCommand();
+
+            Job *job = new Job{ id, params, paramCount, workerCommandsMap[cmd] };
+
+            if (xQueueSend(jobQueue, &job, 0) != pdTRUE)
+            {
+                DEBUG_ERROR("Command [%s] dropped, every worker is busy", cmd.c_str());
+                delete job;
+                _QueueResponse(id, RESULT_ERROR);
+            }
+        }
         else 
         {
-            DEBUG_PRINTLN("Command [%s] not found", cmd.c_str());
+            DEBUG_ERROR("Command [%s] not found", cmd.c_str());
+
+            // Garbage above the base rate: the Nucleo restarted and talks at the base rate.
+            if (baudSwitch.onGarbage())
+                _SetBaudRate(BASE_BAUD_RATE, false);
         }
     }
 }
 
 // ---------------------------------------------------------------------------------------
-String CommandConnectToWiFi(const std::array<String, MAX_PARAMS>& params, size_t paramCount)
+// Runs the commands that block on the network. Workers run side by side, so a slow
+// server doesn't hold back the other commands.
+void WorkerTask(void *arg)
 {
-    if (paramCount == 3) 
+    for (;;)
     {
-        String ssid = params[1];
-        String password = params[2];
+        Job *job;
 
-        WiFi.begin(ssid.c_str(), password.c_str());
-
-        DEBUG_PRINTLN("CommandConnectToWiFi - Connecting to WiFi: [%s]", ssid.c_str());
+        if (xQueueReceive(jobQueue, &job, portMAX_DELAY) == pdTRUE)
+        {
+            workerJob = job;
+            _QueueResponse(job->id, job->function(job->params, job->paramCount));
+            workerJob = nullptr;
+            delete job;
+        }
+    }
+}
 
-        int attempts = 0;
+// ---------------------------------------------------------------------------------------
+// Only task writing to Serial2, so results never interleave.
+void UartWriterTask(void *arg)
+{
+    for (;;)
+    {
+        Response *response;
 
-        while ((WiFi.status() != WL_CONNECTED) && (attempts < 10)) 
+        if (xQueueReceive(responseQueue, &response, portMAX_DELAY) == pdTRUE)
         {
-            delay(1000);
-            Serial.print(".");
-            attempts++;
+            while ((uartHoldTime != 0) && ((millis() - uartHoldStart) < uartHoldTime))
+                vTaskDelay(1);
+
+            if (response->id.length() > 0)
+            {
+                Serial2.print(REQUEST_ID_CHAR);
+                Serial2.print(response->id);
+                Serial2.print(PARAM_SEPARATOR_CHAR);
+            }
+            if (response->isChunk)
+            {
+                Serial2.print(CHUNK_CHAR);
+                Serial2.print(response->result.length());
+                Serial2.print(PARAM_SEPARATOR_CHAR);
+                Serial2.write((const uint8_t *) response->result.c_str(), response->result.length());
+
+                DEBUG_VERBOSE("Chunk of [%u] bytes sent to Nucleo Board", response->result.length());
+            }
+            else
+            {
+                Serial2.print(response->result.c_str());
+                Serial2.print(STOP_CHAR);
+
+                DEBUG_VERBOSE("Result = [%s] sent to Nucleo Board", response->result.c_str());
+            }
+
+            if (response->holdTime != 0)
+            {
+                Serial2.flush();
+                uartHoldStart = millis();
+                uartHoldTime = response->holdTime;
+            }
+
+            // Only the baud command acknowledge switches the rate. Results and events
+            // queued ahead of it went out at the old one.
+            if (baudSwitch.onSent(response->switchBaud, millis()))
+            {
+                Serial2.flush();
+                _SetBaudRate(baudSwitch.getRate(), baudSwitch.isFlowControlled());
+            }
+            delete response;
         }
+    }
+}
 
-        if (WiFi.status() == WL_CONNECTED) 
+// ---------------------------------------------------------------------------------------
+// Serves the webhook. The server is (re)started here when the webhook command changes
+// the port, so it is only ever touched by this task.
+void WebhookTask(void *arg)
+{
+    static const char *headerKeys[] = { WEBHOOK_SECRET_HEADER };
+    uint16_t port = 0;
+
+    webhookServer.onNotFound(_OnWebhookRequest);
+    webhookServer.collectHeaders(headerKeys, 1);
+
+    for (;;)
+    {
+        xSemaphoreTake(webhookMutex, portMAX_DELAY);
+        const uint16_t requestedPort = webhookPort;
+        xSemaphoreGive(webhookMutex);
+
+        if (requestedPort != port)
         {
-            DEBUG_PRINTLN("\nCommandConnectToWiFi - Connected to IP: [%s]", WiFi.localIP().toString().c_str());
-            return RESULT_OK;
-        } 
-        else 
+            if (port != 0)
+                webhookServer.stop();
+
+            port = requestedPort;
+
+            if (port != 0)
+                webhookServer.begin(port);
+
+            DEBUG_PRINTLN("Webhook - Listening on port [%u]", port);
+        }
+
+        if ((port != 0) && _IsConnected())
+            webhookServer.handleClient();
+
+        vTaskDelay(pdMS_TO_TICKS(WEBHOOK_POLL_INTERVAL));
+    }
+}
+
+// ---------------------------------------------------------------------------------------
+// Expected parameters: connect|<ssid>|<password>[|<ssid>|<password>...]
+// Networks are tried in order, after the one cached from the last association.
+String CommandConnectToWiFi(const std::array<String, MAX_PARAMS>& params, size_t paramCount)
+{
+    if ((paramCount >= 3) && ((paramCount % 2) == 1)) 
+    {
+        std::vector<Network> requested;
+
+        for (size_t i = 1; i < paramCount; i += 2)
+            requested.push_back({ params[i], params[i + 1] });
+
+        if (_IsConnected())
         {
-            DEBUG_PRINTLN("CommandConnectToWiFi - Error while connecting");
-            return RESULT_ERROR;
+            for (const Network &network : requested)
+            {
+                if (WiFi.SSID() == network.ssid)
+                {
+                    DEBUG_PRINTLN("CommandConnectToWiFi - Already connected to IP: [%s]", WiFi.localIP().toString().c_str());
+                    return RESULT_OK;
+                }
+            }
         }
+
+        // Association runs in the background, so the command loop keeps answering.
+        // The Nucleo polls the status command until it reads CONNECTED.
+        xSemaphoreTake(networksMutex, portMAX_DELAY);
+        networks = requested;
+        xSemaphoreGive(networksMutex);
+        isConnectRestarted = true;
+        isConnectRequested = true;
+
+        DEBUG_PRINTLN("CommandConnectToWiFi - Connecting to WiFi: [%s] and [%d] fallbacks", requested[0].ssid.c_str(), requested.size() - 1);
+
+        return RESULT_CONNECTING;
     } 
     else 
     {
-        DEBUG_PRINTLN("CommandConnectToWiFi- Incorrect amount of parameters [%d]", (params.size() - 1));
+        DEBUG_ERROR("CommandConnectToWiFi- Incorrect amount of parameters [%d]", (paramCount - 1));
         return RESULT_ERROR;
     }
 }
@@ -123,34 +495,34 @@ String CommandPostToServer(const std::array<String, MAX_PARAMS>& params, size_t
 {
     if (paramCount == 3) 
     {
-        String server = params[1];
+        String server;
         String request = params[2];
 
+        if (!_ResolveServer(params[1], server))
+            return RESULT_NO_ENDPOINT;
+
         if (!_IsConnected()) 
         {
-            DEBUG_PRINTLN("CommandPostToServer - No Connection to WiFi");
+            DEBUG_ERROR("CommandPostToServer - No Connection to WiFi");
             return RESULT_ERROR;
         }
 
-        DEBUG_PRINTLN("CommandPostToServer - Post to server = [%s]\n\r%s", server.c_str(), request.c_str());
+        DEBUG_VERBOSE("CommandPostToServer - Post to server = [%s]\n\r%s", _Redacted(params[1]).c_str(), request.c_str());
         
         HTTPClient http;
 
+        const unsigned long startTime = millis();
+
         http.begin(server.c_str());
         http.addHeader("Content-Type", "application/x-www-form-urlencoded");
+        GzipBuffers *buffers = _AcceptGzip(http);
 
         int httpResponseCode = http.POST(request);
         String response;
 
         if (httpResponseCode > 0) 
         {
-            response = http.getString();
-            DynamicJsonDocument doc(4096);  // Ajustá el tamaño según lo que recibas
-            deserializeJson(doc, response); // response es tu String recibido
-
-            serializeJsonPretty(doc, Serial);
-            
-            DEBUG_PRINTLN("CommandPostToServer - Success\n\r[%d]\n\r[%s]", httpResponseCode, response.c_str());
+            response = _StreamBody(http, "CommandPostToServer", startTime, buffers);
         } 
         else 
         {
@@ -158,12 +530,13 @@ String CommandPostToServer(const std::array<String, MAX_PARAMS>& params, size_t
         }
 
         http.end();
+        _ReleaseGzip(buffers);
 
         return response;
     } 
     else 
     {
-        DEBUG_PRINTLN("CommandPostToServer - Incorrect amount of parameters [%d]", (params.size() - 1));
+        DEBUG_ERROR("CommandPostToServer - Incorrect amount of parameters [%d]", (params.size() - 1));
         return RESULT_ERROR;
     }
 }
@@ -175,22 +548,26 @@ String CommandGet(const std::array<String, MAX_PARAMS>& params, size_t paramCoun
     {
         if (!_IsConnected()) 
         {
-            DEBUG_PRINTLN("CommandGet - No Connection to WiFi");
+            DEBUG_ERROR("CommandGet - No Connection to WiFi");
             return RESULT_ERROR;
         }
 
-        String url = params[1];
+        String url;
 
+        if (!_ResolveServer(params[1], url))
+            return RESULT_NO_ENDPOINT;
+
+        const unsigned long startTime = millis();
         HTTPClient http;
         http.begin(url.c_str());
+        GzipBuffers *buffers = _AcceptGzip(http);
 
         int httpResponseCode = http.GET();
         String response;
 
         if (httpResponseCode > 0) 
         {
-            response = http.getString();
-            DEBUG_PRINTLN("CommandGet - Success\n\r[%d]\n\r[%s]", httpResponseCode, response.c_str());
+            response = _StreamBody(http, "CommandGet", startTime, buffers);
         } 
         else 
         {
@@ -198,12 +575,13 @@ String CommandGet(const std::array<String, MAX_PARAMS>& params, size_t paramCoun
         }
 
         http.end();
+        _ReleaseGzip(buffers);
 
         return response;
     } 
     else 
     {
-        DEBUG_PRINTLN("CommandGet - Incorrect amount of parameters [%d]", (params.size() - 1));
+        DEBUG_ERROR("CommandGet - Incorrect amount of parameters [%d]", (params.size() - 1));
         return RESULT_ERROR;
     }
 }
@@ -213,11 +591,224 @@ String CommandStatus(const std::array<String, MAX_PARAMS>& params, size_t paramC
 {
     if (paramCount == 1) 
     {
-        return (_IsConnected()) ? (RESULT_CONNECTED) : (RESULT_NOT_CONNECTED);
+        if (_IsConnected())
+            return RESULT_CONNECTED;
+
+        return (_IsConnecting()) ? (RESULT_CONNECTING) : (RESULT_NOT_CONNECTED);
+    }
+    else
+    {
+        DEBUG_ERROR("CommandStatus - Incorrect amount of parameters [%d]", (params.size() - 1));
+        return RESULT_ERROR;
+    }
+}
+
+// ---------------------------------------------------------------------------------------
+// Fan-out of the same request body to a list of recipients.
+// Expected parameters: broadcast|<server>|<id1,id2,...>|<request>
+// Each recipient is sent "chat_id=<id>&<request>" over a single kept-alive connection,
+// so the TLS handshake is done only once per broadcast. The result is one OK/ERROR
+// token per recipient, in the same order they were received.
+String CommandBroadcast(const std::array<String, MAX_PARAMS>& params, size_t paramCount)
+{
+    if (paramCount == 4) 
+    {
+        String server;
+        String recipients = params[2];
+        String request = params[3];
+
+        if (!_ResolveServer(params[1], server))
+            return RESULT_NO_ENDPOINT;
+
+        if (!_IsConnected()) 
+        {
+            DEBUG_ERROR("CommandBroadcast - No Connection to WiFi");
+            return RESULT_ERROR;
+        }
+
+        DEBUG_VERBOSE("CommandBroadcast - Post to server = [%s] recipients = [%s]", _Redacted(params[1]).c_str(), recipients.c_str());
+
+        HTTPClient http;
+        http.setReuse(true);
+        http.begin(server.c_str());
+        http.addHeader("Content-Type", "application/x-www-form-urlencoded");
+
+        // No gzip here: the answers are dropped, and _AcceptGzip would give up
+        // the connection reuse across users with HTTP/1.0.
+
+        String results;
+        int index_from = 0;
+
+        while (index_from <= recipients.length()) 
+        {
+            int index_to = recipients.indexOf(LIST_SEPARATOR_CHAR, index_from);
+
+            if (index_to < 0)
+                index_to = recipients.length();
+
+            String chatId = recipients.substring(index_from, index_to);
+            int httpResponseCode = http.POST("chat_id=" + chatId + "&" + request);
+
+            // Body must be consumed so the connection can be reused by the next recipient.
+            if (httpResponseCode > 0)
+                http.getString();
+
+            if (results.length() > 0)
+                results += LIST_SEPARATOR_CHAR;
+
+            results += (httpResponseCode == HTTP_CODE_OK) ? RESULT_OK : RESULT_ERROR;
+
+            DEBUG_VERBOSE("CommandBroadcast - [%s] -> [%d]", chatId.c_str(), httpResponseCode);
+
+            index_from = index_to + 1;
+        }
+
+        http.end();
+
+        return results;
+    } 
+    else 
+    {
+        DEBUG_ERROR("CommandBroadcast - Incorrect amount of parameters [%d]", (params.size() - 1));
+        return RESULT_ERROR;
+    }
+}
+
+// ---------------------------------------------------------------------------------------
+// Expected parameters: endpoint|<id>|<url>
+// The URL holds the bot token: it is never printed.
+String CommandEndpoint(const std::array<String, MAX_PARAMS>& params, size_t paramCount)
+{
+    if ((paramCount == 3) && (params[1].length() == 1) && (params[2].length() > 0)) 
+    {
+        const unsigned int index = params[1][0] - '0';
+
+        if (index >= ENDPOINT_COUNT_MAX)
+        {
+            DEBUG_ERROR("CommandEndpoint - ID out of range [%c]", params[1][0]);
+            return RESULT_ERROR;
+        }
+
+        xSemaphoreTake(endpointsMutex, portMAX_DELAY);
+        endpoints[index] = params[2];
+        xSemaphoreGive(endpointsMutex);
+
+        DEBUG_PRINTLN("CommandEndpoint - Endpoint [%u] registered, [%u] bytes", index, params[2].length());
+
+        return RESULT_OK;
+    } 
+    else 
+    {
+        DEBUG_ERROR("CommandEndpoint - Incorrect parameters [%d]", (paramCount - 1));
+        return RESULT_ERROR;
+    }
+}
+
+// ---------------------------------------------------------------------------------------
+// Expected parameters: webhook|<port>[|<secret>]
+// With a secret, updates without it in the secret token header are refused. The secret
+// is never printed.
+String CommandWebhook(const std::array<String, MAX_PARAMS>& params, size_t paramCount)
+{
+    if ((paramCount == 2) || (paramCount == 3)) 
+    {
+        const long port = params[1].toInt();
+
+        if ((port < 0) || (port > 65535))
+        {
+            DEBUG_ERROR("CommandWebhook - Port out of range [%s]", params[1].c_str());
+            return RESULT_ERROR;
+        }
+
+        xSemaphoreTake(webhookMutex, portMAX_DELAY);
+        webhookPort = (uint16_t) port;
+        webhookSecret = (paramCount == 3) ? params[2] : String();
+        xSemaphoreGive(webhookMutex);
+
+        DEBUG_PRINTLN("CommandWebhook - Port [%ld], secret [%s]", port, (paramCount == 3) ? "YES" : "NO");
+
+        return RESULT_OK;
+    } 
+    else 
+    {
+        DEBUG_ERROR("CommandWebhook - Incorrect parameters [%d]", (paramCount - 1));
+        return RESULT_ERROR;
+    }
+}
+
+// ---------------------------------------------------------------------------------------
+// The Nucleo is about to stop reading the UART, for a flash erase. Whatever is queued
+// meanwhile goes out once the hold time is over, or right away on hold|0.
+String CommandHold(const std::array<String, MAX_PARAMS>& params, size_t paramCount)
+{
+    if (paramCount == 2) 
+    {
+        const long time = params[1].toInt();
+
+        if ((time < 0) || (time > HOLD_TIME_MAX))
+        {
+            DEBUG_ERROR("CommandHold - Time out of range [%s]", params[1].c_str());
+            return RESULT_ERROR;
+        }
+
+        if (time == 0)
+            uartHoldTime = 0;
+        requestedHoldTime = (uint32_t) time;
+
+        DEBUG_VERBOSE("CommandHold - Holding for [%ld] ms", time);
+
+        return RESULT_OK;
+    } 
+    else 
+    {
+        DEBUG_ERROR("CommandHold - Incorrect amount of parameters [%d]", (paramCount - 1));
+        return RESULT_ERROR;
+    }
+}
+
+// ---------------------------------------------------------------------------------------
+String CommandLogLevel(const std::array<String, MAX_PARAMS>& params, size_t paramCount)
+{
+    if (paramCount == 2) 
+    {
+        debugLevel = params[1].toInt();
+        return RESULT_OK;
+    }
+    else
+    {
+        DEBUG_ERROR("CommandLogLevel - Incorrect amount of parameters [%d]", (params.size() - 1));
+        return RESULT_ERROR;
+    }
+}
+
+// ---------------------------------------------------------------------------------------
+// Telemetry frame for a gateway, sent as a single UDP datagram. No answer is expected
+// from the gateway, so the result only tells if the datagram left the ESP32.
+// Expected parameters: telemetry|<host>|<port>|<frame>
+String CommandTelemetry(const std::array<String, MAX_PARAMS>& params, size_t paramCount)
+{
+    WiFiUDP telemetryUdp;
+
+    if (paramCount == 4) 
+    {
+        if (!_IsConnected()) 
+        {
+            DEBUG_ERROR("CommandTelemetry - No Connection to WiFi");
+            return RESULT_ERROR;
+        }
+
+        DEBUG_VERBOSE("CommandTelemetry - [%s] to [%s:%s]", params[3].c_str(), params[1].c_str(), params[2].c_str());
+
+        if (!telemetryUdp.beginPacket(params[1].c_str(), params[2].toInt()))
+            return RESULT_ERROR;
+
+        telemetryUdp.print(params[3]);
+
+        return (telemetryUdp.endPacket()) ? RESULT_OK : RESULT_ERROR;
     }
     else
     {
-        DEBUG_PRINTLN("CommandStatus - Incorrect amount of parameters [%d]", (params.size() - 1));
+        DEBUG_ERROR("CommandTelemetry - Incorrect amount of parameters [%d]", (params.size() - 1));
         return RESULT_ERROR;
     }
 }
@@ -227,6 +818,620 @@ bool _IsConnected()
 {
     return (WiFi.status() == WL_CONNECTED);
 }
+// ---------------------------------------------------------------------------------------
+bool _IsConnecting()
+{
+    return isConnectRequested && !_IsConnected();
+}
+// ---------------------------------------------------------------------------------------
+// Walks the connect attempts: the cached link first, then every network with a full
+// scan. Gives up after the last one, the Nucleo retries later.
+void _UpdateConnection()
+{
+    if (isConnectRestarted)
+    {
+        isConnectRestarted = false;
+        connectAttempt = CONNECT_ATTEMPT_CACHED - 1;
+        connectAttemptStart = 0;
+    }
+    else if (!isConnectRequested)
+    {
+        return;
+    }
+
+    if (_IsConnected())
+    {
+        DEBUG_PRINTLN("Connected to [%s] in [%lu] ms, IP: [%s]", WiFi.SSID().c_str(), millis() - connectAttemptStart, WiFi.localIP().toString().c_str());
+        if (connectAttempt != CONNECT_ATTEMPT_CACHED)
+            _SaveLinkCache();
+        isConnectRequested = false;
+        return;
+    }
+
+    const unsigned long timeout = (connectAttempt == CONNECT_ATTEMPT_CACHED) ? FAST_CONNECT_TIMEOUT : FULL_CONNECT_TIMEOUT;
+
+    if ((connectAttempt >= CONNECT_ATTEMPT_CACHED) && ((millis() - connectAttemptStart) < timeout))
+        return;
+
+    if (connectAttempt == CONNECT_ATTEMPT_CACHED)
+    {
+        // The AP moved or the lease is gone, back to scan and DHCP.
+        DEBUG_PRINTLN("Cached link to [%s] failed", linkCache.ssid.c_str());
+        _ClearLinkCache();
+        WiFi.config(INADDR_NONE, INADDR_NONE, INADDR_NONE);
+    }
+
+    int attempt = connectAttempt + 1;
+
+    // The connect command replaces the networks from the UART reader task.
+    xSemaphoreTake(networksMutex, portMAX_DELAY);
+    const int networkCount = (int) networks.size();
+    xSemaphoreGive(networksMutex);
+
+    while (!_StartConnectAttempt(attempt))
+    {
+        if (attempt >= networkCount)
+        {
+            DEBUG_ERROR("No network available");
+            WiFi.disconnect();
+            isConnectRequested = false;
+            return;
+        }
+        attempt++;
+    }
+}
+// ---------------------------------------------------------------------------------------
+// Starts a connect attempt. Returns false if the attempt doesn't apply, or there are no
+// more networks.
+bool _StartConnectAttempt(int attempt)
+{
+    bool isStarted = false;
+
+    xSemaphoreTake(networksMutex, portMAX_DELAY);
+
+    if (attempt == CONNECT_ATTEMPT_CACHED)
+    {
+        for (const Network &network : networks)
+        {
+            if (linkCache.isValid && (network.ssid == linkCache.ssid))
+            {
+                DEBUG_PRINTLN("Connecting to [%s] with the cached link, channel [%d]", network.ssid.c_str(), linkCache.channel);
+                WiFi.config(IPAddress(linkCache.ip), IPAddress(linkCache.gateway), IPAddress(linkCache.subnet), IPAddress(linkCache.dns));
+                WiFi.begin(network.ssid.c_str(), network.password.c_str(), linkCache.channel, linkCache.bssid);
+                isStarted = true;
+                break;
+            }
+        }
+    }
+    else if (attempt < (int) networks.size())
+    {
+        DEBUG_PRINTLN("Connecting to [%s]", networks[attempt].ssid.c_str());
+        WiFi.disconnect();
+        WiFi.begin(networks[attempt].ssid.c_str(), networks[attempt].password.c_str());
+        isStarted = true;
+    }
+
+    xSemaphoreGive(networksMutex);
+
+    connectAttempt = attempt;
+    connectAttemptStart = millis();
+
+    return isStarted;
+}
+// ---------------------------------------------------------------------------------------
+void _LoadLinkCache()
+{
+    preferences.begin("link", true);
+    linkCache.isValid = preferences.getBool("valid", false);
+    linkCache.ssid = preferences.getString("ssid", "");
+    preferences.getBytes("bssid", linkCache.bssid, sizeof(linkCache.bssid));
+    linkCache.channel = preferences.getInt("channel", 0);
+    linkCache.ip = preferences.getUInt("ip", 0);
+    linkCache.gateway = preferences.getUInt("gateway", 0);
+    linkCache.subnet = preferences.getUInt("subnet", 0);
+    linkCache.dns = preferences.getUInt("dns", 0);
+    preferences.end();
+}
+// ---------------------------------------------------------------------------------------
+void _SaveLinkCache()
+{
+    linkCache.isValid = true;
+    linkCache.ssid = WiFi.SSID();
+    memcpy(linkCache.bssid, WiFi.BSSID(), sizeof(linkCache.bssid));
+    linkCache.channel = WiFi.channel();
+    linkCache.ip = (uint32_t) WiFi.localIP();
+    linkCache.gateway = (uint32_t) WiFi.gatewayIP();
+    linkCache.subnet = (uint32_t) WiFi.subnetMask();
+    linkCache.dns = (uint32_t) WiFi.dnsIP();
+
+    preferences.begin("link", false);
+    preferences.putString("ssid", linkCache.ssid);
+    preferences.putBytes("bssid", linkCache.bssid, sizeof(linkCache.bssid));
+    preferences.putInt("channel", linkCache.channel);
+    preferences.putUInt("ip", linkCache.ip);
+    preferences.putUInt("gateway", linkCache.gateway);
+    preferences.putUInt("subnet", linkCache.subnet);
+    preferences.putUInt("dns", linkCache.dns);
+    preferences.putBool("valid", true);
+    preferences.end();
+}
+// ---------------------------------------------------------------------------------------
+void _ClearLinkCache()
+{
+    linkCache.isValid = false;
+
+    preferences.begin("link", false);
+    preferences.putBool("valid", false);
+    preferences.end();
+}
+// ---------------------------------------------------------------------------------------
+// Expected parameters: baud|<rate>|<flow control 0/1>
+// Answered at the current rate, the switch happens right after.
+String CommandBaud(const std::array<String, MAX_PARAMS>& params, size_t paramCount)
+{
+    if (paramCount == 3) 
+    {
+        const uint32_t baudRate = params[1].toInt();
+        const bool isFlowControlled = (params[2].toInt() != 0);
+
+        if (!baudSwitch.request(baudRate, isFlowControlled))
+        {
+            DEBUG_ERROR("CommandBaud - Rate not supported [%u]", baudRate);
+            return RESULT_ERROR;
+        }
+
+        DEBUG_PRINTLN("CommandBaud - Switching to [%u] baud, flow control [%d]", baudRate, isFlowControlled);
+
+        return RESULT_OK;
+    } 
+    else 
+    {
+        DEBUG_ERROR("CommandBaud - Incorrect amount of parameters [%d]", (paramCount - 1));
+        return RESULT_ERROR;
+    }
+}
+
+// ---------------------------------------------------------------------------------------
+// Expected parameters: fill|<size>
+// Answers <size> filler bytes, for the Nucleo to measure the UART throughput.
+String CommandFill(const std::array<String, MAX_PARAMS>& params, size_t paramCount)
+{
+    if (paramCount == 2) 
+    {
+        const long size = params[1].toInt();
+
+        if ((size <= 0) || (size > FILL_SIZE_MAX))
+        {
+            DEBUG_ERROR("CommandFill - Size out of range [%ld]", size);
+            return RESULT_ERROR;
+        }
+
+        String fill;
+
+        fill.reserve(size);
+        for (long i = 0; i < size; i++)
+            fill += (char) ('a' + (i % 26));
+
+        return fill;
+    } 
+    else 
+    {
+        DEBUG_ERROR("CommandFill - Incorrect amount of parameters [%d]", (paramCount - 1));
+        return RESULT_ERROR;
+    }
+}
+
+// ---------------------------------------------------------------------------------------
+void _SetBaudRate(uint32_t baudRate, bool isFlowControlled)
+{
+    Serial2.updateBaudRate(baudRate);
+
+    if (isFlowControlled)
+    {
+        Serial2.setPins(RXD2, TXD2, CTS2, RTS2);
+        Serial2.setHwFlowCtrlMode(UART_HW_FLOWCTRL_CTS_RTS, FLOW_CONTROL_THRESHOLD);
+    }
+    else
+    {
+        Serial2.setHwFlowCtrlMode(UART_HW_FLOWCTRL_DISABLE, FLOW_CONTROL_THRESHOLD);
+    }
+}
+
+// ---------------------------------------------------------------------------------------
+// The Nucleo didn't follow the switch: back to the rate it boots at.
+void _UpdateBaudRate()
+{
+    if (!baudSwitch.update(millis()))
+        return;
+
+    DEBUG_ERROR("No command at [%u] baud, back to [%u]", Serial2.baudRate(), BASE_BAUD_RATE);
+    _SetBaudRate(BASE_BAUD_RATE, false);
+}
+
+// ---------------------------------------------------------------------------------------
+// Pushes link changes to the Nucleo as they happen, so it doesn't have to poll status.
+// Runs in the WiFi event task.
+void _OnWiFiEvent(WiFiEvent_t event, WiFiEventInfo_t info)
+{
+    switch (event)
+    {
+        case ARDUINO_EVENT_WIFI_STA_GOT_IP:
+        {
+            const String ip = IPAddress(info.got_ip.ip_info.ip.addr).toString();
+
+            if (isLinkUpReported)
+            {
+                _QueueEvent(EVENT_IP_STR, ip);
+            }
+            else
+            {
+                lastReportedRssi = WiFi.RSSI();
+                _QueueEvent(EVENT_LINK_UP_STR, ip + PARAM_SEPARATOR_CHAR + String(lastReportedRssi));
+                isLinkUpReported = true;
+            }
+        }
+        break;
+
+        case ARDUINO_EVENT_WIFI_STA_DISCONNECTED:
+        case ARDUINO_EVENT_WIFI_STA_LOST_IP:
+        {
+            // Reported once, the ESP32 raises it again on every failed reassociation.
+            if (isLinkUpReported)
+            {
+                const int reason = (event == ARDUINO_EVENT_WIFI_STA_DISCONNECTED) ? info.wifi_sta_disconnected.reason : 0;
+
+                _QueueEvent(EVENT_LINK_DOWN_STR, String(reason));
+                isLinkUpReported = false;
+            }
+        }
+        break;
+
+        default:
+        break;
+    }
+}
+// ---------------------------------------------------------------------------------------
+void _UpdateRssi()
+{
+    if (!isLinkUpReported || ((millis() - lastRssiCheck) < RSSI_EVENT_INTERVAL))
+        return;
+
+    const int32_t rssi = WiFi.RSSI();
+
+    lastRssiCheck = millis();
+
+    if (abs(rssi - lastReportedRssi) >= RSSI_EVENT_THRESHOLD)
+    {
+        lastReportedRssi = rssi;
+        _QueueEvent(EVENT_RSSI_STR, String(rssi));
+    }
+}
+// ---------------------------------------------------------------------------------------
+// Event frames go through the UART writer, between results, without request ID.
+// Returns false if the event was dropped, the writer being too far behind.
+bool _QueueEvent(const char *event, const String &params)
+{
+    Response *response = new Response{ "", String(EVENT_CHAR) + event + PARAM_SEPARATOR_CHAR + params, false, 0, 0 };
+
+    DEBUG_PRINTLN("Event [%s]", response->result.c_str());
+
+    if (xQueueSend(responseQueue, &response, pdMS_TO_TICKS(EVENT_QUEUE_TIMEOUT)) != pdTRUE)
+    {
+        delete response;
+        return false;
+    }
+
+    return true;
+}
+
+// ---------------------------------------------------------------------------------------
+// Any POST to the webhook is an update, whatever the path the proxy or relay uses.
+// Telegram sends an update again until it gets a 200, so one the Nucleo can't be
+// told about is refused instead.
+void _OnWebhookRequest()
+{
+    if (webhookServer.method() != HTTP_POST)
+    {
+        webhookServer.send(405);
+        return;
+    }
+
+    xSemaphoreTake(webhookMutex, portMAX_DELAY);
+    const bool isAuthorized = (webhookSecret.length() == 0) || (webhookServer.header(WEBHOOK_SECRET_HEADER) == webhookSecret);
+    xSemaphoreGive(webhookMutex);
+
+    if (!isAuthorized)
+    {
+        DEBUG_ERROR("Webhook - Update from [%s] without the secret", webhookServer.client().remoteIP().toString().c_str());
+        webhookServer.send(401);
+        return;
+    }
+
+    String update = webhookServer.arg("plain");
+
+    if ((update.length() == 0) || (update.length() > WEBHOOK_BODY_MAX))
+    {
+        DEBUG_ERROR("Webhook - Update refused, [%u] bytes", update.length());
+        webhookServer.send((update.length() == 0) ? 400 : 413);
+        return;
+    }
+
+    // The stop character would end the event frame. In JSON it can only be inside a
+    // string, where \u007e stands for it.
+    update.replace(String(STOP_CHAR), "\\u007e");
+
+    webhookServer.send(_QueueEvent(EVENT_UPDATE_STR, update) ? 200 : 503);
+}
+// ---------------------------------------------------------------------------------------
+// Forwards an HTTP body to the Nucleo in chunks as it is read from the socket, so
+// neither the ESP32 nor the Nucleo has to hold it whole, and the Nucleo gets the first
+// bytes while the rest is still on its way. Memory is bounded by the response queue.
+class ChunkStream : public Stream
+{
+public:
+    explicit ChunkStream(const String &id) : id(id), length(0), total(0) {}
+
+    size_t write(uint8_t data) override
+    {
+        return write(&data, 1);
+    }
+
+    size_t write(const uint8_t *data, size_t size) override
+    {
+        for (size_t i = 0; i < size; i++)
+        {
+            buffer[length++] = data[i];
+
+            if (length == STREAM_CHUNK_SIZE)
+                flush();
+        }
+
+        return size;
+    }
+
+    void flush() override
+    {
+        if (length == 0)
+            return;
+
+        Response *response = new Response{ id, String(), true, 0, 0 };
+
+        response->result.concat((const char *) buffer, length);
+        xQueueSend(responseQueue, &response, portMAX_DELAY);
+        total += length;
+        length = 0;
+    }
+
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+
+    size_t getTotal() const { return total; }
+
+private:
+    String id;
+    uint8_t buffer[STREAM_CHUNK_SIZE];
+    size_t length;
+    size_t total;
+};
+
+// ---------------------------------------------------------------------------------------
+// Inflates a gzip body on the fly into the next stream. tinfl, in ROM, runs over a
+// fixed 32 KB window: output is written from the window as it is filled, so memory
+// doesn't depend on the body size.
+class GzipStream : public Stream
+{
+public:
+    // buffers: taken by _AcceptGzip for the request, nullptr if gzip wasn't asked for.
+    GzipStream(Stream &output, GzipBuffers *buffers)
+    : output(output), buffers(buffers), state((buffers != nullptr) ? GZIP_HEADER : GZIP_FAILED), windowOffset(0), inputTotal(0)
+    {
+        if (buffers != nullptr)
+            tinfl_init(&buffers->inflator);
+    }
+
+    size_t write(uint8_t data) override
+    {
+        return write(&data, 1);
+    }
+
+    // Returns 0 on a corrupt body, which aborts the transfer.
+    size_t write(const uint8_t *data, size_t size) override
+    {
+        size_t index = 0;
+
+        inputTotal += size;
+
+        if (state == GZIP_HEADER)
+        {
+            index = header.parse(data, size);
+
+            if (header.isFailed())
+                state = GZIP_FAILED;
+            else if (header.isDone())
+                state = GZIP_INFLATE;
+        }
+
+        if (state == GZIP_INFLATE)
+            _Inflate(data + index, size - index);
+
+        return (state == GZIP_FAILED) ? 0 : size;
+    }
+
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+
+    bool isDone() const { return (state == GZIP_DONE); }
+    size_t getInputTotal() const { return inputTotal; }
+
+private:
+    // The trailer after the deflate stream is ignored.
+    enum GzipState { GZIP_HEADER, GZIP_INFLATE, GZIP_DONE, GZIP_FAILED };
+
+    void _Inflate(const uint8_t *data, size_t size)
+    {
+        uint8_t *window = buffers->window;
+
+        while (state == GZIP_INFLATE)
+        {
+            size_t inSize = size;
+            size_t outSize = TINFL_LZ_DICT_SIZE - windowOffset;
+            const tinfl_status status = tinfl_decompress(&buffers->inflator, data, &inSize, window, window + windowOffset, &outSize, TINFL_FLAG_HAS_MORE_INPUT);
+
+            data += inSize;
+            size -= inSize;
+
+            if (outSize > 0)
+            {
+                output.write(window + windowOffset, outSize);
+                windowOffset = (windowOffset + outSize) & (TINFL_LZ_DICT_SIZE - 1);
+            }
+
+            if (status == TINFL_STATUS_DONE)
+                state = GZIP_DONE;
+            else if (status < TINFL_STATUS_DONE)
+                state = GZIP_FAILED;
+            else if (status == TINFL_STATUS_NEEDS_MORE_INPUT)
+                break;
+        }
+    }
+
+    Stream &output;
+    GzipBuffers *buffers;
+    GzipHeader header;
+    GzipState state;
+    size_t windowOffset;
+    size_t inputTotal;
+};
+
+// ---------------------------------------------------------------------------------------
+// Asks for a gzip body if the inflate buffers are free: the other worker may be using
+// them, or there was never room to allocate them. Otherwise the body comes as is.
+// HTTPClient sends its own Accept-Encoding with HTTP/1.1, ruling gzip out, so the
+// request goes as HTTP/1.0. Returns the buffers, for _StreamBody and then _ReleaseGzip.
+GzipBuffers *_AcceptGzip(HTTPClient &http)
+{
+    static const char *headerKeys[] = { "Content-Encoding" };
+
+    if (xSemaphoreTake(gzipMutex, 0) != pdTRUE)
+        return nullptr;
+
+    if ((gzipBuffers == nullptr) && (ESP.getMaxAllocHeap() >= GZIP_HEAP_MIN))
+        gzipBuffers = (GzipBuffers *) malloc(sizeof(GzipBuffers));
+
+    if (gzipBuffers == nullptr)
+    {
+        xSemaphoreGive(gzipMutex);
+        return nullptr;
+    }
+
+    http.useHTTP10(true);
+    http.addHeader("Accept-Encoding", "gzip");
+    http.collectHeaders(headerKeys, 1);
+
+    return gzipBuffers;
+}
+
+// ---------------------------------------------------------------------------------------
+void _ReleaseGzip(GzipBuffers *buffers)
+{
+    if (buffers != nullptr)
+        xSemaphoreGive(gzipMutex);
+}
+
+// ---------------------------------------------------------------------------------------
+// Streams the body of an answered request, inflated if it came compressed. Returns the
+// result that closes the stream: OK|<bytes received>|<body bytes>|<transfer ms>, or ERROR.
+String _StreamBody(HTTPClient &http, const char *command, unsigned long startTime, GzipBuffers *buffers)
+{
+    ChunkStream stream((workerJob != nullptr) ? workerJob->id : String());
+    const bool isGzip = http.header("Content-Encoding").equalsIgnoreCase("gzip");
+    size_t receivedBytes;
+    int written;
+
+    if (isGzip)
+    {
+        GzipStream gzip(stream, buffers);
+
+        written = http.writeToStream(&gzip);
+        receivedBytes = gzip.getInputTotal();
+
+        if ((written >= 0) && !gzip.isDone())
+            written = HTTPC_ERROR_STREAM_WRITE;
+    }
+    else
+    {
+        written = http.writeToStream(&stream);
+        receivedBytes = (written > 0) ? written : 0;
+    }
+
+    stream.flush();
+
+    const unsigned long transferTime = millis() - startTime;
+
+    if (written < 0)
+    {
+        DEBUG_ERROR("%s - Body stream failed [%d] after [%u] bytes", command, written, stream.getTotal());
+        return RESULT_ERROR;
+    }
+
+    DEBUG_VERBOSE("%s - Success, [%u] bytes received%s, [%u] bytes streamed in [%lu] ms", command, receivedBytes, isGzip ? " gzip" : "", stream.getTotal(), transferTime);
+
+    return String(RESULT_OK) + PARAM_SEPARATOR_CHAR + receivedBytes + PARAM_SEPARATOR_CHAR + stream.getTotal() + PARAM_SEPARATOR_CHAR + transferTime;
+}
+
+// ---------------------------------------------------------------------------------------
+// A server parameter is either a URL, or "#<id>" for a registered endpoint.
+// Returns false if the endpoint is not registered.
+bool _ResolveServer(const String &server, String &url)
+{
+    if ((server.length() != 2) || (server[0] != ENDPOINT_CHAR))
+    {
+        url = server;
+        return true;
+    }
+
+    const unsigned int index = server[1] - '0';
+
+    if (index >= ENDPOINT_COUNT_MAX)
+        return false;
+
+    xSemaphoreTake(endpointsMutex, portMAX_DELAY);
+    url = endpoints[index];
+    xSemaphoreGive(endpointsMutex);
+
+    if (url.length() == 0)
+    {
+        DEBUG_ERROR("Endpoint [%u] not registered", index);
+        return false;
+    }
+
+    return true;
+}
+
+// ---------------------------------------------------------------------------------------
+// Server parameter fit for the log: endpoint IDs as they are, URLs without their path,
+// which holds the bot token.
+String _Redacted(const String &server)
+{
+    if ((server.length() == 2) && (server[0] == ENDPOINT_CHAR))
+        return server;
+
+    const int hostStart = server.indexOf("://");
+    const int pathStart = server.indexOf('/', (hostStart < 0) ? 0 : hostStart + 3);
+
+    return (pathStart < 0) ? server : server.substring(0, pathStart) + "/...";
+}
+
+// ---------------------------------------------------------------------------------------
+void _QueueResponse(const String &id, const String &result, uint32_t holdTime, uint32_t switchBaud)
+{
+    Response *response = new Response{ id, result, false, holdTime, switchBaud };
+
+    xQueueSend(responseQueue, &response, portMAX_DELAY);
+}
+
 // ---------------------------------------------------------------------------------------
 std::array<String, MAX_PARAMS> _ParseParameters(const String &input, size_t &paramCount) 
 {
@@ -0,0 +1,120 @@
+/********************************************************************************
+ * @file gzip_header.h
+ * @brief Gzip member header parser (RFC 1952) of the ESP32 bridge. Free of the
+ *        Arduino core, so it is checked on the host as well.
+ * @author Gonzalo Puy.
+ * @date Jun 2025
+ *******************************************************************************/
+
+#ifndef GZIP_HEADER_H
+#define GZIP_HEADER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ---------------------------------------------------------------------------------------
+// Skips the header of a gzip body byte by byte, as it comes off the socket, up to the
+// deflate stream. Optional fields are skipped in the order they come.
+class GzipHeader
+{
+public:
+    GzipHeader() : state(GZIP_HEADER), flags(0), headerLength(0), fieldLength(0) {}
+
+    // Takes header bytes until the deflate stream starts. Returns the bytes taken.
+    size_t parse(const uint8_t *data, size_t size)
+    {
+        size_t index = 0;
+
+        while ((index < size) && (state < GZIP_DONE))
+            _Parse(data[index++]);
+
+        return index;
+    }
+
+    bool isDone() const { return (state == GZIP_DONE); }
+    bool isFailed() const { return (state == GZIP_FAILED); }
+
+private:
+    // Header fields, in the order they come.
+    enum GzipState { GZIP_HEADER, GZIP_EXTRA_LENGTH, GZIP_SKIP, GZIP_NAME, GZIP_COMMENT, GZIP_DONE, GZIP_FAILED };
+
+    static const uint8_t GZIP_HEADER_SIZE   = 10;
+    static const uint8_t GZIP_FLAG_HCRC     = 0x02;
+    static const uint8_t GZIP_FLAG_EXTRA    = 0x04;
+    static const uint8_t GZIP_FLAG_NAME     = 0x08;
+    static const uint8_t GZIP_FLAG_COMMENT  = 0x10;
+
+    void _Parse(uint8_t data)
+    {
+        switch (state)
+        {
+            case GZIP_HEADER:
+                if (((headerLength == 0) && (data != 0x1f)) || ((headerLength == 1) && (data != 0x8b)) || ((headerLength == 2) && (data != 8)))
+                {
+                    state = GZIP_FAILED;
+                    break;
+                }
+                if (headerLength == 3)
+                    flags = data;
+                if (++headerLength == GZIP_HEADER_SIZE)
+                    state = _NextField();
+                break;
+
+            case GZIP_EXTRA_LENGTH:
+                fieldLength |= (size_t) data << (8 * headerLength);
+                if (++headerLength == 2)
+                    state = (fieldLength > 0) ? GZIP_SKIP : _NextField();
+                break;
+
+            case GZIP_SKIP:
+                if (--fieldLength == 0)
+                    state = _NextField();
+                break;
+
+            case GZIP_NAME:
+            case GZIP_COMMENT:
+                if (data == 0)
+                    state = _NextField();
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    GzipState _NextField()
+    {
+        if (flags & GZIP_FLAG_EXTRA)
+        {
+            flags &= ~GZIP_FLAG_EXTRA;
+            headerLength = 0;
+            fieldLength = 0;
+            return GZIP_EXTRA_LENGTH;
+        }
+        if (flags & GZIP_FLAG_NAME)
+        {
+            flags &= ~GZIP_FLAG_NAME;
+            return GZIP_NAME;
+        }
+        if (flags & GZIP_FLAG_COMMENT)
+        {
+            flags &= ~GZIP_FLAG_COMMENT;
+            return GZIP_COMMENT;
+        }
+        if (flags & GZIP_FLAG_HCRC)
+        {
+            flags &= ~GZIP_FLAG_HCRC;
+            fieldLength = 2;
+            return GZIP_SKIP;
+        }
+
+        return GZIP_DONE;
+    }
+
+    GzipState state;
+    uint8_t flags;
+    uint8_t headerLength;
+    size_t fieldLength;
+};
+
+#endif // GZIP_HEADER_H
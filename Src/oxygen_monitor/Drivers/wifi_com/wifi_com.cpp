@@ -9,11 +9,21 @@
 #include "PinNames.h"
 #include "arm_book_lib.h"
 #include "commands.h"
+#include "logger.h"
+#include "metrics.h"
+#include "profiler.h"
 #include "mbed.h"
+#include <algorithm>
 #include <cstdio>
+#include <cstdlib>
 #include <cstring>
 #include <string>
 
+//=====[Declaration and initialization of private global variables]============
+
+static_assert((WIFI_TX_BUFFER_SIZE & (WIFI_TX_BUFFER_SIZE - 1)) == 0, "WIFI_TX_BUFFER_SIZE must be a power of two");
+static_assert(WIFI_ENDPOINT_MAX <= ENDPOINT_COUNT_MAX, "The ESP32 can't hold every endpoint");
+
 //=====[Implementations of public functions]===================================
 
 namespace Drivers {
@@ -26,16 +36,19 @@ namespace Drivers {
 
   void WifiCom::update()
   {
+    PROFILE_ZONE(WIFI_COM_UPDATE);
+
     std::string esp32Command;
-    static int startDelayTick;
-    static int delayDuration;
+
+    _receive();
+    _transmit();
 
     switch (wifiState) {
 
       case INIT:
       {
         wifiState = CMD_STATUS_SEND;
-        wifiComDelay.Start(DELAY_3_SECONDS);
+        wifiComDelay.Restart(0);
       }
       break;
       
@@ -47,7 +60,7 @@ namespace Drivers {
           esp32Command += STOP_CHAR;
           _sendCommand(esp32Command.c_str());
           wifiState = CMD_STATUS_WAIT_RESPONSE;
-          wifiComDelay.Start(DELAY_3_SECONDS);
+          wifiComDelay.Restart(WIFI_HANDSHAKE_TIMEOUT);
         }
 
       }
@@ -56,67 +69,188 @@ namespace Drivers {
       case CMD_STATUS_WAIT_RESPONSE:
       {
         const bool isResponseCompleted = _isResponseCompleted(&wifiResponse);
-        if( wifiComDelay.HasFinished() || (isResponseCompleted && (wifiResponse.compare(RESULT_NOT_CONNECTED) == 0)) ) {
+        const bool isTimeout = wifiComDelay.HasFinished();
+
+        if (isResponseCompleted && wifiIsBaudVerifying) {
+          wifiIsBaudVerifying = false;
+          wifiBaudAttempts = 0;
+          LOG_INFO(LOG_MODULE_WIFI_COM, LOG_WIFI_COM_BAUD_RATE, wifiBaudRate, WIFI_FLOW_CONTROL);
+        }
+
+        if (isResponseCompleted && _isBaudNegotiable()) {
+          // The ESP32 answers: switch the UART rate first, the status is asked again after.
+          wifiState = CMD_BAUD_SEND;
+        } else if (isResponseCompleted && (wifiResponse.compare(RESULT_CONNECTED) == 0)) {
+          _setLinkReady(); //Wifi ya conectado.
+        } else if (isResponseCompleted && (wifiResponse.compare(RESULT_CONNECTING) == 0)) {
+          wifiConnectStartTick = Util::Tick::GetTickCounter();
+          wifiState = CMD_CONNECT_POLL_SEND;
+          wifiComDelay.Restart(WIFI_CONNECT_POLL_INTERVAL);
+        } else if (isResponseCompleted) {
           wifiState = CMD_CONNECT_SEND; //Wifi no conectado, tratando de reconectar.
-        }else if( isResponseCompleted && (wifiResponse.compare(RESULT_CONNECTED) == 0) ) {
-          wifiState = IDLE; //Wifi ya conectado.
+        } else if (isTimeout) {
+          // The ESP32 may still be booting, ask again.
+          Util::Metrics::Increment(METRIC_WIFI_TIMEOUT_STATUS);
+
+          // No answer at the fast rate: the line can't take it or the ESP32 restarted
+          // at the base rate. The ESP32 goes back on its own as well.
+          if (wifiBaudRate != WIFI_BAUD_RATE) {
+            LOG_WARN(LOG_MODULE_WIFI_COM, LOG_WIFI_COM_BAUD_FALLBACK, wifiBaudRate);
+            Util::Metrics::Increment(METRIC_WIFI_BAUD_FALLBACKS);
+            _setBaudRate(WIFI_BAUD_RATE, false);
+            wifiIsBaudVerifying = false;
+            wifiBaudAttempts++;
+          }
+          wifiState = CMD_STATUS_SEND;
+          wifiComDelay.Restart(0);
+        }
+      }
+      break;
+
+      case CMD_BAUD_SEND:
+      {
+        wifiResponse.clear();
+        esp32Command = COMMAND_BAUD_STR;
+        esp32Command += PARAM_SEPARATOR_CHAR;
+        esp32Command += std::to_string(WIFI_BAUD_RATE_FAST);
+        esp32Command += PARAM_SEPARATOR_CHAR;
+        esp32Command += std::to_string(WIFI_FLOW_CONTROL);
+        esp32Command += STOP_CHAR;
+        _sendCommand(esp32Command.c_str());
+        wifiState = CMD_BAUD_WAIT_RESPONSE;
+        wifiComDelay.Restart(WIFI_HANDSHAKE_TIMEOUT);
+      }
+      break;
+
+      case CMD_BAUD_WAIT_RESPONSE:
+      {
+        const bool isResponseCompleted = _isResponseCompleted(&wifiResponse);
+        const bool isTimeout = wifiComDelay.HasFinished();
+        if (isResponseCompleted && (wifiResponse.compare(RESULT_OK) == 0)) {
+          // The ESP32 switches once the acknowledge is out. The status, asked at
+          // the new rate, confirms the switch to both sides.
+          _setBaudRate(WIFI_BAUD_RATE_FAST, WIFI_FLOW_CONTROL);
+          wifiIsBaudVerifying = true;
+          wifiState = CMD_STATUS_SEND;
+          wifiComDelay.Restart(0);
+        } else if (isResponseCompleted) {
+          // Rate not supported by the ESP32, don't ask again.
+          wifiBaudAttempts = WIFI_BAUD_ATTEMPTS;
+          wifiState = CMD_STATUS_SEND;
+          wifiComDelay.Restart(0);
+        } else if (isTimeout) {
+          // Bridge firmware without the command.
+          wifiBaudAttempts++;
+          wifiState = CMD_STATUS_SEND;
+          wifiComDelay.Restart(0);
         }
       }
       break;
 
       case CMD_CONNECT_SEND:
       {
-        if(wifiComDelay.HasFinished()) {
-          wifiResponse.clear();
-          esp32Command = COMMAND_CONNECT_STR;
+        wifiResponse.clear();
+        esp32Command = COMMAND_CONNECT_STR;
+        esp32Command += PARAM_SEPARATOR_CHAR;
+        esp32Command += wifiSsid;
+        esp32Command += PARAM_SEPARATOR_CHAR;
+        esp32Command += wifiPassword;
+        if (strlen(WIFI_SSID_FALLBACK) > 0) {
           esp32Command += PARAM_SEPARATOR_CHAR;
-          esp32Command += wifiSsid;
+          esp32Command += WIFI_SSID_FALLBACK;
           esp32Command += PARAM_SEPARATOR_CHAR;
-          esp32Command += wifiPassword;
+          esp32Command += WIFI_PASSWORD_FALLBACK;
+        }
+        esp32Command += STOP_CHAR;
+        _sendCommand(esp32Command.c_str());
+        wifiState = CMD_CONNECT_WAIT_RESPONSE;
+        wifiComDelay.Restart(WIFI_HANDSHAKE_TIMEOUT);
+      }
+      break;
+
+      case CMD_CONNECT_WAIT_RESPONSE:
+      {
+        const bool isResponseCompleted = _isResponseCompleted(&wifiResponse);
+        const bool isTimeout = wifiComDelay.HasFinished();
+        if (isTimeout) {
+          Util::Metrics::Increment(METRIC_WIFI_TIMEOUT_CONNECT);
+        }
+        if (isResponseCompleted && (wifiResponse.compare(RESULT_OK) == 0)) {
+          _setLinkReady();
+        } else if (isResponseCompleted && (wifiResponse.compare(RESULT_CONNECTING) == 0)) {
+          wifiConnectStartTick = Util::Tick::GetTickCounter();
+          wifiState = CMD_CONNECT_POLL_SEND;
+          wifiComDelay.Restart(WIFI_CONNECT_POLL_INTERVAL);
+        } else if (isTimeout || isResponseCompleted) {
+          _retryLink();
+        }
+      }
+      break;
+
+      case CMD_CONNECT_POLL_SEND:
+      {
+        if (wifiComDelay.HasFinished()) {
+          wifiResponse.clear();
+          esp32Command = COMMAND_STATUS_STR;
           esp32Command += STOP_CHAR;
           _sendCommand(esp32Command.c_str());
-          wifiState = CMD_CONNECT_WAIT_RESPONSE;
-          wifiComDelay.Start(DELAY_10_SECONDS);
+          wifiState = CMD_CONNECT_POLL_WAIT_RESPONSE;
+          wifiComDelay.Restart(WIFI_HANDSHAKE_TIMEOUT);
         }
-        
       }
       break;
 
-      case CMD_CONNECT_WAIT_RESPONSE:
+      case CMD_CONNECT_POLL_WAIT_RESPONSE:
       {
         const bool isResponseCompleted = _isResponseCompleted(&wifiResponse);
-        if( wifiComDelay.HasFinished() || (isResponseCompleted && (wifiResponse.compare(RESULT_ERROR) == 0)) ) {
-          printf("WifiCom - Conection: [ERROR]\n\r");
-          wifiState = INIT;
-        } else if (isResponseCompleted && (wifiResponse.compare(RESULT_OK) == 0)) {
-          printf("WifiCom - Conection: [OK]\n\r");
-          wifiState = IDLE;
+        const bool isConnectExpired = ((Util::Tick::GetTickCounter() - wifiConnectStartTick) >= WIFI_CONNECT_TIMEOUT);
+        const bool isTimeout = wifiComDelay.HasFinished();
+        if (isResponseCompleted && (wifiResponse.compare(RESULT_CONNECTED) == 0)) {
+          _setLinkReady();
+        } else if (isConnectExpired) {
+          Util::Metrics::Increment(METRIC_WIFI_TIMEOUT_CONNECT);
+          _retryLink();
+        } else if (isTimeout || (isResponseCompleted && (wifiResponse.compare(RESULT_CONNECTING) == 0))) {
+          wifiState = CMD_CONNECT_POLL_SEND;
+          wifiComDelay.Restart(WIFI_CONNECT_POLL_INTERVAL);
+        } else if (isResponseCompleted) {
+          _retryLink();
         }
       }
       break;
 
       case CMD_GET_SEND:
       {
-        wifiCommandGetResponse.clear();
+        wifiResponse.clear();
         esp32Command = COMMAND_GET_STR;
         esp32Command += PARAM_SEPARATOR_CHAR;
         esp32Command += wifiServer;
         esp32Command += STOP_CHAR;
         _sendCommand(esp32Command.c_str());
         wifiState = CMD_GET_WAIT_RESPONSE;
-        wifiComDelay.Start(DELAY_3_SECONDS);
+        wifiComDelay.Restart(WIFI_REQUEST_TIMEOUT);
       }
       break;
 
       case CMD_GET_WAIT_RESPONSE:
       {
         const bool isResponseCompleted = _isResponseCompleted(&wifiResponse);
-        if ((wifiComDelay.HasFinished()) || (isResponseCompleted && (wifiCommandGetResponse.compare(RESULT_ERROR) == 0))) {
+        const bool isTimeout = wifiComDelay.HasFinished();
+        if (isResponseCompleted) {
+          _checkEndpoints(&wifiResponse);
+        }
+        if (isTimeout) {
+          Util::Metrics::Increment(METRIC_WIFI_TIMEOUT_GET);
+        }
+        if (isTimeout || isResponseCompleted) {
+          _updateHealth(!isTimeout && (wifiResponse.compare(RESULT_ERROR) != 0));
+        }
+        if (isTimeout || (isResponseCompleted && (wifiResponse.compare(RESULT_ERROR) == 0))) {
           wifiState = ERROR;
         } else if (isResponseCompleted) {
           wifiState = CMD_GET_RESPONSE_READY;
           wifiIsGetResponseReady = true;
-          wifiComDelay.Start(DELAY_10_SECONDS);
+          wifiComDelay.Restart(WIFI_RESPONSE_HOLD_TIMEOUT);
         }
       }
       break;
@@ -127,7 +261,7 @@ namespace Drivers {
           wifiState = IDLE;
         } else if(wifiComDelay.HasFinished()) {
           wifiState = ERROR;
-          wifiCommandGetResponse.clear();
+          wifiResponse.clear();
         }
       }
       break;
@@ -143,21 +277,99 @@ namespace Drivers {
         esp32Command += STOP_CHAR;
         _sendCommand(esp32Command.c_str());
         wifiState = CMD_POST_WAIT_RESPONSE;
-        wifiComDelay.Start(DELAY_3_SECONDS);
+        wifiComDelay.Restart(WIFI_REQUEST_TIMEOUT);
       }
       break;
 
       case CMD_POST_WAIT_RESPONSE:
       {
         const bool isResponseCompleted = _isResponseCompleted(&wifiResponse);
-        if ((wifiComDelay.HasFinished()) || (isResponseCompleted && (wifiResponse.compare(RESULT_ERROR) == 0))) {
+        const bool isTimeout = wifiComDelay.HasFinished();
+        if (isResponseCompleted) {
+          _checkEndpoints(&wifiResponse);
+        }
+        if (isTimeout) {
+          Util::Metrics::Increment(METRIC_WIFI_TIMEOUT_POST);
+        }
+        if (isTimeout || isResponseCompleted) {
+          _updateHealth(!isTimeout && (wifiResponse.compare(RESULT_ERROR) != 0));
+        }
+        if (isTimeout || (isResponseCompleted && (wifiResponse.compare(RESULT_ERROR) == 0))) {
           wifiState = CMD_POST_RESPONSE_READY;
           wifiResponse = RESULT_ERROR;
 
         } else if (isResponseCompleted) {
           wifiState = CMD_POST_RESPONSE_READY;
           wifiIsResponseReady = true;
-          wifiComDelay.Start(DELAY_10_SECONDS);
+          wifiComDelay.Restart(WIFI_RESPONSE_HOLD_TIMEOUT);
+        }
+      }
+      break;
+
+      case CMD_BROADCAST_SEND:
+      {
+        wifiResponse.clear();
+        esp32Command = COMMAND_BROADCAST_STR;
+        esp32Command += PARAM_SEPARATOR_CHAR;
+        esp32Command += wifiServer;
+        esp32Command += PARAM_SEPARATOR_CHAR;
+        esp32Command += wifiRecipients;
+        esp32Command += PARAM_SEPARATOR_CHAR;
+        esp32Command += wifiRequest;
+        esp32Command += STOP_CHAR;
+        _sendCommand(esp32Command.c_str());
+        wifiState = CMD_BROADCAST_WAIT_RESPONSE;
+        wifiComDelay.Restart(WIFI_BROADCAST_TIMEOUT);
+      }
+      break;
+
+      case CMD_BROADCAST_WAIT_RESPONSE:
+      {
+        const bool isResponseCompleted = _isResponseCompleted(&wifiResponse);
+        if (isResponseCompleted) {
+          _checkEndpoints(&wifiResponse);
+        }
+        if (wifiComDelay.HasFinished()) {
+          Util::Metrics::Increment(METRIC_WIFI_TIMEOUT_BROADCAST);
+          _updateHealth(false);
+          wifiState = CMD_POST_RESPONSE_READY;
+          wifiResponse = RESULT_ERROR;
+        } else if (isResponseCompleted) {
+          _updateHealth(true);
+          wifiState = CMD_POST_RESPONSE_READY;
+          wifiIsResponseReady = true;
+          wifiComDelay.Restart(WIFI_RESPONSE_HOLD_TIMEOUT);
+        }
+      }
+      break;
+
+      case CMD_TELEMETRY_SEND:
+      {
+        wifiResponse.clear();
+        esp32Command = COMMAND_TELEMETRY_STR;
+        esp32Command += PARAM_SEPARATOR_CHAR;
+        esp32Command += wifiServer;
+        esp32Command += PARAM_SEPARATOR_CHAR;
+        esp32Command += std::to_string(wifiGatewayPort);
+        esp32Command += PARAM_SEPARATOR_CHAR;
+        esp32Command += wifiRequest;
+        esp32Command += STOP_CHAR;
+        _sendCommand(esp32Command.c_str());
+        wifiState = CMD_TELEMETRY_WAIT_RESPONSE;
+        wifiComDelay.Restart(WIFI_REQUEST_TIMEOUT);
+      }
+      break;
+
+      case CMD_TELEMETRY_WAIT_RESPONSE:
+      {
+        const bool isResponseCompleted = _isResponseCompleted(&wifiResponse);
+        if (wifiComDelay.HasFinished()) {
+          Util::Metrics::Increment(METRIC_WIFI_TIMEOUT_TELEMETRY);
+          _updateHealth(false);
+          wifiState = IDLE;
+        } else if (isResponseCompleted) {
+          _updateHealth(wifiResponse.compare(RESULT_ERROR) != 0);
+          wifiState = IDLE;
         }
       }
       break;
@@ -173,6 +385,129 @@ namespace Drivers {
       }
       break;
 
+      case CMD_ENDPOINT_SEND:
+      {
+        wifiResponse.clear();
+        esp32Command = COMMAND_ENDPOINT_STR;
+        esp32Command += PARAM_SEPARATOR_CHAR;
+        esp32Command += (char) ('0' + wifiEndpointIndex);
+        esp32Command += PARAM_SEPARATOR_CHAR;
+        esp32Command += wifiEndpoints[wifiEndpointIndex];
+        esp32Command += STOP_CHAR;
+        _sendCommand(esp32Command.c_str());
+        wifiState = CMD_ENDPOINT_WAIT_RESPONSE;
+        wifiComDelay.Restart(WIFI_HANDSHAKE_TIMEOUT);
+      }
+      break;
+
+      case CMD_ENDPOINT_WAIT_RESPONSE:
+      {
+        const bool isResponseCompleted = _isResponseCompleted(&wifiResponse);
+        const bool isTimeout = wifiComDelay.HasFinished();
+        if (isResponseCompleted && (wifiResponse.compare(RESULT_OK) == 0)) {
+          wifiEndpointIndex++;
+          if (wifiEndpointIndex < wifiEndpointCount) {
+            wifiState = CMD_ENDPOINT_SEND;
+          } else {
+            wifiState = (wifiWebhookPort != 0) ? CMD_WEBHOOK_SEND : IDLE;
+          }
+        } else if (isTimeout || isResponseCompleted) {
+          // Requests to these endpoints would fail, bring the link up again.
+          wifiIsLinkUp = false;
+          _retryLink();
+        }
+      }
+      break;
+
+      case CMD_WEBHOOK_SEND:
+      {
+        wifiResponse.clear();
+        esp32Command = COMMAND_WEBHOOK_STR;
+        esp32Command += PARAM_SEPARATOR_CHAR;
+        esp32Command += std::to_string(wifiWebhookPort);
+        if (!wifiWebhookSecret.empty()) {
+          esp32Command += PARAM_SEPARATOR_CHAR;
+          esp32Command += wifiWebhookSecret;
+        }
+        esp32Command += STOP_CHAR;
+        _sendCommand(esp32Command.c_str());
+        wifiState = CMD_WEBHOOK_WAIT_RESPONSE;
+        wifiComDelay.Restart(WIFI_HANDSHAKE_TIMEOUT);
+      }
+      break;
+
+      case CMD_WEBHOOK_WAIT_RESPONSE:
+      {
+        const bool isResponseCompleted = _isResponseCompleted(&wifiResponse);
+        const bool isTimeout = wifiComDelay.HasFinished();
+        if (isResponseCompleted && (wifiResponse.compare(RESULT_OK) == 0)) {
+          wifiState = IDLE;
+        } else if (isTimeout || isResponseCompleted) {
+          // No updates would be pushed, bring the link up again.
+          wifiIsLinkUp = false;
+          _retryLink();
+        }
+      }
+      break;
+
+      case CMD_HOLD_SEND:
+      {
+        wifiResponse.clear();
+        esp32Command = COMMAND_HOLD_STR;
+        esp32Command += PARAM_SEPARATOR_CHAR;
+        esp32Command += std::to_string(wifiHoldTime);
+        esp32Command += STOP_CHAR;
+        _sendCommand(esp32Command.c_str());
+        wifiState = CMD_HOLD_WAIT_RESPONSE;
+        wifiComDelay.Restart(WIFI_HANDSHAKE_TIMEOUT);
+      }
+      break;
+
+      case CMD_HOLD_WAIT_RESPONSE:
+      {
+        const bool isResponseCompleted = _isResponseCompleted(&wifiResponse);
+        const bool isTimeout = wifiComDelay.HasFinished();
+        if (isResponseCompleted && (wifiResponse.compare(RESULT_OK) == 0)) {
+          wifiState = HELD;
+          wifiComDelay.Restart(wifiHoldTime);
+        } else if (isTimeout || isResponseCompleted) {
+          // Bridge firmware without the command, or not answering: not held.
+          wifiState = IDLE;
+        }
+      }
+      break;
+
+      case HELD:
+      {
+        // The ESP32 sends again on its own once the hold time is over.
+        if (wifiComDelay.HasFinished()) {
+          wifiState = IDLE;
+        }
+      }
+      break;
+
+      case CMD_RESUME_SEND:
+      {
+        wifiResponse.clear();
+        esp32Command = COMMAND_HOLD_STR;
+        esp32Command += PARAM_SEPARATOR_CHAR;
+        esp32Command += '0';
+        esp32Command += STOP_CHAR;
+        _sendCommand(esp32Command.c_str());
+        wifiState = CMD_RESUME_WAIT_RESPONSE;
+        wifiComDelay.Restart(WIFI_HANDSHAKE_TIMEOUT);
+      }
+      break;
+
+      case CMD_RESUME_WAIT_RESPONSE:
+      {
+        // Either way the hold ends, at the latest when its time is over.
+        if (_isResponseCompleted(&wifiResponse) || wifiComDelay.HasFinished()) {
+          wifiState = IDLE;
+        }
+      }
+      break;
+
       case ERROR:
       {
         wifiState = IDLE;
@@ -180,6 +515,15 @@ namespace Drivers {
       break;
 
       case IDLE:
+      {
+        // Requests keep failing: the ESP32 lost the AP or stopped answering.
+        if (!wifiIsLinkUp || (wifiLinkHealth <= 0)) {
+          wifiIsLinkUp = false;
+          LOG_WARN(LOG_MODULE_WIFI_COM, LOG_WIFI_COM_LINK_LOST);
+          Util::Metrics::Increment(METRIC_WIFI_LINK_LOST);
+          wifiState = INIT;
+        }
+      }
       break;
     }
   } // WifiCom::update();
@@ -189,20 +533,99 @@ namespace Drivers {
     return (wifiState != IDLE);
   }
 
-  void WifiCom::post(const std::string &server, const std::string &request)
+  Util::tick_t WifiCom::getLinkReadyTick()
+  {
+    return wifiLinkReadyTick;
+  }
+
+  int WifiCom::getLinkHealth()
+  {
+    return wifiLinkHealth;
+  }
+
+  bool WifiCom::isLinkUp()
+  {
+    return wifiIsLinkUp;
+  }
+
+  int WifiCom::getRssi()
+  {
+    return wifiRssi;
+  }
+
+  int WifiCom::getBaudRate()
+  {
+    return wifiBaudRate;
+  }
+
+  int WifiCom::registerEndpoint(const std::string &url)
+  {
+    for (size_t i = 0; i < wifiEndpointCount; i++) {
+      if (wifiEndpoints[i] == url) {
+        return (int) i;
+      }
+    }
+
+    if (wifiEndpointCount == WIFI_ENDPOINT_MAX) {
+      return -1;
+    }
+
+    // Sent on the next handshake. If the link is already up, the ESP32 answers
+    // NO_ENDPOINT to the first request and the link is brought up again.
+    wifiEndpoints[wifiEndpointCount] = url;
+
+    return (int) wifiEndpointCount++;
+  }
+
+  void WifiCom::post(uint8_t endpoint, const char* request)
   {
     wifiState = CMD_POST_SEND;
+    _setEndpoint(endpoint);
+    wifiRequest = request;
+    wifiResponse.clear();
+  }
+
+  void WifiCom::broadcast(uint8_t endpoint, const std::string &recipients, const char* request)
+  {
+    wifiState = CMD_BROADCAST_SEND;
+    _setEndpoint(endpoint);
+    wifiRecipients = recipients;
+    wifiRequest = request;
+    wifiResponse.clear();
+  }
+
+  void WifiCom::post(const std::string &server, const char* request)
+  {
+    wifiState = CMD_POST_SEND;
+    wifiServer = server;
+    wifiRequest = request;
+    wifiResponse.clear();
+  }
+
+  void WifiCom::broadcast(const std::string &server, const std::string &recipients, const char* request)
+  {
+    wifiState = CMD_BROADCAST_SEND;
     wifiServer = server;
+    wifiRecipients = recipients;
     wifiRequest = request;
     wifiResponse.clear();
   }
 
+  void WifiCom::telemetry(const std::string &host, uint16_t port, const char* frame)
+  {
+    wifiState = CMD_TELEMETRY_SEND;
+    wifiServer = host;
+    wifiGatewayPort = port;
+    wifiRequest = frame;
+    wifiResponse.clear();
+  }
+
   void WifiCom::request(const std::string &url)
   {
     wifiState = CMD_GET_SEND;
     wifiServer = url;
     wifiRequest = "";
-    wifiCommandGetResponse.clear();
+    wifiResponse.clear();
   }
 
   bool WifiCom::getPostResponse(std::string *response)
@@ -221,8 +644,8 @@ namespace Drivers {
   bool WifiCom::getGetResponse(std::string *response)
   {
     if (wifiState == CMD_GET_RESPONSE_READY) {
-      (*response) = wifiCommandGetResponse;
-      wifiCommandGetResponse.clear();
+      (*response) = wifiResponse;
+      wifiResponse.clear();
       wifiIsGetResponseReady = false;
 
       return true;
@@ -231,6 +654,46 @@ namespace Drivers {
     return false;
   }
 
+  void WifiCom::listen(uint16_t port, const std::string &secret)
+  {
+    // Sent on the next handshake, as endpoints are.
+    wifiWebhookPort = port;
+    wifiWebhookSecret = secret;
+  }
+
+  bool WifiCom::getUpdate(std::string *update)
+  {
+    if (wifiUpdateCount == 0) {
+      return false;
+    }
+
+    update->swap(wifiUpdates[wifiUpdateHead]);
+    wifiUpdates[wifiUpdateHead].clear();
+    wifiUpdateHead = (wifiUpdateHead + 1) % WIFI_UPDATE_QUEUE_SIZE;
+    wifiUpdateCount--;
+
+    return true;
+  }
+
+  void WifiCom::hold(Util::tick_t duration)
+  {
+    wifiState = CMD_HOLD_SEND;
+    wifiHoldTime = duration;
+    wifiResponse.clear();
+  }
+
+  bool WifiCom::isHeld()
+  {
+    return (wifiState == HELD);
+  }
+
+  void WifiCom::resume()
+  {
+    if (wifiState == HELD) {
+      wifiState = CMD_RESUME_SEND;
+    }
+  }
+
 //=====[Implementations of private functions]===================================
 
  /**
@@ -242,7 +705,24 @@ namespace Drivers {
   */
   WifiCom::WifiCom(PinName txPin, PinName rxPin, const int baudRate)
   : wifiSerial(txPin, rxPin, baudRate),
-  wifiComDelay(0)
+  wifiComDelay(0),
+  wifiLinkReadyTick(0),
+  wifiRequestId(0),
+  wifiBaudRate(baudRate),
+  wifiBaudAttempts(0),
+  wifiIsBaudVerifying(false),
+  wifiTxHead(0),
+  wifiTxTail(0),
+  wifiIsTxActive(false),
+  wifiTxPendingOffset(0),
+  wifiIsTxInFlight(false),
+  wifiTxStartUs(0),
+  wifiEndpointCount(0),
+  wifiEndpointIndex(0),
+  wifiWebhookPort(0),
+  wifiUpdateHead(0),
+  wifiUpdateCount(0),
+  wifiHoldTime(0)
   {}
 
  /**
@@ -254,43 +734,558 @@ namespace Drivers {
     wifiState = INIT;
     wifiSsid = WIFI_SSID;
     wifiPassword = WIFI_PASSWORD;
+    wifiLinkHealth = 0;
+    wifiRetryCount = 0;
+    wifiRandomState = us_ticker_read() | 1;
+    wifiIsLinkUp = false;
+    wifiRssi = 0;
+    wifiIsRxResponseReady = false;
+    wifiIsRxFrameDropped = false;
+    wifiRxChunkRemaining = 0;
+    wifiIsRxChunkCurrent = false;
+    wifiRxBody.reserve(WIFI_BODY_MAX);
+    wifiIsBodyStreamed = false;
+    wifiIsBodyTruncated = false;
+    Util::Metrics::Set(METRIC_WIFI_BAUD_RATE, (float) wifiBaudRate);
     wifiSerial.enable_output(true);
   }
 
  /**
   * @brief Sends a command to the WiFi module.
+  *
+  * The command is tagged with a new request ID. The ESP32 runs commands in
+  * parallel and echoes the ID with the result, so late results of commands
+  * that already timed out can be told apart.
+  *
+  * Doesn't wait for the transmission: the command is queued and goes out from
+  * the UART TX interrupt while the superloop keeps running.
   * 
   * @param command Null-terminated C string containing the command.
   */
   void WifiCom::_sendCommand(const char* command)
   {
-    wifiSerial.enable_output(true);
-    wifiSerial.write(command, strlen(command));
-    wifiSerial.enable_output(false);
+    PROFILE_ZONE(WIFI_COM_SEND);
+
+    const uint32_t startUs = us_ticker_read();
+    char prefix[8];
+    const size_t length = strlen(command);
+    const int prefixLength = snprintf(prefix, sizeof(prefix), "%c%u%c", REQUEST_ID_CHAR, (unsigned int) ++wifiRequestId, PARAM_SEPARATOR_CHAR);
+
+    if (!wifiIsTxInFlight) {
+      wifiTxPending.clear();
+      wifiTxPendingOffset = 0;
+      wifiTxStartUs = startUs;
+      wifiIsTxInFlight = true;
+    }
+    wifiTxPending.append(prefix, prefixLength);
+    wifiTxPending.append(command, length);
+    _feedTx();
+
+    // Whatever response or body was not read belongs to an older command.
+    wifiIsRxResponseReady = false;
+    wifiRxBody.clear();
+    wifiIsBodyStreamed = false;
+    wifiIsBodyTruncated = false;
+    wifiRequestStartTick = Util::Tick::GetTickCounter();
+    Util::Metrics::Increment(METRIC_WIFI_BYTES_OUT, prefixLength + length);
+    Util::Metrics::Observe(METRIC_WIFI_SEND_STALL, us_ticker_read() - startUs);
+  }
+
+ /**
+  * @brief Feeds the transmit ring with the rest of long commands, and completes
+  *        the commands in flight once the TX interrupt is done with them.
+  */
+  void WifiCom::_transmit()
+  {
+    if (!wifiIsTxInFlight) {
+      return;
+    }
+
+    _feedTx();
+
+    if (!wifiIsTxActive && (wifiTxPendingOffset == wifiTxPending.size())) {
+      Util::Metrics::Observe(METRIC_WIFI_TX_TIME, us_ticker_read() - wifiTxStartUs);
+      wifiTxPending.clear();
+      wifiTxPendingOffset = 0;
+      wifiIsTxInFlight = false;
+    }
+  }
+
+ /**
+  * @brief Moves as many pending bytes as fit into the transmit ring and starts
+  *        the TX interrupt if it is stopped.
+  */
+  void WifiCom::_feedTx()
+  {
+    const uint32_t head = wifiTxHead;
+    const size_t room = WIFI_TX_BUFFER_SIZE - (head - wifiTxTail);
+    const size_t count = std::min(room, wifiTxPending.size() - wifiTxPendingOffset);
+
+    if (count == 0) {
+      return;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+      wifiTxBuffer[(head + i) & (WIFI_TX_BUFFER_SIZE - 1)] = (uint8_t) wifiTxPending[wifiTxPendingOffset + i];
+    }
+    wifiTxPendingOffset += count;
+
+    // Published before checking the interrupt: if it stopped, it didn't see these bytes.
+    wifiTxHead = head + count;
+
+    if (!wifiIsTxActive) {
+      wifiIsTxActive = true;
+      wifiSerial.attach(callback(this, &WifiCom::_onTxReady), SerialBase::TxIrq);
+    }
+  }
+
+ /**
+  * @brief UART TX interrupt: hands the ring bytes to the UART, and stops itself
+  *        once the ring is empty.
+  */
+  void WifiCom::_onTxReady()
+  {
+    uint32_t tail = wifiTxTail;
+
+    while ((tail != wifiTxHead) && wifiSerial.writable()) {
+      const char txChar = (char) wifiTxBuffer[tail & (WIFI_TX_BUFFER_SIZE - 1)];
+
+      wifiSerial.write(&txChar, 1);
+      tail++;
+    }
+    wifiTxTail = tail;
+
+    if (tail == wifiTxHead) {
+      wifiSerial.attach(nullptr, SerialBase::TxIrq);
+      wifiIsTxActive = false;
+    }
   }
 
  /**
-  * @brief Checks if a response from the module is complete.
+  * @brief Reads the bytes received from the module and splits them in frames.
+  *
+  * Event frames, starting with EVENT_CHAR, are handled right away in any state.
+  * Body chunks are appended to the body of the last command as they arrive.
+  * Other frames are responses, kept for _isResponseCompleted().
+  */
+  void WifiCom::_receive()
+  {
+    PROFILE_ZONE(WIFI_COM_RX_DRAIN);
+
+    char receivedChar;
+
+    for (int i = 0; (i < WIFI_RX_DRAIN_MAX) && _readCom(&receivedChar); i++) {
+      if (wifiRxChunkRemaining > 0) {
+        _receiveChunk(receivedChar);
+        continue;
+      }
+
+      if ((receivedChar == PARAM_SEPARATOR_CHAR) && _isChunkHeader(wifiRxFrame)) {
+        wifiRxFrame.clear();
+        continue;
+      }
+
+      if ((receivedChar != STOP_CHAR) && wifiIsRxFrameDropped) {
+        continue;
+      }
+
+      if ((receivedChar != STOP_CHAR) && (wifiRxFrame.length() == WIFI_RX_FRAME_MAX)) {
+        LOG_WARN(LOG_MODULE_WIFI_COM, LOG_WIFI_COM_FRAME_DROPPED, WIFI_RX_FRAME_MAX);
+        Util::Metrics::Increment(METRIC_WIFI_RX_FRAMES_DROPPED);
+        wifiIsRxFrameDropped = true;
+        wifiRxFrame.clear();
+        continue;
+      }
+
+      if (receivedChar != STOP_CHAR) {
+        wifiRxFrame += receivedChar;
+        continue;
+      }
+
+      // Back in step with the frames at the stop character of the dropped one.
+      if (wifiIsRxFrameDropped) {
+        wifiIsRxFrameDropped = false;
+        continue;
+      }
+
+      if (!wifiRxFrame.empty() && (wifiRxFrame[0] == EVENT_CHAR)) {
+        _handleEvent(wifiRxFrame);
+      } else {
+        wifiRxResponse.swap(wifiRxFrame);
+        wifiIsRxResponseReady = true;
+      }
+      wifiRxFrame.clear();
+    }
+  }
+
+  /**
+  * @brief Checks if the frame received so far is a body chunk header, and
+  *        gets ready to receive the chunk bytes.
+  *
+  * @param frame Frame received so far, up to a separator: [@<id>|]*<length>
+  * @return true if it is a chunk header.
+  */
+  bool WifiCom::_isChunkHeader(const std::string &frame)
+  {
+    size_t start = 0;
+    bool isCurrent = true;
+
+    if (!frame.empty() && (frame[0] == REQUEST_ID_CHAR)) {
+      const size_t idEnd = frame.find(PARAM_SEPARATOR_CHAR);
+
+      // This separator ends the request ID.
+      if (idEnd == std::string::npos) {
+        return false;
+      }
+
+      isCurrent = (strtoul(frame.c_str() + 1, nullptr, 10) == wifiRequestId);
+      start = idEnd + 1;
+    }
+
+    if ((frame.length() < (start + 2)) || (frame[start] != CHUNK_CHAR)) {
+      return false;
+    }
+
+    char *lengthEnd;
+    const unsigned long length = strtoul(frame.c_str() + start + 1, &lengthEnd, 10);
+
+    if ((*lengthEnd != '\0') || (length == 0)) {
+      return false;
+    }
+
+    // Chunks of an older command are read and dropped.
+    if (isCurrent && !wifiIsBodyStreamed) {
+      Util::Metrics::Observe(METRIC_WIFI_FIRST_CHUNK_LATENCY, (uint32_t) (Util::Tick::GetTickCounter() - wifiRequestStartTick));
+      wifiIsBodyStreamed = true;
+    }
+    Util::Metrics::Increment(METRIC_WIFI_BODY_CHUNKS);
+    wifiIsRxChunkCurrent = isCurrent;
+    wifiRxChunkRemaining = length;
+
+    return true;
+  }
+
+  /**
+  * @brief Appends a body chunk byte to the body of the last command.
+  * @param receivedChar Byte received.
+  */
+  void WifiCom::_receiveChunk(char receivedChar)
+  {
+    wifiRxChunkRemaining--;
+
+    if (!wifiIsRxChunkCurrent) {
+      return;
+    }
+
+    if (wifiRxBody.length() < WIFI_BODY_MAX) {
+      wifiRxBody += receivedChar;
+    } else {
+      wifiIsBodyTruncated = true;
+    }
+  }
+
+  /**
+  * @brief Handles an event frame pushed by the module.
+  * 
+  * @param frame Complete frame, without the stop character.
+  */
+  void WifiCom::_handleEvent(const std::string &frame)
+  {
+    const size_t nameEnd = frame.find(PARAM_SEPARATOR_CHAR);
+    const std::string name = frame.substr(1, (nameEnd == std::string::npos) ? std::string::npos : nameEnd - 1);
+    const std::string params = (nameEnd == std::string::npos) ? "" : frame.substr(nameEnd + 1);
+
+    Util::Metrics::Increment(METRIC_WIFI_EVENTS);
+
+    if (name == EVENT_LINK_UP_STR) {
+      const size_t rssiStart = params.find(PARAM_SEPARATOR_CHAR);
+
+      if (rssiStart != std::string::npos) {
+        wifiRssi = atoi(params.c_str() + rssiStart + 1);
+        Util::Metrics::Set(METRIC_WIFI_RSSI, (float) wifiRssi);
+      }
+
+      // Associated again: no need to wait for the next poll or the backoff.
+      if ((wifiState == CMD_STATUS_SEND) || (wifiState == CMD_CONNECT_POLL_SEND)) {
+        wifiComDelay.Restart(0);
+      }
+    } else if (name == EVENT_LINK_DOWN_STR) {
+      LOG_WARN(LOG_MODULE_WIFI_COM, LOG_WIFI_COM_LINK_DOWN, atoi(params.c_str()));
+      wifiIsLinkUp = false;
+    } else if (name == EVENT_RSSI_STR) {
+      wifiRssi = atoi(params.c_str());
+      Util::Metrics::Set(METRIC_WIFI_RSSI, (float) wifiRssi);
+    } else if (name == EVENT_IP_STR) {
+      LOG_INFO(LOG_MODULE_WIFI_COM, LOG_WIFI_COM_IP_CHANGED, params.c_str());
+    } else if (name == EVENT_UPDATE_STR) {
+      _queueUpdate(params);
+    }
+  }
+
+  /**
+  * @brief Keeps an update pushed to the webhook until it is read.
+  *
+  * The ESP32 already acknowledged it, so an update that doesn't fit is lost.
+  *
+  * @param update Update, as JSON.
+  */
+  void WifiCom::_queueUpdate(const std::string &update)
+  {
+    Util::Metrics::Increment(METRIC_WIFI_UPDATES);
+
+    if (wifiUpdateCount == WIFI_UPDATE_QUEUE_SIZE) {
+      LOG_WARN(LOG_MODULE_WIFI_COM, LOG_WIFI_COM_UPDATE_DROPPED, WIFI_UPDATE_QUEUE_SIZE);
+      Util::Metrics::Increment(METRIC_WIFI_UPDATES_DROPPED);
+      return;
+    }
+
+    wifiUpdates[(wifiUpdateHead + wifiUpdateCount) % WIFI_UPDATE_QUEUE_SIZE] = update;
+    wifiUpdateCount++;
+  }
+
+ /**
+  * @brief Checks if the response to the last command was received.
   * 
   * @param response Pointer to store the raw response string.
   * @return true if response is completed (e.g., "OK" or "ERROR" received).
   */
   bool WifiCom::_isResponseCompleted(std::string* response)
   {
-    char receivedChar;
+    if (!wifiIsRxResponseReady) {
+      return false;
+    }
 
-    if (_readCom(&receivedChar)) {
-      if (receivedChar == STOP_CHAR) {
-        return true;
-      } else {
-        (*response) += receivedChar;
+    wifiIsRxResponseReady = false;
+    (*response) = wifiRxResponse;
+
+    if (!_isCurrentResponse(response)) {
+      return false;
+    }
+
+    // A streamed body is followed by OK, with the transfer sizes and time, or
+    // ERROR if the transfer failed. Empty bodies only get the OK.
+    if (wifiIsBodyStreamed || _isTransferResult(*response)) {
+      if (wifiIsBodyTruncated) {
+        LOG_WARN(LOG_MODULE_WIFI_COM, LOG_WIFI_COM_BODY_TRUNCATED, WIFI_BODY_MAX);
+        Util::Metrics::Increment(METRIC_WIFI_BODY_TRUNCATED);
       }
+      if (response->compare(0, strlen(RESULT_OK), RESULT_OK) == 0) {
+        _readTransferStats(*response);
+        response->assign(wifiRxBody);
+      }
+      wifiRxBody.clear();
+      wifiIsBodyStreamed = false;
+      wifiIsBodyTruncated = false;
     }
 
-    return false;
+    return true;
+  }
+
+  /**
+  * @brief Checks if a response closes an HTTP transfer, as OK|<sizes and time>.
+  *
+  * @param response Complete response, without ID.
+  * @return true if it is a transfer result.
+  */
+  bool WifiCom::_isTransferResult(const std::string &response)
+  {
+    const size_t okLength = strlen(RESULT_OK);
+
+    return (response.length() > okLength) &&
+           (response.compare(0, okLength, RESULT_OK) == 0) &&
+           (response[okLength] == PARAM_SEPARATOR_CHAR);
   }
 
   /**
+  * @brief Records the sizes and time of an HTTP transfer.
+  *
+  * The result is OK|<bytes received>|<body bytes>|<transfer ms>: bytes received
+  * are the ones that went over the air, gzip compressed if the server did so.
+  * Bridges that don't report them answer a plain OK, which is skipped.
+  *
+  * @param response Transfer result.
+  */
+  void WifiCom::_readTransferStats(const std::string &response)
+  {
+    if (!_isTransferResult(response)) {
+      return;
+    }
+
+    char* field = const_cast<char*>(response.c_str()) + strlen(RESULT_OK) + 1;
+    const uint32_t receivedBytes = strtoul(field, &field, 10);
+    const uint32_t bodyBytes = (*field == PARAM_SEPARATOR_CHAR) ? strtoul(field + 1, &field, 10) : 0;
+    const uint32_t transferTime = (*field == PARAM_SEPARATOR_CHAR) ? strtoul(field + 1, &field, 10) : 0;
+
+    Util::Metrics::Increment(METRIC_WIFI_HTTP_BYTES_RECEIVED, receivedBytes);
+    Util::Metrics::Increment(METRIC_WIFI_HTTP_BODY_BYTES, bodyBytes);
+    Util::Metrics::Observe(METRIC_WIFI_HTTP_TRANSFER_SIZE, receivedBytes);
+    Util::Metrics::Observe(METRIC_WIFI_HTTP_TRANSFER_TIME, transferTime);
+  }
+
+  /**
+  * @brief Checks the request ID of a complete response and strips it.
+  *
+  * Responses without ID, from bridges that run one command at a time, are
+  * always taken as current.
+  *
+  * @param response Complete response, without the stop character.
+  * @return true if it answers the last command sent, false if it was dropped.
+  */
+  bool WifiCom::_isCurrentResponse(std::string* response)
+  {
+    if (!response->empty() && ((*response)[0] == REQUEST_ID_CHAR)) {
+      const size_t separator = response->find(PARAM_SEPARATOR_CHAR);
+      const unsigned long id = strtoul(response->c_str() + 1, nullptr, 10);
+
+      if ((separator == std::string::npos) || (id != wifiRequestId)) {
+        Util::Metrics::Increment(METRIC_WIFI_STALE_RESPONSES);
+        response->clear();
+        return false;
+      }
+
+      response->erase(0, separator + 1);
+    }
+
+    Util::Metrics::Observe(METRIC_WIFI_REQUEST_LATENCY, (uint32_t) (Util::Tick::GetTickCounter() - wifiRequestStartTick));
+
+    return true;
+  }
+
+  /**
+  * @brief The ESP32 is associated, requests can be served.
+  */
+  void WifiCom::_setLinkReady()
+  {
+    static bool isFirstLinkMeasured = false;
+
+    LOG_INFO(LOG_MODULE_WIFI_COM, LOG_WIFI_COM_CONNECTION_OK);
+    Util::Metrics::Increment(METRIC_WIFI_CONNECTIONS);
+    wifiLinkReadyTick = Util::Tick::GetTickCounter();
+    wifiRetryCount = 0;
+    wifiLinkHealth = WIFI_HEALTH_MAX;
+    wifiIsLinkUp = true;
+    Util::Metrics::Set(METRIC_WIFI_LINK_HEALTH, (float) wifiLinkHealth);
+    if (!isFirstLinkMeasured) {
+      Util::Metrics::Set(METRIC_BOOT_LINK_READY, (float) Util::Tick::GetTickCounter());
+      isFirstLinkMeasured = true;
+    }
+
+    // The ESP32 may have been reset: endpoints and webhook are sent again before any request.
+    wifiEndpointIndex = 0;
+    if (wifiEndpointCount > 0) {
+      wifiState = CMD_ENDPOINT_SEND;
+    } else {
+      wifiState = (wifiWebhookPort != 0) ? CMD_WEBHOOK_SEND : IDLE;
+    }
+  }
+
+  /**
+  * @brief Sets a registered endpoint as server of the next request.
+  * @param endpoint Endpoint ID, from registerEndpoint.
+  */
+  void WifiCom::_setEndpoint(uint8_t endpoint)
+  {
+    wifiServer.assign(1, ENDPOINT_CHAR);
+    wifiServer += (char) ('0' + endpoint);
+  }
+
+  /**
+  * @brief Checks if the ESP32 lost the registered endpoints, after a reset.
+  *
+  * The request is taken as failed, and the link is brought up again to
+  * register them.
+  *
+  * @param response Complete response, replaced by RESULT_ERROR if the endpoints were lost.
+  */
+  void WifiCom::_checkEndpoints(std::string* response)
+  {
+    if (response->compare(RESULT_NO_ENDPOINT) == 0) {
+      LOG_WARN(LOG_MODULE_WIFI_COM, LOG_WIFI_COM_ENDPOINTS_LOST);
+      wifiIsLinkUp = false;
+      (*response) = RESULT_ERROR;
+    }
+  }
+
+  /**
+  * @brief The ESP32 failed to associate, a new handshake is done after a backoff.
+  *
+  * The backoff doubles on every consecutive failure, from WIFI_RETRY_DELAY up to
+  * WIFI_RETRY_DELAY_MAX. Half of it is random, so monitors sharing an AP don't
+  * all retry at once when it comes back.
+  */
+  void WifiCom::_retryLink()
+  {
+    const int shift = std::min(wifiRetryCount, 16);
+    const uint32_t backoff = std::min<uint32_t>((uint32_t) WIFI_RETRY_DELAY << shift, WIFI_RETRY_DELAY_MAX);
+    const uint32_t delay = (backoff / 2) + (_random() % ((backoff / 2) + 1));
+
+    LOG_WARN(LOG_MODULE_WIFI_COM, LOG_WIFI_COM_CONNECTION_ERROR);
+    wifiRetryCount++;
+    wifiState = CMD_STATUS_SEND;
+    wifiComDelay.Restart(delay);
+  }
+
+  /**
+  * @brief Updates the link health with the result of a request.
+  * @param isSuccess true if the ESP32 answered and the request went through.
+  */
+  void WifiCom::_updateHealth(bool isSuccess)
+  {
+    if (isSuccess) {
+      wifiLinkHealth = std::min(wifiLinkHealth + WIFI_HEALTH_SUCCESS_STEP, WIFI_HEALTH_MAX);
+    } else {
+      wifiLinkHealth = std::max(wifiLinkHealth - WIFI_HEALTH_FAILURE_STEP, 0);
+    }
+
+    Util::Metrics::Set(METRIC_WIFI_LINK_HEALTH, (float) wifiLinkHealth);
+  }
+
+  /**
+  * @brief Pseudo random numbers for the backoff jitter (xorshift32).
+  */
+  uint32_t WifiCom::_random()
+  {
+    wifiRandomState ^= wifiRandomState << 13;
+    wifiRandomState ^= wifiRandomState >> 17;
+    wifiRandomState ^= wifiRandomState << 5;
+
+    return wifiRandomState;
+  }
+
+  /**
+  * @brief Changes the UART baud rate and flow control.
+  * 
+  * @param baudRate New baud rate.
+  * @param isFlowControlled true to enable RTS/CTS.
+  */
+  void WifiCom::_setBaudRate(int baudRate, bool isFlowControlled)
+  {
+    // Frames half received at the old rate are garbage at the new one.
+    wifiRxFrame.clear();
+    wifiIsRxFrameDropped = false;
+    wifiIsRxResponseReady = false;
+
+    wifiSerial.baud(baudRate);
+#if DEVICE_SERIAL_FC
+    if (isFlowControlled) {
+      wifiSerial.set_flow_control(SerialBase::RTSCTS, WIFI_PIN_RTS, WIFI_PIN_CTS);
+    } else {
+      wifiSerial.set_flow_control(SerialBase::Disabled);
+    }
+#endif
+    wifiBaudRate = baudRate;
+    Util::Metrics::Set(METRIC_WIFI_BAUD_RATE, (float) wifiBaudRate);
+  }
+
+ /**
+  * @brief Checks if the fast baud rate is still to be negotiated.
+  */
+  bool WifiCom::_isBaudNegotiable()
+  {
+    return (WIFI_BAUD_RATE_FAST != WIFI_BAUD_RATE) && (wifiBaudRate == WIFI_BAUD_RATE) && (wifiBaudAttempts < WIFI_BAUD_ATTEMPTS);
+  }
+
+ /**
   * @brief Reads a single character from the UART interface.
   * 
   * @param receivedChar Pointer to store received character.
@@ -303,6 +1298,7 @@ namespace Drivers {
     if (wifiSerial.readable()) {
       wifiSerial.read(&receivedCharLocal, 1);
       (*receivedChar) = receivedCharLocal;
+      Util::Metrics::Increment(METRIC_WIFI_BYTES_IN);
 
       return true;
     }
@@ -7,6 +7,7 @@
 #ifndef WIFI_COM
 #define WIFI_COM
 
+#include <array>
 #include <string.h>
 #include <string>
 #include "delay.h"
@@ -21,15 +22,117 @@
 /** @brief UART RX pin used for WiFi module. */
 #define WIFI_PIN_RX     PA_10
 
-/** @brief Baud rate for UART communication with WiFi module. */
+/** @brief UART RTS pin used for WiFi module flow control, to the ESP32 CTS. */
+#define WIFI_PIN_RTS    PA_12
+
+/** @brief UART CTS pin used for WiFi module flow control, from the ESP32 RTS. */
+#define WIFI_PIN_CTS    PA_11
+
+/** @brief Baud rate for UART communication with WiFi module, used at startup. */
 #define WIFI_BAUD_RATE  115200
 
+/** @brief Baud rate negotiated with the ESP32 once it answers. WIFI_BAUD_RATE to
+ *         disable the negotiation. */
+#ifndef WIFI_BAUD_RATE_FAST
+#define WIFI_BAUD_RATE_FAST     921600
+#endif
+
+/** @brief RTS/CTS flow control at WIFI_BAUD_RATE_FAST. Needs the RTS and CTS lines
+ *         wired. Without it the receive path can't keep up with long responses. */
+#ifndef WIFI_FLOW_CONTROL
+#define WIFI_FLOW_CONTROL       1
+#endif
+
 /** @brief Default SSID for WiFi connection. */
 #define WIFI_SSID       "Royale With Cheese"
 
 /** @brief Default WiFi password. */
 #define WIFI_PASSWORD   "Milkra264"
 
+/** @brief Fallback WiFi network, tried by the ESP32 when the default one fails. Empty for none. */
+#ifndef WIFI_SSID_FALLBACK
+#define WIFI_SSID_FALLBACK      ""
+#endif
+
+#ifndef WIFI_PASSWORD_FALLBACK
+#define WIFI_PASSWORD_FALLBACK  ""
+#endif
+
+//=========================[Driver Timing Defines]================================
+
+/** @brief Timeout of the status and connect commands, which the ESP32 answers right away [ms].
+ *         While the ESP32 boots the status command is resent at this pace. */
+#ifndef WIFI_HANDSHAKE_TIMEOUT
+#define WIFI_HANDSHAKE_TIMEOUT      250
+#endif
+
+/** @brief Time between two status polls while the ESP32 associates [ms]. */
+#ifndef WIFI_CONNECT_POLL_INTERVAL
+#define WIFI_CONNECT_POLL_INTERVAL  250
+#endif
+
+/** @brief Maximum time for the ESP32 to associate [ms]. */
+#ifndef WIFI_CONNECT_TIMEOUT
+#define WIFI_CONNECT_TIMEOUT        DELAY_10_SECONDS
+#endif
+
+/** @brief Wait before a new handshake after a failed connection [ms]. Doubled on
+ *         every consecutive failure up to WIFI_RETRY_DELAY_MAX, half of it random. */
+#ifndef WIFI_RETRY_DELAY
+#define WIFI_RETRY_DELAY            DELAY_1_SECONDS
+#endif
+
+/** @brief Longest wait between handshakes, reached during long AP outages [ms]. */
+#ifndef WIFI_RETRY_DELAY_MAX
+#define WIFI_RETRY_DELAY_MAX        DELAY_1_MINUTE
+#endif
+
+/** @brief Timeout of GET and POST requests [ms]. */
+#ifndef WIFI_REQUEST_TIMEOUT
+#define WIFI_REQUEST_TIMEOUT        DELAY_3_SECONDS
+#endif
+
+/** @brief Timeout of broadcast requests, sent to several recipients [ms]. */
+#ifndef WIFI_BROADCAST_TIMEOUT
+#define WIFI_BROADCAST_TIMEOUT      DELAY_15_SECONDS
+#endif
+
+/** @brief Time a response is kept for its reader before it is dropped [ms]. */
+#ifndef WIFI_RESPONSE_HOLD_TIMEOUT
+#define WIFI_RESPONSE_HOLD_TIMEOUT  DELAY_10_SECONDS
+#endif
+
+//=========================[Driver Defines]=====================================
+
+#define WIFI_HEALTH_MAX             100   /**< Link health of a link that just came up. */
+#define WIFI_HEALTH_SUCCESS_STEP    10    /**< Health gained by an answered request. */
+#define WIFI_HEALTH_FAILURE_STEP    25    /**< Health lost by a failed request. At 0 the link is brought up again. */
+#define WIFI_RX_DRAIN_MAX           64    /**< Bytes read from the ESP32 per update, bounds the time spent in the loop. */
+#define WIFI_BAUD_ATTEMPTS          3     /**< Consecutive failed negotiations before staying at WIFI_BAUD_RATE. */
+#define WIFI_ENDPOINT_MAX           4     /**< URLs that can be registered with the ESP32. */
+#define WIFI_UPDATE_QUEUE_SIZE      4     /**< Updates pushed to the webhook kept until read. */
+
+/** @brief Largest HTTP body kept from a response [bytes]. Bodies arrive in chunks
+ *         and the rest of a longer one is dropped, so memory stays bounded. */
+#ifndef WIFI_BODY_MAX
+#define WIFI_BODY_MAX               2048
+#endif
+
+/** @brief Longest frame kept while it is received [bytes]: an update event with a
+ *         body of WIFI_BODY_MAX and its prefix. Longer frames are garbage or can't
+ *         be kept, they are dropped up to their stop character. */
+#define WIFI_RX_FRAME_MAX           (WIFI_BODY_MAX + 16)
+
+/** @brief Size in bytes of the transmit ring, fed to the UART from its TX interrupt.
+ *         Must be a power of two. Longer commands are fed to it from update(). */
+#ifndef WIFI_TX_BUFFER_SIZE
+#define WIFI_TX_BUFFER_SIZE         512
+#endif
+
+namespace Module {
+  class Benchmark;
+}
+
 namespace Drivers {
   /**
   * @class WifiCom
@@ -78,13 +181,105 @@ namespace Drivers {
       */
       bool isBusy();
 
+      /**
+      * @brief Tick at which the ESP32 was last found associated.
+      * 
+      * @return Util::tick_t Tick [ms] of the last link up, 0 if it never came up.
+      */
+      Util::tick_t getLinkReadyTick();
+
+      /**
+      * @brief Link health score, from the results of the last requests.
+      * 
+      * @return int From 0 to WIFI_HEALTH_MAX. 0 while the link is being brought up.
+      */
+      int getLinkHealth();
+
+      /**
+      * @brief Checks if requests can go through.
+      * 
+      * The ESP32 reports link changes as soon as they happen, so upper layers can
+      * hold their requests while it is down instead of waiting for them to fail.
+      * 
+      * @return true from the link handshake until the link goes down.
+      */
+      bool isLinkUp();
+
+      /**
+      * @brief Signal strength last reported by the ESP32.
+      * 
+      * @return int RSSI [dBm], 0 if not reported yet.
+      */
+      int getRssi();
+
+      /**
+      * @brief UART baud rate in use with the ESP32.
+      * 
+      * @return int WIFI_BAUD_RATE_FAST once negotiated, WIFI_BAUD_RATE otherwise.
+      */
+      int getBaudRate();
+
+      /**
+      * @brief Registers a URL with the ESP32, to be referenced by a 1 byte ID.
+      * 
+      * Requests to a registered endpoint don't carry the URL, nor the token it
+      * may hold, over the UART. Endpoints are sent to the ESP32 on every link
+      * handshake, and again if it reports having lost them.
+      * 
+      * @param url Full URL.
+      * @return int Endpoint ID, the same one if already registered. -1 if there is no room left.
+      */
+      int registerEndpoint(const std::string& url);
+
+      /**
+      * @brief Sends a POST request to a registered endpoint.
+      * 
+      * @param endpoint Endpoint ID, from registerEndpoint.
+      * @param request Complete HTTP request payload, already URL encoded.
+      */
+      void post(uint8_t endpoint, const char* request);
+
+      /**
+      * @brief Sends the same POST request to several recipients of a registered endpoint.
+      * 
+      * @param endpoint Endpoint ID, from registerEndpoint.
+      * @param recipients Comma separated list of recipient IDs.
+      * @param request HTTP payload shared by all recipients.
+      */
+      void broadcast(uint8_t endpoint, const std::string& recipients, const char* request);
+
       /**
       * @brief Sends a POST request to a remote server.
       * 
       * @param server Server URL or IP address.
-      * @param request Complete HTTP request payload.
+      * @param request Complete HTTP request payload, already URL encoded.
+      */
+      void post(const std::string& server, const char* request);
+
+      /**
+      * @brief Sends the same POST request to several recipients in a single command.
+      * 
+      * The ESP32 fans the request out, prefixing "chat_id=<id>&" for each recipient.
+      * The response (see getPostResponse) is a comma separated list with one
+      * OK/ERROR result per recipient, in the same order.
+      * 
+      * @param server Server URL or IP address.
+      * @param recipients Comma separated list of recipient IDs.
+      * @param request HTTP payload shared by all recipients.
       */
-      void post(const std::string& server, const std::string& request);
+      void broadcast(const std::string& server, const std::string& recipients, const char* request);
+
+      /**
+      * @brief Sends a telemetry frame to a gateway as a UDP datagram.
+      * 
+      * Fire and forget: there is no response to read, the module goes back to
+      * idle once the ESP32 acknowledges the frame.
+      * 
+      * @param host Gateway host name or IP address.
+      * @param port Gateway UDP port.
+      * @param frame Telemetry frame. Must not hold separator or stop characters.
+      */
+      void telemetry(const std::string& host, uint16_t port, const char* frame);
 
       /**
       * @brief Sends a GET request to a specific URL.
@@ -109,8 +304,52 @@ namespace Drivers {
       */
       bool getGetResponse(std::string* response);
 
+      /**
+      * @brief Has the ESP32 accept updates pushed to a local HTTP port (webhook).
+      * 
+      * Sent on every link handshake, after the endpoints. Each update pushed
+      * to the port is kept until read with getUpdate.
+      * 
+      * @param port Local TCP port, 0 to stop listening.
+      * @param secret Expected in the X-Telegram-Bot-Api-Secret-Token header. Empty to accept any update.
+      */
+      void listen(uint16_t port, const std::string& secret);
+
+      /**
+      * @brief Retrieves the oldest update pushed to the webhook.
+      * 
+      * @param update Pointer to store the update, as JSON.
+      * @return true if an update was available; false otherwise.
+      */
+      bool getUpdate(std::string* update);
+
+      /**
+      * @brief Asks the ESP32 to send nothing for a while, so the UART can go unread.
+      * 
+      * For operations that stall the CPU, like flash erases, during which received
+      * bytes would be lost. Only while not busy. isHeld() tells once the ESP32
+      * agrees, the module is back to idle if it doesn't.
+      * 
+      * @param duration Longest hold [ms]. The ESP32 sends again on its own after it.
+      */
+      void hold(Util::tick_t duration);
+
+      /**
+      * @brief Checks if the ESP32 is holding its transmissions.
+      * 
+      * @return true from the hold acknowledge until resume() or the hold time is over.
+      */
+      bool isHeld();
+
+      /**
+      * @brief Lets the ESP32 send again before the hold time is over.
+      */
+      void resume();
+
     private:
 
+      friend class Module::Benchmark;   /**< On-target benchmarks exercise the receive path. */
+
       WifiCom(PinName txPin, PinName rxPin, const int baudRate);
       ~WifiCom() = default;
 
@@ -124,35 +363,129 @@ namespace Drivers {
         INIT,                       /**< Initialization state. */
         CMD_STATUS_SEND,            /**< Sending status command. */
         CMD_STATUS_WAIT_RESPONSE,   /**< Waiting for status command response. */
+        CMD_BAUD_SEND,              /**< Sending baud rate command. */
+        CMD_BAUD_WAIT_RESPONSE,     /**< Waiting for baud rate command acknowledge. */
         CMD_CONNECT_SEND,           /**< Sending connect command with SSID/PASSWORD. */
-        CMD_CONNECT_WAIT_RESPONSE,  /**< Waiting for WiFi connection response. */
+        CMD_CONNECT_WAIT_RESPONSE,  /**< Waiting for the connect command acknowledge. */
+        CMD_CONNECT_POLL_SEND,      /**< Sending status command while the ESP32 associates. */
+        CMD_CONNECT_POLL_WAIT_RESPONSE, /**< Waiting for status command response while the ESP32 associates. */
         CMD_GET_SEND,               /**< Sending GET request. */
         CMD_GET_WAIT_RESPONSE,      /**< Waiting for GET response. */
         CMD_GET_RESPONSE_READY,     /**< GET response is ready. */
         CMD_POST_SEND,              /**< Sending POST request. */
         CMD_POST_WAIT_RESPONSE,     /**< Waiting for POST response. */
         CMD_POST_RESPONSE_READY,    /**< POST response is ready. */
+        CMD_BROADCAST_SEND,         /**< Sending broadcast POST request. */
+        CMD_BROADCAST_WAIT_RESPONSE,/**< Waiting for broadcast results. */
+        CMD_TELEMETRY_SEND,         /**< Sending telemetry frame. */
+        CMD_TELEMETRY_WAIT_RESPONSE,/**< Waiting for telemetry acknowledge. */
+        CMD_ENDPOINT_SEND,          /**< Registering an endpoint with the ESP32. */
+        CMD_ENDPOINT_WAIT_RESPONSE, /**< Waiting for endpoint registration acknowledge. */
+        CMD_WEBHOOK_SEND,           /**< Starting the webhook on the ESP32. */
+        CMD_WEBHOOK_WAIT_RESPONSE,  /**< Waiting for webhook acknowledge. */
+        CMD_HOLD_SEND,              /**< Asking the ESP32 to hold its transmissions. */
+        CMD_HOLD_WAIT_RESPONSE,     /**< Waiting for hold acknowledge. */
+        HELD,                       /**< The ESP32 sends nothing, the UART may go unread. */
+        CMD_RESUME_SEND,            /**< Ending the hold before its time. */
+        CMD_RESUME_WAIT_RESPONSE,   /**< Waiting for resume acknowledge. */
         IDLE,                       /**< Idle state (ready). */
         ERROR                       /**< Error state. */
       } wifi_state_t;
 
       void _sendCommand(const char* command);
 
+      void _receive();
+
+      void _transmit();
+
+      void _feedTx();
+
+      void _onTxReady();
+
+      void _handleEvent(const std::string &frame);
+
+      bool _isChunkHeader(const std::string &frame);
+
+      void _receiveChunk(char receivedChar);
+
       bool _isResponseCompleted(std::string* response);
 
+      bool _isTransferResult(const std::string &response);
+
+      void _readTransferStats(const std::string &response);
+
+      bool _isCurrentResponse(std::string* response);
+
       bool _readCom(char* receivedChar);
 
+      void _setLinkReady();
+
+      void _retryLink();
+
+      void _updateHealth(bool isSuccess);
+
+      uint32_t _random();
+
+      void _setBaudRate(int baudRate, bool isFlowControlled);
+
+      bool _isBaudNegotiable();
+
+      void _setEndpoint(uint8_t endpoint);
+
+      void _checkEndpoints(std::string* response);
+
+      void _queueUpdate(const std::string &update);
+
       wifi_state_t   wifiState;               /**< Current FSM state. */
       UnbufferedSerial wifiSerial;            /**< Serial interface for WiFi communication. */
       Util::Delay    wifiComDelay;            /**< Delay helper for timing between states. */
       std::string    wifiSsid;                /**< SSID of the WiFi network. */
       std::string    wifiPassword;            /**< Password for the WiFi network. */
       std::string    wifiResponse;            /**< Full response buffer. */
-      std::string    wifiCommandGetResponse;  /**< Temporary response buffer for GET. */
       std::string    wifiServer;              /**< Server URL for POST requests. */
       std::string    wifiRequest;             /**< HTTP payload for POST requests. */
+      std::string    wifiRecipients;          /**< Recipients list for broadcast requests. */
+      uint16_t       wifiGatewayPort;         /**< Gateway UDP port for telemetry frames. */
       bool           wifiIsResponseReady;     /**< Flag indicating response to POST is ready. */
       bool           wifiIsGetResponseReady;  /**< Flag indicating response to GET is ready. */
+      Util::tick_t   wifiRequestStartTick;    /**< Tick at which the last command was sent. */
+      Util::tick_t   wifiConnectStartTick;    /**< Tick at which the ESP32 started to associate. */
+      Util::tick_t   wifiLinkReadyTick;       /**< Tick at which the ESP32 was last found associated. */
+      int            wifiLinkHealth;          /**< Link health score, 0 to WIFI_HEALTH_MAX. */
+      int            wifiRetryCount;          /**< Consecutive failed connections, sets the backoff. */
+      uint32_t       wifiRandomState;         /**< State of the backoff jitter generator. */
+      bool           wifiIsLinkUp;            /**< Link handshake done and no link down reported since. */
+      int            wifiRssi;                /**< Last reported RSSI [dBm]. */
+      std::string    wifiRxFrame;             /**< Frame being received, up to WIFI_RX_FRAME_MAX. */
+      bool           wifiIsRxFrameDropped;    /**< The frame being received is too long, skipped up to its stop character. */
+      std::string    wifiRxResponse;          /**< Last response frame received, not read yet. */
+      bool           wifiIsRxResponseReady;   /**< wifiRxResponse holds a response not read yet. */
+      size_t         wifiRxChunkRemaining;    /**< Bytes of the body chunk being received still to come. */
+      bool           wifiIsRxChunkCurrent;    /**< The chunk being received belongs to the last command. */
+      std::string    wifiRxBody;              /**< Body streamed for the last command, up to WIFI_BODY_MAX. */
+      bool           wifiIsBodyStreamed;      /**< Chunks were received for the last command. */
+      bool           wifiIsBodyTruncated;     /**< The body of the last command didn't fit in wifiRxBody. */
+      uint16_t       wifiRequestId;           /**< ID of the last command sent, echoed back by the ESP32. */
+      int            wifiBaudRate;            /**< UART baud rate in use. */
+      int            wifiBaudAttempts;        /**< Consecutive failed baud rate negotiations. */
+      bool           wifiIsBaudVerifying;     /**< Baud rate switched, waiting for an answer at the new rate. */
+      uint8_t        wifiTxBuffer[WIFI_TX_BUFFER_SIZE]; /**< Transmit ring, drained by the TX interrupt. */
+      volatile uint32_t wifiTxHead;           /**< Write index of the transmit ring, moved by the superloop. */
+      volatile uint32_t wifiTxTail;           /**< Read index of the transmit ring, moved by the TX interrupt. */
+      volatile bool  wifiIsTxActive;          /**< TX interrupt attached, the ring is being drained. */
+      std::string    wifiTxPending;           /**< Commands being sent, bytes not in the ring yet from wifiTxPendingOffset. */
+      size_t         wifiTxPendingOffset;     /**< First byte of wifiTxPending not in the ring yet. */
+      bool           wifiIsTxInFlight;        /**< Commands queued and not completely handed to the UART. */
+      uint32_t       wifiTxStartUs;           /**< Microsecond tick at which the commands in flight were queued. */
+      std::array<std::string, WIFI_ENDPOINT_MAX> wifiEndpoints; /**< Registered URLs, by endpoint ID. */
+      size_t         wifiEndpointCount;       /**< Number of registered URLs. */
+      size_t         wifiEndpointIndex;       /**< Next endpoint to send to the ESP32 during the handshake. */
+      uint16_t       wifiWebhookPort;         /**< Local port of the ESP32 webhook, 0 if not listening. */
+      std::string    wifiWebhookSecret;       /**< Secret expected by the ESP32 webhook. */
+      std::array<std::string, WIFI_UPDATE_QUEUE_SIZE> wifiUpdates; /**< Pushed updates not read yet, oldest at wifiUpdateHead. */
+      size_t         wifiUpdateHead;          /**< Oldest update in wifiUpdates. */
+      size_t         wifiUpdateCount;         /**< Updates in wifiUpdates. */
+      Util::tick_t   wifiHoldTime;            /**< Hold asked to the ESP32 [ms]. */
   };
 } // namespace Drivers
 
@@ -0,0 +1,117 @@
+/****************************************************************************//**
+ * @file alert_queue.cpp
+ * @author Gonzalo Puy.
+ * @date Jun 2025
+ * @brief Outbound alert queue.
+ *******************************************************************************/
+
+#include "alert_queue.h"
+
+//=====[Implementations of public methods]=======================================
+
+namespace Module {
+
+  AlertQueue::AlertQueue()
+  {
+    clear();
+  }
+
+  void AlertQueue::clear()
+  {
+    count = 0;
+    nextSequence = 0;
+    deliveredState = TANK_LEVEL_OK;
+  }
+
+  bool AlertQueue::push(alert_kind_t kind, tank_state_t state, Util::tick_t timestamp)
+  {
+    bool isQueued = false;
+
+    // Entries about another state are superseded.
+    for (size_t i = count; i-- > 0;) {
+      if (entries[i].state != state) {
+        _remove(i);
+      } else if (entries[i].kind == kind) {
+        isQueued = true;
+      }
+    }
+
+    // Already queued: the oldest timestamp tells since when.
+    if (isQueued) return false;
+
+    // The users already know.
+    if ((kind == ALERT_TANK_STATE) && (state == deliveredState)) return false;
+
+    if (count == ALERT_QUEUE_SIZE) return false;
+
+    entries[count].sequence = nextSequence++;
+    entries[count].kind = kind;
+    entries[count].state = state;
+    entries[count].timestamp = timestamp;
+    count++;
+
+    return true;
+  }
+
+  bool AlertQueue::isEmpty() const
+  {
+    return (count == 0);
+  }
+
+  size_t AlertQueue::peek(alert_t *sorted, uint32_t &lastSequence) const
+  {
+    lastSequence = 0;
+
+    for (size_t i = 0; i < count; i++) {
+      size_t j = i;
+
+      // Insertion by kind, arrival order is kept within a kind.
+      while ((j > 0) && (sorted[j - 1].kind > entries[i].kind)) {
+        sorted[j] = sorted[j - 1];
+        j--;
+      }
+      sorted[j] = entries[i];
+
+      if ((i == 0) || ((int32_t) (entries[i].sequence - lastSequence) > 0)) {
+        lastSequence = entries[i].sequence;
+      }
+    }
+
+    return count;
+  }
+
+  void AlertQueue::markSending(uint32_t lastSequence)
+  {
+    for (size_t i = 0; i < count; i++) {
+      if ((int32_t) (entries[i].sequence - lastSequence) <= 0) {
+        deliveredState = entries[i].state;
+      }
+    }
+  }
+
+  void AlertQueue::markDelivered(uint32_t lastSequence)
+  {
+    for (size_t i = 0; i < count;) {
+      if ((int32_t) (entries[i].sequence - lastSequence) <= 0) {
+        deliveredState = entries[i].state;
+        _remove(i);
+      } else {
+        i++;
+      }
+    }
+  }
+
+//=====[Implementations of private methods]======================================
+
+  /**
+  * @brief Removes an entry, keeping the arrival order of the rest.
+  */
+  void AlertQueue::_remove(size_t index)
+  {
+    for (size_t i = index + 1; i < count; i++) {
+      entries[i - 1] = entries[i];
+    }
+    count--;
+  }
+
+} // namespace Module
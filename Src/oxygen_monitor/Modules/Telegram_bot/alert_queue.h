@@ -0,0 +1,118 @@
+/****************************************************************************//**
+ * @file alert_queue.h
+ * @author Gonzalo Puy.
+ * @date Jun 2025
+ * @brief Outbound alert queue header file.
+ *
+ * Keeps the alerts and tank state changes not delivered yet, so they are sent
+ * once the link is back instead of being dropped.
+ *******************************************************************************/
+
+#ifndef ALERT_QUEUE_H
+#define ALERT_QUEUE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "delay.h"
+#include "tank_types.h"
+
+//=========================[Module Defines]=====================================
+
+#define ALERT_QUEUE_SIZE    4       /**< Pending entries. Superseded ones are dropped, so few are ever kept. */
+
+//===========================[Module Types]=====================================
+
+/**
+ * @enum alert_kind_t
+ * @brief Kind of a queued entry, also its priority: lower values are sent first.
+ */
+typedef enum alert_kind {
+  ALERT_TANK_LOW = 0,       /**< Low pressure alarm, repeated while the tank stays low. */
+  ALERT_TANK_STATE = 1      /**< Tank left the state last reported to the users. */
+} alert_kind_t;
+
+/**
+ * @struct alert_t
+ * @brief Queued alert.
+ */
+typedef struct alert {
+  uint32_t sequence;        /**< Order of arrival. */
+  alert_kind_t kind;        /**< Kind and priority. */
+  tank_state_t state;       /**< Tank state reported. */
+  Util::tick_t timestamp;   /**< Tick [ms] at which the state was published. */
+} alert_t;
+
+namespace Module {
+
+  /**
+  * @class AlertQueue
+  * @brief Store and forward queue of alerts, drained as a single message.
+  *
+  * Only the latest tank state is worth sending: a new entry drops the queued
+  * ones about another state, and a state change back to what the users were
+  * told last is dropped as well (e.g. LOW followed by OK while offline).
+  */
+  class AlertQueue {
+
+  public:
+
+    /**
+    * @brief Constructs an empty AlertQueue.
+    */
+    AlertQueue();
+
+    /**
+    * @brief Drops every entry. The users are taken as told the tank is OK.
+    */
+    void clear();
+
+    /**
+    * @brief Queues an alert.
+    * @param kind Kind of the alert.
+    * @param state Tank state reported.
+    * @param timestamp Tick [ms] at which the state was published.
+    * @return true if queued, false if already queued or not worth sending.
+    */
+    bool push(alert_kind_t kind, tank_state_t state, Util::tick_t timestamp);
+
+    /**
+    * @brief Checks if there is anything to send.
+    */
+    bool isEmpty() const;
+
+    /**
+    * @brief Copies the pending entries in priority order, oldest first within a kind.
+    * @param sorted Destination, at least ALERT_QUEUE_SIZE long.
+    * @param lastSequence Highest sequence copied, to be passed to markDelivered().
+    * @return size_t Entries copied.
+    */
+    size_t peek(alert_t *sorted, uint32_t &lastSequence) const;
+
+    /**
+    * @brief Takes the entries of a broadcast being sent as reported, since some
+    *        users may get them even if it is superseded: a later change back to
+    *        the previous state is then queued as well (e.g. OK after LOW).
+    * @param lastSequence Value returned by peek() for the message being sent.
+    */
+    void markSending(uint32_t lastSequence);
+
+    /**
+    * @brief Removes the entries sent to every user.
+    * @param lastSequence Value returned by peek() for the message delivered.
+    */
+    void markDelivered(uint32_t lastSequence);
+
+  private:
+
+    void _remove(size_t index);
+
+    alert_t entries[ALERT_QUEUE_SIZE];    /**< Pending entries, in arrival order. */
+    size_t count;                         /**< Number of pending entries. */
+    uint32_t nextSequence;                /**< Sequence of the next entry. */
+    tank_state_t deliveredState;          /**< Tank state last reported, or being reported, to the users. */
+
+  }; // class AlertQueue
+
+} // namespace Module
+
+#endif // ALERT_QUEUE_H
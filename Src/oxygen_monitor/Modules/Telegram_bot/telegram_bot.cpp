@@ -9,11 +9,14 @@
 
 #include <cstddef>
 #include <cstdio>
-#include <cstdarg>
+#include <cstdlib>
 #include <sstream>
-#include "Ticker.h"
 #include "arm_book_lib.h"
 #include "commands.h"
+#include "config_store.h"
+#include "logger.h"
+#include "metrics.h"
+#include "profiler.h"
 #include "wifi_com.h"
 #include <string>
 #include <type_traits>
@@ -21,26 +24,23 @@
 
 //=====[Declaration and initialization of private global variables]============
 
-static Timeout tBotTimeout;                         /**< Bot Timeout. */
-static bool isTimeoutFinished;                      /**< Variable to check if Bot Timeout is finished. */
+static_assert(WIFI_ENDPOINT_MAX >= 2, "WifiCom can't hold the bot endpoints");
 
-static Timeout alertTimeout;                        /**< Alert Timeout. */
-static bool isAlertTimeoutFinished;                 /**< Variable to check if Alert Timeout is finished. */
+static Util::Delay tBotDelay(0);                    /**< Bot Delay. */
+static bool isTimeoutFinished;                      /**< Variable to check if Bot Delay is finished. */
 
-static constexpr chrono::seconds alertDelay = 60s;  /**< Alert Delay. */\
+static Util::Delay alertDelay(0);                   /**< Alert Delay. */
+static bool isAlertTimeoutFinished;                 /**< Variable to check if Alert Delay is finished. */
 
-static size_t broadcastTotal;
-std::array<std::string, MAX_USER_COUNT> broadcastList;
+static Util::Delay alertRetryDelay(0);              /**< Pause of an alert broadcast out of retries. */
+static bool isAlertRetryFinished;                   /**< Variable to check if Alert Retry Delay is finished. */
+static bool wasLinkUp = false;                      /**< Link state seen on the previous update. */
 
-/**
-* @brief Callback function for Bot Timeout.
-*/
-static void onTBotTimeoutFinishedCallback();
+static bool isFirstMessageMeasured = false;         /**< Boot time to the first Telegram answer already measured. */
 
-/**
-* @brief Callback function for Alert Timeout.
-*/
-static void onAlertTimeoutFinishedCallback();
+static size_t broadcastTotal;
+std::array<std::string, MAX_USER_COUNT> broadcastList;
+static std::array<bool, MAX_USER_COUNT> broadcastDelivered;  /**< Delivery result for each broadcast recipient. */
 
 //=====[Implementations of public functions]===================================
 
@@ -53,13 +53,32 @@ namespace Module {
 
   void TelegramBot::update()
   {
-    std::chrono::microseconds remainingTime;
-    std::chrono::microseconds remainingAlertTime;
+    PROFILE_ZONE(TELEGRAM_BOT_UPDATE);
+
+    if (!isTimeoutFinished && tBotDelay.HasFinished()) {
+      isTimeoutFinished = true;
+    }
+    if (!isAlertTimeoutFinished && alertDelay.HasFinished()) {
+      isAlertTimeoutFinished = true;
+    }
+    if (!isAlertRetryFinished && alertRetryDelay.HasFinished()) {
+      isAlertRetryFinished = true;
+    }
+
+    // Link back: pending alerts go out now instead of after the retry pause.
+    const bool isLinkUp = Drivers::WifiCom::getInstance().isLinkUp();
+    if (isLinkUp && !wasLinkUp) {
+      isAlertRetryFinished = true;
+    }
+    wasLinkUp = isLinkUp;
+
+    _queueAlerts();
 
     switch (botState) {
       case INIT:
       {
-        if (!Drivers::WifiCom::getInstance().isBusy() ) {
+        // Polling is held while the link is down.
+        if (!Drivers::WifiCom::getInstance().isBusy() && isLinkUp) {
           botState = MONITOR;
         }
       }
@@ -67,25 +86,44 @@ namespace Module {
 
       case MONITOR:
       {
-        if ( isAlertTimeoutFinished && (Module::TankMonitor::getInstance().getTankState() == TANK_LEVEL_LOW) ) {
-          
-          broadcastTotal = userCount;
-          for (size_t i = 0; i < userCount; i++) {
-              broadcastList[i] = userId[i];
-          }
-          broadcastIndex = 0;
+        if ( isAlertRetryFinished && (isAlertPending || !alertQueue.isEmpty()) ) {
+
+          // A paused broadcast resumes with the recipients not notified yet.
+          if (!isAlertPending) {
+            alert_t pending[ALERT_QUEUE_SIZE];
 
-          isAlertTimeoutFinished = false;
-          alertTimeout.detach();
-          alertTimeout.attach(&onAlertTimeoutFinishedCallback, 60s);
+            alertQueue.peek(pending, alertSequence);
+            alertQueue.markSending(alertSequence);
+            _prepareBroadcast();
+            isAlertPending = true;
+            Util::Metrics::Increment(METRIC_BOT_ALERTS);
+          }
           botState = SEND_ALERT;
           
+        }
+#if BOT_WEBHOOK_MODE
+        else if (!botIsWebhookSet) {
+          botState = REGISTER_WEBHOOK;
         } else {
+          // Updates are pushed: a message is processed as soon as it arrives, with no polling.
+          botState = INIT;
+          if (Drivers::WifiCom::getInstance().getUpdate(&botResponse)) {
+            if (!isFirstMessageMeasured) {
+              Util::Metrics::Set(METRIC_BOOT_FIRST_MESSAGE, (float) Util::Tick::GetTickCounter());
+              isFirstMessageMeasured = true;
+            }
+            if (_getMessageFromResponse(&botLastMessage, botResponse)) {
+              botState = PROCESS_LAST_MESSAGE;
+            }
+          }
+        }
+#else
+        else {
           botState = REQUEST_LAST_MESSAGE;
           isTimeoutFinished = false;
-          tBotTimeout.detach();
-          tBotTimeout.attach(&onTBotTimeoutFinishedCallback, 2s);
+          tBotDelay.Restart(BOT_POLL_INTERVAL);
         }
+#endif
       }
       break;
 
@@ -93,17 +131,20 @@ namespace Module {
       {
         if (!Drivers::WifiCom::getInstance().isBusy()) {
 
-          std::string messegeToSend = ALERT_TANK_EMPTY;
-          messegeToSend += "\n";
-          _sendMessage(broadcastList[broadcastIndex], messegeToSend);
-          // botState = userCount > 1 ? WAITING_BROADCAST_RESPONSE : WAITING_RESPONSE;
-          if (broadcastIndex == broadcastTotal - 1) {
-            botState = WAITING_RESPONSE;
-          } else {
-            tBotTimeout.detach();
-            tBotTimeout.attach(&onTBotTimeoutFinishedCallback, 8s);
-            botState = WAITING_BROADCAST_RESPONSE;
+          std::string recipients;
+          _getPendingRecipients(recipients);
+
+          // No users, or the alerts were superseded meanwhile.
+          if (recipients.empty() || (_composeAlerts() == 0)) {
+            _completeAlerts();
+            botState = INIT;
+            break;
           }
+
+          _broadcastMessage(recipients);
+          isTimeoutFinished = false;
+          tBotDelay.Restart(BOT_BROADCAST_TIMEOUT);
+          botState = WAITING_BROADCAST_RESPONSE;
         }
       }
       break;
@@ -113,8 +154,7 @@ namespace Module {
         if (isTimeoutFinished && !(Drivers::WifiCom::getInstance().isBusy())) {
           _requestLastMessage();
           isTimeoutFinished = false;
-          tBotTimeout.detach();
-          tBotTimeout.attach(&onTBotTimeoutFinishedCallback,8000ms);
+          tBotDelay.Restart(BOT_POLL_TIMEOUT);
           botState = WAITING_LAST_MESSAGE;
         }
         
@@ -124,9 +164,15 @@ namespace Module {
       case WAITING_LAST_MESSAGE:
       {
         if (isTimeoutFinished) {
+          Util::Metrics::Increment(METRIC_BOT_POLL_TIMEOUTS);
           botState = INIT;
         }
         else if (Drivers::WifiCom::getInstance().getPostResponse(&botResponse)) {
+          if (!isFirstMessageMeasured && (botResponse.compare(RESULT_ERROR) != 0)) {
+            Util::Metrics::Set(METRIC_BOOT_FIRST_MESSAGE, (float) Util::Tick::GetTickCounter());
+            isFirstMessageMeasured = true;
+          }
+
           const bool isNewMessage = _getMessageFromResponse(&botLastMessage, botResponse);
           if (isNewMessage) {
             botState = PROCESS_LAST_MESSAGE;
@@ -139,28 +185,29 @@ namespace Module {
 
       case PROCESS_LAST_MESSAGE:
       {
-        std::string messegeToSend;
         size_t paramCount;
         std::array<std::string, MAX_PARAMS> params = _parseMessage(botLastMessage.message, paramCount);
         std::string command = params[0];
+
+        _beginMessage(botLastMessage.fromId);
         
         if( (_isUserIdValid(botLastMessage.fromId)) || (command.compare(COMMAND_START_STR) == 0 )) {
           command_t command_nb = _findCommand(command);
-          printf("TelegramBot - Message received: [%s] from %s\r\n", botLastMessage.message.c_str(), botLastMessage.fromName.c_str());
+          LOG_INFO(LOG_MODULE_TELEGRAM_BOT, LOG_TELEGRAM_BOT_MESSAGE, botLastMessage.message.c_str(), botLastMessage.fromName.c_str());
+          Util::Metrics::Increment(METRIC_BOT_MESSAGES_RECEIVED);
           if (command_nb != ERROR_INVALID_COMMAND)
           {
-            messegeToSend = (this->*functionsArray[command_nb])(params, paramCount);
+            (this->*functionsArray[command_nb])(params, paramCount);
           }else {
-            messegeToSend = _formatString(ERROR_INVALID_COMMAND_STR, command.c_str());
+            botReply.Format(ERROR_INVALID_COMMAND_STR, command.c_str());
           }
         } else {
-          messegeToSend = _formatString(ERROR_INVALID_USER_STR, botLastMessage.fromName.c_str());
+          botReply.Format(ERROR_INVALID_USER_STR, botLastMessage.fromName.c_str());
         }
 
-        _sendMessage(botLastMessage.fromId, messegeToSend);
+        _sendMessage();
         isTimeoutFinished = false;
-        tBotTimeout.detach();
-        tBotTimeout.attach(&onTBotTimeoutFinishedCallback, 5s);
+        tBotDelay.Restart(BOT_REPLY_TIMEOUT);
         botState = WAITING_RESPONSE;
       }
       break;
@@ -181,37 +228,80 @@ namespace Module {
 
       case WAITING_BROADCAST_RESPONSE:
       {
-        const bool isResponseReady = Drivers::WifiCom::getInstance().getPostResponse(&botResponse);
-        if (isTimeoutFinished || ( isResponseReady && botResponse.compare(RESULT_ERROR) == 0 ))
-        {
-          if (broadcastRetryCount < BROADCAST_MAX_RETRIES)
-          {
-            broadcastRetryCount++;
-            tBotTimeout.detach();
-            tBotTimeout.attach(&onTBotTimeoutFinishedCallback, 8s);
-            botState = SEND_ALERT;
-          } else {
-            broadcastIndex = 0;
-            broadcastRetryCount = 0;
-            botState = INIT;
-          }
+        bool isBroadcastCompleted = false;
+        bool isRetryNeeded = false;
+
+        if (isTimeoutFinished) {
+          isRetryNeeded = true;
         } else if (Drivers::WifiCom::getInstance().getPostResponse(&botResponse)) {
-          broadcastIndex++;
-          if (broadcastIndex >= broadcastTotal)
-          {
-            broadcastIndex = 0;
-            broadcastRetryCount = 0;
-            botState = INIT;
-          } else {
-            broadcastRetryCount = 0;
-            botState = SEND_ALERT;
+          isBroadcastCompleted = _updateBroadcastResults(botResponse);
+          isRetryNeeded = !isBroadcastCompleted;
+        }
+
+        if (isRetryNeeded && (broadcastRetryCount < BROADCAST_MAX_RETRIES)) {
+          broadcastRetryCount++;
+          Util::Metrics::Increment(METRIC_BOT_ALERT_RETRIES);
+          botState = SEND_ALERT;
+        } else if (isBroadcastCompleted) {
+          _completeAlerts();
+          botState = INIT;
+        } else if (isRetryNeeded) {
+          // The alerts stay queued, the link is probably down.
+          broadcastRetryCount = 0;
+          isAlertRetryFinished = false;
+          alertRetryDelay.Restart(BOT_ALERT_RETRY_INTERVAL);
+          botState = INIT;
+        }
+      }
+      break;
+
+      case REGISTER_WEBHOOK:
+      {
+        if (isTimeoutFinished && !(Drivers::WifiCom::getInstance().isBusy())) {
+          _registerWebhook();
+          isTimeoutFinished = false;
+          tBotDelay.Restart(BOT_POLL_TIMEOUT);
+          botState = WAITING_WEBHOOK_RESPONSE;
+        }
+      }
+      break;
+
+      case WAITING_WEBHOOK_RESPONSE:
+      {
+        if (isTimeoutFinished) {
+          botState = INIT;
+        }
+        else if (Drivers::WifiCom::getInstance().getPostResponse(&botResponse)) {
+          botIsWebhookSet = (botResponse.find("\"ok\":true") != std::string::npos);
+          if (!botIsWebhookSet) {
+            LOG_WARN(LOG_MODULE_TELEGRAM_BOT, LOG_TELEGRAM_BOT_WEBHOOK_ERROR);
           }
+
+          // Tried again after a poll interval.
+          isTimeoutFinished = false;
+          tBotDelay.Restart(BOT_POLL_INTERVAL);
+          botState = INIT;
         }
       }
       break;
     }
   } // TelegramBot::update()
 
+  int TelegramBot::getUserCount()
+  {
+    return userCount;
+  }
+
+  const std::string& TelegramBot::getUserId(int index)
+  {
+    return userId[index];
+  }
+
+  bool TelegramBot::addUser(const std::string &newUserId)
+  {
+    return _registerUser(newUserId);
+  }
+
 //=====[Implementations of private functions]===================================
 
   /**
@@ -222,10 +312,28 @@ namespace Module {
     botLastUpdateId = 0;
     userId.fill("");
     userCount = 0;
-    broadcastIndex = 0;
     isTimeoutFinished = false;
     isAlertTimeoutFinished = true; //Initial state of this variable MUST be true.
+    isAlertRetryFinished = true;
     broadcastRetryCount = 0;
+    alertQueue.clear();
+    alertTankState = TANK_LEVEL_UNKNOWN;
+    alertSequence = 0;
+    isAlertPending = false;
+
+    // URL and token go to the ESP32 once, requests only carry the endpoint ID.
+    botSendEndpoint = (uint8_t) Drivers::WifiCom::getInstance().registerEndpoint(botUrl + botToken + "/sendmessage");
+#if BOT_WEBHOOK_MODE
+    // A LAN relay pushes the updates by itself, Telegram has to be told where to.
+    botIsWebhookSet = (strlen(BOT_WEBHOOK_URL) == 0);
+    if (!botIsWebhookSet) {
+      botUpdatesEndpoint = (uint8_t) Drivers::WifiCom::getInstance().registerEndpoint(botUrl + botToken + "/setWebhook");
+    }
+    Drivers::WifiCom::getInstance().listen(BOT_WEBHOOK_PORT, BOT_WEBHOOK_SECRET);
+#else
+    botIsWebhookSet = false;
+    botUpdatesEndpoint = (uint8_t) Drivers::WifiCom::getInstance().registerEndpoint(botUrl + botToken + "/getUpdates");
+#endif
 
     functionsArray[COMMAND_START] = &TelegramBot::_commandStart;
     functionsArray[COMMAND_SET_UNIT] = &TelegramBot::_commandSetUnit;
@@ -236,104 +344,101 @@ namespace Module {
     functionsArray[COMMAND_NEW_GAS_FLOW] = &TelegramBot::_commandNewGasFlow;
     functionsArray[COMMAND_GAS_FLOW] =  &TelegramBot::_commandGasFlow;
     functionsArray[COMMAND_END] = &TelegramBot::_commandEnd;
+    functionsArray[COMMAND_METRICS] = &TelegramBot::_commandMetrics;
   }
 
   /**
   * @brief /start command. Register user in the system.
   * @param params parameters received from user, already parsed.
   * @param paramCount number of parameters received.
-  * @return Message to send to Telegram bot.
+  * @note The reply is written into botReply.
   */
-  std::string TelegramBot::_commandStart(const ParametersArray &params, size_t paramCount)
+  void TelegramBot::_commandStart(const ParametersArray &params, size_t paramCount)
   {
     if (paramCount == 1) {
-      std::string result;
       bool registerSuccess = _registerUser(botLastMessage.fromId);
 
       if (registerSuccess)
       {
-        result = _formatString(START_COMMAND_USER_REGISTERED_RESPONSE_STR, botLastMessage.fromName.c_str());
+        botReply.Format(START_COMMAND_USER_REGISTERED_RESPONSE_STR, botLastMessage.fromName.c_str());
         // Debug:
         // for (int i = 0; i < userCount; ++i) { printf("Success! users ID:[ %s ]\r\n", userId[i].c_str()); }
       } else {
-        result = _formatString(START_COMMAND_USER_REGISTER_FAIL_RESPONSE_STR, botLastMessage.fromName.c_str());
+        botReply.Format(START_COMMAND_USER_REGISTER_FAIL_RESPONSE_STR, botLastMessage.fromName.c_str());
       }
-      return result;
+      return;
     }
 
-    return _formatString(ERROR_INVALID_PARAMETERS_STR, COMMAND_START_STR);
+    botReply.Format(ERROR_INVALID_PARAMETERS_STR, COMMAND_START_STR);
   }
 
   /**
   * @brief /setunit command. Configure unit used by system.
   * @param params parameters received from user, already parsed.
   * @param paramCount number of parameters received.
-  * @return Message to send to Telegram bot.
+  * @note The reply is written into botReply.
   */
-  std::string TelegramBot::_commandSetUnit(const ParametersArray &params, size_t paramCount)
+  void TelegramBot::_commandSetUnit(const ParametersArray &params, size_t paramCount)
   {
     if (paramCount == 2) {
       std::string unit = params[1];
 
       if(Module::TankMonitor::getInstance().setPressureGaugeUnit(unit))
       {
-        return SET_UNIT_COMMAND_RESPONSE_STR;
+        botReply.Append(SET_UNIT_COMMAND_RESPONSE_STR);
+        return;
       } 
 
     }
 
-    return _formatString(ERROR_INVALID_PARAMETERS_STR, COMMAND_START_STR);
+    botReply.Format(ERROR_INVALID_PARAMETERS_STR, COMMAND_START_STR);
   }
 
   /**
   * @brief /unit command. Display current unit.
   * @param params parameters received from user, already parsed.
   * @param paramCount number of parameters received.
-  * @return Message to send to Telegram bot.
+  * @note The reply is written into botReply.
   */
-  std::string TelegramBot::_commandUnit(const ParametersArray &params, size_t paramCount)
+  void TelegramBot::_commandUnit(const ParametersArray &params, size_t paramCount)
   {
     if (paramCount == 1) {
-      std::string result;
-      
       std::string unit = Module::TankMonitor::getInstance().getPressureGaugeUnitStr();
       if (unit != "Unknown")
       {
-        result = _formatString(UNIT_COMMAND_RESPONSE_STR, unit.c_str());
+        botReply.Format(UNIT_COMMAND_RESPONSE_STR, unit.c_str());
       } else {
-        result = _formatString(UNIT_COMMAND_RESPONSE_STR, "unit not set");
+        botReply.Format(UNIT_COMMAND_RESPONSE_STR, "unit not set");
       }
 
-      return result;
+      return;
     }
 
-    return _formatString(ERROR_INVALID_PARAMETERS_STR, COMMAND_START_STR);
+    botReply.Format(ERROR_INVALID_PARAMETERS_STR, COMMAND_START_STR);
   }  
 
   /**
   * @brief /newtank command. Display message with information about tank registration.
   * @param params parameters received from user, already parsed.
   * @param paramCount number of parameters received.
-  * @return Message to send to Telegram bot.
+  * @note The reply is written into botReply.
   */
-  std::string TelegramBot::_commandNewTank(const ParametersArray &params, size_t paramCount)
+  void TelegramBot::_commandNewTank(const ParametersArray &params, size_t paramCount)
   {
     if (paramCount == 1) {
-      return NEW_TANK_COMMAND_RESPONSE_STR;
+      botReply.Append(NEW_TANK_COMMAND_RESPONSE_STR);
     } else {
-      return _formatString(ERROR_INVALID_PARAMETERS_STR, COMMAND_NEW_TANK_STR);
+      botReply.Format(ERROR_INVALID_PARAMETERS_STR, COMMAND_NEW_TANK_STR);
     }
-
-    return _formatString(ERROR_INVALID_PARAMETERS_STR, COMMAND_NEW_TANK_STR);
   }
 
   /**
   * @brief /tank command. Sets a new tank in the system.
   * @param params parameters received from user, already parsed.
   * @param paramCount number of parameters received.
-  * @return Message to send to Telegram bot.
+  * @note The reply is written into botReply.
   */
-  std::string TelegramBot::_commandTank(const ParametersArray &params, size_t paramCount)
+  void TelegramBot::_commandTank(const ParametersArray &params, size_t paramCount)
   {
     if (paramCount == 5) {
       std::string firstParam = params[1];
@@ -343,152 +448,175 @@ namespace Module {
       
       if (!Module::TankMonitor::getInstance().isUnitSet())
       {
-        return TANK_COMMAND_NO_UNIT_RESPONSE;
+        botReply.Append(TANK_COMMAND_NO_UNIT_RESPONSE);
+        return;
       }
 
       std::string unit = Module::TankMonitor::getInstance().getPressureGaugeUnitStr();
 
       if (firstParam == "type") {
 
-        if (_isStringNumeric(numTankGasFlow)) {
+        float tankGasFlow;
+
+        if (_getNumber(numTankGasFlow, BOT_GAS_FLOW_MAX, tankGasFlow)) {
           bool isTypeValid = Module::TankMonitor::getInstance().isTankTypeValid(tankType);
 
           if (isTypeValid) {
-            float tankGasFlow = std::stof(numTankGasFlow);
             int tankCapacity = 0;
             Module::TankMonitor::getInstance().setNewTank(tankType, tankCapacity, tankGasFlow);
-            return _formatString(TANK_COMMAND_TYPE_RESPONSE_STR, tankType.c_str(), tankGasFlow);
+            botReply.Format(TANK_COMMAND_TYPE_RESPONSE_STR, tankType.c_str(), tankGasFlow);
+            return;
           }
         }
 
       } else if (firstParam == "vol") {
-        if (unit != "BAR") return COMMAND_TANK_UNIT_ERROR;
+        if (unit != "BAR") {
+          botReply.Append(COMMAND_TANK_UNIT_ERROR);
+          return;
+        }
+
+        float tankGasFlow;
+        float capacity;
 
-        if (_isStringNumeric(numTankGasFlow) && _isStringNumeric(numTankCapacity)) {
-          float tankGasFlow = std::stof(numTankGasFlow);
-          int tankCapacity = std::stoi(numTankCapacity);
+        if (_getNumber(numTankGasFlow, BOT_GAS_FLOW_MAX, tankGasFlow) && _getNumber(numTankCapacity, BOT_CAPACITY_MAX, capacity)) {
+          int tankCapacity = (int) capacity;
           tankType = "None";
           Module::TankMonitor::getInstance().setNewTank(tankType, tankCapacity, tankGasFlow);
-          return _formatString(TANK_COMMAND_VOL_RESPONSE_STR, tankCapacity, tankGasFlow);
+          botReply.Format(TANK_COMMAND_VOL_RESPONSE_STR, tankCapacity, tankGasFlow);
+          return;
         }
         
       }
 
-    } else {
-      return _formatString(ERROR_INVALID_PARAMETERS_STR, COMMAND_TANK_STR);
     }
 
-    return _formatString(ERROR_INVALID_PARAMETERS_STR, COMMAND_TANK_STR);
+    botReply.Format(ERROR_INVALID_PARAMETERS_STR, COMMAND_TANK_STR);
   }
 
   /**
   * @brief /status command. Display current information in the system and shows estimated time for tank to go low.
   * @param params parameters received from user, already parsed.
   * @param paramCount number of parameters received.
-  * @return Message to send to Telegram bot.
+  * @note The reply is written into botReply.
   */
-  std::string TelegramBot::_commandTankStatus(const ParametersArray &params, size_t paramCount)
+  void TelegramBot::_commandTankStatus(const ParametersArray &params, size_t paramCount)
   {
     if (paramCount == 1) {
-      if (Module::TankMonitor::getInstance().getTankState() == TANK_LEVEL_LOW){
-        return STATUS_COMMAND_RESPONSE_ALERT_ON;
+      tank_status_t status = Module::TankMonitor::getInstance().getStatusSnapshot();
+
+      if (status.state == TANK_LEVEL_LOW){
+        botReply.Append(STATUS_COMMAND_RESPONSE_ALERT_ON);
+        return;
       }
-      if (Module::TankMonitor::getInstance().isTankRegistered()) {
-        float pressure;
-        float gasFlow;
-        float time = Module::TankMonitor::getInstance().getTankStatus(pressure, gasFlow);
+      if (status.tankRegistered) {
+        float pressure = status.pressure;
+        float gasFlow = status.gasFlow;
+        float time = status.timeLeft;
         std::string unit = Module::TankMonitor::getInstance().getPressureGaugeUnitStr();
         
         if (time == -1){
-          return ERROR_STATUS_COMMAND_STR;
+          botReply.Append(ERROR_STATUS_COMMAND_STR);
         } else if (time >= 60.0) {
           int hours = (int) (time / 60.0);
           float minutesLeft = time - (hours * 60.0);
           int minutes = (int) (minutesLeft + 0.5);
-          return _formatString(STATUS_COMMAND_RESPONSE_HOURS_STR, pressure, unit.c_str(), gasFlow, hours, minutes);
-        } else if (time < 60.0){
+          botReply.Format(STATUS_COMMAND_RESPONSE_HOURS_STR, pressure, unit.c_str(), gasFlow, hours, minutes);
+        } else {
           int timeLeft = (int) time;
-          return _formatString(STATUS_COMMAND_RESPONSE_MINUTES_STR, pressure, unit.c_str(), gasFlow, timeLeft);
+          botReply.Format(STATUS_COMMAND_RESPONSE_MINUTES_STR, pressure, unit.c_str(), gasFlow, timeLeft);
         }
 
       } else {
-        return ERROR_NO_TANK_STR;
+        botReply.Append(ERROR_NO_TANK_STR);
       }
-      
-    } else {
-      return _formatString(ERROR_INVALID_PARAMETERS_STR, COMMAND_TANK_STATUS_STR);
+      return;
     }
 
-    return _formatString(ERROR_INVALID_PARAMETERS_STR, COMMAND_TANK_STATUS_STR);
+    botReply.Format(ERROR_INVALID_PARAMETERS_STR, COMMAND_TANK_STATUS_STR);
   }
 
   /**
   * @brief /newgf command. Display message with information about new gas flow set up.
   * @param params parameters received from user, already parsed.
   * @param paramCount number of parameters received.
-  * @return Message to send to Telegram bot.
+  * @note The reply is written into botReply.
   */
-  std::string TelegramBot::_commandNewGasFlow(const ParametersArray &params, size_t paramCount)
+  void TelegramBot::_commandNewGasFlow(const ParametersArray &params, size_t paramCount)
   {
     if (paramCount == 1) {
-      return NEW_GAS_FLOW_COMMAND_RESPONSE_STR;
+      botReply.Append(NEW_GAS_FLOW_COMMAND_RESPONSE_STR);
     } else {
-      return _formatString(ERROR_INVALID_PARAMETERS_STR, COMMAND_NEW_TANK_STR);
+      botReply.Format(ERROR_INVALID_PARAMETERS_STR, COMMAND_NEW_TANK_STR);
     }
-
-    return _formatString(ERROR_INVALID_PARAMETERS_STR, COMMAND_NEW_TANK_STR);
   }
 
   /**
   * @brief /gasflow command. Set a new gas flow.
   * @param params parameters received from user, already parsed.
   * @param paramCount number of parameters received.
-  * @return Message to send to Telegram bot.
+  * @note The reply is written into botReply.
   */
-  std::string TelegramBot::_commandGasFlow(const ParametersArray &params, size_t paramCount)
+  void TelegramBot::_commandGasFlow(const ParametersArray &params, size_t paramCount)
   {
     if (paramCount == 2) {
       if (Module::TankMonitor::getInstance().isTankRegistered()) {
         std::string numTankGasFlow = params[1];
 
-        if (_isStringNumeric(numTankGasFlow)) {
-          float tankGasFlow = std::stof(numTankGasFlow);
-          Module::TankMonitor::getInstance().setNewGasFlow(tankGasFlow);
-          return _formatString(GAS_FLOW_COMMAND_RESPONSE_STR, tankGasFlow);
+        float tankGasFlow;
 
+        if (_getNumber(numTankGasFlow, BOT_GAS_FLOW_MAX, tankGasFlow)) {
+          Module::TankMonitor::getInstance().setNewGasFlow(tankGasFlow);
+          botReply.Format(GAS_FLOW_COMMAND_RESPONSE_STR, tankGasFlow);
+          return;
         }  
       } else {
-        return _formatString(ERROR_NO_TANK_STR);
+        botReply.Append(ERROR_NO_TANK_STR);
+        return;
       }
-    } else {
-      return _formatString(ERROR_INVALID_PARAMETERS_STR, COMMAND_NEW_GAS_FLOW_STR);
     }
 
-    return _formatString(ERROR_INVALID_PARAMETERS_STR, COMMAND_NEW_GAS_FLOW_STR);
+    botReply.Format(ERROR_INVALID_PARAMETERS_STR, COMMAND_NEW_GAS_FLOW_STR);
   }
 
   /**
   * @brief /end command. Unregistered a user.
   * @param params parameters received from user, already parsed.
   * @param paramCount number of parameters received.
-  * @return Message to send to Telegram bot.
+  * @note The reply is written into botReply.
   */
-  std::string TelegramBot::_commandEnd(const ParametersArray &params, size_t paramCount)
+  void TelegramBot::_commandEnd(const ParametersArray &params, size_t paramCount)
   {
     if (paramCount == 1) {
-      std::string result;
       bool unregisterSuccess = _unregisterUser(botLastMessage.fromId);
 
       if (unregisterSuccess)
       {
-        result = _formatString(END_COMMAND_USR_REMOVED_RESPONSE_STR, botLastMessage.fromName.c_str());
+        botReply.Format(END_COMMAND_USR_REMOVED_RESPONSE_STR, botLastMessage.fromName.c_str());
       } else {
-        result = _formatString(END_COMMAND_USR_NOTFOUND_RESPONSE_STR, botLastMessage.fromName.c_str());
+        botReply.Format(END_COMMAND_USR_NOTFOUND_RESPONSE_STR, botLastMessage.fromName.c_str());
       }
-      return result;
+      return;
+    }
+
+    botReply.Format(ERROR_INVALID_PARAMETERS_STR, COMMAND_END_STR);
+  }
+
+  /**
+  * @brief /metrics command. Display runtime metrics and dump them over the debug UART.
+  * @param params parameters received from user, already parsed.
+  * @param paramCount number of parameters received.
+  * @note The reply is written into botReply.
+  */
+  void TelegramBot::_commandMetrics(const ParametersArray &params, size_t paramCount)
+  {
+    if (paramCount == 1) {
+      Util::Metrics::WriteSummary(botReply);
+      Util::Metrics::RequestDump();
+      PROFILE_REQUEST_DUMP();
+      return;
     }
 
-    return _formatString(ERROR_INVALID_PARAMETERS_STR, COMMAND_END_STR);
+    botReply.Format(ERROR_INVALID_PARAMETERS_STR, COMMAND_METRICS_STR);
   }
 
   /**
@@ -508,6 +636,8 @@ namespace Module {
       }
       userId[userCount] = newUserId;
       userCount++;
+      Util::Metrics::Set(METRIC_BOT_USERS, userCount);
+      ConfigStore::getInstance().requestSave();
       return true;
     }
     return false;
@@ -533,7 +663,9 @@ namespace Module {
       }
 
       userCount--;
+      Util::Metrics::Set(METRIC_BOT_USERS, userCount);
       userId[userCount] = "";
+      ConfigStore::getInstance().requestSave();
       return true;
     } else {
       return false;
@@ -568,6 +700,8 @@ namespace Module {
   */
   Module::TelegramBot::ParametersArray TelegramBot::_parseMessage(const std::string &message, size_t &paramCount)
   {
+    PROFILE_ZONE(TELEGRAM_BOT_PARSE);
+
     ParametersArray params;
     paramCount = 0;
 
@@ -596,17 +730,215 @@ namespace Module {
   }
 
   /**
-  * @brief Sends a message to a specific chat ID.
+  * @brief Starts a new reply to a specific chat ID in botReply.
+  * 
+  * Everything written to botReply afterwards is URL encoded as the message text.
   * 
   * @param chatId Target chat ID.
-  * @param message The message content to send.
   */
-  void TelegramBot::_sendMessage(const std::string chatId, const std::string message)
+  void TelegramBot::_beginMessage(const std::string &chatId)
+  {
+    botReply.Clear();
+    botReply.Append("chat_id=");
+    botReply.Append(chatId.c_str());
+    botReply.Append("&text=");
+    botReply.SetUrlEncoding(true);
+  }
+
+  /**
+  * @brief Starts a new broadcast message in botReply.
+  * 
+  * Recipients are added by the WiFi module, so only the text field is written.
+  * Everything written to botReply afterwards is URL encoded as the message text.
+  */
+  void TelegramBot::_beginBroadcastMessage()
+  {
+    botReply.Clear();
+    botReply.Append("text=");
+    botReply.SetUrlEncoding(true);
+  }
+
+  /**
+  * @brief Sends the reply started with _beginMessage.
+  */
+  void TelegramBot::_sendMessage()
+  {
+    Drivers::WifiCom::getInstance().post(botSendEndpoint, botReply.c_str());
+  }
+
+  /**
+  * @brief Sends the message started with _beginBroadcastMessage to several chat IDs
+  *        with a single command to the WiFi module.
+  * 
+  * @param recipients Comma separated list of target chat IDs.
+  */
+  void TelegramBot::_broadcastMessage(const std::string &recipients)
+  {
+    Drivers::WifiCom::getInstance().broadcast(botSendEndpoint, recipients, botReply.c_str());
+  }
+
+  /**
+  * @brief Takes the registered users as recipients of a new broadcast.
+  */
+  void TelegramBot::_prepareBroadcast()
+  {
+    broadcastTotal = userCount;
+    for (size_t i = 0; i < userCount; i++) {
+        broadcastList[i] = userId[i];
+        broadcastDelivered[i] = false;
+    }
+    broadcastRetryCount = 0;
+  }
+
+  /**
+  * @brief Builds the list of broadcast recipients not delivered yet.
+  * 
+  * @param recipients Output comma separated list of chat IDs, empty if every recipient was delivered.
+  */
+  void TelegramBot::_getPendingRecipients(std::string &recipients)
   {
-    std::string server = botUrl + botToken + "/sendmessage";
-    std::string request = "chat_id=" + chatId + "&text=" + message;
+    recipients.clear();
 
-    Drivers::WifiCom::getInstance().post(server, request);
+    for (size_t i = 0; i < broadcastTotal; i++) {
+      if (!broadcastDelivered[i]) {
+        if (!recipients.empty()) {
+          recipients += LIST_SEPARATOR_CHAR;
+        }
+        recipients += broadcastList[i];
+      }
+    }
+  }
+
+  /**
+  * @brief Marks as delivered the broadcast recipients reported OK by the WiFi module.
+  * 
+  * The response holds one OK/ERROR result per pending recipient, in the order
+  * they were sent.
+  * 
+  * @param response Comma separated broadcast results.
+  * @return true if every recipient has been delivered, false otherwise.
+  */
+  bool TelegramBot::_updateBroadcastResults(const std::string &response)
+  {
+    bool isBroadcastCompleted = true;
+    size_t start = 0;
+
+    for (size_t i = 0; i < broadcastTotal; i++) {
+      if (broadcastDelivered[i]) {
+        continue;
+      }
+
+      size_t end = response.find(LIST_SEPARATOR_CHAR, start);
+      if (end == std::string::npos) {
+        end = response.length();
+      }
+
+      if ((start < response.length()) && (response.compare(start, end - start, RESULT_OK) == 0)) {
+        broadcastDelivered[i] = true;
+      } else {
+        isBroadcastCompleted = false;
+      }
+
+      start = end + 1;
+    }
+
+    return isBroadcastCompleted;
+  }
+
+  /**
+  * @brief Queues an alert when the tank goes low, again every BOT_ALERT_INTERVAL
+  *        while it stays low, and a notice when it leaves the low state.
+  */
+  void TelegramBot::_queueAlerts()
+  {
+    const tank_status_t status = Module::TankMonitor::getInstance().getStatusSnapshot();
+    bool isQueued = false;
+
+    if (status.state == TANK_LEVEL_LOW) {
+      if ((alertTankState != TANK_LEVEL_LOW) || isAlertTimeoutFinished) {
+        isQueued = alertQueue.push(ALERT_TANK_LOW, status.state, status.timestamp);
+        isAlertTimeoutFinished = false;
+        alertDelay.Restart(BOT_ALERT_INTERVAL);
+      }
+    } else if (status.state != alertTankState) {
+      isQueued = alertQueue.push(ALERT_TANK_STATE, status.state, status.timestamp);
+    }
+
+    alertTankState = status.state;
+
+    if (isQueued) {
+      Util::Metrics::Increment(METRIC_BOT_ALERTS_QUEUED);
+    }
+  }
+
+  /**
+  * @brief Writes the alerts of the broadcast in progress into botReply, as a single
+  *        message in priority order. Alerts held for a while tell their age.
+  * 
+  * @return size_t Alerts written, 0 if all of them were superseded.
+  */
+  size_t TelegramBot::_composeAlerts()
+  {
+    alert_t pending[ALERT_QUEUE_SIZE];
+    uint32_t lastSequence;
+    const size_t count = alertQueue.peek(pending, lastSequence);
+    const Util::tick_t now = Util::Tick::GetTickCounter();
+    size_t written = 0;
+
+    _beginBroadcastMessage();
+
+    for (size_t i = 0; i < count; i++) {
+      if ((int32_t) (pending[i].sequence - alertSequence) > 0) {
+        continue;
+      }
+
+      if (pending[i].kind == ALERT_TANK_LOW) {
+        botReply.Append(ALERT_TANK_EMPTY);
+      } else {
+        botReply.Append((pending[i].state == TANK_LEVEL_OK) ? ALERT_TANK_OK : ALERT_TANK_UNKNOWN);
+      }
+
+      const int age = (int) ((now - pending[i].timestamp) / DELAY_1_MINUTE);
+      if (age > 0) {
+        botReply.Format(ALERT_AGE_STR, age);
+      }
+      botReply.Append('\n');
+      written++;
+    }
+
+    return written;
+  }
+
+  /**
+  * @brief Ends the broadcast in progress: its alerts are removed from the queue and
+  *        their delivery latency observed.
+  */
+  void TelegramBot::_completeAlerts()
+  {
+    alert_t pending[ALERT_QUEUE_SIZE];
+    uint32_t lastSequence;
+    const size_t count = alertQueue.peek(pending, lastSequence);
+    const Util::tick_t now = Util::Tick::GetTickCounter();
+    const Util::tick_t linkReadyTick = Drivers::WifiCom::getInstance().getLinkReadyTick();
+    bool isHeldOver = false;
+
+    for (size_t i = 0; i < count; i++) {
+      if ((int32_t) (pending[i].sequence - alertSequence) > 0) {
+        continue;
+      }
+
+      Util::Metrics::Observe(METRIC_BOT_ALERT_LATENCY, (uint32_t) (now - pending[i].timestamp));
+      isHeldOver = isHeldOver || (pending[i].timestamp < linkReadyTick);
+    }
+
+    // Alerts raised before the link came up were held through the outage.
+    if (isHeldOver) {
+      Util::Metrics::Observe(METRIC_BOT_ALERT_DRAIN_LATENCY, (uint32_t) (now - linkReadyTick));
+    }
+
+    alertQueue.markDelivered(alertSequence);
+    isAlertPending = false;
+    broadcastRetryCount = 0;
   }
 
   /**
@@ -616,20 +948,49 @@ namespace Module {
   */
   void TelegramBot::_requestLastMessage()
   {
-    std::string server = botUrl + botToken + "/getUpdates";
-    std::string request = "offset=-1";
-    Drivers::WifiCom::getInstance().post(server, request);
+    Util::Metrics::Increment(METRIC_BOT_POLLS);
+
+    Drivers::WifiCom::getInstance().post(botUpdatesEndpoint, "offset=-1");
+  }
+
+  /**
+  * @brief Hands the webhook URL and secret to Telegram, which then pushes
+  *        the updates there and stops answering getUpdates.
+  */
+  void TelegramBot::_registerWebhook()
+  {
+    botReply.Clear();
+    botReply.Append("allowed_updates=%5B%22message%22%5D");
+
+    // Values are percent-encoded, keys and separators go as they are.
+    if (strlen(BOT_WEBHOOK_SECRET) > 0) {
+      botReply.Append("&secret_token=");
+      botReply.SetUrlEncoding(true);
+      botReply.Append(BOT_WEBHOOK_SECRET);
+      botReply.SetUrlEncoding(false);
+    }
+    botReply.Append("&url=");
+    botReply.SetUrlEncoding(true);
+    botReply.Append(BOT_WEBHOOK_URL);
+    botReply.SetUrlEncoding(false);
+
+    Drivers::WifiCom::getInstance().post(botUpdatesEndpoint, botReply.c_str());
   }
 
   /**
   * @brief Extracts a message from a Telegram API response.
   * 
+  * The response is either a getUpdates answer, or a single update pushed to
+  * the webhook.
+  * 
   * @param message Pointer to message structure to fill.
   * @param response Raw JSON response string.
   * @return true if a new message was parsed successfully, false otherwise.
   */
   bool TelegramBot::_getMessageFromResponse(telegram_Message *message, const std::string &response)
   {
+    PROFILE_ZONE(TELEGRAM_BOT_GET_MESSAGE);
+
     std::string fixedResponse = response;
 
     // Erase first '{'
@@ -639,33 +1000,61 @@ namespace Module {
         fixedResponse.erase(0, 1);
     }
 
+    // Only the fields read below are kept, the rest of the update is skipped while parsing.
+    static JsonDocument filter;
+    if (filter["ok"].isNull()) {
+      filter["ok"] = true;
+      filter["result"][0]["update_id"] = true;
+      filter["result"][0]["message"]["text"] = true;
+      filter["result"][0]["message"]["from"]["id"] = true;
+      filter["result"][0]["message"]["from"]["first_name"] = true;
+      filter["result"][0]["message"]["from"]["username"] = true;
+      filter["update_id"] = true;
+      filter["message"]["text"] = true;
+      filter["message"]["from"]["id"] = true;
+      filter["message"]["from"]["first_name"] = true;
+      filter["message"]["from"]["username"] = true;
+    }
+
     JsonDocument doc;
 
     // Parse the JSON payload
-    DeserializationError error = deserializeJson(doc, fixedResponse);
+    DeserializationError error = deserializeJson(doc, fixedResponse, DeserializationOption::Filter(filter));
     if (error)
     {
       return false;
     }
     
-    if (!doc["ok"])
-    {
-      return false;
-    }
+    JsonObject firstResult;
+    unsigned long updateId;
 
-    JsonArray results = doc["result"];
-    if (results.size() == 0)
+    if (!doc["update_id"].isNull())
     {
-      return false;
+      // Pushed update: the first one is new as well.
+      firstResult = doc.as<JsonObject>();
+      updateId = firstResult["update_id"] | 0;
     }
-    
-    JsonObject firstResult = results[0];
-    unsigned long updateId = firstResult["update_id"] | 0;
-
-    if (botLastUpdateId == 0)
+    else
     {
-      botLastUpdateId = updateId;
-      return false;
+      if (!doc["ok"])
+      {
+        return false;
+      }
+
+      JsonArray results = doc["result"];
+      if (results.size() == 0)
+      {
+        return false;
+      }
+      
+      firstResult = results[0];
+      updateId = firstResult["update_id"] | 0;
+
+      if (botLastUpdateId == 0)
+      {
+        botLastUpdateId = updateId;
+        return false;
+      }
     }
 
     if (updateId <= botLastUpdateId)
@@ -678,6 +1067,12 @@ namespace Module {
     JsonObject messageObj = firstResult["message"];
     JsonObject from = messageObj["from"];
 
+    // Stickers, photos and the like have no text.
+    if (messageObj["text"].isNull())
+    {
+      return false;
+    }
+
     const char* result_0_message_text = messageObj["text"];
     unsigned long long result_0_message_from_id = from["id"];
     const char* result_0_message_from_first_name = from["first_name"];
@@ -719,37 +1114,13 @@ namespace Module {
       return COMMAND_GAS_FLOW;
     } else if (command == COMMAND_END_STR) {
       return COMMAND_END;
+    } else if (command == COMMAND_METRICS_STR) {
+      return COMMAND_METRICS;
     }
 
     return ERROR_INVALID_COMMAND;
   }
 
-  /**
-  * @brief Format a string according to the provided format.
-  * @note This implementation was obtained from <a href="https://stackoverflow.com/a/49812018">here</a>.
-  * @param format The format string.
-  * @param ... Additional arguments for formatting.
-  * @return The formatted string.
-  */
-  std::string TelegramBot::_formatString(const char* format, ...)
-  {
-    va_list args;
-    va_start(args,format);
-
-    int size = std::vsnprintf(nullptr, 0, format, args);
-    va_end(args);
-
-    std::string result(size + 1, '\0');
-    
-    va_start(args, format);
-    std::vsnprintf(&result[0], result.size(), format, args);
-    va_end(args);
-
-    result.pop_back();
-
-    return result;
-  }
-
   /**
   * @brief Checks if a string is a valid numeric representation.
   * 
@@ -779,17 +1150,25 @@ namespace Module {
     return digit_found;
   }
 
+  /**
+  * @brief Reads a number sent by a user, bounded so it can't overflow the
+  *        estimations or the replies.
+  * 
+  * @param str The string to read.
+  * @param max Largest value accepted.
+  * @param value Number read.
+  * @return true if numeric and not above max, false otherwise.
+  */
+  bool TelegramBot::_getNumber(const std::string &str, float max, float &value)
+  {
+    if (!_isStringNumeric(str)) return false;
 
-} // namespace Module
+    // No exceptions: too many digits read as HUGE_VALF, above any bound.
+    value = strtof(str.c_str(), nullptr);
+
+    return (value <= max);
+  }
 
-//===[Callback function implementation]====================s
 
-static void onTBotTimeoutFinishedCallback()
-{
-  isTimeoutFinished = true;
-}
 
-static void onAlertTimeoutFinishedCallback()
-{
-  isAlertTimeoutFinished = true;
-}
\ No newline at end of file
+} // namespace Module
@@ -20,19 +20,79 @@
 #include <algorithm>
 #include <stdint.h>
 #include "telegram_bot_lib.h"
+#include "alert_queue.h"
 #include "PinNames.h"
 #include "delay.h"
+#include "text_writer.h"
 #include "mbed.h"
 #include "tank_monitor.h"
 
 //=========================[Module Defines]=====================================
 
-#define NB_COMMANDS 9
+#define NB_COMMANDS 10
 #define BOT_API_URL "https://api.telegram.org/bot"
 #define BOT_TOKEN   "7713584244:AAGMZfNYBwRIWm1gPhduFv5bhBhdRNhkBcA"
 #define MAX_USER_COUNT 10
 #define MAX_PARAMS 10
 #define BROADCAST_MAX_RETRIES 3
+#define BOT_REPLY_BUFFER_SIZE 1024
+#define BOT_GAS_FLOW_MAX      100.0f    /**< Largest gas flow accepted from a user [L/min]. */
+#define BOT_CAPACITY_MAX      100000.0f /**< Largest tank capacity accepted from a user [L]. */
+
+//=========================[Module Timing Defines]==============================
+
+/** @brief Wait between getUpdates requests [ms]. */
+#ifndef BOT_POLL_INTERVAL
+#define BOT_POLL_INTERVAL       DELAY_2_SECONDS
+#endif
+
+/** @brief Timeout of a getUpdates request [ms]. */
+#ifndef BOT_POLL_TIMEOUT
+#define BOT_POLL_TIMEOUT        DELAY_8_SECONDS
+#endif
+
+/** @brief Timeout of a reply to a user [ms]. */
+#ifndef BOT_REPLY_TIMEOUT
+#define BOT_REPLY_TIMEOUT       DELAY_5_SECONDS
+#endif
+
+/** @brief Timeout of an alert broadcast [ms]. */
+#ifndef BOT_BROADCAST_TIMEOUT
+#define BOT_BROADCAST_TIMEOUT   DELAY_20_SECONDS
+#endif
+
+/** @brief Minimum time between two alerts [ms]. */
+#ifndef BOT_ALERT_INTERVAL
+#define BOT_ALERT_INTERVAL      DELAY_1_MINUTE
+#endif
+
+/** @brief Wait before resuming an alert broadcast that ran out of retries [ms]. */
+#ifndef BOT_ALERT_RETRY_INTERVAL
+#define BOT_ALERT_RETRY_INTERVAL  DELAY_5_SECONDS
+#endif
+
+//=========================[Module Webhook Defines]=============================
+
+/** @brief Take updates pushed to a webhook on the ESP32 instead of polling getUpdates. */
+#ifndef BOT_WEBHOOK_MODE
+#define BOT_WEBHOOK_MODE        0
+#endif
+
+/** @brief Local port of the ESP32 webhook. */
+#ifndef BOT_WEBHOOK_PORT
+#define BOT_WEBHOOK_PORT        8080
+#endif
+
+/** @brief Secret expected in the X-Telegram-Bot-Api-Secret-Token header, empty to accept any update. */
+#ifndef BOT_WEBHOOK_SECRET
+#define BOT_WEBHOOK_SECRET      ""
+#endif
+
+/** @brief Public HTTPS URL forwarded to the ESP32 webhook, handed to Telegram with setWebhook.
+ *         Empty when a LAN relay pushes the updates instead. */
+#ifndef BOT_WEBHOOK_URL
+#define BOT_WEBHOOK_URL         ""
+#endif
 
 namespace Module {
 
@@ -62,15 +122,35 @@ namespace Module {
       */
       void update();
 
+      /**
+      * @brief Number of registered users.
+      */
+      int getUserCount();
+
+      /**
+      * @brief Telegram ID of a registered user.
+      * @param index User index, below getUserCount().
+      */
+      const std::string& getUserId(int index);
+
+      /**
+      * @brief Registers a user, as /start does.
+      * @param newUserId Telegram user ID.
+      * @return true if registered, false if already registered or there is no room.
+      */
+      bool addUser(const std::string &newUserId);
+
     private:
 
+      friend class Benchmark;   /**< On-target benchmarks exercise the private hot paths. */
+
       using ParametersArray = std::array<std::string, MAX_PARAMS>;  /**< Aliasing used for array class. */
       using UsersArray = std::array<std::string, MAX_USER_COUNT>;   /**< Aliasing used for array class. */
 
       /**
       * @brief Type for command function pointers.
       */
-      typedef std::string (TelegramBot::*commandFunction)(const ParametersArray &params, const size_t paramCount);
+      typedef void (TelegramBot::*commandFunction)(const ParametersArray &params, const size_t paramCount);
 
       /**
        * @struct telegram_Message
@@ -96,7 +176,9 @@ namespace Module {
         WAITING_LAST_MESSAGE,       /**< Waiting for last message. */
         PROCESS_LAST_MESSAGE,       /**< Processing the received message. */
         WAITING_RESPONSE,           /**< Waiting for API response. */
-        WAITING_BROADCAST_RESPONSE  /**< Waiting for API response in case of broadcast. */
+        WAITING_BROADCAST_RESPONSE, /**< Waiting for API response in case of broadcast. */
+        REGISTER_WEBHOOK,           /**< State to hand the webhook URL to Telegram. */
+        WAITING_WEBHOOK_RESPONSE    /**< Waiting for API response to setWebhook. */
       } bot_state_t;
 
       TelegramBot(const char *apiUrl, const char *token)
@@ -110,41 +192,59 @@ namespace Module {
 
       /**
       * @name Comands Handlers
-      * Handler for telegram commands
+      * Handler for telegram commands. Each one writes its reply into botReply.
       * @{
       */
-      std::string _commandStart(const ParametersArray &params, size_t paramCount);
-      std::string _commandSetUnit(const ParametersArray &params, size_t paramCount);
-      std::string _commandUnit(const ParametersArray &params, size_t paramCount);
-      std::string _commandNewTank(const ParametersArray &params, size_t paramCount);
-      std::string _commandTank(const ParametersArray &params, size_t paramCount);
-      std::string _commandTankStatus(const ParametersArray &params, size_t paramCount);
-      std::string _commandNewGasFlow(const ParametersArray &params, size_t paramCount);
-      std::string _commandGasFlow(const ParametersArray &params, size_t paramCount);
-      std::string _commandEnd(const ParametersArray &params, size_t paramCount);
+      void _commandStart(const ParametersArray &params, size_t paramCount);
+      void _commandSetUnit(const ParametersArray &params, size_t paramCount);
+      void _commandUnit(const ParametersArray &params, size_t paramCount);
+      void _commandNewTank(const ParametersArray &params, size_t paramCount);
+      void _commandTank(const ParametersArray &params, size_t paramCount);
+      void _commandTankStatus(const ParametersArray &params, size_t paramCount);
+      void _commandNewGasFlow(const ParametersArray &params, size_t paramCount);
+      void _commandGasFlow(const ParametersArray &params, size_t paramCount);
+      void _commandEnd(const ParametersArray &params, size_t paramCount);
+      void _commandMetrics(const ParametersArray &params, size_t paramCount);
       /** @} */
 
       bool _registerUser(std::string userId);
       bool _unregisterUser(std::string oldUserId);
       bool _isUserIdValid(std::string fUserId);
       ParametersArray _parseMessage(const std::string &message, size_t &paramCount);
-      void _sendMessage(const std::string chatId, const std::string message);
+      void _beginMessage(const std::string &chatId);
+      void _beginBroadcastMessage();
+      void _sendMessage();
+      void _broadcastMessage(const std::string &recipients);
+      void _prepareBroadcast();
+      void _getPendingRecipients(std::string &recipients);
+      bool _updateBroadcastResults(const std::string &response);
+      void _queueAlerts();
+      size_t _composeAlerts();
+      void _completeAlerts();
       void _requestLastMessage();
+      void _registerWebhook();
       bool _getMessageFromResponse(telegram_Message *message, const std::string &response);
       command_t _findCommand(const std::string command);
-      std::string _formatString(const char* format, ... );
       bool _isStringNumeric(const std::string &str);
+      bool _getNumber(const std::string &str, float max, float &value);
 
       bot_state_t botState;                         /**< Current bot state. */
       const std::string botToken;                   /**< Bot API token. */
       const std::string botUrl;                     /**< Bot API URL. */
+      uint8_t botSendEndpoint;                      /**< WifiCom endpoint of sendMessage. */
+      uint8_t botUpdatesEndpoint;                   /**< WifiCom endpoint of getUpdates, or setWebhook in webhook mode. */
+      bool botIsWebhookSet;                         /**< Telegram pushes the updates to the webhook. */
       unsigned long botLastUpdateId;                /**< ID of the last processed update. */
       UsersArray userId;                            /**< List of registered user IDs. */
       int userCount;                                /**< Number of registered users. */
-      int broadcastIndex;                           /**< Index of current user in broadcast. */
       int broadcastRetryCount;                      /**< Number of broadcast retries attempted. */
+      AlertQueue alertQueue;                        /**< Alerts not delivered to every user yet. */
+      tank_state_t alertTankState;                  /**< Tank state seen on the last update. */
+      uint32_t alertSequence;                       /**< Last queued alert included in the broadcast in progress. */
+      bool isAlertPending;                          /**< An alert broadcast is in progress, maybe paused. */
       telegram_Message botLastMessage;              /**< Last received message. */
       std::string botResponse;                      /**< Last response from API. */
+      Util::TextBuffer<BOT_REPLY_BUFFER_SIZE> botReply; /**< Reusable request body for outgoing messages. */
       commandFunction functionsArray[NB_COMMANDS];  /**< Commands function array. */
 
   }; //TelegramBot class
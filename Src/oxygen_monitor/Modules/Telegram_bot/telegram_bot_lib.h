@@ -6,11 +6,15 @@
  *
  * This file defines command identifiers, associated command strings, and common
  * error or alert messages used throughout the Telegram Bot system.
+ * Messages with parameters are declared as Util::MessageTemplate, so their
+ * format string is checked against the argument types at compile time.
  *******************************************************************************/
 
 #ifndef TELEGRAM_BOT_LIB_H
 #define TELEGRAM_BOT_LIB_H
 
+#include "text_writer.h"
+
 /**
  * @enum command_t
  * @brief Enumerates all supported commands for the Telegram Bot.
@@ -25,6 +29,7 @@ typedef enum COMMANDS {
     COMMAND_NEW_GAS_FLOW,           /**< Command to configure new gas flow (/newgf). */
     COMMAND_GAS_FLOW,               /**< Command to set new gas flow (/gasflow). */
     COMMAND_END,                    /**< Command to unregister user (/end). */
+    COMMAND_METRICS,                /**< Command to display runtime metrics (/metrics). */
     ERROR_INVALID_COMMAND           /**< Returned when a command is not recognized. */
 } command_t;
 
@@ -73,6 +78,11 @@ const char COMMAND_GAS_FLOW_STR[]           = "/gasflow";
  */
 const char COMMAND_END_STR[]                = "/end";
 
+/**
+ * @brief Command string for runtime metrics.
+ */
+const char COMMAND_METRICS_STR[]            = "/metrics";
+
 /**
  * @brief Message displayed after /newtank command
  */
@@ -88,7 +98,7 @@ const char NEW_TANK_COMMAND_RESPONSE_STR[]                        = "To register
 /**
  * @brief Message displayed after /unit command
  */
-const char UNIT_COMMAND_RESPONSE_STR[]                            = "The current unit is: %s\
+constexpr Util::MessageTemplate<const char*> UNIT_COMMAND_RESPONSE_STR = "The current unit is: %s\
                                                                   \n\nTo set the unit please use '/setunit' command as follows:\
                                                                   \n\n/setunit <unit>\
                                                                   \n\nExamples:\
@@ -104,12 +114,12 @@ const char SET_UNIT_COMMAND_RESPONSE_STR[]                        = "[Success!]\
 /**
  * @brief Message displayed after a successful user registration
  */
-const char START_COMMAND_USER_REGISTERED_RESPONSE_STR[]           = "User registered correctly\nHello %s!";
+constexpr Util::MessageTemplate<const char*> START_COMMAND_USER_REGISTERED_RESPONSE_STR = "User registered correctly\nHello %s!";
 
 /**
  * @brief Error message displayed when trying to register a usar that is already registered.
  */
-const char START_COMMAND_USER_REGISTER_FAIL_RESPONSE_STR[]        = "[ERROR]\
+constexpr Util::MessageTemplate<const char*> START_COMMAND_USER_REGISTER_FAIL_RESPONSE_STR = "[ERROR]\
                                                                     \nUser '%s' is already registered!\
                                                                     \nor user limit is reached.";
 
@@ -124,7 +134,7 @@ const char NEW_GAS_FLOW_COMMAND_RESPONSE_STR[]                    = "To set a ne
 /**
  * @brief Message displayed after a new gas flow is set.
  */
-const char GAS_FLOW_COMMAND_RESPONSE_STR[]                        = "[Success!]\
+constexpr Util::MessageTemplate<float> GAS_FLOW_COMMAND_RESPONSE_STR = "[Success!]\
                                                                     \nNew gas flow seted up with the value: %.2f [L/min]";
 
 /**
@@ -137,7 +147,7 @@ const char STATUS_COMMAND_RESPONSE_ALERT_ON[]                     = "[Tank Statu
 /**
  * @brief Message displayed after /status command and time left is more than an hour.
  */
-const char STATUS_COMMAND_RESPONSE_HOURS_STR[]                    = "[Tank Status]\
+constexpr Util::MessageTemplate<float, const char*, float, int, int> STATUS_COMMAND_RESPONSE_HOURS_STR = "[Tank Status]\
                                                                     \nCurrent preassure: %.2f [%s]\
                                                                     \nCurrent Gas Flow: %.2f [L/min]\
                                                                     \n\nThe tank will go low in approximately %d hs. and %d min.";
@@ -145,7 +155,7 @@ const char STATUS_COMMAND_RESPONSE_HOURS_STR[]                    = "[Tank Statu
 /**
  * @brief Message displayed after /status command and time left is less than an hour.
  */
-const char STATUS_COMMAND_RESPONSE_MINUTES_STR[]                  = "[Tank Status]\
+constexpr Util::MessageTemplate<float, const char*, float, int> STATUS_COMMAND_RESPONSE_MINUTES_STR = "[Tank Status]\
                                                                     \nCurrent preassure: %.2f [%s]\
                                                                     \nCurrent Gas Flow: %.2f [L/min]\
                                                                     \n\nThe tank will go low in approximately %d min.";
@@ -160,7 +170,7 @@ const char TANK_COMMAND_NO_UNIT_RESPONSE[]                        = "[Warning!]\
 /**
  * @brief Success message displayed after registering a new tank by type.
  */
-const char TANK_COMMAND_TYPE_RESPONSE_STR[]                       = "[Success!]\
+constexpr Util::MessageTemplate<const char*, float> TANK_COMMAND_TYPE_RESPONSE_STR = "[Success!]\
                                                                     \nNew Oxygen Tank registered:\
                                                                     \nType: %s\
                                                                     \nGas Flow: %.2f [L/min].\n";
@@ -168,7 +178,7 @@ const char TANK_COMMAND_TYPE_RESPONSE_STR[]                       = "[Success!]\
 /**
  * @brief Success message displayed after registering a new tank by volume.
  */
-const char TANK_COMMAND_VOL_RESPONSE_STR[]                        = "[Success!]\
+constexpr Util::MessageTemplate<int, float> TANK_COMMAND_VOL_RESPONSE_STR = "[Success!]\
                                                                     \nNew Oxygen Tank registered:\
                                                                     \nCapacity: %d [L]\
                                                                     \nGas Flow: %.2f [L/min]";
@@ -182,27 +192,27 @@ const char COMMAND_TANK_UNIT_ERROR[]                              = "[ERROR]\
 /**
  * @brief Message confirming user was removed from system.
  */
-const char END_COMMAND_USR_REMOVED_RESPONSE_STR[]                 = "User removed correctly\nGoodbye %s!";
+constexpr Util::MessageTemplate<const char*> END_COMMAND_USR_REMOVED_RESPONSE_STR = "User removed correctly\nGoodbye %s!";
 
 /**
  * @brief Message shown when attempting to remove a non-registered user.
  */
-const char END_COMMAND_USR_NOTFOUND_RESPONSE_STR[]                = "User '%s' is not registered!\nUse '/start' command if you want to register";
+constexpr Util::MessageTemplate<const char*> END_COMMAND_USR_NOTFOUND_RESPONSE_STR = "User '%s' is not registered!\nUse '/start' command if you want to register";
 
 /**
  * @brief Error message for invalid commands.
  */
-const char ERROR_INVALID_COMMAND_STR[]                            = "[ERROR]\nInvalid command [%s].";
+constexpr Util::MessageTemplate<const char*> ERROR_INVALID_COMMAND_STR = "[ERROR]\nInvalid command [%s].";
 
 /**
  * @brief Error message for unregistered or unauthorized users.
  */
-const char ERROR_INVALID_USER_STR[]                               = "[ERROR]\nInvalid user [%s].";
+constexpr Util::MessageTemplate<const char*> ERROR_INVALID_USER_STR = "[ERROR]\nInvalid user [%s].";
 
 /**
  * @brief Error message for invalid or missing parameters.
  */
-const char ERROR_INVALID_PARAMETERS_STR[]                         = "[ERROR]\nInvalid parameters for  [%s] command.";
+constexpr Util::MessageTemplate<const char*> ERROR_INVALID_PARAMETERS_STR = "[ERROR]\nInvalid parameters for  [%s] command.";
 
 /**
  * @brief Error shown when user requests status but no tank is registered.
@@ -221,4 +231,19 @@ const char ERROR_STATUS_COMMAND_STR[]                             = "[Tank Statu
  */
 const char ALERT_TANK_EMPTY[]                                     = "[ALERT]\nTank is low!";
 
+/**
+ * @brief Message indicating the tank is no longer low.
+ */
+const char ALERT_TANK_OK[]                                        = "[INFO]\nTank pressure is back to normal.";
+
+/**
+ * @brief Message indicating the tank state can't be determined anymore.
+ */
+const char ALERT_TANK_UNKNOWN[]                                   = "[INFO]\nTank state is unknown, check the sensor.";
+
+/**
+ * @brief Age of an alert held while the link was down.
+ */
+constexpr Util::MessageTemplate<int> ALERT_AGE_STR                = "\n(%d min ago)";
+
 #endif // TELEGRAM_BOT_LIB_H
\ No newline at end of file
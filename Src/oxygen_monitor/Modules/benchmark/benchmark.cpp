@@ -0,0 +1,439 @@
+/********************************************************************************
+ * @file benchmark.cpp
+ * @brief On-target benchmarks of the modules hot paths.
+ * @author Gonzalo Puy
+ * @date Jun 2025
+ *******************************************************************************/
+
+#include "benchmark.h"
+
+#if BENCHMARK_ENABLED
+
+#include <cstdio>
+#include <string>
+#include "commands.h"
+#include "delay.h"
+#include "pressure_gauge.h"
+#include "tank_catalogue.h"
+#include "tank_estimator.h"
+#include "tank_monitor.h"
+#include "telegram_bot.h"
+#include "text_writer.h"
+#include "wifi_com.h"
+
+namespace Module {
+
+//=====[Declaration and initialization of private global variables]============
+
+static volatile uint32_t benchmarkSink;           /**< Keeps results alive so the compiler can't drop the work. */
+static constexpr size_t RESULT_LINE_SIZE = 192;
+static constexpr size_t UPDATE_BUFFER_SIZE = 384;
+static constexpr unsigned long BENCHMARK_FIRST_USER_ID = 100000000;
+
+bool Benchmark::isFirstResult;
+
+//=====[Declaration of private functions]======================================
+
+static void buildUpdateResponse(Util::TextWriter &writer, int32_t updateId, const char *text);
+
+//=====[Implementations of public methods]======================================
+
+void Benchmark::run()
+{
+  Util::CycleCounter::Init();
+  isFirstResult = true;
+
+  fputs("{\"benchmarks\":[\r\n", stdout);
+
+  _benchmarkPressureGauge();
+  _benchmarkTankMonitor();
+  _benchmarkTankEstimator();
+  _benchmarkTelegramBot();
+  _benchmarkWifiCom();
+  _scenarioBroadcast();
+  _scenarioStatusBurst();
+  _scenarioUartThroughput();
+
+  fputs("\r\n]}\r\n", stdout);
+}
+
+//=====[Implementations of private methods]==================================
+
+/**
+* @brief Prints a benchmark result as a JSON object.
+*/
+void Benchmark::_printResult(const char *name, uint32_t iterations, uint32_t operations, uint64_t total, Util::cycles_t best)
+{
+  Util::TextBuffer<RESULT_LINE_SIZE> line;
+  const uint64_t totalOperations = (uint64_t) iterations * operations;
+
+  if (!isFirstResult) {
+    line.Append(",\r\n");
+  }
+  isFirstResult = false;
+
+  line.Append("{\"name\":\"");
+  line.Append(name);
+  line.Append("\",\"iterations\":");
+  line.AppendInt((int32_t) iterations);
+  line.Append(",\"ops_per_iteration\":");
+  line.AppendInt((int32_t) operations);
+  line.Append(",\"cycles_per_op\":");
+  line.AppendInt((int32_t) (total / totalOperations));
+  line.Append(",\"best_cycles_per_iteration\":");
+  line.AppendInt((int32_t) best);
+  line.Append('}');
+
+  fwrite(line.c_str(), 1, line.Length(), stdout);
+}
+
+/**
+* @brief Prints a throughput result as a JSON object.
+*/
+void Benchmark::_printThroughput(const char *name, uint32_t iterations, uint32_t payloadSize, int baudRate, uint64_t total, Util::cycles_t best)
+{
+  Util::TextBuffer<RESULT_LINE_SIZE> line;
+  const uint64_t totalUs = total / (SystemCoreClock / 1000000);
+
+  if (!isFirstResult) {
+    line.Append(",\r\n");
+  }
+  isFirstResult = false;
+
+  line.Append("{\"name\":\"");
+  line.Append(name);
+  line.Append("\",\"iterations\":");
+  line.AppendInt((int32_t) iterations);
+  line.Append(",\"payload_bytes\":");
+  line.AppendInt((int32_t) payloadSize);
+  line.Append(",\"baud_rate\":");
+  line.AppendInt(baudRate);
+  line.Append(",\"bytes_per_second\":");
+  line.AppendInt((totalUs == 0) ? 0 : (int32_t) (((uint64_t) iterations * payloadSize * 1000000) / totalUs));
+  line.Append(",\"mean_latency_us\":");
+  line.AppendInt((int32_t) (totalUs / iterations));
+  line.Append(",\"best_latency_us\":");
+  line.AppendInt((int32_t) (best / (SystemCoreClock / 1000000)));
+  line.Append('}');
+
+  fwrite(line.c_str(), 1, line.Length(), stdout);
+}
+
+/**
+* @brief Voltage to pressure conversion, switching units so it can't be cached.
+*/
+void Benchmark::_benchmarkPressureGauge()
+{
+  static Drivers::PressureGauge gauge(PRESS_SENSOR_PIN);
+
+  gauge.init();
+
+  _measure("pressure_gauge_convert", BENCHMARK_ITERATIONS, 1, [](uint32_t i) {
+    gauge.setUnit((i & 1) ? Drivers::PressureGauge::UNIT_PSI : Drivers::PressureGauge::UNIT_BAR);
+    benchmarkSink += (uint32_t) gauge.getLastReading();
+  });
+}
+
+/**
+* @brief Status read from the published snapshot.
+*/
+void Benchmark::_benchmarkTankMonitor()
+{
+  _measure("tank_monitor_get_tank_status", BENCHMARK_ITERATIONS, 1, [](uint32_t i) {
+    float lastReading;
+    float gasFlow;
+
+    benchmarkSink += (uint32_t) TankMonitor::getInstance().getTankStatus(lastReading, gasFlow);
+  });
+}
+
+/**
+* @brief Estimation of a fleet of tanks, one by one and as a batch, and tank type lookup.
+*/
+void Benchmark::_benchmarkTankEstimator()
+{
+  static float pressure[BENCHMARK_FLEET_SIZE];
+  static float gasFlow[BENCHMARK_FLEET_SIZE];
+  static float capacity[BENCHMARK_FLEET_SIZE];
+  static uint8_t type[BENCHMARK_FLEET_SIZE];
+  static uint8_t unit[BENCHMARK_FLEET_SIZE];
+  static float timeLeft[BENCHMARK_FLEET_SIZE];
+  static uint8_t state[BENCHMARK_FLEET_SIZE];
+  static const tank_batch_t batch = { BENCHMARK_FLEET_SIZE, pressure, gasFlow, capacity, type, unit, timeLeft, state };
+
+  // Mix of units, types and readings so every path of the kernel is taken.
+  for (size_t i = 0; i < BENCHMARK_FLEET_SIZE; i++) {
+    unit[i] = (uint8_t) (i % TANK_UNIT_COUNT);
+    type[i] = (uint8_t) (i % TANK_TYPE_COUNT);
+    pressure[i] = (float) ((i * 37) % 250);
+    gasFlow[i] = (float) (i % 7);
+    capacity[i] = (float) ((i * 13) % 40);
+  }
+
+  _measure("tank_estimator_scalar_1k", BENCHMARK_SCENARIO_ITERATIONS, BENCHMARK_FLEET_SIZE, [](uint32_t i) {
+    for (size_t tank = 0; tank < BENCHMARK_FLEET_SIZE; tank++) {
+      timeLeft[tank] = TankEstimator::getTimeLeft(pressure[tank], gasFlow[tank], capacity[tank], type[tank], unit[tank]);
+      state[tank] = (uint8_t) TankEstimator::getState(pressure[tank], unit[tank]);
+    }
+    benchmarkSink += state[i];
+  });
+
+  _measure("tank_estimator_batch_1k", BENCHMARK_SCENARIO_ITERATIONS, BENCHMARK_FLEET_SIZE, [](uint32_t i) {
+    TankEstimator::estimate(batch);
+    benchmarkSink += state[i];
+  });
+
+  // Names, aliases in both cases and a miss.
+  static const char *const names[] = { "D", "h", "m122", "K", "X" };
+
+  _measure("tank_catalogue_find", BENCHMARK_ITERATIONS, 1, [](uint32_t i) {
+    benchmarkSink += (uint32_t) TankCatalogue::find(names[i % 5]);
+  });
+}
+
+/**
+* @brief Message parsing, command lookup, reply formatting and JSON extraction.
+*/
+void Benchmark::_benchmarkTelegramBot()
+{
+  TelegramBot &bot = TelegramBot::getInstance();
+  const unsigned long savedLastUpdateId = bot.botLastUpdateId;
+  const TelegramBot::telegram_Message savedLastMessage = bot.botLastMessage;
+  Util::TextBuffer<UPDATE_BUFFER_SIZE> update;
+
+  _measure("telegram_bot_parse_message", BENCHMARK_ITERATIONS, 1, [&bot](uint32_t i) {
+    size_t paramCount;
+    TelegramBot::ParametersArray params = bot._parseMessage("/tank type G 2", paramCount);
+
+    benchmarkSink += paramCount + params[0].length();
+  });
+
+  // Last command of the lookup chain, worst case.
+  const std::string command = COMMAND_METRICS_STR;
+  _measure("telegram_bot_find_command", BENCHMARK_ITERATIONS, 1, [&bot, &command](uint32_t i) {
+    benchmarkSink += bot._findCommand(command);
+  });
+
+  const std::string chatId = std::to_string(BENCHMARK_FIRST_USER_ID);
+  _measure("telegram_bot_format_reply", BENCHMARK_ITERATIONS, 1, [&bot, &chatId](uint32_t i) {
+    bot._beginMessage(chatId);
+    bot.botReply.Format(TANK_COMMAND_TYPE_RESPONSE_STR, TankCatalogue::getName(TANK_G), 2.5f);
+    benchmarkSink += bot.botReply.Length();
+  });
+
+  buildUpdateResponse(update, 2, COMMAND_TANK_STATUS_STR);
+  const std::string response = update.c_str();
+  _measure("telegram_bot_get_message_from_response", BENCHMARK_ITERATIONS / 10, 1, [&bot, &response](uint32_t i) {
+    bot.botLastUpdateId = 1;
+    benchmarkSink += bot._getMessageFromResponse(&bot.botLastMessage, response);
+  });
+
+  bot.botLastUpdateId = savedLastUpdateId;
+  bot.botLastMessage = savedLastMessage;
+}
+
+/**
+* @brief Receive path poll with no pending data, as run on every superloop
+*        iteration while waiting for the ESP32.
+*/
+void Benchmark::_benchmarkWifiCom()
+{
+  Drivers::WifiCom &wifi = Drivers::WifiCom::getInstance();
+  std::string response;
+
+  _measure("wifi_com_receive_poll", BENCHMARK_ITERATIONS, 1, [&wifi, &response](uint32_t i) {
+    wifi._receive();
+    benchmarkSink += wifi._isResponseCompleted(&response);
+  });
+}
+
+/**
+* @brief Alert to BENCHMARK_BROADCAST_USERS users: recipients list, message,
+*        a partial failure and the retry, without the UART transfer.
+*/
+void Benchmark::_scenarioBroadcast()
+{
+  TelegramBot &bot = TelegramBot::getInstance();
+  const TelegramBot::UsersArray savedUsers = bot.userId;
+  const int savedUserCount = bot.userCount;
+  std::string firstResults;
+  std::string retryResults;
+
+  bot.userCount = BENCHMARK_BROADCAST_USERS;
+  for (size_t i = 0; i < BENCHMARK_BROADCAST_USERS; i++) {
+    bot.userId[i] = std::to_string(BENCHMARK_FIRST_USER_ID + i);
+
+    if (i != 0) {
+      firstResults += LIST_SEPARATOR_CHAR;
+    }
+    firstResults += ((i % 3) == 0) ? RESULT_ERROR : RESULT_OK;
+  }
+  for (size_t i = 0; i < BENCHMARK_BROADCAST_USERS; i += 3) {
+    if (i != 0) {
+      retryResults += LIST_SEPARATOR_CHAR;
+    }
+    retryResults += RESULT_OK;
+  }
+
+  _measure("scenario_broadcast_10_users", BENCHMARK_SCENARIO_ITERATIONS, 1, [&bot, &firstResults, &retryResults](uint32_t i) {
+    std::string recipients;
+
+    bot._prepareBroadcast();
+
+    bot._getPendingRecipients(recipients);
+    bot._beginBroadcastMessage();
+    bot.botReply.Append(ALERT_TANK_EMPTY);
+    bot.botReply.Append('\n');
+    bot._updateBroadcastResults(firstResults);
+
+    bot._getPendingRecipients(recipients);
+    bot._beginBroadcastMessage();
+    bot.botReply.Append(ALERT_TANK_EMPTY);
+    bot.botReply.Append('\n');
+    benchmarkSink += bot._updateBroadcastResults(retryResults);
+  });
+
+  bot.userId = savedUsers;
+  bot.userCount = savedUserCount;
+}
+
+/**
+* @brief Burst of BENCHMARK_STATUS_BURST /status requests from a registered user,
+*        from the raw getUpdates answer to the reply, without the UART transfer.
+*/
+void Benchmark::_scenarioStatusBurst()
+{
+  TelegramBot &bot = TelegramBot::getInstance();
+  const TelegramBot::UsersArray savedUsers = bot.userId;
+  const int savedUserCount = bot.userCount;
+  const unsigned long savedLastUpdateId = bot.botLastUpdateId;
+  const TelegramBot::telegram_Message savedLastMessage = bot.botLastMessage;
+  static Util::TextBuffer<UPDATE_BUFFER_SIZE> update;
+
+  bot.userCount = 1;
+  bot.userId[0] = std::to_string(BENCHMARK_FIRST_USER_ID);
+
+  _measure("scenario_status_burst_100", BENCHMARK_SCENARIO_ITERATIONS, BENCHMARK_STATUS_BURST, [&bot](uint32_t i) {
+    bot.botLastUpdateId = 1;
+
+    for (int32_t request = 0; request < BENCHMARK_STATUS_BURST; request++) {
+      size_t paramCount;
+
+      update.Clear();
+      buildUpdateResponse(update, request + 2, COMMAND_TANK_STATUS_STR);
+
+      if (!bot._getMessageFromResponse(&bot.botLastMessage, update.c_str())) {
+        continue;
+      }
+
+      TelegramBot::ParametersArray params = bot._parseMessage(bot.botLastMessage.message, paramCount);
+      bot._beginMessage(bot.botLastMessage.fromId);
+
+      if (bot._isUserIdValid(bot.botLastMessage.fromId)) {
+        const command_t command = bot._findCommand(params[0]);
+
+        if (command != ERROR_INVALID_COMMAND) {
+          (bot.*(bot.functionsArray[command]))(params, paramCount);
+        }
+      }
+
+      benchmarkSink += bot.botReply.Length();
+    }
+  });
+
+  bot.userId = savedUsers;
+  bot.userCount = savedUserCount;
+  bot.botLastUpdateId = savedLastUpdateId;
+  bot.botLastMessage = savedLastMessage;
+}
+
+/**
+* @brief Fill answers of growing size from the ESP32, over the UART at the rate
+*        negotiated by the handshake: sustained throughput and latency per size.
+*
+* Needs the ESP32. Skipped if it doesn't answer, the link is brought up again
+* afterwards.
+*/
+void Benchmark::_scenarioUartThroughput()
+{
+  static const uint32_t payloadSizes[] = { 64, 512, 2048, 4096 };
+  Drivers::WifiCom &wifi = Drivers::WifiCom::getInstance();
+  Util::Delay timeout(BENCHMARK_UART_TIMEOUT);
+  std::string response;
+
+  // Handshake, up to the rate negotiation and the status check at the new rate.
+  while (((wifi.wifiState < Drivers::WifiCom::CMD_CONNECT_SEND) || wifi.wifiIsBaudVerifying) && !timeout.HasFinished()) {
+    wifi.update();
+  }
+
+  if ((wifi.wifiState < Drivers::WifiCom::CMD_CONNECT_SEND) || wifi.wifiIsBaudVerifying) {
+    return;
+  }
+
+  for (const uint32_t payloadSize : payloadSizes) {
+    const std::string command = std::string(COMMAND_FILL_STR) + PARAM_SEPARATOR_CHAR + std::to_string(payloadSize) + STOP_CHAR;
+    Util::TextBuffer<32> name;
+    Util::cycles_t best = UINT32_MAX;
+    uint64_t total = 0;
+    uint32_t iterations = 0;
+
+    for (; iterations < BENCHMARK_SCENARIO_ITERATIONS; iterations++) {
+      bool isResponseCompleted = false;
+      const Util::cycles_t start = Util::CycleCounter::Get();
+
+      wifi._sendCommand(command.c_str());
+      timeout.Restart(BENCHMARK_UART_TIMEOUT);
+      while (!isResponseCompleted && !timeout.HasFinished()) {
+        wifi._transmit();
+        wifi._receive();
+        isResponseCompleted = wifi._isResponseCompleted(&response);
+      }
+
+      const Util::cycles_t elapsed = Util::CycleCounter::Get() - start;
+
+      if (!isResponseCompleted || (response.length() != payloadSize)) {
+        break;
+      }
+
+      total += elapsed;
+      if (elapsed < best) {
+        best = elapsed;
+      }
+    }
+
+    if (iterations == 0) {
+      break;
+    }
+
+    name.Append("uart_fill_");
+    name.AppendInt((int32_t) payloadSize);
+    _printThroughput(name.c_str(), iterations, payloadSize, wifi.getBaudRate(), total, best);
+  }
+
+  wifi.wifiState = Drivers::WifiCom::INIT;
+}
+
+//=====[Implementations of private functions]==================================
+
+/**
+* @brief Writes a getUpdates answer holding a single text message, as sent by
+*        the ESP32, from the first benchmark user.
+*/
+static void buildUpdateResponse(Util::TextWriter &writer, int32_t updateId, const char *text)
+{
+  writer.Append("{\"ok\":true,\"result\":[{\"update_id\":");
+  writer.AppendInt(updateId);
+  writer.Append(",\"message\":{\"message_id\":");
+  writer.AppendInt(updateId);
+  writer.Append(",\"from\":{\"id\":");
+  writer.AppendInt((int32_t) BENCHMARK_FIRST_USER_ID);
+  writer.Append(",\"is_bot\":false,\"first_name\":\"Bench\",\"username\":\"bench\"},\"chat\":{\"id\":");
+  writer.AppendInt((int32_t) BENCHMARK_FIRST_USER_ID);
+  writer.Append(",\"type\":\"private\"},\"date\":0,\"text\":\"");
+  writer.Append(text);
+  writer.Append("\"}}]}");
+}
+
+} // namespace Module
+
+#endif // BENCHMARK_ENABLED
@@ -0,0 +1,107 @@
+/********************************************************************************
+ * @file benchmark.h
+ * @brief On-target benchmarks of the modules hot paths.
+ * @author Gonzalo Puy
+ * @date Jun 2025
+ *******************************************************************************/
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+/**
+ * @brief Build the benchmarks in. Define as 1 (e.g. in mbed_app.json macros)
+ *        to run them once at startup.
+ */
+#ifndef BENCHMARK_ENABLED
+#define BENCHMARK_ENABLED 0
+#endif
+
+#if BENCHMARK_ENABLED
+
+#include <stddef.h>
+#include <stdint.h>
+#include "profiler.h"
+
+//=========================[Module Defines]=====================================
+
+#define BENCHMARK_ITERATIONS            1000    /**< Iterations of every micro benchmark. */
+#define BENCHMARK_SCENARIO_ITERATIONS   10      /**< Iterations of every end to end scenario. */
+#define BENCHMARK_BROADCAST_USERS       10      /**< Users of the broadcast scenario. */
+#define BENCHMARK_STATUS_BURST          100     /**< /status requests of the burst scenario. */
+#define BENCHMARK_FLEET_SIZE            1024    /**< Tanks of the estimation kernel benchmarks. */
+#define BENCHMARK_UART_TIMEOUT          5000    /**< Wait for the ESP32 handshake, and for each fill answer [ms]. */
+
+namespace Module {
+
+  /**
+   * @class Benchmark
+   * @brief Runs micro benchmarks and end to end scenarios of the modules hot paths.
+   *
+   * Results are printed over the debug UART as a single JSON document, so runs can
+   * be compared to catch regressions. Modules must be initialized before run() and
+   * their state is restored afterwards.
+   */
+  class Benchmark
+  {
+    public:
+
+      /**
+      * @brief Runs every benchmark and prints the results.
+      */
+      static void run();
+
+    private:
+
+      Benchmark() {};
+      ~Benchmark() = default;
+      Benchmark(const Benchmark&) = delete;
+      Benchmark& operator=(const Benchmark&) = delete;
+
+      /**
+      * @brief Times a benchmark and prints its result.
+      * @param name Benchmark name, as printed in the results.
+      * @param iterations Number of times body is run.
+      * @param operations Operations done by a single run of body.
+      * @param body Callable to time.
+      */
+      template <typename Body>
+      static void _measure(const char *name, uint32_t iterations, uint32_t operations, Body body)
+      {
+        Util::cycles_t best = UINT32_MAX;
+        uint64_t total = 0;
+
+        for (uint32_t i = 0; i < iterations; i++) {
+          const Util::cycles_t start = Util::CycleCounter::Get();
+          body(i);
+          const Util::cycles_t elapsed = Util::CycleCounter::Get() - start;
+
+          total += elapsed;
+          if (elapsed < best) {
+            best = elapsed;
+          }
+        }
+
+        _printResult(name, iterations, operations, total, best);
+      }
+
+      static void _printResult(const char *name, uint32_t iterations, uint32_t operations, uint64_t total, Util::cycles_t best);
+
+      static void _printThroughput(const char *name, uint32_t iterations, uint32_t payloadSize, int baudRate, uint64_t total, Util::cycles_t best);
+
+      static void _benchmarkPressureGauge();
+      static void _benchmarkTankMonitor();
+      static void _benchmarkTankEstimator();
+      static void _benchmarkTelegramBot();
+      static void _benchmarkWifiCom();
+      static void _scenarioBroadcast();
+      static void _scenarioStatusBurst();
+      static void _scenarioUartThroughput();
+
+      static bool isFirstResult;    /**< Used to separate results in the JSON output. */
+  };
+
+} // namespace Module
+
+#endif // BENCHMARK_ENABLED
+
+#endif // BENCHMARK_H
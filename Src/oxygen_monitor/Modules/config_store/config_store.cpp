@@ -0,0 +1,229 @@
+/****************************************************************************//**
+ * @file config_store.cpp
+ * @author Gonzalo Puy.
+ * @date Jun 2025
+ * @brief Persistent configuration module. Implemented with singleton design
+          pattern in order to ensure only one instance of the object ConfigStore.
+
+ *******************************************************************************/
+
+#include <stddef.h>
+#include <string.h>
+#include <string>
+#include "config_store.h"
+#include "crc.h"
+#include "logger.h"
+#include "metrics.h"
+#include "telegram_bot.h"
+#include "telemetry.h"
+#include "wifi_com.h"
+
+//=====[Declaration and initialization of private global variables]==============
+
+static Drivers::FlashStorage config_flash;    /**< FlashStorage instance. */
+
+static const size_t CONFIG_CRC_OFFSET = offsetof(config_record_t, crc);
+static const size_t CONFIG_PAYLOAD_OFFSET = offsetof(config_record_t, tank);
+static const size_t CONFIG_PAYLOAD_SIZE = CONFIG_CRC_OFFSET - CONFIG_PAYLOAD_OFFSET;
+
+static_assert(CONFIG_MAX_USERS >= MAX_USER_COUNT, "Config record can't hold every Telegram user");
+
+//=====[Implementations of public methods]=======================================
+
+namespace Module {
+
+  void ConfigStore::init()
+  {
+    getInstance()._init();
+  }
+
+  void ConfigStore::update()
+  {
+    Drivers::WifiCom &wifi = Drivers::WifiCom::getInstance();
+
+    if (isHoldRequested) {
+      if (wifi.isHeld()) {
+        isHoldRequested = false;
+        isWriteDue = false;
+        holdAttempts = 0;
+        isDirty = !_save();
+        wifi.resume();
+      } else if (!wifi.isBusy()) {
+        // Refused, asked again on the next pass.
+        isHoldRequested = false;
+        holdAttempts++;
+      }
+      return;
+    }
+
+    if (!isDirty) {
+      return;
+    }
+
+    if (!isWriteDue && writeDelay.HasFinished()) {
+      isWriteDue = true;
+    }
+
+    if (!isWriteAllowed && wearDelay.HasFinished()) {
+      isWriteAllowed = true;
+    }
+
+    if (!isWriteDue || !isWriteAllowed) {
+      return;
+    }
+
+    // Link down: at worst a handshake answer is lost, and it is asked again. Bridge
+    // firmware refusing the hold: written anyway, as it was without it.
+    if (!wifi.isLinkUp() || (holdAttempts >= CONFIG_HOLD_ATTEMPTS)) {
+      isWriteDue = false;
+      holdAttempts = 0;
+      isDirty = !_save();
+    } else if (!wifi.isBusy()) {
+      wifi.hold(CONFIG_WRITE_HOLD_TIME);
+      isHoldRequested = true;
+    }
+  }
+
+  void ConfigStore::requestSave()
+  {
+    isDirty = true;
+    isWriteDue = false;
+    writeDelay.Restart(CONFIG_WRITE_DELAY);
+  }
+
+//=====[Implementations of private methods]======================================
+
+  /**
+  * @brief Internal init function. Restores the stored configuration, if any.
+  */
+  void ConfigStore::_init()
+  {
+    memset(&current, 0, sizeof(current));
+    currentSlot = -1;
+
+    if (config_flash.init() && _load()) {
+      _apply(current);
+      LOG_INFO(LOG_MODULE_SYSTEM, LOG_CONFIG_STORE_RESTORED, (int) current.sequence);
+    }
+
+    // Restoring goes through the same setters as the commands, nothing new to write.
+    isDirty = false;
+    isWriteDue = false;
+    isWriteAllowed = true;
+    isHoldRequested = false;
+    holdAttempts = 0;
+  }
+
+  /**
+  * @brief Finds the current record among the slots.
+  * @return true if a valid record was found and copied into current.
+  */
+  bool ConfigStore::_load()
+  {
+    config_record_t record;
+
+    for (int slot = 0; slot < FLASH_STORAGE_SLOT_COUNT; slot++) {
+      if (!config_flash.read(slot, &record, sizeof(record)) || !_isValid(record)) {
+        continue;
+      }
+
+      // Sequence numbers compared with wrap around.
+      if ((currentSlot < 0) || ((int32_t) (record.sequence - current.sequence) > 0)) {
+        memcpy(&current, &record, sizeof(record));
+        currentSlot = slot;
+      }
+    }
+
+    return (currentSlot >= 0);
+  }
+
+  /**
+  * @brief Writes the configuration to the other slot, if it changed.
+  * @return true if the stored configuration is up to date, false on error.
+  */
+  bool ConfigStore::_save()
+  {
+    config_record_t record;
+    config_record_t check;
+
+    _collect(record);
+
+    if ((currentSlot >= 0) &&
+        (memcmp((const uint8_t*) &record + CONFIG_PAYLOAD_OFFSET, (const uint8_t*) &current + CONFIG_PAYLOAD_OFFSET, CONFIG_PAYLOAD_SIZE) == 0)) {
+      return true;
+    }
+
+    const int slot = (currentSlot == 0) ? 1 : 0;
+
+    record.magic = CONFIG_RECORD_MAGIC;
+    record.version = CONFIG_RECORD_VERSION;
+    record.size = sizeof(config_record_t);
+    record.sequence = current.sequence + 1;
+    record.crc = Util::Crc32::Compute(&record, CONFIG_CRC_OFFSET);
+
+    isWriteAllowed = false;
+    wearDelay.Restart(CONFIG_WRITE_MIN_INTERVAL);
+    Util::Metrics::Increment(METRIC_CONFIG_WRITES);
+
+    if (!config_flash.write(slot, &record, sizeof(record)) ||
+        !config_flash.read(slot, &check, sizeof(check)) ||
+        (memcmp(&record, &check, sizeof(record)) != 0)) {
+      Util::Metrics::Increment(METRIC_CONFIG_WRITE_ERRORS);
+      LOG_ERROR(LOG_MODULE_SYSTEM, LOG_CONFIG_STORE_WRITE_ERROR);
+      return false;
+    }
+
+    memcpy(&current, &record, sizeof(record));
+    currentSlot = slot;
+
+    return true;
+  }
+
+  /**
+  * @brief Builds a record with the configuration of the modules.
+  *
+  * Unused fields and padding are zeroed, so records can be compared as bytes.
+  */
+  void ConfigStore::_collect(config_record_t &record)
+  {
+    memset(&record, 0, sizeof(record));
+
+    TankMonitor::getInstance().getConfig(record.tank);
+
+#if !GATEWAY_MODE
+    TelegramBot &bot = TelegramBot::getInstance();
+
+    record.userCount = (uint32_t) bot.getUserCount();
+    for (uint32_t i = 0; i < record.userCount; i++) {
+      strncpy(record.userId[i], bot.getUserId(i).c_str(), CONFIG_USER_ID_SIZE - 1);
+    }
+#endif
+  }
+
+  /**
+  * @brief Restores the configuration of the modules from a record.
+  */
+  void ConfigStore::_apply(const config_record_t &record)
+  {
+    TankMonitor::getInstance().setConfig(record.tank);
+
+#if !GATEWAY_MODE
+    for (uint32_t i = 0; i < record.userCount; i++) {
+      TelegramBot::getInstance().addUser(std::string(record.userId[i], strnlen(record.userId[i], CONFIG_USER_ID_SIZE)));
+    }
+#endif
+  }
+
+  /**
+  * @brief Checks the header and CRC of a record read from flash.
+  */
+  bool ConfigStore::_isValid(const config_record_t &record)
+  {
+    return (record.magic == CONFIG_RECORD_MAGIC) &&
+           (record.version == CONFIG_RECORD_VERSION) &&
+           (record.size == sizeof(config_record_t)) &&
+           (record.userCount <= CONFIG_MAX_USERS) &&
+           (record.crc == Util::Crc32::Compute(&record, CONFIG_CRC_OFFSET));
+  }
+
+} // namespace Module
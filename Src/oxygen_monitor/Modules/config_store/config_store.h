@@ -0,0 +1,144 @@
+/****************************************************************************//**
+ * @file config_store.h
+ * @author Gonzalo Puy.
+ * @date Jun 2025
+ * @brief Persistent configuration module header file.
+ *
+ * Keeps the pressure unit, the registered tank, the gas flow and the Telegram
+ * users in flash, so the monitor resumes right away after a reset.
+ *******************************************************************************/
+
+#ifndef CONFIG_STORE_H
+#define CONFIG_STORE_H
+
+#include <stdint.h>
+#include "delay.h"
+#include "flash_storage.h"
+#include "tank_monitor.h"
+
+//=========================[Module Defines]=====================================
+
+#define CONFIG_RECORD_MAGIC         0x47464E43   /**< "CNFG" */
+#define CONFIG_RECORD_VERSION       1            /**< Record layout version, records of other versions are ignored. */
+#define CONFIG_MAX_USERS            10           /**< Users kept in the record. */
+#define CONFIG_USER_ID_SIZE         24           /**< Size of a Telegram user ID, terminator included. */
+
+/** @brief Time without changes before they are written [ms]. */
+#ifndef CONFIG_WRITE_DELAY
+#define CONFIG_WRITE_DELAY          DELAY_10_SECONDS
+#endif
+
+/** @brief Minimum time between two flash writes [ms]. Bounds the wear of the slots. */
+#ifndef CONFIG_WRITE_MIN_INTERVAL
+#define CONFIG_WRITE_MIN_INTERVAL   DELAY_1_MINUTE
+#endif
+
+/** @brief Time the ESP32 is asked to send nothing while a slot is erased [ms]. Above
+ *         the worst erase time of a slot, 4 s for a 128 KB sector of the STM32F429. */
+#ifndef CONFIG_WRITE_HOLD_TIME
+#define CONFIG_WRITE_HOLD_TIME      DELAY_5_SECONDS
+#endif
+
+/** @brief Refused holds before a write goes ahead without one. */
+#define CONFIG_HOLD_ATTEMPTS        3
+
+//===========================[Module Types]=====================================
+
+/**
+ * @struct config_record_t
+ * @brief Configuration record as stored in a flash slot.
+ */
+typedef struct config_record {
+  uint32_t magic;                                         /**< CONFIG_RECORD_MAGIC. */
+  uint16_t version;                                       /**< CONFIG_RECORD_VERSION. */
+  uint16_t size;                                          /**< sizeof(config_record_t). */
+  uint32_t sequence;                                      /**< Incremented on every write, the highest one is current. */
+  tank_config_t tank;                                     /**< Unit and tank configuration. */
+  uint32_t userCount;                                     /**< Number of registered users. */
+  char userId[CONFIG_MAX_USERS][CONFIG_USER_ID_SIZE];     /**< Registered Telegram user IDs. */
+  uint32_t crc;                                           /**< CRC-32 of everything before it. */
+} config_record_t;
+
+namespace Module {
+
+  /**
+  * @class ConfigStore
+  * @brief Singleton class that persists the configuration in two flash slots.
+  *
+  * Every write goes to the slot not holding the current record, with a higher
+  * sequence number and the CRC programmed last. A write interrupted by a power
+  * loss leaves an invalid record and the previous one is still found at boot.
+  *
+  * Modules call requestSave() on every change. Changes are written once they
+  * settle for CONFIG_WRITE_DELAY, at most once per CONFIG_WRITE_MIN_INTERVAL,
+  * and only if the configuration differs from the stored one.
+  *
+  * The erase stalls the CPU and the ESP32 UART is polled, so while the link is
+  * up the ESP32 is first asked to hold its transmissions.
+  */
+  class ConfigStore {
+
+  public:
+
+    /**
+    * @brief Gets the singleton instance of the ConfigStore.
+    * @return Reference to the ConfigStore instance.
+    */
+    static ConfigStore& getInstance(){
+      static ConfigStore instance;
+
+      return instance;
+    }
+
+    ConfigStore(const ConfigStore&) = delete;
+    ConfigStore& operator=(const ConfigStore&) = delete;
+
+    /**
+    * @brief Initializes the module and restores the stored configuration.
+    *
+    * Must be called after the modules it restores are initialized.
+    */
+    static void init();
+
+    /**
+    * @brief Writes pending changes when due.
+    *
+    * This method should be called regularly in the main loop.
+    */
+    void update();
+
+    /**
+    * @brief Signals that the configuration changed.
+    */
+    void requestSave();
+
+  private:
+
+    ConfigStore()
+    : writeDelay(CONFIG_WRITE_DELAY)
+    , wearDelay(CONFIG_WRITE_MIN_INTERVAL)
+    {};
+    ~ConfigStore() = default;
+
+    void _init();
+    bool _load();
+    bool _save();
+    void _collect(config_record_t &record);
+    void _apply(const config_record_t &record);
+    bool _isValid(const config_record_t &record);
+
+    config_record_t current;        /**< Last record written or restored. */
+    int currentSlot;                /**< Slot holding current, -1 if none. */
+    bool isDirty;                   /**< Changes are waiting to be written. */
+    bool isWriteDue;                /**< Changes settled for CONFIG_WRITE_DELAY. */
+    bool isWriteAllowed;            /**< CONFIG_WRITE_MIN_INTERVAL elapsed since the last write. */
+    bool isHoldRequested;           /**< Waiting for the ESP32 to hold its transmissions. */
+    int holdAttempts;               /**< Consecutive holds refused by the ESP32. */
+    Util::Delay writeDelay;         /**< Settle time of the changes. */
+    Util::Delay wearDelay;          /**< Minimum time between writes. */
+
+  }; // class ConfigStore
+
+} // namespace Module
+
+#endif // CONFIG_STORE_H
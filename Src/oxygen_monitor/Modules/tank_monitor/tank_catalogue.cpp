@@ -0,0 +1,172 @@
+/****************************************************************************//**
+ * @file tank_catalogue.cpp
+ * @author Gonzalo Puy.
+ * @date Jun 2025
+ * @brief Tank type catalogue.
+ *******************************************************************************/
+
+#include <string.h>
+#include "tank_catalogue.h"
+#include "crc.h"
+
+//=====[Declaration and initialization of private global variables]==============
+
+#define TANK_ENTRY_FACTOR_BAR(id, name, factorBar, factorPsi, residualBar, residualPsi, capacity)   factorBar,
+#define TANK_ENTRY_FACTOR_PSI(id, name, factorBar, factorPsi, residualBar, residualPsi, capacity)   factorPsi,
+#define TANK_ENTRY_RESIDUAL_BAR(id, name, factorBar, factorPsi, residualBar, residualPsi, capacity) residualBar,
+#define TANK_ENTRY_RESIDUAL_PSI(id, name, factorBar, factorPsi, residualBar, residualPsi, capacity) residualPsi,
+#define TANK_ENTRY_CAPACITY(id, name, factorBar, factorPsi, residualBar, residualPsi, capacity)     capacity,
+#define TANK_ENTRY_NAME(id, name, factorBar, factorPsi, residualBar, residualPsi, capacity)         name,
+#define TANK_ENTRY_COUNT(id, name, factorBar, factorPsi, residualBar, residualPsi, capacity)        + 1
+
+#define BUILTIN_FACTORS     { { TANK_CATALOGUE(TANK_ENTRY_FACTOR_BAR) }, { TANK_CATALOGUE(TANK_ENTRY_FACTOR_PSI) } }
+#define BUILTIN_RESIDUALS   { { TANK_CATALOGUE(TANK_ENTRY_RESIDUAL_BAR) }, { TANK_CATALOGUE(TANK_ENTRY_RESIDUAL_PSI) } }
+#define BUILTIN_CAPACITIES  { TANK_CATALOGUE(TANK_ENTRY_CAPACITY) }
+#define BUILTIN_NAMES       { TANK_CATALOGUE(TANK_ENTRY_NAME) }
+#define BUILTIN_COUNT       (0 TANK_CATALOGUE(TANK_ENTRY_COUNT))
+
+static_assert(BUILTIN_COUNT <= TANK_CATALOGUE_MAX, "Built-in tank catalogue too large");
+
+static constexpr float BUILTIN_FACTOR_TABLE[TANK_UNIT_COUNT][TANK_TYPE_COUNT] = BUILTIN_FACTORS;
+static constexpr float BUILTIN_RESIDUAL_TABLE[TANK_UNIT_COUNT][TANK_TYPE_COUNT] = BUILTIN_RESIDUALS;
+static constexpr float BUILTIN_CAPACITY_TABLE[TANK_TYPE_COUNT] = BUILTIN_CAPACITIES;
+static constexpr char BUILTIN_NAME_TABLE[TANK_TYPE_COUNT][TANK_NAME_SIZE] = BUILTIN_NAMES;
+
+static const size_t BLOB_HEADER_SIZE = 8;
+static const size_t BLOB_TANK_SIZE = TANK_NAME_SIZE + (5 * sizeof(float));
+static const size_t BLOB_ALIAS_SIZE = TANK_NAME_SIZE + 1;
+static const size_t BLOB_CRC_SIZE = sizeof(uint32_t);
+
+namespace Module {
+
+  float TankCatalogue::factors[TANK_UNIT_COUNT][TANK_TYPE_COUNT] = BUILTIN_FACTORS;
+  float TankCatalogue::residuals[TANK_UNIT_COUNT][TANK_TYPE_COUNT] = BUILTIN_RESIDUALS;
+  float TankCatalogue::capacities[TANK_TYPE_COUNT] = BUILTIN_CAPACITIES;
+  char TankCatalogue::names[TANK_TYPE_COUNT][TANK_NAME_SIZE] = BUILTIN_NAMES;
+  size_t TankCatalogue::count = BUILTIN_COUNT;
+
+  /**
+  * @brief Lookup table of the built-in names and aliases, built at compile time.
+  */
+  constexpr tank_lookup_t TankCatalogue::_builtinLookup()
+  {
+    tank_lookup_t table = {};
+
+#define TANK_INSERT_NAME(id, name, factorBar, factorPsi, residualBar, residualPsi, capacity) _insert(table, name, TANK_##id);
+#define TANK_INSERT_ALIAS(alias, id) _insert(table, alias, TANK_##id);
+    TANK_CATALOGUE(TANK_INSERT_NAME)
+    TANK_ALIASES(TANK_INSERT_ALIAS)
+#undef TANK_INSERT_NAME
+#undef TANK_INSERT_ALIAS
+
+    return table;
+  }
+
+  tank_lookup_t TankCatalogue::lookup = _builtinLookup();
+
+//=====[Implementations of public methods]=======================================
+
+  void TankCatalogue::reset()
+  {
+    memcpy(factors, BUILTIN_FACTOR_TABLE, sizeof(factors));
+    memcpy(residuals, BUILTIN_RESIDUAL_TABLE, sizeof(residuals));
+    memcpy(capacities, BUILTIN_CAPACITY_TABLE, sizeof(capacities));
+    memcpy(names, BUILTIN_NAME_TABLE, sizeof(names));
+    lookup = _builtinLookup();
+    count = BUILTIN_COUNT;
+  }
+
+  bool TankCatalogue::load(const uint8_t *blob, size_t size)
+  {
+    uint32_t magic;
+    uint32_t crc;
+
+    if ((blob == nullptr) || (size < BLOB_HEADER_SIZE + BLOB_CRC_SIZE)) return false;
+
+    memcpy(&magic, blob, sizeof(magic));
+    const uint8_t version = blob[4];
+    const uint8_t tankCount = blob[5];
+    const uint8_t aliasCount = blob[6];
+
+    if ((magic != TANK_CATALOGUE_MAGIC) || (version != TANK_CATALOGUE_VERSION)) return false;
+    if ((tankCount == 0) || (tankCount > TANK_CATALOGUE_MAX) || (aliasCount > TANK_ALIAS_MAX)) return false;
+
+    const uint8_t *tanks = blob + BLOB_HEADER_SIZE;
+    const uint8_t *aliases = tanks + (tankCount * BLOB_TANK_SIZE);
+    const size_t length = (size_t) ((aliases + (aliasCount * BLOB_ALIAS_SIZE)) - blob);
+
+    if (length + BLOB_CRC_SIZE > size) return false;
+
+    memcpy(&crc, blob + length, sizeof(crc));
+    if (Util::Crc32::Compute(blob, length) != crc) return false;
+
+    // Names must be terminated and values positive before anything is replaced.
+    for (size_t i = 0; i < tankCount; i++) {
+      const uint8_t *record = tanks + (i * BLOB_TANK_SIZE);
+      float values[5];
+
+      memcpy(values, record + TANK_NAME_SIZE, sizeof(values));
+      if (memchr(record, '\0', TANK_NAME_SIZE) == nullptr) return false;
+      for (float value : values) {
+        if (!(value >= 0)) return false;
+      }
+    }
+
+    for (size_t i = 0; i < aliasCount; i++) {
+      const uint8_t *record = aliases + (i * BLOB_ALIAS_SIZE);
+
+      if ((memchr(record, '\0', TANK_NAME_SIZE) == nullptr) || (record[TANK_NAME_SIZE] >= tankCount)) return false;
+    }
+
+    memset(factors, 0, sizeof(factors));
+    memset(residuals, 0, sizeof(residuals));
+    memset(capacities, 0, sizeof(capacities));
+    memset(names, 0, sizeof(names));
+    lookup = tank_lookup_t();
+    count = tankCount;
+
+    for (size_t type = 0; type < tankCount; type++) {
+      const uint8_t *record = tanks + (type * BLOB_TANK_SIZE);
+      float values[5];
+
+      memcpy(names[type], record, TANK_NAME_SIZE);
+      memcpy(values, record + TANK_NAME_SIZE, sizeof(values));
+      factors[TANK_UNIT_BAR][type] = values[0];
+      factors[TANK_UNIT_PSI][type] = values[1];
+      residuals[TANK_UNIT_BAR][type] = values[2];
+      residuals[TANK_UNIT_PSI][type] = values[3];
+      capacities[type] = values[4];
+
+      if (!_insert(lookup, names[type], (uint8_t) type)) {
+        reset();
+        return false;
+      }
+    }
+
+    for (size_t i = 0; i < aliasCount; i++) {
+      const uint8_t *record = aliases + (i * BLOB_ALIAS_SIZE);
+
+      if (!_insert(lookup, (const char*) record, record[TANK_NAME_SIZE])) {
+        reset();
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+  tank_type_t TankCatalogue::find(const char *name)
+  {
+    if ((name == nullptr) || (name[0] == '\0')) return TANK_TYPE_NONE;
+
+    for (uint32_t probe = 0, slot = _hash(name); probe < TANK_LOOKUP_SIZE; probe++, slot++) {
+      const char *key = lookup.key[slot & (TANK_LOOKUP_SIZE - 1)];
+
+      if (key[0] == '\0') break;
+      if (_equals(key, name)) return (tank_type_t) lookup.type[slot & (TANK_LOOKUP_SIZE - 1)];
+    }
+
+    return TANK_TYPE_NONE;
+  }
+
+} // namespace Module
@@ -0,0 +1,236 @@
+/****************************************************************************//**
+ * @file tank_catalogue.h
+ * @author Gonzalo Puy.
+ * @date Jun 2025
+ * @brief Tank type catalogue header file.
+ *
+ * Names, aliases, capacity factors, residual pressures and nominal capacities of
+ * the supported tank types. The built-in catalogue comes from TANK_CATALOGUE and
+ * may be replaced by a regional one stored in flash. Like tank_types.h, it has no
+ * Mbed dependencies.
+ *******************************************************************************/
+
+#ifndef TANK_CATALOGUE_H
+#define TANK_CATALOGUE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "tank_types.h"
+
+//=========================[Module Defines]=====================================
+
+#define TANK_NAME_SIZE             8            /**< Size of a tank name or alias, terminator included. */
+#define TANK_ALIAS_MAX             16           /**< Maximum aliases of a catalogue. */
+#define TANK_LOOKUP_SIZE           64           /**< Name lookup slots, a power of two at least twice the names. */
+
+#define TANK_CATALOGUE_MAGIC       0x54414354   /**< "TCAT" */
+#define TANK_CATALOGUE_VERSION     1            /**< Catalogue blob layout version. */
+
+/**
+ * @brief Address of a catalogue blob in flash. Define it (e.g. in mbed_app.json
+ *        macros) to load a regional catalogue at init; 0 keeps the built-in one.
+ */
+#ifndef TANK_CATALOGUE_FLASH_ADDRESS
+#define TANK_CATALOGUE_FLASH_ADDRESS    0
+#endif
+
+#ifndef TANK_CATALOGUE_FLASH_SIZE
+#define TANK_CATALOGUE_FLASH_SIZE       1024    /**< Size of the flash area holding the blob. */
+#endif
+
+static_assert(TANK_LOOKUP_SIZE >= 2 * (TANK_CATALOGUE_MAX + TANK_ALIAS_MAX), "Tank lookup table too small");
+static_assert((TANK_LOOKUP_SIZE & (TANK_LOOKUP_SIZE - 1)) == 0, "Tank lookup size must be a power of two");
+
+//===========================[Module Types]=====================================
+
+/**
+ * @struct tank_lookup_t
+ * @brief Open addressing table from upper case names and aliases to tank types.
+ */
+typedef struct tank_lookup {
+  char key[TANK_LOOKUP_SIZE][TANK_NAME_SIZE];   /**< Upper case name, empty if the slot is free. */
+  uint8_t type[TANK_LOOKUP_SIZE];               /**< tank_type_t of the name. */
+} tank_lookup_t;
+
+namespace Module {
+
+  /**
+  * @class TankCatalogue
+  * @brief Active tank catalogue, with case insensitive name lookup.
+  *
+  * Factors and residuals are kept as tables indexed by unit and type, so
+  * TankEstimator can gather them for a whole batch. Rows of TANK_UNIT_UNKNOWN,
+  * TANK_TYPE_NONE and types past the end of the catalogue are 0.
+  *
+  * A catalogue blob is little endian and laid out as:
+  *   - header: magic (uint32), version (uint8), tank count (uint8), alias count (uint8), reserved (uint8).
+  *   - tank count records: name (char[TANK_NAME_SIZE]), factor [L/bar], factor [L/psi],
+  *     residual [bar], residual [psi] and nominal capacity [L], all float.
+  *   - alias count records: name (char[TANK_NAME_SIZE]), type (uint8).
+  *   - CRC-32 (uint32) of everything before it.
+  * Tank records take the types from 0 onwards, in order.
+  */
+  class TankCatalogue {
+
+  public:
+
+    /**
+    * @brief Restores the built-in catalogue.
+    */
+    static void reset();
+
+    /**
+    * @brief Replaces the catalogue with the one of a blob.
+    *
+    * The blob is fully validated first. If it is not valid the catalogue in use is
+    * kept; if its names clash the built-in catalogue is restored.
+    *
+    * @param blob Catalogue blob, e.g. memory mapped flash.
+    * @param size Bytes available at blob.
+    * @return true if the blob catalogue is now in use, false otherwise.
+    */
+    static bool load(const uint8_t *blob, size_t size);
+
+    /**
+    * @brief Finds a tank type by name or alias, ignoring case.
+    * @param name Null terminated name.
+    * @return tank_type_t Type of the name, or TANK_TYPE_NONE if unknown.
+    */
+    static tank_type_t find(const char *name);
+
+    /**
+    * @brief Name of a tank type.
+    * @return const char* Name, or an empty string if the type is not in the catalogue.
+    */
+    static const char* getName(uint8_t type)
+    {
+      return names[(type < TANK_TYPE_COUNT) ? type : (uint8_t) TANK_TYPE_NONE];
+    }
+
+    /**
+    * @brief Number of tank types of the catalogue.
+    */
+    static size_t getCount()
+    {
+      return count;
+    }
+
+    /**
+    * @brief Capacity factor [L/unit] of a tank type, 0 if unknown.
+    */
+    static float getFactor(uint8_t unit, uint8_t type)
+    {
+      return factors[unit][type];
+    }
+
+    /**
+    * @brief Residual pressure of a tank type in the given unit, 0 if unknown.
+    */
+    static float getResidual(uint8_t unit, uint8_t type)
+    {
+      return residuals[unit][type];
+    }
+
+    /**
+    * @brief Volume of gas [L] of a full tank of the given type, 0 if unknown.
+    */
+    static float getNominalCapacity(uint8_t type)
+    {
+      return capacities[type];
+    }
+
+    /**
+    * @brief Factor table, TANK_UNIT_COUNT rows of TANK_TYPE_COUNT floats.
+    */
+    static const float* getFactorTable()
+    {
+      return &factors[0][0];
+    }
+
+    /**
+    * @brief Residual table, TANK_UNIT_COUNT rows of TANK_TYPE_COUNT floats.
+    */
+    static const float* getResidualTable()
+    {
+      return &residuals[0][0];
+    }
+
+  private:
+
+    TankCatalogue() {};
+    ~TankCatalogue() = default;
+    TankCatalogue(const TankCatalogue&) = delete;
+    TankCatalogue& operator=(const TankCatalogue&) = delete;
+
+    static constexpr char _toUpper(char c)
+    {
+      return ((c >= 'a') && (c <= 'z')) ? (char) (c - 'a' + 'A') : c;
+    }
+
+    /**
+    * @brief FNV-1a hash of the upper case name.
+    */
+    static constexpr uint32_t _hash(const char *name)
+    {
+      uint32_t hash = 2166136261u;
+
+      for (size_t i = 0; name[i] != '\0'; i++) {
+        hash = (hash ^ (uint8_t) _toUpper(name[i])) * 16777619u;
+      }
+
+      return hash;
+    }
+
+    static constexpr bool _equals(const char *key, const char *name)
+    {
+      size_t i = 0;
+
+      for (; (i < TANK_NAME_SIZE) && (name[i] != '\0'); i++) {
+        if (key[i] != _toUpper(name[i])) return false;
+      }
+
+      return (i < TANK_NAME_SIZE) && (key[i] == '\0');
+    }
+
+    /**
+    * @brief Adds a name to a lookup table.
+    * @return false if the name is empty, too long, already there or the table is full.
+    */
+    static constexpr bool _insert(tank_lookup_t &table, const char *name, uint8_t type)
+    {
+      size_t length = 0;
+
+      while (name[length] != '\0') length++;
+      if ((length == 0) || (length >= TANK_NAME_SIZE)) return false;
+
+      for (uint32_t probe = 0, slot = _hash(name); probe < TANK_LOOKUP_SIZE; probe++, slot++) {
+        char *key = table.key[slot & (TANK_LOOKUP_SIZE - 1)];
+
+        if (key[0] == '\0') {
+          for (size_t i = 0; i < length; i++) {
+            key[i] = _toUpper(name[i]);
+          }
+          table.type[slot & (TANK_LOOKUP_SIZE - 1)] = type;
+          return true;
+        }
+
+        if (_equals(key, name)) return false;
+      }
+
+      return false;
+    }
+
+    static constexpr tank_lookup_t _builtinLookup();
+
+    static float factors[TANK_UNIT_COUNT][TANK_TYPE_COUNT];    /**< Capacity factor [L/unit] per unit and type. */
+    static float residuals[TANK_UNIT_COUNT][TANK_TYPE_COUNT];  /**< Residual pressure per unit and type. */
+    static float capacities[TANK_TYPE_COUNT];                  /**< Nominal capacity [L] per type. */
+    static char names[TANK_TYPE_COUNT][TANK_NAME_SIZE];        /**< Name per type. */
+    static tank_lookup_t lookup;                               /**< Names and aliases to types. */
+    static size_t count;                                       /**< Number of tank types. */
+
+  }; // class TankCatalogue
+
+} // namespace Module
+
+#endif // TANK_CATALOGUE_H
@@ -0,0 +1,116 @@
+/****************************************************************************//**
+ * @file tank_estimator.cpp
+ * @author Gonzalo Puy.
+ * @date Jun 2025
+ * @brief Branch-free tank estimation kernel.
+ *******************************************************************************/
+
+#include "tank_estimator.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace Module {
+
+//=====[Declaration and initialization of private global variables]==============
+
+  constexpr float TankEstimator::THRESHOLDS[TANK_UNIT_COUNT];
+
+//=====[Implementations of public methods]=======================================
+
+  void TankEstimator::estimate(const tank_batch_t &batch)
+  {
+    size_t i = _estimateVector(batch);
+
+    for (; i < batch.count; i++) {
+      batch.timeLeft[i] = getTimeLeft(batch.pressure[i], batch.gasFlow[i], batch.capacity[i], batch.type[i], batch.unit[i]);
+      batch.state[i] = (uint8_t) getState(batch.pressure[i], batch.unit[i]);
+    }
+  }
+
+//=====[Implementations of private methods]======================================
+
+#if defined(__AVX2__)
+
+  /**
+  * @brief AVX2 kernel, eight tanks per iteration.
+  * @return size_t Number of tanks done, the rest is left to the scalar loop.
+  */
+  size_t TankEstimator::_estimateVector(const tank_batch_t &batch)
+  {
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 minusOne = _mm256_set1_ps(-1.0f);
+    const __m256 bigCapacity = _mm256_set1_ps(BIG_TANK_CAPACITY);
+    const __m256 bigResidual = _mm256_set1_ps(BIG_TANK_RESIDUAL_BAR);
+    const __m256 smallResidual = _mm256_set1_ps(SMALL_TANK_RESIDUAL_BAR);
+    const __m256i typeNone = _mm256_set1_epi32(TANK_TYPE_NONE);
+    const __m256i unitBar = _mm256_set1_epi32(TANK_UNIT_BAR);
+    const __m256i unitUnknown = _mm256_set1_epi32(TANK_UNIT_UNKNOWN);
+    const __m256i typeCount = _mm256_set1_epi32(TANK_TYPE_COUNT);
+    const __m256i stateLow = _mm256_set1_epi32(TANK_LEVEL_LOW);
+    const __m256i stateUnknown = _mm256_set1_epi32(TANK_LEVEL_UNKNOWN);
+    const float *factors = TankCatalogue::getFactorTable();
+    const float *residuals = TankCatalogue::getResidualTable();
+    size_t i = 0;
+
+    for (; i + 8 <= batch.count; i += 8) {
+      const __m256 pressure = _mm256_loadu_ps(&batch.pressure[i]);
+      const __m256 gasFlow = _mm256_loadu_ps(&batch.gasFlow[i]);
+      const __m256 capacity = _mm256_loadu_ps(&batch.capacity[i]);
+      const __m256i type = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*) &batch.type[i]));
+      const __m256i unit = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*) &batch.unit[i]));
+
+      // Table lookups.
+      const __m256i factorIndex = _mm256_add_epi32(_mm256_mullo_epi32(unit, typeCount), type);
+      const __m256 typeFactor = _mm256_i32gather_ps(factors, factorIndex, 4);
+      const __m256 typeResidual = _mm256_i32gather_ps(residuals, factorIndex, 4);
+      const __m256 threshold = _mm256_i32gather_ps(THRESHOLDS, unit, 4);
+
+      // Time left.
+      const __m256 isTyped = _mm256_castsi256_ps(_mm256_cmpgt_epi32(typeNone, type));
+      const __m256 isBar = _mm256_castsi256_ps(_mm256_cmpeq_epi32(unit, unitBar));
+      const __m256 isUnitSet = _mm256_castsi256_ps(_mm256_cmpgt_epi32(unitUnknown, unit));
+      const __m256 isBig = _mm256_cmp_ps(capacity, bigCapacity, _CMP_GT_OQ);
+      const __m256 factor = _mm256_blendv_ps(capacity, typeFactor, isTyped);
+      const __m256 volumeResidual = _mm256_blendv_ps(smallResidual, bigResidual, isBig);
+      const __m256 count = _mm256_sub_ps(pressure, _mm256_blendv_ps(volumeResidual, typeResidual, isTyped));
+      const __m256 isKnownType = _mm256_and_ps(isTyped, _mm256_cmp_ps(typeFactor, zero, _CMP_GT_OQ));
+      const __m256 isRegistered = _mm256_or_ps(isKnownType, _mm256_and_ps(isBar, _mm256_cmp_ps(capacity, zero, _CMP_GT_OQ)));
+      __m256 isValid = _mm256_and_ps(isRegistered, isUnitSet);
+      isValid = _mm256_and_ps(isValid, _mm256_cmp_ps(gasFlow, zero, _CMP_NEQ_UQ));
+      isValid = _mm256_and_ps(isValid, _mm256_cmp_ps(count, zero, _CMP_GE_OQ));
+      const __m256 time = _mm256_div_ps(_mm256_mul_ps(count, factor), _mm256_blendv_ps(one, gasFlow, isValid));
+
+      _mm256_storeu_ps(&batch.timeLeft[i], _mm256_blendv_ps(minusOne, time, isValid));
+
+      // Level condition.
+      const __m256i isLow = _mm256_castps_si256(_mm256_cmp_ps(pressure, threshold, _CMP_LT_OQ));
+      const __m256i isEmpty = _mm256_castps_si256(_mm256_cmp_ps(pressure, zero, _CMP_EQ_OQ));
+      const __m256i state = _mm256_blendv_epi8(_mm256_and_si256(isLow, stateLow), stateUnknown, isEmpty);
+      alignas(32) int32_t states[8];
+
+      _mm256_store_si256((__m256i*) states, state);
+      for (int lane = 0; lane < 8; lane++) {
+        batch.state[i + lane] = (uint8_t) states[lane];
+      }
+    }
+
+    return i;
+  }
+
+#else
+
+  /**
+  * @brief No vector kernel for this target, everything is left to the scalar loop.
+  * @return size_t Always 0.
+  */
+  size_t TankEstimator::_estimateVector(const tank_batch_t &)
+  {
+    return 0;
+  }
+
+#endif
+
+} // namespace Module
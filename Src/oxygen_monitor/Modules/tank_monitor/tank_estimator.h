@@ -0,0 +1,121 @@
+/****************************************************************************//**
+ * @file tank_estimator.h
+ * @author Gonzalo Puy.
+ * @date Jun 2025
+ * @brief Branch-free tank estimation kernel header file.
+ *
+ * Computes the time left and the level condition of one or many tanks. It has no
+ * Mbed dependencies, so the gateway can run it over its whole fleet.
+ *******************************************************************************/
+
+#ifndef TANK_ESTIMATOR_H
+#define TANK_ESTIMATOR_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "tank_types.h"
+#include "tank_catalogue.h"
+
+//=========================[Module Defines]=====================================
+
+/** @brief Capacity [L] above which a tank registered by volume uses the big tank residual. */
+#define BIG_TANK_CAPACITY      20
+
+//===========================[Module Types]=====================================
+
+/**
+ * @struct tank_batch_t
+ * @brief Struct of arrays with the inputs and outputs of a batch of tanks.
+ *
+ * A tank registered by volume has type TANK_TYPE_NONE and a capacity above 0.
+ * A tank with type TANK_TYPE_NONE and no capacity is not registered.
+ */
+typedef struct tank_batch {
+  size_t count;               /**< Number of tanks. */
+  const float *pressure;      /**< Last pressure reading in the tank unit. */
+  const float *gasFlow;       /**< Gas flow rate [L/min]. */
+  const float *capacity;      /**< Tank volume [L], only used for TANK_TYPE_NONE. */
+  const uint8_t *type;        /**< tank_type_t of every tank. */
+  const uint8_t *unit;        /**< TANK_UNIT_* of every tank. */
+  float *timeLeft;            /**< Output: minutes until the tank goes low, or -1 if unknown. */
+  uint8_t *state;             /**< Output: tank_state_t of every tank. */
+} tank_batch_t;
+
+namespace Module {
+
+  /**
+  * @class TankEstimator
+  * @brief Time left and level condition of tanks, without data dependent branches.
+  *
+  * Factors and residuals come from the TankCatalogue tables and thresholds from a
+  * constexpr table, all indexed by unit and type, so the single tank functions and
+  * the batch kernel share the same math.
+  */
+  class TankEstimator {
+
+  public:
+
+    /**
+    * @brief Estimates the time left of a single tank.
+    * @param pressure Pressure in the given unit.
+    * @param gasFlow Gas flow rate [L/min].
+    * @param capacity Tank volume [L], only used for TANK_TYPE_NONE.
+    * @param type tank_type_t of the tank.
+    * @param unit TANK_UNIT_* of the pressure.
+    * @return float Remaining time in minutes, or -1 if it can't be estimated.
+    */
+    static float getTimeLeft(float pressure, float gasFlow, float capacity, uint8_t type, uint8_t unit)
+    {
+      const bool isTyped = (type < TANK_TYPE_NONE);
+      const float factor = isTyped ? TankCatalogue::getFactor(unit, type) : capacity;
+      const float volumeResidual = (capacity > BIG_TANK_CAPACITY) ? BIG_TANK_RESIDUAL_BAR : SMALL_TANK_RESIDUAL_BAR;
+      const float count = pressure - (isTyped ? TankCatalogue::getResidual(unit, type) : volumeResidual);
+      const bool isRegistered = (isTyped & (factor > 0)) | ((unit == TANK_UNIT_BAR) & (capacity > 0));
+      const bool isValid = isRegistered & (unit < TANK_UNIT_UNKNOWN) & (gasFlow != 0) & (count >= 0);
+      const float time = (count * factor) / (isValid ? gasFlow : 1.0f);
+
+      return isValid ? time : -1.0f;
+    }
+
+    /**
+    * @brief Level condition of a single tank.
+    * @param pressure Pressure in the given unit, 0 if there is no reading.
+    * @param unit TANK_UNIT_* of the pressure.
+    * @return tank_state_t LOW below the unit threshold, UNKNOWN without reading.
+    */
+    static tank_state_t getState(float pressure, uint8_t unit)
+    {
+      const int low = (pressure < THRESHOLDS[unit]) ? TANK_LEVEL_LOW : TANK_LEVEL_OK;
+
+      return (pressure == 0) ? TANK_LEVEL_UNKNOWN : (tank_state_t) low;
+    }
+
+    /**
+    * @brief Estimates time left and level condition of every tank of a batch.
+    *
+    * Uses AVX2 when built for a host that has it, eight tanks at a time with the
+    * table lookups done as gathers. Otherwise the branch-free scalar loop is used,
+    * which compilers can vectorize on their own.
+    *
+    * @param batch Inputs and outputs, all arrays batch.count long.
+    */
+    static void estimate(const tank_batch_t &batch);
+
+    static constexpr float THRESHOLDS[TANK_UNIT_COUNT] = {
+      PRESSURE_THRESHOLD_BAR, PRESSURE_THRESHOLD_PSI, PRESSURE_THRESHOLD_PSI
+    };                                                  /**< Low pressure threshold per unit. */
+
+  private:
+
+    TankEstimator() {};
+    ~TankEstimator() = default;
+    TankEstimator(const TankEstimator&) = delete;
+    TankEstimator& operator=(const TankEstimator&) = delete;
+
+    static size_t _estimateVector(const tank_batch_t &batch);
+
+  }; // class TankEstimator
+
+} // namespace Module
+
+#endif // TANK_ESTIMATOR_H
@@ -9,11 +9,24 @@
 
 #include <cstdio>
 #include <string>
+#include <string.h>
 #include "tank_monitor.h"
+#include "tank_estimator.h"
+#include "tank_catalogue.h"
+#include "config_store.h"
+#include "logger.h"
+#include "metrics.h"
+#include "profiler.h"
 
 //=====[Declaration and initialization of private global variables]==============
 
 static Drivers::PressureGauge pressure_sensor(PRESS_SENSOR_PIN); /**< PressureGauge instance. */
+static bool isFirstReadingMeasured = false;                      /**< Boot time to the first valid reading already measured. */
+
+static_assert((Drivers::PressureGauge::UNIT_BAR == TANK_UNIT_BAR) &&
+              (Drivers::PressureGauge::UNIT_PSI == TANK_UNIT_PSI) &&
+              (Drivers::PressureGauge::UNIT_UNKNOWN == TANK_UNIT_UNKNOWN),
+              "TankEstimator unit indexes must match PressureGauge units");
 
 //=====[Implementations of public methods]=======================================
 
@@ -26,19 +39,32 @@ namespace Module {
 
   void TankMonitor::update()
   {
+    PROFILE_ZONE(TANK_MONITOR_UPDATE);
+
     pressure_sensor.update();
-    float last_reading = pressure_sensor.getLastReading();
-    float threshold = pressure_sensor.get_unit() == Drivers::PressureGauge::UNIT_BAR ? PRESSURE_THRESHOLD_BAR : PRESSURE_THRESHOLD_PSI;
-    printf("TankMonitor - Last reading: [%.2f]\n\r", last_reading);
-    if (last_reading < threshold) {
+    Util::Metrics::Increment(METRIC_TANK_SAMPLES);
+    LOG_INFO(LOG_MODULE_TANK_MONITOR, LOG_TANK_MONITOR_READING, pressure_sensor.getLastReading());
+    _evaluate();
 
-      tankState = TANK_LEVEL_LOW;
-    } else {
-      tankState = TANK_LEVEL_OK;
+    if (!isFirstReadingMeasured && pressure_sensor.isUnitSet()) {
+      Util::Metrics::Set(METRIC_BOOT_FIRST_READING, (float) Util::Tick::GetTickCounter());
+      isFirstReadingMeasured = true;
+    }
+  }
+
+  void TankMonitor::checkThreshold()
+  {
+    if (pressure_sensor.hasThresholdCrossed()) {
+      Util::Metrics::Increment(METRIC_TANK_THRESHOLD_CROSSINGS);
+      thresholdDelay.Restart(PRESSURE_ALARM_DEBOUNCE);
+      isThresholdPending = true;
     }
-    
-    if (last_reading == 0) {
-      tankState = TANK_LEVEL_UNKNOWN;
+
+    // Crossings bouncing within the debounce time end in a single reading.
+    if (isThresholdPending && thresholdDelay.HasFinished()) {
+      isThresholdPending = false;
+      LOG_INFO(LOG_MODULE_TANK_MONITOR, LOG_TANK_MONITOR_THRESHOLD);
+      update();
     }
   }
 
@@ -48,47 +74,44 @@ namespace Module {
     tankCapacity = (float) fTankCapacity;
     gasFlow = tankGasFlow;
     tankRegistered = true;
+    _evaluate();
+    ConfigStore::getInstance().requestSave();
   }
 
   void TankMonitor::setNewGasFlow(const float tankGasFlow)
   {
     gasFlow = tankGasFlow;
+    _evaluate();
+    ConfigStore::getInstance().requestSave();
   }
 
   tank_state_t TankMonitor::getTankState()
   {
-    return tankState;
+    return getStatusSnapshot().state;
   }
 
   float TankMonitor::getTankStatus(float &lastReading, float &currentGasFlow)
   {
-    if (!tankRegistered) return -1;
-    if (gasFlow == 0) return -1;
-    if (!pressure_sensor.isUnitSet()) return -1;
+    tank_status_t status = getStatusSnapshot();
 
-    Drivers::PressureGauge::unit_t unit = pressure_sensor.get_unit();
-    pressure_sensor.update();
-    lastReading = pressure_sensor.getLastReading();
-    currentGasFlow = gasFlow;
-
-    if (unit == Drivers::PressureGauge::UNIT_BAR && tankType == TANK_TYPE_NONE) {
-      float count = tankCapacity > 20 ? (lastReading - BIG_TANK_RESIDUAL_BAR) : (lastReading - SMALL_TANK_RESIDUAL_BAR);
-      if (count < 0) return -1;
-      float availabeVolume = count * tankCapacity;
-      float time = availabeVolume / gasFlow;
-
-      return time;
-    } else if (tankType != TANK_TYPE_NONE){
-      float factor = _getTypeFactor(unit);
-      float count = unit == Drivers::PressureGauge::UNIT_PSI ? (lastReading - TANK_RESIDUAL_PSI) : (lastReading - TANK_RESIDUAL_BAR);
-      if (count < 0) return -1;
-      float availabeVolume = count * factor;
-      float time = availabeVolume / gasFlow;
-
-      return time;
-    } else {
-      return -1;
-    }
+    lastReading = status.pressure;
+    currentGasFlow = status.gasFlow;
+
+    return status.timeLeft;
+  }
+
+  tank_status_t TankMonitor::getStatusSnapshot()
+  {
+    tank_status_t status;
+    uint32_t version;
+
+    // Retry if a new snapshot was published while copying.
+    do {
+      version = statusVersion;
+      status = statusSnapshot[version & 1];
+    } while (version != statusVersion);
+
+    return status;
   }
 
   bool TankMonitor::isTankTypeValid(const std::string fTankType)
@@ -110,9 +133,15 @@ namespace Module {
   {
     if (unitStr == "bar" || unitStr == "BAR"){
       pressure_sensor.setUnit(Drivers::PressureGauge::UNIT_BAR);
+      _armThreshold();
+      _evaluate();
+      ConfigStore::getInstance().requestSave();
       return true;
     } else if (unitStr == "psi" || unitStr == "PSI") {
       pressure_sensor.setUnit(Drivers::PressureGauge::UNIT_PSI);
+      _armThreshold();
+      _evaluate();
+      ConfigStore::getInstance().requestSave();
       return true;
     } else {
       return false;
@@ -137,6 +166,44 @@ namespace Module {
     return result;
   }
 
+  void TankMonitor::getConfig(tank_config_t &config)
+  {
+    memset(&config, 0, sizeof(config));
+    config.unit = (uint8_t) pressure_sensor.get_unit();
+    config.tankRegistered = tankRegistered;
+
+    if (tankRegistered) {
+      strncpy(config.tankType, TankCatalogue::getName(tankType), TANK_NAME_SIZE - 1);
+      config.tankCapacity = tankCapacity;
+      config.gasFlow = gasFlow;
+    }
+  }
+
+  void TankMonitor::setConfig(const tank_config_t &config)
+  {
+    char typeName[TANK_NAME_SIZE];
+
+    if (config.unit < Drivers::PressureGauge::UNIT_UNKNOWN) {
+      pressure_sensor.setUnit((Drivers::PressureGauge::unit_t) config.unit);
+      _armThreshold();
+    }
+
+    memcpy(typeName, config.tankType, TANK_NAME_SIZE);
+    typeName[TANK_NAME_SIZE - 1] = '\0';
+
+    const tank_type_t type = TankCatalogue::find(typeName);
+    const bool isTypeKnown = (typeName[0] == '\0') || (type != TANK_TYPE_NONE);
+
+    if (config.tankRegistered && isTypeKnown && ((type != TANK_TYPE_NONE) || (config.tankCapacity > 0))) {
+      tankType = type;
+      tankCapacity = config.tankCapacity;
+      gasFlow = config.gasFlow;
+      tankRegistered = true;
+    }
+
+    _evaluate();
+  }
+
   //=====[Implementations of private methods]===================================
 
   /**
@@ -146,82 +213,89 @@ namespace Module {
   {
     pressure_sensor.init();
 
+#if TANK_CATALOGUE_FLASH_ADDRESS
+    if (TankCatalogue::load((const uint8_t*) TANK_CATALOGUE_FLASH_ADDRESS, TANK_CATALOGUE_FLASH_SIZE)) {
+      LOG_INFO(LOG_MODULE_TANK_MONITOR, LOG_TANK_CATALOGUE_LOADED, (int) TankCatalogue::getCount());
+    } else {
+      LOG_WARN(LOG_MODULE_TANK_MONITOR, LOG_TANK_CATALOGUE_INVALID);
+    }
+#endif
+
     tankState = TANK_LEVEL_UNKNOWN;
     gasFlow = 0;
     tankCapacity = 0;
     tankType = TANK_TYPE_NONE;
     tankRegistered = false;
+    isThresholdPending = false;
+    statusVersion = 0;
+    _evaluate();
+  }
+
+  /**
+  * @brief Evaluates tank state and remaining time from the last reading and publishes a new snapshot.
+  *
+  * The snapshot is written in the inactive buffer and only then made visible
+  * by incrementing the version, so readers never see a partially written one.
+  */
+  void TankMonitor::_evaluate()
+  {
+    float last_reading = pressure_sensor.getLastReading();
+    const tank_state_t previousState = tankState;
+
+    tankState = TankEstimator::getState(last_reading, pressure_sensor.get_unit());
+
+    const uint32_t nextVersion = statusVersion + 1;
+    tank_status_t &status = statusSnapshot[nextVersion & 1];
+
+    status.version = nextVersion;
+    status.pressure = last_reading;
+    status.gasFlow = gasFlow;
+    status.timeLeft = _getTimeLeft(last_reading);
+    status.state = tankState;
+    status.tankRegistered = tankRegistered;
+    status.timestamp = Util::Tick::GetTickCounter();
+
+    statusVersion = nextVersion;
+
+    if (tankState != previousState) {
+      Util::Metrics::Increment(METRIC_TANK_STATE_TRANSITIONS);
+    }
+    Util::Metrics::Set(METRIC_TANK_PRESSURE, status.pressure);
+    Util::Metrics::Set(METRIC_TANK_TIME_LEFT, status.timeLeft);
+    Util::Metrics::Set(METRIC_TANK_STATE, status.state);
+  }
+
+  /**
+  * @brief Estimates remaining tank time based on a pressure reading and the gas flow.
+  * @param lastReading Pressure in the configured unit.
+  * @return float Remaining time in minutes, or -1 if it can't be estimated.
+  */
+  float TankMonitor::_getTimeLeft(float lastReading)
+  {
+    if (!tankRegistered) return -1;
+
+    return TankEstimator::getTimeLeft(lastReading, gasFlow, tankCapacity, tankType, pressure_sensor.get_unit());
   }
 
   /**
   * @brief Converts a string representation of a tank type to its corresponding enum.
   *
-  * This helper function allows case-insensitive matching of known tank type strings
-  * ("D", "E", "M", "G", "H") to their respective `tank_type_t` enumeration values.
+  * Names and aliases of the active TankCatalogue are matched ignoring case.
   *
   * @param fTankType String representing the tank type (e.g., "D", "e", "M").
   * @return Corresponding `tank_type_t` value, or `TANK_TYPE_NONE` if the type is not recognized.
   */
   tank_type_t TankMonitor::_findType(const std::string fTankType)
   {
-    if (fTankType == TANK_D_STR || fTankType == "d") {
-      return TANK_D;
-    } else if (fTankType == TANK_E_STR || fTankType == "e") {
-      return TANK_E;
-    } else if (fTankType == TANK_M_STR || fTankType == "m") {
-      return TANK_M;
-    } else if (fTankType == TANK_G_STR || fTankType == "g") {
-      return TANK_G;
-    } else if (fTankType == TANK_H_STR || fTankType == "h") {
-      return TANK_H;
-    } 
-
-    return TANK_TYPE_NONE;
+    return TankCatalogue::find(fTankType.c_str());
   }
 
   /**
-  * @brief Returns the capacity conversion factor associated with the tank type.
-  *
-  * This function determines the appropriate factor used to convert pressure readings
-  * to remaining volume, based on the tank type and the currently configured pressure unit.
-  * If no valid type is set or the unit is unknown, it returns 0.
-  *
-  * @param unit Unit system in use (BAR or PSI).
-  * @return Tank factor in L/bar or L/psi, or 0 if invalid.
+  * @brief Arms the gauge watchdog at the low pressure threshold of the configured unit.
   */
-  float TankMonitor::_getTypeFactor(Drivers::PressureGauge::unit_t unit)
-  {
-    if (unit == Drivers::PressureGauge::UNIT_BAR)
-    {
-      if (tankType == TANK_D ) {
-        return TANK_D_FACTOR_BAR;
-      } else if (tankType == TANK_E) {
-        return TANK_E_FACTOR_BAR;
-      } else if (tankType == TANK_M) {
-        return TANK_M_FACTOR_BAR;
-      } else if (tankType == TANK_G) {
-        return TANK_G_FACTOR_BAR;
-      } else if (tankType == TANK_H) {
-        return TANK_H_FACTOR_BAR;
-      }
-    }
-
-    if (unit == Drivers::PressureGauge::UNIT_PSI)
-    {
-      if (tankType == TANK_D ) {
-        return TANK_D_FACTOR_PSI;
-      } else if (tankType == TANK_E) {
-        return TANK_E_FACTOR_PSI;
-      } else if (tankType == TANK_M) {
-        return TANK_M_FACTOR_PSI;
-      } else if (tankType == TANK_G) {
-        return TANK_G_FACTOR_PSI;
-      } else if (tankType == TANK_H) {
-        return TANK_H_FACTOR_PSI;
-      }
-    }
-
-    return 0.0;
+  void TankMonitor::_armThreshold()
+  {
+    pressure_sensor.setThreshold(TankEstimator::THRESHOLDS[pressure_sensor.get_unit()]);
   }
 
 }; // namespace Module
\ No newline at end of file
@@ -11,71 +11,45 @@
 
 #include "mbed.h"
 #include <string>
+#include "delay.h"
 #include "pressure_gauge.h"
+#include "tank_types.h"
+#include "tank_catalogue.h"
 
 //=========================[Module Defines]=====================================
 
-#define PRESSURE_THRESHOLD_BAR     34.0f    /**< Low pressure threshold in BAR */
-#define SMALL_TANK_RESIDUAL_BAR    10       /**< Residual pressure for small tanks in BAR */
-#define BIG_TANK_RESIDUAL_BAR      20       /**< Residual pressure for big tanks in BAR */
-#define TANK_RESIDUAL_BAR          13.8f    /**< Average residual pressure in BAR */
-
-#define TANK_D_FACTOR_BAR          2.3f     /**< Tank D capacity factor in [L/bar] */
-#define TANK_E_FACTOR_BAR          3.5f     /**< Tank E capacity factor in [L/bar] */
-#define TANK_M_FACTOR_BAR          17.4f    /**< Tank M capacity factor in [L/bar] */
-#define TANK_G_FACTOR_BAR          27.0f    /**< Tank G capacity factor in [L/bar] */
-#define TANK_H_FACTOR_BAR          35.0f    /**< Tank H capacity factor in [L/bar] */
-
-#define TANK_RESIDUAL_PSI          200      /**< Residual pressure in PSI */
-#define PRESSURE_THRESHOLD_PSI     500.0f   /**< Low pressure threshold in PSI */
-
-#define TANK_D_FACTOR_PSI          0.16f    /**< Tank D capacity factor in [L/psi] */
-#define TANK_E_FACTOR_PSI          0.28f    /**< Tank E capacity factor in [L/psi] */
-#define TANK_M_FACTOR_PSI          1.56f    /**< Tank M capacity factor in [L/psi] */
-#define TANK_G_FACTOR_PSI          2.41f    /**< Tank G capacity factor in [L/psi] */
-#define TANK_H_FACTOR_PSI          3.14f    /**< Tank H capacity factor in [L/psi] */
-
-//===========================[Module Strings]===================================
-
-/** @brief String for tank type D. */
-const char TANK_D_STR[] = "D";
-
-/** @brief String for tank type E. */
-const char TANK_E_STR[] = "E";
-
-/** @brief String for tank type M. */
-const char TANK_M_STR[] = "M";
-
-/** @brief String for tank type G. */
-const char TANK_G_STR[] = "G";
-
-/** @brief String for tank type H. */
-const char TANK_H_STR[] = "H";
+/** @brief Time a threshold crossing must settle before it is read [ms]. */
+#ifndef PRESSURE_ALARM_DEBOUNCE
+#define PRESSURE_ALARM_DEBOUNCE   50
+#endif
 
 //===========================[Module Types]=====================================
 
 /**
- * @enum tank_state_t
- * @brief Represents the current level condition of the tank.
+ * @struct tank_status_t
+ * @brief Immutable snapshot of the tank status, published on every evaluation.
  */
-typedef enum tank_state {
-  TANK_LEVEL_OK = 0,         /**< Tank pressure is within normal range. */
-  TANK_LEVEL_LOW = 1,        /**< Tank pressure is below threshold (alert). */
-  TANK_LEVEL_UNKNOWN = 2     /**< Tank status cannot be determined. */
-} tank_state_t;
+typedef struct tank_status {
+  uint32_t version;          /**< Incremented on every publication. */
+  float pressure;            /**< Last pressure reading in the configured unit. */
+  float gasFlow;             /**< Gas flow rate [L/min]. */
+  float timeLeft;            /**< Estimated minutes until the tank goes low, or -1 if unknown. */
+  tank_state_t state;        /**< Tank level condition. */
+  bool tankRegistered;       /**< Indicates whether a tank has been registered. */
+  Util::tick_t timestamp;    /**< Tick [ms] at which the snapshot was published. */
+} tank_status_t;
 
 /**
- * @enum tank_type_t
- * @brief Enumerates the supported tank types.
+ * @struct tank_config_t
+ * @brief Tank configuration kept across resets.
  */
-typedef enum tank_type {
-  TANK_D = 0,           /**< Tank type D. */
-  TANK_E = 1,           /**< Tank type E. */
-  TANK_M = 2,           /**< Tank type M. */
-  TANK_G = 3,           /**< Tank type G. */
-  TANK_H = 4,           /**< Tank type H. */
-  TANK_TYPE_NONE = 5    /**< No valid tank type configured. */
-} tank_type_t;
+typedef struct tank_config {
+  uint8_t unit;                    /**< Drivers::PressureGauge::unit_t of the readings. */
+  bool tankRegistered;             /**< Indicates whether a tank has been registered. */
+  char tankType[TANK_NAME_SIZE];   /**< Catalogue name of the tank type, empty if registered by volume. */
+  float tankCapacity;              /**< Tank volume [L], if type is not set. */
+  float gasFlow;                   /**< Gas flow rate [L/min]. */
+} tank_config_t;
 
 namespace Module {
   /**
@@ -115,6 +89,15 @@ namespace Module {
     */
     void update();
 
+    /**
+    * @brief Reads the pressure right away when the gauge watchdog reports a
+    *        threshold crossing, once it settles for PRESSURE_ALARM_DEBOUNCE.
+    *
+    * This method should be called on every iteration of the main loop. It only
+    * checks a flag while the pressure stays on one side of the threshold.
+    */
+    void checkThreshold();
+
     /**
     * @brief Registers a new tank by type or volume and sets gas flow.
     * @param tankType The tank type string (e.g., "D", "E", "G").
@@ -137,12 +120,25 @@ namespace Module {
 
     /**
     * @brief Estimates remaining tank time based on pressure and gas flow.
+    *
+    * Values come from the last published snapshot, no new reading is done.
+    *
     * @param lastReading Reference to store the latest pressure reading.
     * @param currentGasFlow Reference to store the current gas flow.
     * @return float Remaining time in minutes.
     */
     float getTankStatus(float &lastReading, float &currentGasFlow);
 
+    /**
+    * @brief Returns a copy of the last published tank status.
+    *
+    * The snapshot is double buffered and versioned, so it can be read without
+    * locks while a new one is being published.
+    *
+    * @return tank_status_t Last published snapshot.
+    */
+    tank_status_t getStatusSnapshot();
+
     /**
     * @brief Validates a given tank type string.
     * @param fTankType The tank type string.
@@ -175,20 +171,43 @@ namespace Module {
     */
     std::string getPressureGaugeUnitStr();
 
+    /**
+    * @brief Gets the current unit and tank configuration.
+    * @param config Filled with the configuration. Unused fields and padding are zeroed.
+    */
+    void getConfig(tank_config_t &config);
+
+    /**
+    * @brief Restores a configuration returned by getConfig().
+    *
+    * A tank whose type is not in the active catalogue is not registered.
+    *
+    * @param config Configuration to restore.
+    */
+    void setConfig(const tank_config_t &config);
+
   private:
     
-    TankMonitor() {};
+    TankMonitor()
+    : thresholdDelay(PRESSURE_ALARM_DEBOUNCE)
+    {};
     ~TankMonitor() = default;
 
     void _init();
+    void _evaluate();
+    float _getTimeLeft(float lastReading);
     tank_type_t _findType(const std::string fTankType);
-    float _getTypeFactor(Drivers::PressureGauge::unit_t unit);
+    void _armThreshold();
 
+    tank_status_t statusSnapshot[2];     /**< Double buffered status, active one selected by statusVersion. */
+    volatile uint32_t statusVersion;     /**< Version of the last published snapshot. */
     tank_state_t tankState;  /**< Current state of the tank. */
     tank_type_t tankType;    /**< Registered tank type. */
     float gasFlow;           /**< Current gas flow rate [L/min]. */
     float tankCapacity;      /**< Tank volume [L], if type is not set. */
     bool tankRegistered;     /**< Indicates whether a tank has been registered. */
+    bool isThresholdPending; /**< A threshold crossing is settling. */
+    Util::Delay thresholdDelay; /**< Debounce of threshold crossings. */
 
   }; // Class PressureMonitor
 
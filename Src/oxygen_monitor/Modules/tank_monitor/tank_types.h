@@ -0,0 +1,81 @@
+/****************************************************************************//**
+ * @file tank_types.h
+ * @author Gonzalo Puy.
+ * @date Jun 2024
+ * @brief Tank constants and types.
+ *
+ * Kept free of Mbed dependencies, so the estimation code can also be built for
+ * the gateway host.
+ *******************************************************************************/
+
+#ifndef TANK_TYPES_H
+#define TANK_TYPES_H
+
+//=========================[Module Defines]=====================================
+
+#define PRESSURE_THRESHOLD_BAR     34.0f    /**< Low pressure threshold in BAR */
+#define SMALL_TANK_RESIDUAL_BAR    10       /**< Residual pressure for small tanks in BAR */
+#define BIG_TANK_RESIDUAL_BAR      20       /**< Residual pressure for big tanks in BAR */
+#define TANK_RESIDUAL_BAR          13.8f    /**< Average residual pressure in BAR */
+
+#define TANK_RESIDUAL_PSI          200      /**< Residual pressure in PSI */
+#define PRESSURE_THRESHOLD_PSI     500.0f   /**< Low pressure threshold in PSI */
+
+/** @brief Unit indexes, same values as Drivers::PressureGauge::unit_t. */
+#define TANK_UNIT_BAR              0
+#define TANK_UNIT_PSI              1
+#define TANK_UNIT_UNKNOWN          2
+#define TANK_UNIT_COUNT            3
+
+#define TANK_CATALOGUE_MAX         15       /**< Maximum tank types of a catalogue. */
+#define TANK_TYPE_COUNT            (TANK_CATALOGUE_MAX + 1)     /**< Tank types, TANK_TYPE_NONE included. */
+
+/**
+ * @brief Built-in tank catalogue, as X(id, name, factor [L/bar], factor [L/psi],
+ *        residual [bar], residual [psi], nominal capacity [L of gas when full]).
+ */
+#define TANK_CATALOGUE(X) \
+  X(D, "D", 2.3f,  0.16f, TANK_RESIDUAL_BAR, TANK_RESIDUAL_PSI, 425) \
+  X(E, "E", 3.5f,  0.28f, TANK_RESIDUAL_BAR, TANK_RESIDUAL_PSI, 680) \
+  X(M, "M", 17.4f, 1.56f, TANK_RESIDUAL_BAR, TANK_RESIDUAL_PSI, 3450) \
+  X(G, "G", 27.0f, 2.41f, TANK_RESIDUAL_BAR, TANK_RESIDUAL_PSI, 5300) \
+  X(H, "H", 35.0f, 3.14f, TANK_RESIDUAL_BAR, TANK_RESIDUAL_PSI, 6900)
+
+/**
+ * @brief Other names of the built-in tanks, as X(alias, id).
+ */
+#define TANK_ALIASES(X) \
+  X("M15",  D) \
+  X("M24",  E) \
+  X("M122", M) \
+  X("K",    H)
+
+//===========================[Module Types]=====================================
+
+/**
+ * @enum tank_state_t
+ * @brief Represents the current level condition of the tank.
+ */
+typedef enum tank_state {
+  TANK_LEVEL_OK = 0,         /**< Tank pressure is within normal range. */
+  TANK_LEVEL_LOW = 1,        /**< Tank pressure is below threshold (alert). */
+  TANK_LEVEL_UNKNOWN = 2     /**< Tank status cannot be determined. */
+} tank_state_t;
+
+#define TANK_TYPE_ID(id, name, factorBar, factorPsi, residualBar, residualPsi, capacity) TANK_##id,
+
+/**
+ * @enum tank_type_t
+ * @brief Index of a tank type in the catalogue.
+ *
+ * Built-in types get a name from TANK_CATALOGUE. A catalogue loaded from flash
+ * may use any index below TANK_TYPE_NONE.
+ */
+typedef enum tank_type {
+  TANK_CATALOGUE(TANK_TYPE_ID)
+  TANK_TYPE_NONE = TANK_CATALOGUE_MAX    /**< No valid tank type configured. */
+} tank_type_t;
+
+#undef TANK_TYPE_ID
+
+#endif // TANK_TYPES_H
@@ -0,0 +1,83 @@
+/****************************************************************************//**
+ * @file telemetry.cpp
+ * @author Gonzalo Puy.
+ * @date Jun 2025
+ * @brief Telemetry publisher for gateway mode. Implemented with singleton design
+          pattern in order to ensure only one instance of the object Telemetry.
+
+ *******************************************************************************/
+
+#include <string>
+#include "telemetry.h"
+#include "logger.h"
+#include "metrics.h"
+#include "wifi_com.h"
+
+//=====[Declaration and initialization of private global variables]==============
+
+static Util::TextBuffer<TELEMETRY_FRAME_SIZE> telemetryFrame;  /**< Reusable frame buffer. */
+
+//=====[Implementations of public methods]=======================================
+
+namespace Module {
+
+  void Telemetry::init()
+  {
+    getInstance()._init();
+  }
+
+  void Telemetry::update()
+  {
+    // Held while the link is down, the latest status goes out once it is back.
+    if (Drivers::WifiCom::getInstance().isBusy() || !Drivers::WifiCom::getInstance().isLinkUp()) {
+      return;
+    }
+
+    const tank_status_t status = Module::TankMonitor::getInstance().getStatusSnapshot();
+
+    if ((status.version != lastSentVersion) || heartbeatDelay.HasFinished()) {
+      _sendFrame(status);
+    }
+  }
+
+//=====[Implementations of private methods]======================================
+
+  /**
+  * @brief Internal init function. Does the actual initiation of the module.
+  */
+  void Telemetry::_init()
+  {
+    lastSentVersion = 0;
+    frameSequence = 0;
+    LOG_INFO(LOG_MODULE_SYSTEM, LOG_INIT_TELEMETRY, TELEMETRY_DEVICE_ID);
+  }
+
+  /**
+  * @brief Builds a frame from a status snapshot and hands it to the WiFi module.
+  * @param status Snapshot to send.
+  */
+  void Telemetry::_sendFrame(const tank_status_t &status)
+  {
+    const std::string unit = Module::TankMonitor::getInstance().getPressureGaugeUnitStr();
+    telemetry_frame_t frame;
+
+    frame.deviceId = TELEMETRY_DEVICE_ID;
+    frame.sequence = frameSequence;
+    frame.state = (uint8_t) status.state;
+    frame.tankRegistered = status.tankRegistered;
+    frame.unit = unit.empty() ? 'U' : unit[0];
+    frame.pressureCenti = (int32_t) (status.pressure * 100.0f);
+    frame.gasFlowCenti = (int32_t) (status.gasFlow * 100.0f);
+    frame.timeLeft = (int32_t) status.timeLeft;
+
+    TelemetryFrame::encode(frame, telemetryFrame);
+
+    Drivers::WifiCom::getInstance().telemetry(TELEMETRY_GATEWAY_HOST, TELEMETRY_GATEWAY_PORT, telemetryFrame.c_str());
+    Util::Metrics::Increment(METRIC_TELEMETRY_FRAMES);
+
+    lastSentVersion = status.version;
+    frameSequence++;
+    heartbeatDelay.Restart(TELEMETRY_HEARTBEAT);
+  }
+
+} // namespace Module
@@ -0,0 +1,102 @@
+/****************************************************************************//**
+ * @file telemetry.h
+ * @author Gonzalo Puy.
+ * @date Jun 2025
+ * @brief Telemetry publisher for gateway mode header file.
+ *
+ * In gateway mode the monitor doesn't run its own Telegram bot. Tank status is
+ * pushed as compact frames to a gateway that serves many monitors behind one bot.
+ *******************************************************************************/
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdint.h>
+#include "delay.h"
+#include "tank_monitor.h"
+#include "telemetry_frame.h"
+
+//=========================[Module Defines]=====================================
+
+/** @brief Run as a gateway client (telemetry) instead of a standalone Telegram bot. */
+#ifndef GATEWAY_MODE
+#define GATEWAY_MODE            0
+#endif
+
+/** @brief ID of this monitor, unique among the monitors of a gateway. */
+#ifndef TELEMETRY_DEVICE_ID
+#define TELEMETRY_DEVICE_ID     1
+#endif
+
+/** @brief Gateway host name or IP address. */
+#ifndef TELEMETRY_GATEWAY_HOST
+#define TELEMETRY_GATEWAY_HOST  "192.168.0.10"
+#endif
+
+/** @brief Maximum time between two frames, even without new readings [ms]. */
+#ifndef TELEMETRY_HEARTBEAT
+#define TELEMETRY_HEARTBEAT     DELAY_5_MINUTES
+#endif
+
+/** @brief Size of the frame buffer. */
+#define TELEMETRY_FRAME_SIZE    64
+
+namespace Module {
+
+  /**
+  * @class Telemetry
+  * @brief Singleton class that publishes the tank status to a gateway.
+  *
+  * A frame is sent every time TankMonitor publishes a new status snapshot, and at
+  * least every TELEMETRY_HEARTBEAT. See TelemetryFrame for the frame layout.
+  */
+  class Telemetry {
+
+  public:
+
+    /**
+    * @brief Gets the singleton instance of the Telemetry module.
+    * @return Reference to the Telemetry instance.
+    */
+    static Telemetry& getInstance(){
+      static Telemetry instance;
+
+      return instance;
+    }
+
+    // Erase default C++ copy methods in order to avoid generating accidental copies of singleton.
+    Telemetry(const Telemetry&) = delete;
+    Telemetry& operator=(const Telemetry&) = delete;
+
+    /**
+    * @brief Initializes Telemetry Module
+    */
+    static void init();
+
+    /**
+    * @brief Sends a frame when there is a new status or the heartbeat expires.
+    *
+    * This method should be called regularly in the main loop.
+    */
+    void update();
+
+  private:
+
+    Telemetry()
+    : heartbeatDelay(TELEMETRY_HEARTBEAT)
+    {};
+
+    ~Telemetry() = default;
+
+    void _init();
+    void _sendFrame(const tank_status_t &status);
+
+    Util::Delay heartbeatDelay;     /**< Time since the last frame. */
+    uint32_t lastSentVersion;       /**< Snapshot version of the last frame. */
+    uint32_t frameSequence;         /**< Sequence number of the next frame. */
+
+  }; // class Telemetry
+
+} // namespace Module
+
+#endif // TELEMETRY_H
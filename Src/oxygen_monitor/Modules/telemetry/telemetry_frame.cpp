@@ -0,0 +1,84 @@
+/****************************************************************************//**
+ * @file telemetry_frame.cpp
+ * @author Gonzalo Puy.
+ * @date Jun 2025
+ * @brief Telemetry frame codec.
+ *******************************************************************************/
+
+#include <stdlib.h>
+#include "telemetry_frame.h"
+
+//=====[Implementations of public methods]=======================================
+
+namespace Module {
+
+  bool TelemetryFrame::encode(const telemetry_frame_t &frame, Util::TextWriter &writer)
+  {
+    writer.Clear();
+    writer.AppendInt(TELEMETRY_FRAME_VERSION);
+    writer.Append(TELEMETRY_FRAME_SEPARATOR);
+    writer.AppendInt(frame.deviceId);
+    writer.Append(TELEMETRY_FRAME_SEPARATOR);
+    writer.AppendInt((int32_t) frame.sequence);
+    writer.Append(TELEMETRY_FRAME_SEPARATOR);
+    writer.AppendInt(frame.state);
+    writer.Append(TELEMETRY_FRAME_SEPARATOR);
+    writer.AppendInt(frame.tankRegistered ? 1 : 0);
+    writer.Append(TELEMETRY_FRAME_SEPARATOR);
+    writer.Append(frame.unit);
+    writer.Append(TELEMETRY_FRAME_SEPARATOR);
+    writer.AppendInt(frame.pressureCenti);
+    writer.Append(TELEMETRY_FRAME_SEPARATOR);
+    writer.AppendInt(frame.gasFlowCenti);
+    writer.Append(TELEMETRY_FRAME_SEPARATOR);
+    writer.AppendInt(frame.timeLeft);
+
+    return !writer.IsOverflowed();
+  }
+
+  bool TelemetryFrame::parse(const char *text, telemetry_frame_t &frame)
+  {
+    long fields[TELEMETRY_FRAME_FIELDS];
+    const char *cursor = text;
+
+    for (int i = 0; i < TELEMETRY_FRAME_FIELDS; i++) {
+      char *end;
+
+      if (i == 5) {
+        // Unit is a single letter, not a number.
+        if ((cursor[0] == '\0') || (cursor[0] == TELEMETRY_FRAME_SEPARATOR)) {
+          return false;
+        }
+        fields[i] = cursor[0];
+        end = const_cast<char*>(cursor + 1);
+      } else {
+        fields[i] = strtol(cursor, &end, 10);
+        if (end == cursor) {
+          return false;
+        }
+      }
+
+      const bool isLast = (i == TELEMETRY_FRAME_FIELDS - 1);
+      if (isLast ? (*end != '\0') : (*end != TELEMETRY_FRAME_SEPARATOR)) {
+        return false;
+      }
+      cursor = end + 1;
+    }
+
+    if (fields[0] != TELEMETRY_FRAME_VERSION) {
+      return false;
+    }
+
+    frame.deviceId = (uint16_t) fields[1];
+    frame.sequence = (uint32_t) fields[2];
+    frame.state = (uint8_t) fields[3];
+    frame.tankRegistered = (fields[4] != 0);
+    frame.unit = (char) fields[5];
+    frame.pressureCenti = (int32_t) fields[6];
+    frame.gasFlowCenti = (int32_t) fields[7];
+    frame.timeLeft = (int32_t) fields[8];
+
+    return true;
+  }
+
+} // namespace Module
@@ -0,0 +1,92 @@
+/****************************************************************************//**
+ * @file telemetry_frame.h
+ * @author Gonzalo Puy.
+ * @date Jun 2025
+ * @brief Telemetry frame codec header file.
+ *
+ * Shared by the monitors and the gateway. It has no Mbed dependencies so it
+ * can be built for the gateway host as is.
+ *******************************************************************************/
+
+#ifndef TELEMETRY_FRAME_H
+#define TELEMETRY_FRAME_H
+
+#include <stdint.h>
+#include "text_writer.h"
+
+//=========================[Module Defines]=====================================
+
+/** @brief Version of the frame layout, first field of every frame. */
+#define TELEMETRY_FRAME_VERSION 1
+
+/** @brief Number of fields of a frame, version included. */
+#define TELEMETRY_FRAME_FIELDS  9
+
+/** @brief Field separator. */
+#define TELEMETRY_FRAME_SEPARATOR ','
+
+/** @brief Gateway UDP port. */
+#ifndef TELEMETRY_GATEWAY_PORT
+#define TELEMETRY_GATEWAY_PORT  5005
+#endif
+
+//===========================[Module Types]=====================================
+
+/**
+ * @struct telemetry_frame_t
+ * @brief Decoded telemetry frame. Values are fixed point so both ends agree
+ *        without float formatting.
+ */
+typedef struct telemetry_frame {
+  uint16_t deviceId;        /**< Monitor ID, unique per gateway. */
+  uint32_t sequence;        /**< Frame counter, lets the gateway spot lost frames. */
+  uint8_t state;            /**< tank_state_t of the monitor. */
+  bool tankRegistered;      /**< Indicates whether a tank has been registered. */
+  char unit;                /**< First letter of the pressure unit: B, P or U. */
+  int32_t pressureCenti;    /**< Pressure x 100, in the unit above. */
+  int32_t gasFlowCenti;     /**< Gas flow x 100 [L/min]. */
+  int32_t timeLeft;         /**< Minutes until the tank goes low, -1 if unknown. */
+} telemetry_frame_t;
+
+namespace Module {
+
+  /**
+  * @class TelemetryFrame
+  * @brief Encodes and parses telemetry frames.
+  *
+  * Frames are comma separated fields:
+  *
+  *   version,device,sequence,state,registered,unit,pressure_x100,gasflow_x100,time_left
+  */
+  class TelemetryFrame {
+
+  public:
+
+    /**
+    * @brief Writes a frame.
+    * @param frame Frame to encode.
+    * @param writer Destination, cleared first.
+    * @retval true if the frame fits in the writer, false otherwise.
+    */
+    static bool encode(const telemetry_frame_t &frame, Util::TextWriter &writer);
+
+    /**
+    * @brief Parses a frame.
+    * @param text Null terminated frame.
+    * @param frame Decoded frame, only valid if true is returned.
+    * @retval true if the frame is complete and its version is known, false otherwise.
+    */
+    static bool parse(const char *text, telemetry_frame_t &frame);
+
+  private:
+
+    TelemetryFrame() {};
+    ~TelemetryFrame() = default;
+    TelemetryFrame(const TelemetryFrame&) = delete;
+    TelemetryFrame& operator=(const TelemetryFrame&) = delete;
+
+  }; // class TelemetryFrame
+
+} // namespace Module
+
+#endif // TELEMETRY_FRAME_H
@@ -8,10 +8,16 @@
 #include "oxygen_monitor.h"
 
 #include "arm_book_lib.h"
+#include "benchmark.h"
+#include "config_store.h"
 #include "delay.h"
+#include "logger.h"
+#include "metrics.h"
+#include "profiler.h"
 #include "mbed.h"
 #include "telegram_bot.h"
 #include "tank_monitor.h"
+#include "telemetry.h"
 #include "wifi_com.h"
 #include "util.h"
 
@@ -19,9 +25,9 @@ namespace Module {
 
 //=====[Declaration and initialization of private global variables]============
 
-static Timeout o2MonitorTimeout;                              /**< O2Monitor Timeout. */
-static bool isTimeoutFinished;                                /**< Variable to check if O2Monitor Timeout is finished. */
-static constexpr chrono::seconds O2_MONITOR_TIMEOUT = 40s;   /**< Timeout Delay. */
+static Util::Delay o2MonitorDelay(0);                         /**< O2Monitor Delay. */
+static bool isTimeoutFinished;                                /**< Variable to check if O2Monitor Delay is finished. */
+static constexpr size_t LOG_DRAIN_MAX_RECORDS = 1;            /**< Log records printed per update, keeps the loop responsive. */
 
 //=====[Implementations of public methods]======================================
 
@@ -36,15 +42,33 @@ void OxygenMonitor::init()
 //-----------------------------------------------------------------------------
 void OxygenMonitor::update()
 {
+    PROFILE_ZONE(SUPERLOOP);
+
+    if (!isTimeoutFinished && o2MonitorDelay.HasFinished())
+    {
+      isTimeoutFinished = true;
+    }
+
     if(isTimeoutFinished) 
     {
       Module::TankMonitor::getInstance().update();
-      o2MonitorTimeout.detach();
-      o2MonitorTimeout.attach(&onO2MonitorTimeoutFinishedCallback, O2_MONITOR_TIMEOUT);
+      o2MonitorDelay.Restart(O2_MONITOR_SAMPLE_INTERVAL);
       isTimeoutFinished = false;
     }
+    Module::TankMonitor::getInstance().checkThreshold();
     Drivers::WifiCom::getInstance().update();
+#if GATEWAY_MODE
+    Module::Telemetry::getInstance().update();
+#else
     Module::TelegramBot::getInstance().update();
+#endif
+    Module::ConfigStore::getInstance().update();
+    {
+      PROFILE_ZONE(LOG_DRAIN);
+      Util::Log::Drain(LOG_DRAIN_MAX_RECORDS);
+    }
+    Util::Metrics::DrainDump();
+    PROFILE_DRAIN_DUMP();
 }
 
 //=====[Implementations of private methods]==================================
@@ -60,23 +84,32 @@ OxygenMonitor::OxygenMonitor() {}
 void Module::OxygenMonitor::_init()
 {
   
-    printf("\nInit TICK\n");
+    LOG_INFO(LOG_MODULE_SYSTEM, LOG_INIT_TICK);
     Util::Tick::Init();
-    printf("\nInit WifiCom\n");
+    PROFILE_INIT();
+
+    // Sensing first, so the first sample is taken on the first loop.
+    LOG_INFO(LOG_MODULE_SYSTEM, LOG_INIT_TANK_MONITOR);
+    Module::TankMonitor::init();
+
+    // The link comes up in the background: these only set their state machines.
+    LOG_INFO(LOG_MODULE_SYSTEM, LOG_INIT_WIFI_COM);
     Drivers::WifiCom::init();
-    printf("\nInit Telegram BOT\n");
+#if GATEWAY_MODE
+    Module::Telemetry::init();
+#else
+    LOG_INFO(LOG_MODULE_SYSTEM, LOG_INIT_TELEGRAM_BOT);
     Module::TelegramBot::init();
-    printf("\nInit TankMonitor\n");
-    Module::TankMonitor::init();
+#endif
 
-}
+    // Restores unit, tank and users into the modules above.
+    LOG_INFO(LOG_MODULE_SYSTEM, LOG_INIT_CONFIG_STORE);
+    Module::ConfigStore::init();
+
+#if BENCHMARK_ENABLED && !GATEWAY_MODE
+    Module::Benchmark::run();
+#endif
 
-/**
-* @brief Callback function triggered when the monitoring delay expires.
-*/
-void Module::OxygenMonitor::onO2MonitorTimeoutFinishedCallback()
-{
-  isTimeoutFinished = true;
 }
 
 } // namespace Module
\ No newline at end of file
@@ -10,6 +10,11 @@
 
 #include "delay.h"
 
+/** @brief Time between two tank samples [ms]. */
+#ifndef O2_MONITOR_SAMPLE_INTERVAL
+#define O2_MONITOR_SAMPLE_INTERVAL  40000
+#endif
+
 namespace Module {
 
   /**
@@ -51,7 +56,6 @@ namespace Module {
       OxygenMonitor();
       ~OxygenMonitor() = default;
       void _init();
-      static void onO2MonitorTimeoutFinishedCallback(); 
   };
 
 } // namespace Subsystems
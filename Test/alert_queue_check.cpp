@@ -0,0 +1,89 @@
+/****************************************************************************//**
+ * @file alert_queue_check.cpp
+ * @author Gonzalo Puy.
+ * @date Jun 2025
+ * @brief Host check of the alert queue.
+ *
+ * Build and run from the repository root:
+ *   g++ -std=c++14 -ITest/host -ISrc/Utils -ISrc/oxygen_monitor/Modules/Telegram_bot -ISrc/oxygen_monitor/Modules/tank_monitor \
+ *       Test/alert_queue_check.cpp Src/oxygen_monitor/Modules/Telegram_bot/alert_queue.cpp -o alert_queue_check
+ *   ./alert_queue_check
+ *******************************************************************************/
+
+#include <cstdio>
+#include "alert_queue.h"
+
+static int failures = 0;
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            printf("FAILED %s:%d: %s\n", __FILE__, __LINE__, #condition); \
+            failures++; \
+        } \
+    } while (0)
+
+//-----------------------------------------------------------------------------
+// A LOW broadcast reaches some users, then the tank recovers: they must be told.
+static void checkRecoveryAfterPartialBroadcast()
+{
+    Module::AlertQueue queue;
+    alert_t pending[ALERT_QUEUE_SIZE];
+    uint32_t sending;
+
+    CHECK(queue.push(ALERT_TANK_LOW, TANK_LEVEL_LOW, 0));
+    queue.peek(pending, sending);
+    queue.markSending(sending);
+
+    // Superseded while the broadcast is paused, some users got it.
+    CHECK(queue.push(ALERT_TANK_STATE, TANK_LEVEL_OK, 10));
+    queue.markDelivered(sending);
+
+    CHECK(!queue.isEmpty());
+    CHECK(queue.peek(pending, sending) == 1);
+    CHECK((pending[0].kind == ALERT_TANK_STATE) && (pending[0].state == TANK_LEVEL_OK));
+}
+
+//-----------------------------------------------------------------------------
+// LOW followed by OK while nothing was sent: nothing worth telling.
+static void checkChangeBackWhileOffline()
+{
+    Module::AlertQueue queue;
+
+    CHECK(queue.push(ALERT_TANK_LOW, TANK_LEVEL_LOW, 0));
+    CHECK(!queue.push(ALERT_TANK_STATE, TANK_LEVEL_OK, 10));
+    CHECK(queue.isEmpty());
+}
+
+//-----------------------------------------------------------------------------
+// Once OK is delivered, a repeated OK is not queued again.
+static void checkDeliveredStateKept()
+{
+    Module::AlertQueue queue;
+    alert_t pending[ALERT_QUEUE_SIZE];
+    uint32_t sending;
+
+    CHECK(queue.push(ALERT_TANK_STATE, TANK_LEVEL_UNKNOWN, 0));
+    queue.peek(pending, sending);
+    queue.markSending(sending);
+    queue.markDelivered(sending);
+    CHECK(queue.isEmpty());
+
+    CHECK(queue.push(ALERT_TANK_STATE, TANK_LEVEL_OK, 10));
+    queue.peek(pending, sending);
+    queue.markSending(sending);
+    queue.markDelivered(sending);
+    CHECK(!queue.push(ALERT_TANK_STATE, TANK_LEVEL_OK, 20));
+}
+
+//-----------------------------------------------------------------------------
+int main()
+{
+    checkRecoveryAfterPartialBroadcast();
+    checkChangeBackWhileOffline();
+    checkDeliveredStateKept();
+
+    printf("%s\n", (failures == 0) ? "alert_queue: OK" : "alert_queue: FAILED");
+
+    return (failures == 0) ? 0 : 1;
+}
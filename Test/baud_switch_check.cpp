@@ -0,0 +1,214 @@
+/****************************************************************************//**
+ * @file baud_switch_check.cpp
+ * @author Gonzalo Puy.
+ * @date Jun 2025
+ * @brief Host checks of the UART rate negotiation of the ESP32 bridge.
+ *
+ * Runs BaudSwitch as the reader and writer tasks of esp32_main.ino do, with
+ * the response queue in between. Checks that only the baud command
+ * acknowledge switches the rate, not the results queued ahead of it, that a
+ * command read confirms the new rate, and that the bridge goes back to the
+ * base rate when none comes in time or garbage is read above it.
+ *
+ * Build and run from the repository root:
+ *   g++ -std=c++14 -O2 -ISrc/oxygen_monitor/Drivers/wifi_com/Esp32 \
+ *       Test/baud_switch_check.cpp -o baud_switch_check
+ *   ./baud_switch_check
+ *******************************************************************************/
+
+#include <cstdio>
+#include <deque>
+#include "baud_switch.h"
+
+static int failures = 0;
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            printf("FAILED %s:%d: %s\n", __FILE__, __LINE__, #condition); \
+            failures++; \
+        } \
+    } while (0)
+
+#define BASE_RATE           115200
+#define MAX_RATE            5000000
+#define FAST_RATE           921600
+#define CONFIRM_TIMEOUT     1000        // [ms]
+
+//-----------------------------------------------------------------------------
+// Both ends of the bridge UART, with the responses waiting for the writer.
+class Bridge
+{
+    public:
+
+        Bridge() : mSwitch(BASE_RATE, MAX_RATE, CONFIRM_TIMEOUT), mUartRate(BASE_RATE), mIsUartFlowControlled(false), mNow(0) {}
+
+        // Reader task, a worker command: its result is queued later, by the worker.
+        void Command()
+        {
+            mSwitch.onCommand();
+        }
+
+        // Reader task, the baud command answered right away.
+        bool Baud(uint32_t baudRate, bool isFlowControlled)
+        {
+            mSwitch.onCommand();
+
+            const bool isOk = mSwitch.request(baudRate, isFlowControlled);
+
+            mQueue.push_back(mSwitch.takeRequest());
+            return isOk;
+        }
+
+        // Worker task or event, a response without switch.
+        void Queue()
+        {
+            mQueue.push_back(mSwitch.takeRequest());
+        }
+
+        void Garbage()
+        {
+            if (mSwitch.onGarbage()) {
+                _SetUart(BASE_RATE, false);
+            }
+        }
+
+        // Writer task, one response out.
+        bool Write()
+        {
+            if (mQueue.empty()) {
+                return false;
+            }
+
+            const uint32_t switchBaud = mQueue.front();
+
+            mQueue.pop_front();
+            if (mSwitch.onSent(switchBaud, mNow)) {
+                _SetUart(mSwitch.getRate(), mSwitch.isFlowControlled());
+            }
+            return true;
+        }
+
+        // loop()
+        void Advance(unsigned long milliseconds)
+        {
+            mNow += milliseconds;
+            if (mSwitch.update(mNow)) {
+                _SetUart(BASE_RATE, false);
+            }
+        }
+
+        uint32_t GetUartRate() const { return mUartRate; }
+
+        bool IsUartFlowControlled() const { return mIsUartFlowControlled; }
+
+        bool IsSwitchPending() const { return mSwitch.isSwitchPending(); }
+
+    private:
+
+        void _SetUart(uint32_t baudRate, bool isFlowControlled)
+        {
+            mUartRate = baudRate;
+            mIsUartFlowControlled = isFlowControlled;
+        }
+
+        BaudSwitch mSwitch;
+        std::deque<uint32_t> mQueue;
+        uint32_t mUartRate;
+        bool mIsUartFlowControlled;
+        unsigned long mNow;
+};
+
+//-----------------------------------------------------------------------------
+static void checkRange()
+{
+    Bridge bridge;
+
+    CHECK(!bridge.Baud(BASE_RATE / 2, false));
+    CHECK(!bridge.Baud(MAX_RATE + 1, false));
+    CHECK(!bridge.IsSwitchPending());
+    while (bridge.Write()) {
+    }
+    CHECK(bridge.GetUartRate() == BASE_RATE);
+}
+
+//-----------------------------------------------------------------------------
+// Results queued ahead of the acknowledge go out at the base rate, the ones
+// after it at the new rate.
+static void checkSwitch()
+{
+    Bridge bridge;
+
+    bridge.Command();
+    bridge.Queue();
+    CHECK(bridge.Baud(FAST_RATE, true));
+    bridge.Queue();
+    CHECK(bridge.IsSwitchPending());
+
+    CHECK(bridge.Write());
+    CHECK(bridge.GetUartRate() == BASE_RATE);
+
+    // Garbage while the acknowledge is on its way is read at the base rate.
+    bridge.Garbage();
+    CHECK(bridge.IsSwitchPending());
+
+    CHECK(bridge.Write());
+    CHECK(bridge.GetUartRate() == FAST_RATE);
+    CHECK(bridge.IsUartFlowControlled());
+    CHECK(!bridge.IsSwitchPending());
+
+    CHECK(bridge.Write());
+    CHECK(bridge.GetUartRate() == FAST_RATE);
+
+    // Confirmed by the next command: kept for good.
+    bridge.Advance(CONFIRM_TIMEOUT / 2);
+    bridge.Command();
+    bridge.Advance(10 * CONFIRM_TIMEOUT);
+    CHECK(bridge.GetUartRate() == FAST_RATE);
+
+    // Garbage above the base rate: the Nucleo restarted.
+    bridge.Garbage();
+    CHECK(bridge.GetUartRate() == BASE_RATE);
+    CHECK(!bridge.IsUartFlowControlled());
+    bridge.Garbage();
+    CHECK(bridge.GetUartRate() == BASE_RATE);
+}
+
+//-----------------------------------------------------------------------------
+static void checkFallback()
+{
+    Bridge bridge;
+
+    CHECK(bridge.Baud(FAST_RATE, false));
+    bridge.Advance(10 * CONFIRM_TIMEOUT);
+    CHECK(bridge.GetUartRate() == BASE_RATE);
+
+    // Nothing comes at the new rate.
+    CHECK(bridge.Write());
+    CHECK(bridge.GetUartRate() == FAST_RATE);
+    bridge.Advance(CONFIRM_TIMEOUT - 1);
+    CHECK(bridge.GetUartRate() == FAST_RATE);
+    bridge.Advance(1);
+    CHECK(bridge.GetUartRate() == BASE_RATE);
+
+    // Negotiated again.
+    CHECK(bridge.Baud(FAST_RATE, false));
+    CHECK(bridge.Write());
+    bridge.Command();
+    bridge.Advance(10 * CONFIRM_TIMEOUT);
+    CHECK(bridge.GetUartRate() == FAST_RATE);
+}
+
+//-----------------------------------------------------------------------------
+int main()
+{
+    checkRange();
+    checkSwitch();
+    checkFallback();
+
+    if (failures == 0) {
+        printf("baud_switch: OK\n");
+    }
+
+    return (failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,243 @@
+/****************************************************************************//**
+ * @file config_store_check.cpp
+ * @author Gonzalo Puy.
+ * @date Jun 2025
+ * @brief Power loss checks of the config store on the RAM flash stand-in.
+ *
+ * Records are written through ConfigStore as the firmware does, with the power
+ * cut at random byte offsets of the write, and the monitor is booted again
+ * after each one. The configuration restored must always be the one of the
+ * last record written whole. Also checks erased slots and sequence numbers
+ * wrapping around, on records placed in the slots by hand.
+ *
+ * Build and run from the repository root, with ArduinoJson next to the sources:
+ *   g++ -std=c++14 -O2 -ITest/host -Iarduinojson/src -ISrc -ISrc/Utils \
+ *       $(find Src/oxygen_monitor -type d -printf '-I%p ') \
+ *       Test/config_store_check.cpp $(find Src -name '*.cpp' ! -name main.cpp) -o config_store_check
+ *   ./config_store_check [seed]
+ *******************************************************************************/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "config_store.h"
+#include "crc.h"
+#include "flash_storage.h"
+#include "mbed.h"
+#include "tank_monitor.h"
+
+static int failures = 0;
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            printf("FAILED %s:%d: %s\n", __FILE__, __LINE__, #condition); \
+            failures++; \
+        } \
+    } while (0)
+
+#define FUZZ_WRITES         2000
+#define NO_FLOW             999.0f      // Gas flow set before a boot, left as is when nothing is restored.
+
+static Drivers::FlashStorage flash;     // Same contents as the one of the config store.
+
+//-----------------------------------------------------------------------------
+static uint32_t random32(uint64_t& seed)
+{
+    seed ^= seed << 13;
+    seed ^= seed >> 7;
+    seed ^= seed << 17;
+    return (uint32_t) (seed >> 16);
+}
+
+//-----------------------------------------------------------------------------
+// Tank configurations told apart by their gas flow.
+static tank_config_t makeConfig(float gasFlow)
+{
+    tank_config_t config;
+
+    memset(&config, 0, sizeof(config));
+    config.unit = TANK_UNIT_BAR;
+    config.tankRegistered = true;
+    strncpy(config.tankType, "E", TANK_NAME_SIZE - 1);
+    config.gasFlow = gasFlow;
+
+    return config;
+}
+
+//-----------------------------------------------------------------------------
+static float restoredFlow()
+{
+    tank_config_t config;
+
+    Module::TankMonitor::getInstance().getConfig(config);
+    return config.gasFlow;
+}
+
+//-----------------------------------------------------------------------------
+// Boots again: the modules lose their configuration and the store restores it.
+static float reboot()
+{
+    Module::TankMonitor::getInstance().setConfig(makeConfig(NO_FLOW));
+    Module::ConfigStore::init();
+    return restoredFlow();
+}
+
+//-----------------------------------------------------------------------------
+// Configuration changed by a command, written once the store finds it due.
+static void save(float gasFlow)
+{
+    const uint64_t due = (uint64_t) (CONFIG_WRITE_DELAY + CONFIG_WRITE_MIN_INTERVAL + 1) * 1000;
+
+    Module::TankMonitor::getInstance().setConfig(makeConfig(gasFlow));
+    Module::ConfigStore::getInstance().requestSave();
+    HostClock::Advance(HostClock::Now() + due);
+    Module::ConfigStore::getInstance().update();
+}
+
+//-----------------------------------------------------------------------------
+// Record placed by hand, as an earlier firmware would have left it.
+static void place(int slot, uint32_t sequence, float gasFlow)
+{
+    config_record_t record;
+
+    memset(&record, 0, sizeof(record));
+    record.magic = CONFIG_RECORD_MAGIC;
+    record.version = CONFIG_RECORD_VERSION;
+    record.size = sizeof(config_record_t);
+    record.sequence = sequence;
+    record.tank = makeConfig(gasFlow);
+    record.crc = Util::Crc32::Compute(&record, offsetof(config_record_t, crc));
+    CHECK(flash.write(slot, &record, sizeof(record)));
+}
+
+//-----------------------------------------------------------------------------
+static void erase(int slot)
+{
+    Drivers::FlashStorage::hostCutPower(0);
+    flash.write(slot, "", 1);
+}
+
+//-----------------------------------------------------------------------------
+// A record cut short may still be whole if the bytes left out were erased
+// bytes in the record anyway.
+static bool isWhole(int slot)
+{
+    config_record_t record;
+
+    flash.read(slot, &record, sizeof(record));
+    return (record.magic == CONFIG_RECORD_MAGIC) &&
+           (record.crc == Util::Crc32::Compute(&record, offsetof(config_record_t, crc)));
+}
+
+//-----------------------------------------------------------------------------
+static void checkHandPlaced()
+{
+    // Nothing stored yet.
+    erase(0);
+    erase(1);
+    CHECK(reboot() == NO_FLOW);
+
+    // A single record, in either slot, with the other one erased.
+    place(0, 7, 1.5f);
+    CHECK(reboot() == 1.5f);
+    erase(0);
+    place(1, 7, 2.5f);
+    CHECK(reboot() == 2.5f);
+
+    // Highest sequence wins, whatever the slot.
+    place(0, 8, 3.5f);
+    CHECK(reboot() == 3.5f);
+    place(1, 9, 4.5f);
+    CHECK(reboot() == 4.5f);
+
+    // Sequence wrapping around: 0 comes after 0xFFFFFFFF.
+    place(0, 0xFFFFFFFF, 5.5f);
+    place(1, 0, 6.5f);
+    CHECK(reboot() == 6.5f);
+    place(0, 0xFFFFFFFE, 7.5f);
+    place(1, 0xFFFFFFFF, 8.5f);
+    CHECK(reboot() == 8.5f);
+    place(0, 0, 9.5f);
+    CHECK(reboot() == 9.5f);
+
+    // Written records keep counting across the wrap.
+    save(10.5f);
+    CHECK(reboot() == 10.5f);
+    save(11.5f);
+    CHECK(reboot() == 11.5f);
+
+    // Bad CRC next to a good record.
+    place(0, 20, 12.5f);
+    place(1, 21, 13.5f);
+    {
+        config_record_t record;
+
+        flash.read(1, &record, sizeof(record));
+        record.tank.gasFlow = 14.5f;
+        flash.write(1, &record, sizeof(record));
+    }
+    CHECK(reboot() == 12.5f);
+}
+
+//-----------------------------------------------------------------------------
+// Writes cut at random offsets, starting close to the sequence wrap.
+static void checkPowerLoss(uint64_t seed)
+{
+    float whole;
+    int current = 0;
+    int torn = 0;
+    int wrong = 0;
+
+    erase(1);
+    place(0, 0xFFFFFFF0, 0.25f);
+    whole = reboot();
+    CHECK(whole == 0.25f);
+
+    for (int i = 0; i < FUZZ_WRITES; i++) {
+        const float gasFlow = 1.0f + (float) i;
+        const int slot = 1 - current;
+        const bool isCut = ((random32(seed) % 2) == 0);
+
+        if (isCut) {
+            Drivers::FlashStorage::hostCutPower(random32(seed) % sizeof(config_record_t));
+            torn++;
+        }
+        save(gasFlow);
+
+        if (!isCut || isWhole(slot)) {
+            whole = gasFlow;
+            current = slot;
+        }
+
+        const float restored = reboot();
+        if (restored != whole) {
+            if (wrong == 0) {
+                printf("write %d: restored gas flow %.2f, last whole record %.2f\n", i, restored, whole);
+            }
+            wrong++;
+        }
+    }
+    CHECK(wrong == 0);
+
+    printf("config_store: %d writes, %d cut short, record of %zu bytes\n", FUZZ_WRITES, torn, sizeof(config_record_t));
+}
+
+//-----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+    const uint64_t seed = (argc > 1) ? strtoull(argv[1], nullptr, 0) : 0x9E3779B97F4A7C15ULL;
+
+    Util::Tick::Init();
+    Module::TankMonitor::init();
+    CHECK(flash.init());
+
+    checkHandPlaced();
+    checkPowerLoss(seed);
+
+    if (failures == 0) {
+        printf("config_store: OK\n");
+    }
+
+    return (failures == 0) ? 0 : 1;
+}
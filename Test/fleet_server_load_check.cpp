@@ -0,0 +1,532 @@
+/****************************************************************************//**
+ * @file fleet_server_load_check.cpp
+ * @author Gonzalo Puy.
+ * @date Jun 2025
+ * @brief Load generator of the multi-threaded fleet server.
+ *
+ * Simulated monitors send telemetry frames to the fleet server on the
+ * loopback, most over several UDP sockets and the rest as lines over TCP,
+ * paced to a target rate, while users ask the fleet bot for /status against
+ * an in-process Bot API. Reports the frame rate applied and the evaluation
+ * latency percentiles, from the frame read off the socket to its tank state
+ * evaluated by the worker. Checks that every monitor ends with the state of
+ * the last frame it sent, that /status answers from the shards, and that the
+ * users were told the last state of every monitor.
+ *
+ * The target is 100k frames/s with p99 evaluation under 1 ms. Both depend on
+ * the cores the threads get, so they are only enforced with --strict.
+ *
+ * Build and run from the repository root, with ArduinoJson next to the sources:
+ *   g++ -std=c++14 -O2 -pthread -IGateway -Iarduinojson/src -ISrc/Utils -ISrc/oxygen_monitor/Modules/Telegram_bot \
+ *       -ISrc/oxygen_monitor/Modules/tank_monitor -ISrc/oxygen_monitor/Modules/telemetry \
+ *       Test/fleet_server_load_check.cpp Gateway/fleet_bot.cpp Gateway/fleet_server.cpp Gateway/fleet_table.cpp \
+ *       Src/oxygen_monitor/Modules/telemetry/telemetry_frame.cpp Src/oxygen_monitor/Modules/tank_monitor/tank_estimator.cpp \
+ *       Src/oxygen_monitor/Modules/tank_monitor/tank_catalogue.cpp Src/Utils/crc.cpp Src/Utils/text_writer.cpp \
+ *       -o fleet_server_load_check
+ *   ./fleet_server_load_check [devices] [frames per second] [seconds] [threads] [--strict]
+ *******************************************************************************/
+
+#include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <netinet/in.h>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#include "fleet_server.h"
+#include "tank_estimator.h"
+
+static int failures = 0;
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            printf("FAILED %s:%d: %s\n", __FILE__, __LINE__, #condition); \
+            failures++; \
+        } \
+    } while (0)
+
+#define USER_COUNT          3
+#define FIRST_USER_ID       540000000ULL
+#define SEND_BATCH          64
+#define UDP_SENDERS         3       // Monitors i % 4 < 3 send over UDP socket i % 4, the rest over TCP.
+#define TARGET_RATE         100000
+#define TARGET_P99_US       1000
+
+//-----------------------------------------------------------------------------
+static uint64_t nowMs()
+{
+    return (uint64_t) std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//-----------------------------------------------------------------------------
+static std::string formField(const std::string& form, const char* key)
+{
+    const std::string prefix = std::string(key) + "=";
+    size_t start = (form.compare(0, prefix.length(), prefix) == 0) ? 0 : form.find("&" + prefix);
+    std::string value;
+
+    if (start == std::string::npos) {
+        return value;
+    }
+    start += (start == 0) ? prefix.length() : (prefix.length() + 1);
+
+    for (size_t i = start; (i < form.length()) && (form[i] != '&'); i++) {
+        if ((form[i] == '%') && ((i + 2) < form.length())) {
+            value += (char) strtol(form.substr(i + 1, 2).c_str(), nullptr, 16);
+            i += 2;
+        } else {
+            value += (form[i] == '+') ? ' ' : form[i];
+        }
+    }
+
+    return value;
+}
+
+//-----------------------------------------------------------------------------
+// Bot API in the test process, called from the bot thread only. Alerts are
+// kept as the last state told per monitor, replies as they come.
+class FakeBotApi : public Gateway::BotApi
+{
+    public:
+
+        FakeBotApi() : mNextUpdateId(1000) {}
+
+        void Send(int user, const std::string& text)
+        {
+            const std::string from = std::to_string(FIRST_USER_ID + user);
+
+            mUpdates.push_back("{\"update_id\":" + std::to_string(mNextUpdateId++) + ",\"message\":{\"message_id\":1,\"from\":{\"id\":" +
+                               from + ",\"is_bot\":false,\"first_name\":\"User" + std::to_string(user) + "\"},\"chat\":{\"id\":" + from +
+                               ",\"type\":\"private\"},\"date\":1750000000,\"text\":\"" + text + "\"}}");
+        }
+
+        bool call(const char* method, const std::string& form, std::string& response) override
+        {
+            if (strcmp(method, "getUpdates") == 0) {
+                response = "{\"ok\":true,\"result\":[";
+                for (size_t i = 0; i < mUpdates.size(); i++) {
+                    response += ((i > 0) ? "," : "") + mUpdates[i];
+                }
+                response += "]}";
+                mUpdates.clear();
+                return true;
+            }
+
+            const int user = (int) (strtoull(formField(form, "chat_id").c_str(), nullptr, 10) - FIRST_USER_ID);
+            const std::string text = formField(form, "text");
+
+            if ((user < 0) || (user >= USER_COUNT)) {
+                return false;
+            }
+
+            mReplies[user].push_back(text);
+            _Scan(user, text);
+            response = "{\"ok\":true,\"result\":{}}";
+            return true;
+        }
+
+        const std::vector<std::string>& GetReplies(int user) const { return mReplies[user]; }
+
+        uint8_t GetToldState(int user, uint16_t deviceId) const
+        {
+            auto told = mTold[user].find(deviceId);
+            return (told == mTold[user].end()) ? (uint8_t) TANK_LEVEL_OK : told->second;
+        }
+
+    private:
+
+        // Keeps the state of every "[Device N]" alert block of a message.
+        void _Scan(int user, const std::string& text)
+        {
+            size_t cursor = 0;
+
+            while ((cursor = text.find("[Device ", cursor)) != std::string::npos) {
+                const uint16_t deviceId = (uint16_t) atoi(text.c_str() + cursor + 8);
+                const size_t body = text.find('\n', cursor) + 1;
+
+                if (text.compare(body, strlen(ALERT_TANK_EMPTY), ALERT_TANK_EMPTY) == 0) {
+                    mTold[user][deviceId] = TANK_LEVEL_LOW;
+                } else if (text.compare(body, strlen(ALERT_TANK_OK), ALERT_TANK_OK) == 0) {
+                    mTold[user][deviceId] = TANK_LEVEL_OK;
+                } else if (text.compare(body, strlen(ALERT_TANK_UNKNOWN), ALERT_TANK_UNKNOWN) == 0) {
+                    mTold[user][deviceId] = TANK_LEVEL_UNKNOWN;
+                }
+                cursor = body;
+            }
+        }
+
+        std::vector<std::string> mUpdates;
+        std::vector<std::string> mReplies[USER_COUNT];
+        std::map<uint16_t, uint8_t> mTold[USER_COUNT];
+        uint64_t mNextUpdateId;
+};
+
+//-----------------------------------------------------------------------------
+// A monitor emptying its tank at its own pace, refilled now and then. The
+// state kept is the one the server evaluates from the pressure sent.
+struct device_t
+{
+    uint16_t id;
+    uint32_t sequence;
+    float pressure;
+    float drop;
+    uint8_t state;
+    int32_t pressureCenti;
+};
+
+static uint32_t random32(uint64_t& seed)
+{
+    seed ^= seed << 13;
+    seed ^= seed >> 7;
+    seed ^= seed << 17;
+    return (uint32_t) (seed >> 16);
+}
+
+static void stepDevice(device_t& device, uint64_t& seed, Util::TextWriter& frame)
+{
+    telemetry_frame_t sent = {};
+
+    device.pressure -= device.drop;
+    if ((device.pressure < 20) && ((random32(seed) % 8) == 0)) {
+        device.pressure = 150;
+    }
+    // A sensor unplugged now and then.
+    const bool isUnplugged = ((random32(seed) % 1000) == 0);
+
+    device.sequence++;
+    device.pressureCenti = isUnplugged ? 0 : (int32_t) (device.pressure * 100);
+    device.state = Module::TankEstimator::getState(device.pressureCenti / 100.0f, TANK_UNIT_BAR);
+
+    sent.deviceId = device.id;
+    sent.sequence = device.sequence;
+    sent.state = device.state;
+    sent.tankRegistered = true;
+    sent.unit = 'B';
+    sent.pressureCenti = device.pressureCenti;
+    sent.gasFlowCenti = 200;
+    sent.timeLeft = (int32_t) ((device.pressure - 30) * 10 / 2);
+
+    Module::TelemetryFrame::encode(sent, frame);
+}
+
+//-----------------------------------------------------------------------------
+static int openSender(int type, uint16_t port)
+{
+    const int socketFd = socket(AF_INET, type, 0);
+    const int sendBuffer = 1 << 20;
+    struct sockaddr_in address;
+
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    setsockopt(socketFd, SOL_SOCKET, SO_SNDBUF, &sendBuffer, sizeof(sendBuffer));
+    if (connect(socketFd, (const struct sockaddr*) &address, sizeof(address)) != 0) {
+        close(socketFd);
+        return -1;
+    }
+
+    return socketFd;
+}
+
+//-----------------------------------------------------------------------------
+// Monitors send over UDP or TCP, each always over the same socket so its
+// frames arrive in order.
+class Senders
+{
+    public:
+
+        Senders(uint16_t udpPort, uint16_t tcpPort)
+        {
+            for (int i = 0; i < UDP_SENDERS; i++) {
+                mUdpFds[i] = openSender(SOCK_DGRAM, udpPort);
+                CHECK(mUdpFds[i] >= 0);
+            }
+            mTcpFd = openSender(SOCK_STREAM, tcpPort);
+            CHECK(mTcpFd >= 0);
+        }
+
+        ~Senders()
+        {
+            for (int fd : mUdpFds) {
+                close(fd);
+            }
+            close(mTcpFd);
+        }
+
+        void Add(size_t device, const char* frame)
+        {
+            const size_t path = device % (UDP_SENDERS + 1);
+
+            if (path == UDP_SENDERS) {
+                mStream += frame;
+                mStream += '\n';
+            } else {
+                mBatches[path].push_back(frame);
+                if (mBatches[path].size() == SEND_BATCH) {
+                    _SendBatch(path);
+                }
+            }
+        }
+
+        void Flush()
+        {
+            for (size_t path = 0; path < UDP_SENDERS; path++) {
+                _SendBatch(path);
+            }
+
+            size_t written = 0;
+            while (written < mStream.length()) {
+                const ssize_t length = write(mTcpFd, mStream.data() + written, mStream.length() - written);
+                if (length <= 0) {
+                    break;
+                }
+                written += (size_t) length;
+            }
+            mStream.clear();
+        }
+
+    private:
+
+        void _SendBatch(size_t path)
+        {
+            struct mmsghdr messages[SEND_BATCH];
+            struct iovec vectors[SEND_BATCH];
+            std::vector<std::string>& frames = mBatches[path];
+
+            memset(messages, 0, sizeof(messages));
+            for (size_t i = 0; i < frames.size(); i++) {
+                vectors[i].iov_base = const_cast<char*>(frames[i].data());
+                vectors[i].iov_len = frames[i].length();
+                messages[i].msg_hdr.msg_iov = &vectors[i];
+                messages[i].msg_hdr.msg_iovlen = 1;
+            }
+
+            if (!frames.empty()) {
+                sendmmsg(mUdpFds[path], messages, (unsigned int) frames.size(), 0);
+            }
+            frames.clear();
+        }
+
+        int mUdpFds[UDP_SENDERS];
+        int mTcpFd;
+        std::vector<std::string> mBatches[UDP_SENDERS];
+        std::string mStream;
+};
+
+//-----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+    const bool isStrict = (argc > 1) && (strcmp(argv[argc - 1], "--strict") == 0);
+    const int args = isStrict ? (argc - 1) : argc;
+    const int deviceCount = (args > 1) ? atoi(argv[1]) : 10000;
+    const int rate = (args > 2) ? atoi(argv[2]) : TARGET_RATE;
+    const double seconds = (args > 3) ? atof(argv[3]) : 2.0;
+    const int threadCount = (args > 4) ? atoi(argv[4]) : 2;
+    const fleet_server_config_t config = { 0, 0, (size_t) threadCount, (size_t) threadCount, (size_t) deviceCount };
+    FakeBotApi api;
+    Gateway::FleetServer server(api, config);
+    std::vector<device_t> devices((size_t) deviceCount);
+    uint64_t seed = 0x9E3779B97F4A7C15ULL;
+
+    if (!server.start()) {
+        printf("FAILED: fleet server not started\n");
+        return 1;
+    }
+
+    for (int i = 0; i < deviceCount; i++) {
+        devices[i].id = (uint16_t) (i + 1);
+        devices[i].sequence = 0;
+        devices[i].pressure = 20 + (random32(seed) % 130);
+        devices[i].drop = 0.05f + (random32(seed) % 100) / 1000.0f;
+        devices[i].state = TANK_LEVEL_OK;
+    }
+
+    for (int user = 0; user < USER_COUNT; user++) {
+        api.Send(user, COMMAND_START_STR);
+    }
+
+    // Load: every monitor in turn, paced to the rate, from another thread.
+    std::atomic<bool> isSending(true);
+    uint64_t framesSent = 0;
+    const uint64_t start = nowMs();
+
+    std::thread sender([&]() {
+        Senders senders(server.getUdpPort(), server.getTcpPort());
+        Util::TextBuffer<FLEET_SERVER_FRAME_SIZE> frame;
+        size_t next = 0;
+
+        while ((nowMs() - start) < (uint64_t) (seconds * 1000)) {
+            const uint64_t due = (uint64_t) ((nowMs() - start) * (double) rate / 1000);
+
+            if (framesSent >= due) {
+                std::this_thread::sleep_for(std::chrono::microseconds(200));
+                continue;
+            }
+
+            for (int i = 0; (i < (SEND_BATCH * (UDP_SENDERS + 1))) && (framesSent < due); i++) {
+                stepDevice(devices[next], seed, frame);
+                senders.Add(next, frame.c_str());
+                next = (next + 1) % devices.size();
+                framesSent++;
+            }
+            senders.Flush();
+        }
+
+        isSending = false;
+    });
+
+    int question = 0;
+
+    while (isSending) {
+        const uint64_t now = nowMs();
+
+        // Now and then a user asks about a monitor, answered by its shard.
+        if (((now - start) / 100) > (uint64_t) question) {
+            api.Send(question % USER_COUNT, std::string(COMMAND_TANK_STATUS_STR) + " " + std::to_string(1 + (question * 7919) % deviceCount));
+            question++;
+        }
+        server.update(now, 1);
+    }
+    sender.join();
+
+    const double elapsed = (nowMs() - start) / 1000.0;
+
+    // Whatever is still queued in the sockets and to the workers.
+    for (int i = 0; i < 100; i++) {
+        server.update(nowMs(), 1);
+    }
+
+    const fleet_server_counters_t loadCounters = server.getCounters();
+    const uint32_t p50 = server.getLatencyPercentile(50);
+    const uint32_t p99 = server.getLatencyPercentile(99);
+    const uint32_t p999 = server.getLatencyPercentile(99.9);
+
+    // Last frame of every monitor, sent slowly enough to never be dropped.
+    {
+        Senders senders(server.getUdpPort(), server.getTcpPort());
+        Util::TextBuffer<FLEET_SERVER_FRAME_SIZE> frame;
+
+        for (size_t i = 0; i < devices.size(); i++) {
+            stepDevice(devices[i], seed, frame);
+            senders.Add(i, frame.c_str());
+            if (((i + 1) % SEND_BATCH) == 0) {
+                senders.Flush();
+                server.update(nowMs(), 2);
+            }
+        }
+        senders.Flush();
+        for (int i = 0; i < 50; i++) {
+            server.update(nowMs(), 10);
+        }
+    }
+
+    // Every monitor holds what it sent last, whichever shard and path it took.
+    uint32_t stateCount[TANK_LEVEL_UNKNOWN + 1] = {};
+    int mismatches = 0;
+
+    for (const device_t& device : devices) {
+        fleet_entry_t entry;
+        const bool isFound = server.getEntry(device.id, entry);
+
+        stateCount[device.state]++;
+        mismatches += (!isFound || (entry.state != device.state) || (entry.sequence != device.sequence) ||
+                       (entry.pressureCenti != device.pressureCenti)) ? 1 : 0;
+    }
+    CHECK(mismatches == 0);
+
+    fleet_summary_t summary;
+    server.getSummary((uint32_t) (nowMs() / 1000), FLEET_BOT_SILENCE, summary);
+    CHECK(summary.devices == (uint32_t) deviceCount);
+    CHECK(summary.stateCount[TANK_LEVEL_OK] == stateCount[TANK_LEVEL_OK]);
+    CHECK(summary.stateCount[TANK_LEVEL_LOW] == stateCount[TANK_LEVEL_LOW]);
+    CHECK(summary.stateCount[TANK_LEVEL_UNKNOWN] == stateCount[TANK_LEVEL_UNKNOWN]);
+    CHECK(summary.lowListed == ((stateCount[TANK_LEVEL_LOW] < FLEET_VIEW_LIST_MAX) ? stateCount[TANK_LEVEL_LOW] : FLEET_VIEW_LIST_MAX));
+
+    // Every user ends up told the last state of every monitor, one message a second.
+    uint64_t botTime = nowMs();
+    int alertRounds = 0;
+
+    while (server.getBot().hasPendingAlerts() && (alertRounds < 10000)) {
+        botTime += FLEET_BOT_POLL_INTERVAL;
+        server.update(botTime, 0);
+        alertRounds++;
+    }
+    CHECK(!server.getBot().hasPendingAlerts());
+
+    for (int user = 0; user < USER_COUNT; user++) {
+        int wrong = 0;
+
+        for (const device_t& device : devices) {
+            wrong += (api.GetToldState(user, device.id) != device.state) ? 1 : 0;
+        }
+        CHECK(wrong == 0);
+    }
+
+    // Fleet /status, a monitor by ID, one that never reported, bad lines.
+    const device_t& asked = devices[devices.size() / 2];
+    char expected[96];
+
+    api.Send(0, COMMAND_TANK_STATUS_STR);
+    api.Send(1, std::string(COMMAND_TANK_STATUS_STR) + " " + std::to_string(asked.id));
+    api.Send(2, std::string(COMMAND_TANK_STATUS_STR) + " 65000");
+    botTime += FLEET_BOT_POLL_INTERVAL;
+    server.update(botTime, 0);
+
+    snprintf(expected, sizeof(expected), "\nDevices: %d\nLow: %u\n", deviceCount, stateCount[TANK_LEVEL_LOW]);
+    CHECK(api.GetReplies(0).back().find(expected) != std::string::npos);
+    snprintf(expected, sizeof(expected), "[Device %d]\n", asked.id);
+    CHECK(api.GetReplies(1).back().find(expected) == 0);
+    if ((asked.state == TANK_LEVEL_OK) && (asked.sequence > 0)) {
+        snprintf(expected, sizeof(expected), "%.2f", asked.pressureCenti / 100.0);
+        CHECK(api.GetReplies(1).back().find(expected) != std::string::npos);
+    }
+    CHECK(api.GetReplies(2).back().find("Device 65000 is not reporting") != std::string::npos);
+
+    {
+        const uint64_t badBefore = server.getCounters().badFrames;
+        const int tcpFd = openSender(SOCK_STREAM, server.getTcpPort());
+        const std::string lines = "1,2,3\n" + std::string(2 * FLEET_SERVER_FRAME_SIZE, '9') + "\n";
+
+        CHECK(write(tcpFd, lines.data(), lines.length()) == (ssize_t) lines.length());
+        for (int i = 0; (i < 100) && (server.getCounters().badFrames < (badBefore + 2)); i++) {
+            server.update(nowMs(), 10);
+        }
+        CHECK(server.getCounters().badFrames == (badBefore + 2));
+        close(tcpFd);
+    }
+
+    const uint64_t applied = loadCounters.frames + loadCounters.oldFrames;
+
+    printf("fleet_server_load: %d monitors, %d I/O threads, %d workers, %u cores\n",
+           deviceCount, threadCount, threadCount, std::thread::hardware_concurrency());
+    printf("fleet_server_load: %llu frames sent in %.1f s (%.0f frames/s), %llu applied (%.0f frames/s), "
+           "%llu dropped by the queues, %llu by the sockets\n",
+           (unsigned long long) framesSent, elapsed, framesSent / elapsed, (unsigned long long) loadCounters.frames,
+           loadCounters.frames / elapsed, (unsigned long long) loadCounters.droppedFrames,
+           (unsigned long long) (framesSent - applied - loadCounters.droppedFrames));
+    printf("fleet_server_load: evaluation latency p50 %u us, p99 %u us, p99.9 %u us, %llu state changes, %d alert rounds\n",
+           p50, p99, p999, (unsigned long long) loadCounters.stateChanges, alertRounds);
+
+    if (isStrict) {
+        CHECK((loadCounters.frames / elapsed) >= (rate * 0.95));
+        CHECK(p99 < TARGET_P99_US);
+    }
+
+    server.stop();
+
+    if (failures == 0) {
+        printf("fleet_server_load: OK\n");
+    }
+
+    return (failures == 0) ? 0 : 1;
+}
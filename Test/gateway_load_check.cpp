@@ -0,0 +1,469 @@
+/****************************************************************************//**
+ * @file gateway_load_check.cpp
+ * @author Gonzalo Puy.
+ * @date Jun 2025
+ * @brief Load test of the gateway aggregator with simulated monitors.
+ *
+ * Thousands of monitors send telemetry frames over UDP on the loopback while
+ * users ask the fleet bot for /status, against an in-process Bot API. Checks
+ * that every monitor ends with the state it sent last, that /status answers
+ * about the monitor asked for, and that the users were told the last state of
+ * every monitor. Reports the frame rate taken and the ingest cost per frame.
+ *
+ * Build and run from the repository root, with ArduinoJson next to the sources:
+ *   g++ -std=c++14 -O2 -pthread -IGateway -Iarduinojson/src -ISrc/Utils -ISrc/oxygen_monitor/Modules/Telegram_bot \
+ *       -ISrc/oxygen_monitor/Modules/tank_monitor -ISrc/oxygen_monitor/Modules/telemetry \
+ *       Test/gateway_load_check.cpp Gateway/aggregator.cpp Gateway/fleet_bot.cpp Gateway/fleet_table.cpp \
+ *       Src/oxygen_monitor/Modules/telemetry/telemetry_frame.cpp Src/Utils/text_writer.cpp -o gateway_load_check
+ *   ./gateway_load_check [devices] [frames per second] [seconds]
+ *******************************************************************************/
+
+#include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <netinet/in.h>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#include "aggregator.h"
+
+static int failures = 0;
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            printf("FAILED %s:%d: %s\n", __FILE__, __LINE__, #condition); \
+            failures++; \
+        } \
+    } while (0)
+
+#define USER_COUNT          3
+#define FIRST_USER_ID       540000000ULL
+#define SEND_BATCH          64
+
+//-----------------------------------------------------------------------------
+static uint64_t nowMs()
+{
+    return (uint64_t) std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//-----------------------------------------------------------------------------
+static std::string formField(const std::string& form, const char* key)
+{
+    const std::string prefix = std::string(key) + "=";
+    size_t start = (form.compare(0, prefix.length(), prefix) == 0) ? 0 : form.find("&" + prefix);
+    std::string value;
+
+    if (start == std::string::npos) {
+        return value;
+    }
+    start += (start == 0) ? prefix.length() : (prefix.length() + 1);
+
+    for (size_t i = start; (i < form.length()) && (form[i] != '&'); i++) {
+        if ((form[i] == '%') && ((i + 2) < form.length())) {
+            value += (char) strtol(form.substr(i + 1, 2).c_str(), nullptr, 16);
+            i += 2;
+        } else {
+            value += (form[i] == '+') ? ' ' : form[i];
+        }
+    }
+
+    return value;
+}
+
+//-----------------------------------------------------------------------------
+// Bot API in the test process. Replies to /status are checked against the
+// table as they are sent, alerts are kept as the last state told per monitor.
+class FakeBotApi : public Gateway::BotApi
+{
+    public:
+
+        FakeBotApi() : mTable(nullptr), mNextUpdateId(1000), mStatusReplies(0), mBadReplies(0) {}
+
+        void SetTable(const Gateway::FleetTable* table) { mTable = table; }
+
+        void Send(int user, const std::string& text)
+        {
+            const std::string from = std::to_string(FIRST_USER_ID + user);
+
+            mUpdates.push_back("{\"update_id\":" + std::to_string(mNextUpdateId++) + ",\"message\":{\"message_id\":1,\"from\":{\"id\":" +
+                               from + ",\"is_bot\":false,\"first_name\":\"User" + std::to_string(user) + "\"},\"chat\":{\"id\":" + from +
+                               ",\"type\":\"private\"},\"date\":1750000000,\"text\":\"" + text + "\"}}");
+        }
+
+        bool call(const char* method, const std::string& form, std::string& response) override
+        {
+            if (strcmp(method, "getUpdates") == 0) {
+                response = "{\"ok\":true,\"result\":[";
+                for (size_t i = 0; i < mUpdates.size(); i++) {
+                    response += ((i > 0) ? "," : "") + mUpdates[i];
+                }
+                response += "]}";
+                mUpdates.clear();
+                return true;
+            }
+
+            const int user = (int) (strtoull(formField(form, "chat_id").c_str(), nullptr, 10) - FIRST_USER_ID);
+            const std::string text = formField(form, "text");
+
+            if ((user < 0) || (user >= USER_COUNT)) {
+                mBadReplies++;
+                return false;
+            }
+
+            mReplies[user].push_back(text);
+            _Scan(user, text);
+            response = "{\"ok\":true,\"result\":{}}";
+            return true;
+        }
+
+        const std::vector<std::string>& GetReplies(int user) const { return mReplies[user]; }
+
+        uint8_t GetToldState(int user, uint16_t deviceId) const
+        {
+            auto told = mTold[user].find(deviceId);
+            return (told == mTold[user].end()) ? (uint8_t) TANK_LEVEL_OK : told->second;
+        }
+
+        int GetStatusReplies() const { return mStatusReplies; }
+
+        int GetBadReplies() const { return mBadReplies; }
+
+    private:
+
+        // Splits a message in its "[Device N]" blocks.
+        void _Scan(int user, const std::string& text)
+        {
+            size_t cursor = 0;
+
+            while ((cursor = text.find("[Device ", cursor)) != std::string::npos) {
+                const uint16_t deviceId = (uint16_t) atoi(text.c_str() + cursor + 8);
+                const size_t body = text.find('\n', cursor) + 1;
+
+                if (text.compare(body, strlen(ALERT_TANK_EMPTY), ALERT_TANK_EMPTY) == 0) {
+                    mTold[user][deviceId] = TANK_LEVEL_LOW;
+                } else if (text.compare(body, strlen(ALERT_TANK_OK), ALERT_TANK_OK) == 0) {
+                    mTold[user][deviceId] = TANK_LEVEL_OK;
+                } else if (text.compare(body, strlen(ALERT_TANK_UNKNOWN), ALERT_TANK_UNKNOWN) == 0) {
+                    mTold[user][deviceId] = TANK_LEVEL_UNKNOWN;
+                } else {
+                    _CheckStatus(deviceId, text.substr(body));
+                }
+                cursor = body;
+            }
+        }
+
+        // A /status reply is about the monitor asked for, as the table has it now.
+        void _CheckStatus(uint16_t deviceId, const std::string& status)
+        {
+            const fleet_entry_t* entry = mTable->find(deviceId);
+            char pressure[32];
+
+            mStatusReplies++;
+            if (entry == nullptr) {
+                mBadReplies++;
+                return;
+            }
+
+            snprintf(pressure, sizeof(pressure), "%.2f", entry->pressureCenti / 100.0);
+
+            bool isGood;
+
+            if (entry->state == TANK_LEVEL_LOW) {
+                isGood = (status.find("There is an alert") != std::string::npos);
+            } else if (entry->timeLeft < 0) {
+                isGood = (status.find("Can't get tank status") != std::string::npos);
+            } else {
+                isGood = (status.find(pressure) != std::string::npos);
+            }
+            mBadReplies += isGood ? 0 : 1;
+        }
+
+        const Gateway::FleetTable* mTable;
+        std::vector<std::string> mUpdates;
+        std::vector<std::string> mReplies[USER_COUNT];
+        std::map<uint16_t, uint8_t> mTold[USER_COUNT];
+        uint64_t mNextUpdateId;
+        int mStatusReplies;
+        int mBadReplies;
+};
+
+//-----------------------------------------------------------------------------
+// A monitor emptying its tank at its own pace, refilled now and then.
+struct device_t
+{
+    uint16_t id;
+    uint32_t sequence;
+    float pressure;
+    float drop;
+    uint8_t state;
+};
+
+static uint32_t random32(uint64_t& seed)
+{
+    seed ^= seed << 13;
+    seed ^= seed >> 7;
+    seed ^= seed << 17;
+    return (uint32_t) (seed >> 16);
+}
+
+static void stepDevice(device_t& device, uint64_t& seed, Util::TextWriter& frame)
+{
+    telemetry_frame_t sent = {};
+
+    device.pressure -= device.drop;
+    if ((device.pressure < 20) && ((random32(seed) % 8) == 0)) {
+        device.pressure = 150;
+    }
+    // A sensor unplugged now and then.
+    const bool isUnplugged = ((random32(seed) % 1000) == 0);
+
+    device.state = isUnplugged ? TANK_LEVEL_UNKNOWN : ((device.pressure < PRESSURE_THRESHOLD_BAR) ? TANK_LEVEL_LOW : TANK_LEVEL_OK);
+    device.sequence++;
+
+    sent.deviceId = device.id;
+    sent.sequence = device.sequence;
+    sent.state = device.state;
+    sent.tankRegistered = true;
+    sent.unit = 'B';
+    sent.pressureCenti = isUnplugged ? 0 : (int32_t) (device.pressure * 100);
+    sent.gasFlowCenti = 200;
+    sent.timeLeft = (int32_t) ((device.pressure - 30) * 10 / 2);
+    device.pressure = isUnplugged ? device.pressure : (sent.pressureCenti / 100.0f);
+
+    Module::TelemetryFrame::encode(sent, frame);
+}
+
+//-----------------------------------------------------------------------------
+static int openSender(uint16_t port)
+{
+    const int socketFd = socket(AF_INET, SOCK_DGRAM, 0);
+    const int sendBuffer = 1 << 20;
+    struct sockaddr_in address;
+
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    setsockopt(socketFd, SOL_SOCKET, SO_SNDBUF, &sendBuffer, sizeof(sendBuffer));
+    connect(socketFd, (const struct sockaddr*) &address, sizeof(address));
+
+    return socketFd;
+}
+
+//-----------------------------------------------------------------------------
+static void sendBatch(int socketFd, const std::vector<std::string>& frames)
+{
+    struct mmsghdr messages[SEND_BATCH];
+    struct iovec vectors[SEND_BATCH];
+
+    memset(messages, 0, sizeof(messages));
+    for (size_t i = 0; i < frames.size(); i++) {
+        vectors[i].iov_base = const_cast<char*>(frames[i].data());
+        vectors[i].iov_len = frames[i].length();
+        messages[i].msg_hdr.msg_iov = &vectors[i];
+        messages[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    sendmmsg(socketFd, messages, (unsigned int) frames.size(), 0);
+}
+
+//-----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+    const int deviceCount = (argc > 1) ? atoi(argv[1]) : 5000;
+    const int rate = (argc > 2) ? atoi(argv[2]) : 50000;
+    const double seconds = (argc > 3) ? atof(argv[3]) : 2.0;
+    FakeBotApi api;
+    Gateway::Aggregator aggregator(api, (size_t) deviceCount);
+    std::vector<device_t> devices((size_t) deviceCount);
+    uint64_t seed = 0x9E3779B97F4A7C15ULL;
+
+    api.SetTable(&aggregator.getTable());
+    CHECK(aggregator.open(0));
+
+    for (int i = 0; i < deviceCount; i++) {
+        devices[i].id = (uint16_t) (i + 1);
+        devices[i].sequence = 0;
+        devices[i].pressure = 20 + (random32(seed) % 130);
+        devices[i].drop = 0.05f + (random32(seed) % 100) / 1000.0f;
+        devices[i].state = TANK_LEVEL_OK;
+    }
+
+    for (int user = 0; user < USER_COUNT; user++) {
+        api.Send(user, COMMAND_START_STR);
+    }
+
+    // Load: every monitor in turn, paced to the rate, from another thread.
+    std::atomic<bool> isSending(true);
+    uint64_t framesSent = 0;
+    const uint64_t start = nowMs();
+
+    std::thread sender([&]() {
+        const int socketFd = openSender(aggregator.getPort());
+        Util::TextBuffer<AGGREGATOR_FRAME_SIZE> frame;
+        std::vector<std::string> batch;
+        size_t next = 0;
+
+        while ((nowMs() - start) < (uint64_t) (seconds * 1000)) {
+            const uint64_t due = (uint64_t) ((nowMs() - start) * (double) rate / 1000);
+
+            if (framesSent >= due) {
+                std::this_thread::sleep_for(std::chrono::microseconds(200));
+                continue;
+            }
+
+            batch.clear();
+            while ((batch.size() < SEND_BATCH) && (framesSent < due)) {
+                stepDevice(devices[next], seed, frame);
+                batch.push_back(frame.c_str());
+                next = (next + 1) % devices.size();
+                framesSent++;
+            }
+            sendBatch(socketFd, batch);
+        }
+
+        close(socketFd);
+        isSending = false;
+    });
+
+    int question = 0;
+
+    while (isSending) {
+        const uint64_t now = nowMs();
+
+        // Now and then a user asks about a monitor.
+        if (((now - start) / 100) > (uint64_t) question) {
+            api.Send(question % USER_COUNT, std::string(COMMAND_TANK_STATUS_STR) + " " + std::to_string(1 + (question * 7919) % deviceCount));
+            question++;
+        }
+        aggregator.update(now, 1);
+    }
+    sender.join();
+
+    // Whatever is still queued in the socket.
+    for (int i = 0; i < 100; i++) {
+        aggregator.update(nowMs(), 1);
+    }
+
+    const double elapsed = (nowMs() - start) / 1000.0;
+    const aggregator_counters_t loadCounters = aggregator.getCounters();
+
+    // Last frame of every monitor, sent slowly enough to never be dropped.
+    {
+        const int socketFd = openSender(aggregator.getPort());
+        Util::TextBuffer<AGGREGATOR_FRAME_SIZE> frame;
+        std::vector<std::string> batch;
+
+        for (size_t i = 0; i < devices.size(); i++) {
+            stepDevice(devices[i], seed, frame);
+            batch.push_back(frame.c_str());
+            if ((batch.size() == SEND_BATCH) || ((i + 1) == devices.size())) {
+                sendBatch(socketFd, batch);
+                batch.clear();
+                aggregator.update(nowMs(), 10);
+            }
+        }
+        for (int i = 0; i < 10; i++) {
+            aggregator.update(nowMs(), 10);
+        }
+        close(socketFd);
+    }
+
+    // Every monitor holds what it sent last.
+    const Gateway::FleetTable& table = aggregator.getTable();
+    size_t stateCount[TANK_LEVEL_UNKNOWN + 1] = {};
+    int mismatches = 0;
+
+    CHECK(table.size() == (size_t) deviceCount);
+    for (const device_t& device : devices) {
+        const fleet_entry_t* entry = table.find(device.id);
+
+        stateCount[device.state]++;
+        mismatches += ((entry == nullptr) || (entry->state != device.state) || (entry->sequence != device.sequence)) ? 1 : 0;
+    }
+    CHECK(mismatches == 0);
+    CHECK(table.getStateCount(TANK_LEVEL_OK) == stateCount[TANK_LEVEL_OK]);
+    CHECK(table.getStateCount(TANK_LEVEL_LOW) == stateCount[TANK_LEVEL_LOW]);
+    CHECK(table.getStateCount(TANK_LEVEL_UNKNOWN) == stateCount[TANK_LEVEL_UNKNOWN]);
+
+    // Every user ends up told the last state of every monitor, one message a second.
+    uint64_t botTime = nowMs();
+    int alertRounds = 0;
+
+    while (aggregator.getBot().hasPendingAlerts() && (alertRounds < 10000)) {
+        botTime += FLEET_BOT_POLL_INTERVAL;
+        aggregator.update(botTime, 0);
+        alertRounds++;
+    }
+    CHECK(!aggregator.getBot().hasPendingAlerts());
+
+    for (int user = 0; user < USER_COUNT; user++) {
+        int wrong = 0;
+
+        for (const device_t& device : devices) {
+            wrong += (api.GetToldState(user, device.id) != device.state) ? 1 : 0;
+        }
+        CHECK(wrong == 0);
+    }
+
+    // Fleet /status, a monitor that never reported, bad and repeated frames.
+    api.Send(0, COMMAND_TANK_STATUS_STR);
+    api.Send(1, std::string(COMMAND_TANK_STATUS_STR) + " 65000");
+    botTime += FLEET_BOT_POLL_INTERVAL;
+    aggregator.update(botTime, 0);
+
+    char summary[96];
+    snprintf(summary, sizeof(summary), "\nDevices: %d\nLow: %zu\n", deviceCount, stateCount[TANK_LEVEL_LOW]);
+    CHECK(api.GetReplies(0).back().find(summary) != std::string::npos);
+    CHECK(api.GetReplies(1).back().find("Device 65000 is not reporting") != std::string::npos);
+
+    const aggregator_counters_t before = aggregator.getCounters();
+    Util::TextBuffer<AGGREGATOR_FRAME_SIZE> frame;
+    telemetry_frame_t stale = {};
+
+    stale.deviceId = devices[0].id;
+    stale.sequence = devices[0].sequence - 1;
+    stale.unit = 'B';
+    Module::TelemetryFrame::encode(stale, frame);
+    aggregator.ingest(frame.c_str(), botTime);
+    aggregator.ingest("1,2,3", botTime);
+    CHECK(aggregator.getCounters().oldFrames == (before.oldFrames + 1));
+    CHECK(aggregator.getCounters().badFrames == (before.badFrames + 1));
+    CHECK(api.GetStatusReplies() > 0);
+    CHECK(api.GetBadReplies() == 0);
+
+    // Ingest cost alone, without the socket: a frame parsed and applied.
+    std::vector<std::string> frames;
+    for (int i = 0; i < 200000; i++) {
+        stepDevice(devices[(size_t) i % devices.size()], seed, frame);
+        frames.push_back(frame.c_str());
+    }
+
+    const auto ingestStart = std::chrono::steady_clock::now();
+    for (const std::string& text : frames) {
+        aggregator.ingest(text.c_str(), botTime);
+    }
+    const double ingestNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - ingestStart).count() / frames.size();
+
+    printf("gateway_load: %d monitors, %llu frames sent in %.1f s, %llu applied (%.0f frames/s), %llu dropped by the socket\n",
+           deviceCount, (unsigned long long) framesSent, elapsed, (unsigned long long) loadCounters.frames,
+           loadCounters.frames / elapsed, (unsigned long long) (framesSent - loadCounters.frames - loadCounters.oldFrames));
+    printf("gateway_load: %llu state changes, %d status replies, %d alert rounds, ingest %.0f ns/frame, table %zu KB\n",
+           (unsigned long long) aggregator.getCounters().stateChanges, api.GetStatusReplies(), alertRounds, ingestNs,
+           (table.getCapacity() * sizeof(fleet_entry_t)) / 1024);
+
+    if (failures == 0) {
+        printf("gateway_load: OK\n");
+    }
+
+    return (failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,214 @@
+/****************************************************************************//**
+ * @file gzip_header_check.cpp
+ * @author Gonzalo Puy.
+ * @date Jun 2025
+ * @brief Host gzip round trip of the ESP32 bridge body path.
+ *
+ * Bodies are compressed by zlib as a server would, with every combination of
+ * the optional header fields, and fed to GzipHeader in chunks of random
+ * sizes as HTTPClient::writeToStream() hands them over. The deflate stream
+ * left after the header is inflated by zlib and must give the body back.
+ * tinfl itself lives in the ESP32 ROM and is not built here, zlib stands in
+ * for it. Also checks that bodies that are not gzip are refused.
+ *
+ * Build and run from the repository root:
+ *   g++ -std=c++14 -O2 -ISrc/oxygen_monitor/Drivers/wifi_com/Esp32 \
+ *       Test/gzip_header_check.cpp -lz -o gzip_header_check
+ *   ./gzip_header_check [seed]
+ *******************************************************************************/
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <zlib.h>
+#include "gzip_header.h"
+
+static int failures = 0;
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            printf("FAILED %s:%d: %s\n", __FILE__, __LINE__, #condition); \
+            failures++; \
+        } \
+    } while (0)
+
+#define ROUNDS_PER_HEADER   20
+#define CHUNK_SIZE_MAX      1460        // Largest write of a TCP segment.
+
+//-----------------------------------------------------------------------------
+static uint32_t random32(uint64_t& seed)
+{
+    seed ^= seed << 13;
+    seed ^= seed >> 7;
+    seed ^= seed << 17;
+    return (uint32_t) (seed >> 16);
+}
+
+//-----------------------------------------------------------------------------
+// getUpdates answer of a random size, compressible as the real ones are.
+static std::string makeBody(uint64_t& seed)
+{
+    const uint32_t updates = random32(seed) % 40;
+    std::string body = "{\"ok\":true,\"result\":[";
+
+    for (uint32_t i = 0; i < updates; i++) {
+        body += (i == 0) ? "" : ",";
+        body += "{\"update_id\":" + std::to_string(random32(seed)) + ",\"message\":{\"chat\":{\"id\":" +
+                std::to_string(random32(seed) % 100000) + "},\"text\":\"/status " + std::to_string(random32(seed)) + "\"}}";
+    }
+
+    return body + "]}";
+}
+
+//-----------------------------------------------------------------------------
+// Gzip member with the optional fields picked by the flags (FEXTRA, FNAME,
+// FCOMMENT, FHCRC).
+static std::vector<uint8_t> compress(const std::string& body, unsigned int fields)
+{
+    static char name[] = "updates.json";
+    static char comment[] = "comment";
+    static unsigned char extra[] = { 'A', 'P', 4, 0, 1, 2, 3, 4 };
+    std::vector<uint8_t> output(compressBound(body.size()) + 128);
+    gz_header header = {};
+    z_stream stream = {};
+
+    header.extra = (fields & 1) ? extra : Z_NULL;
+    header.extra_len = sizeof(extra);
+    header.name = (fields & 2) ? (Bytef*) name : Z_NULL;
+    header.comment = (fields & 4) ? (Bytef*) comment : Z_NULL;
+    header.hcrc = (fields & 8) ? 1 : 0;
+
+    deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY);
+    deflateSetHeader(&stream, &header);
+    stream.next_in = (Bytef*) body.data();
+    stream.avail_in = (uInt) body.size();
+    stream.next_out = output.data();
+    stream.avail_out = (uInt) output.size();
+    deflate(&stream, Z_FINISH);
+    output.resize(stream.total_out);
+    deflateEnd(&stream);
+
+    return output;
+}
+
+//-----------------------------------------------------------------------------
+// Feeds the member in chunks, the header to GzipHeader and the rest to a raw
+// inflate, as GzipStream does with tinfl.
+static bool roundTrip(const std::vector<uint8_t>& member, const std::string& body, uint64_t& seed, bool isByteByByte)
+{
+    GzipHeader header;
+    z_stream stream = {};
+    std::string inflated;
+    int status = Z_OK;
+    size_t offset = 0;
+
+    inflateInit2(&stream, -15);
+
+    while ((offset < member.size()) && (status == Z_OK)) {
+        const size_t chunk = isByteByByte ? 1 : 1 + (random32(seed) % CHUNK_SIZE_MAX);
+        const size_t size = std::min(chunk, member.size() - offset);
+        size_t index = 0;
+
+        if (!header.isDone()) {
+            index = header.parse(&member[offset], size);
+            if (header.isFailed()) {
+                break;
+            }
+        }
+
+        if (header.isDone() && (index < size)) {
+            uint8_t window[512];
+
+            stream.next_in = (Bytef*) &member[offset + index];
+            stream.avail_in = (uInt) (size - index);
+            do {
+                stream.next_out = window;
+                stream.avail_out = sizeof(window);
+                status = inflate(&stream, Z_NO_FLUSH);
+                inflated.append((const char*) window, sizeof(window) - stream.avail_out);
+            } while ((status == Z_OK) && (stream.avail_out == 0));
+        }
+        offset += size;
+    }
+    inflateEnd(&stream);
+
+    return header.isDone() && (status == Z_STREAM_END) && (inflated == body);
+}
+
+//-----------------------------------------------------------------------------
+static void checkRoundTrip(uint64_t seed)
+{
+    int rounds = 0;
+    int wrong = 0;
+
+    for (unsigned int fields = 0; fields < 16; fields++) {
+        for (int i = 0; i < ROUNDS_PER_HEADER; i++) {
+            const std::string body = makeBody(seed);
+            const std::vector<uint8_t> member = compress(body, fields);
+
+            if (!roundTrip(member, body, seed, (i == 0))) {
+                if (wrong == 0) {
+                    printf("fields %u, round %d: body of %zu bytes not given back\n", fields, i, body.size());
+                }
+                wrong++;
+            }
+            rounds++;
+        }
+    }
+    CHECK(wrong == 0);
+
+    printf("gzip_header: %d round trips\n", rounds);
+}
+
+//-----------------------------------------------------------------------------
+static void checkRefused()
+{
+    const std::vector<uint8_t> member = compress("{\"ok\":true}", 0);
+
+    // Identity body.
+    {
+        GzipHeader header;
+        const uint8_t json[] = "{\"ok\":true}";
+
+        CHECK(header.parse(json, sizeof(json)) == 1);
+        CHECK(header.isFailed());
+    }
+
+    // Compression method other than deflate.
+    {
+        GzipHeader header;
+        std::vector<uint8_t> bad = member;
+
+        bad[2] = 7;
+        header.parse(bad.data(), bad.size());
+        CHECK(header.isFailed());
+    }
+
+    // Cut short: still waiting for the header.
+    {
+        GzipHeader header;
+
+        CHECK(header.parse(member.data(), 9) == 9);
+        CHECK(!header.isDone() && !header.isFailed());
+        CHECK(header.parse(member.data() + 9, member.size() - 9) == 1);
+        CHECK(header.isDone());
+    }
+}
+
+//-----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+    const uint64_t seed = (argc > 1) ? strtoull(argv[1], nullptr, 0) : 0x9E3779B97F4A7C15ULL;
+
+    checkRoundTrip(seed);
+    checkRefused();
+
+    if (failures == 0) {
+        printf("gzip_header: OK\n");
+    }
+
+    return (failures == 0) ? 0 : 1;
+}
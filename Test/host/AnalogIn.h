@@ -0,0 +1,8 @@
+/*!****************************************************************************
+ * @file AnalogIn.h
+ * @brief Host stand-in, the analog input lives in mbed.h.
+ * @author Gonzalo Puy
+ * @date Jun 2025
+ *******************************************************************************/
+
+#include "mbed.h"
@@ -0,0 +1,20 @@
+/*!****************************************************************************
+ * @file PinNames.h
+ * @brief Host stand-in for the target pin names: only the pins the firmware uses.
+ * @author Gonzalo Puy
+ * @date Jun 2025
+ *******************************************************************************/
+
+#ifndef PINNAMES_H
+#define PINNAMES_H
+
+typedef enum {
+    PA_9,
+    PA_10,
+    PA_11,
+    PA_12,
+    A1,
+    NC
+} PinName;
+
+#endif // PINNAMES_H
@@ -0,0 +1,8 @@
+/*!****************************************************************************
+ * @file UnbufferedSerial.h
+ * @brief Host stand-in, the serial port lives in mbed.h.
+ * @author Gonzalo Puy
+ * @date Jun 2025
+ *******************************************************************************/
+
+#include "mbed.h"
@@ -0,0 +1,408 @@
+/*!****************************************************************************
+ * @file mbed.h
+ * @brief Host stand-in for the parts of Mbed OS used by the firmware, on a
+ *        virtual clock.
+ *
+ * Time only moves when the host program calls HostClock::Advance(), which runs
+ * the tickers due on the way: Util::Tick counts virtual milliseconds, and
+ * us_ticker_read() returns virtual microseconds. The serial port and the analog
+ * input are wired to models run by the host program, through their Host*()
+ * methods.
+ *
+ * @author Gonzalo Puy
+ * @date Jun 2025
+ *******************************************************************************/
+
+#ifndef MBED_H
+#define MBED_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <functional>
+#include <string>
+#include <vector>
+#include <sys/types.h>
+#include "PinNames.h"
+
+namespace mbed {
+
+    class Ticker;
+
+    /**
+    * @brief Virtual time of the host build.
+    */
+    class HostClock
+    {
+        public:
+
+            /**
+            * @brief Virtual time since start [us].
+            */
+            static uint64_t Now() { return _State().now; }
+
+            /**
+            * @brief Moves the virtual time forward, running the tickers due on the way
+            *        at their own time.
+            *
+            * @param target New virtual time [us]. Earlier times are ignored.
+            */
+            static void Advance(uint64_t target);
+
+        private:
+
+            friend class Ticker;
+
+            struct State
+            {
+                uint64_t now;
+                std::vector<Ticker*> tickers;
+            };
+
+            // Never destroyed: static tickers of the firmware detach after main() returns.
+            static State& _State()
+            {
+                static State* state = new State{ 0, {} };
+
+                return *state;
+            }
+    };
+
+    //-----------------------------------------------------------------------------
+    class Ticker
+    {
+        public:
+
+            Ticker() : mPeriod(0), mDue(0) {}
+
+            ~Ticker() { detach(); }
+
+            template <typename Duration>
+            void attach(std::function<void()> function, Duration interval)
+            {
+                detach();
+                mFunction = function;
+                mPeriod = std::max<uint64_t>(1, std::chrono::duration_cast<std::chrono::microseconds>(interval).count());
+                mDue = HostClock::Now() + mPeriod;
+                HostClock::_State().tickers.push_back(this);
+            }
+
+            void detach()
+            {
+                std::vector<Ticker*>& tickers = HostClock::_State().tickers;
+
+                tickers.erase(std::remove(tickers.begin(), tickers.end(), this), tickers.end());
+            }
+
+        private:
+
+            friend class HostClock;
+
+            std::function<void()> mFunction;
+            uint64_t mPeriod;   /**< [us] */
+            uint64_t mDue;      /**< Virtual time of the next call [us]. */
+    };
+
+    //-----------------------------------------------------------------------------
+    inline void HostClock::Advance(uint64_t target)
+    {
+        State& state = _State();
+
+        for (;;) {
+            Ticker* next = nullptr;
+
+            for (Ticker* ticker : state.tickers) {
+                if ((ticker->mDue <= target) && ((next == nullptr) || (ticker->mDue < next->mDue))) {
+                    next = ticker;
+                }
+            }
+
+            if (next == nullptr) {
+                break;
+            }
+
+            state.now = std::max(state.now, next->mDue);
+            next->mDue += next->mPeriod;
+            next->mFunction();
+        }
+
+        state.now = std::max(state.now, target);
+    }
+
+    //-----------------------------------------------------------------------------
+    template <typename T>
+    std::function<void()> callback(T* object, void (T::*method)())
+    {
+        return [object, method]() { (object->*method)(); };
+    }
+
+    //-----------------------------------------------------------------------------
+    class SerialBase
+    {
+        public:
+
+            enum IrqType { RxIrq = 0, TxIrq };
+
+            enum Flow { Disabled = 0, RTS, CTS, RTSCTS };
+    };
+
+    /**
+    * @brief Serial port wired to a model of the device on the other end.
+    *
+    * A byte takes 10 bit times at the rate of its sender, and reads as 0xFF at
+    * any other rate. The TX interrupt runs from HostService(), once for every
+    * byte the line takes until the current time. There is no overrun: the line
+    * is taken as flow controlled.
+    */
+    class UnbufferedSerial : public SerialBase
+    {
+        public:
+
+            UnbufferedSerial(PinName tx, PinName, int baud = 9600)
+                : mTx(tx)
+                , mBaud(baud)
+                , mTxFree(0)
+                , mTxIrqStart(0)
+                , mIrqTime(0)
+                , mIsInIrq(false)
+                , mTxBusy(0)
+                , mRxFree(0)
+                , mRxBusy(0)
+                {
+                    _Ports().push_back(this);
+                }
+
+            ~UnbufferedSerial()
+            {
+                std::vector<UnbufferedSerial*>& ports = _Ports();
+
+                ports.erase(std::remove(ports.begin(), ports.end(), this), ports.end());
+            }
+
+            ssize_t write(const void* buffer, size_t length)
+            {
+                const uint8_t* bytes = static_cast<const uint8_t*>(buffer);
+
+                for (size_t i = 0; i < length; i++) {
+                    mTxFree = std::max(mTxFree, _Time()) + _ByteTime(mBaud);
+                    mTxBusy += _ByteTime(mBaud);
+                    mTxLine.push_back({ mTxFree, bytes[i], mBaud });
+                }
+
+                return (ssize_t) length;
+            }
+
+            ssize_t read(void* buffer, size_t length)
+            {
+                uint8_t* bytes = static_cast<uint8_t*>(buffer);
+                size_t count = 0;
+
+                while ((count < length) && readable()) {
+                    bytes[count++] = (mRxLine.front().baud == mBaud) ? mRxLine.front().value : 0xFF;
+                    mRxLine.pop_front();
+                }
+
+                return (ssize_t) count;
+            }
+
+            bool readable() { return !mRxLine.empty() && (mRxLine.front().time <= _Time()); }
+
+            bool writable() { return (mTxFree <= _Time()); }
+
+            int enable_output(bool) { return 0; }
+
+            int enable_input(bool) { return 0; }
+
+            void baud(int baudRate) { mBaud = baudRate; }
+
+            void attach(std::function<void()> function, IrqType type = RxIrq)
+            {
+                if (type != TxIrq) {
+                    return;
+                }
+
+                if (function && !mTxIrq) {
+                    mTxIrqStart = HostClock::Now() * 1000;
+                }
+                mTxIrq = function;
+            }
+
+            void set_flow_control(Flow, PinName = NC, PinName = NC) {}
+
+            /**
+            * @brief Finds the port of a TX pin, for the model on the other end.
+            */
+            static UnbufferedSerial* HostFind(PinName tx)
+            {
+                for (UnbufferedSerial* port : _Ports()) {
+                    if (port->mTx == tx) {
+                        return port;
+                    }
+                }
+
+                return nullptr;
+            }
+
+            /**
+            * @brief Runs the TX interrupt for every byte the line took by now.
+            */
+            void HostService()
+            {
+                const uint64_t now = HostClock::Now() * 1000;
+
+                while (mTxIrq) {
+                    const size_t written = mTxLine.size();
+                    const std::function<void()> irq = mTxIrq;
+
+                    mIrqTime = std::max(mTxFree, mTxIrqStart);
+                    if (mIrqTime > now) {
+                        break;
+                    }
+
+                    mIsInIrq = true;
+                    irq();
+                    mIsInIrq = false;
+
+                    if (mTxLine.size() == written) {
+                        break;
+                    }
+                }
+            }
+
+            /**
+            * @brief Sends bytes from the other end, behind the ones still on the line.
+            *
+            * @param bytes Bytes sent.
+            * @param baudRate Rate they are sent at.
+            * @return uint64_t Virtual time the last one is received [ns].
+            */
+            uint64_t HostSend(const std::string& bytes, int baudRate)
+            {
+                for (char value : bytes) {
+                    mRxFree = std::max(mRxFree, HostClock::Now() * 1000) + _ByteTime(baudRate);
+                    mRxBusy += _ByteTime(baudRate);
+                    mRxLine.push_back({ mRxFree, (uint8_t) value, baudRate });
+                }
+
+                return mRxFree;
+            }
+
+            /**
+            * @brief Takes the next byte sent by the firmware that is through by now.
+            *
+            * @param value Byte, 0xFF if it was sent at another rate than baudRate.
+            * @param baudRate Rate of the other end.
+            * @param time Virtual time it was through [ns].
+            * @return true if there was one.
+            */
+            bool HostReceive(uint8_t* value, int baudRate, uint64_t* time)
+            {
+                if (mTxLine.empty() || (mTxLine.front().time > HostClock::Now() * 1000)) {
+                    return false;
+                }
+
+                (*value) = (mTxLine.front().baud == baudRate) ? mTxLine.front().value : 0xFF;
+                (*time) = mTxLine.front().time;
+                mTxLine.pop_front();
+
+                return true;
+            }
+
+            /**
+            * @brief Checks if bytes are on the line, either way, or waiting to be read.
+            */
+            bool HostIsActive() const { return !mTxLine.empty() || !mRxLine.empty() || mTxIrq; }
+
+            int HostBaud() const { return mBaud; }
+
+            /**
+            * @brief Line time taken by the firmware bytes [ns].
+            */
+            uint64_t HostTxBusy() const { return mTxBusy; }
+
+            /**
+            * @brief Line time taken by the bytes of the other end [ns].
+            */
+            uint64_t HostRxBusy() const { return mRxBusy; }
+
+        private:
+
+            struct LineByte
+            {
+                uint64_t time;      /**< Virtual time its last bit is through [ns]. */
+                uint8_t value;
+                int baud;           /**< Rate it was sent at. */
+            };
+
+            static uint64_t _ByteTime(int baudRate) { return 10000000000ULL / (uint64_t) baudRate; }
+
+            uint64_t _Time() const { return mIsInIrq ? mIrqTime : (HostClock::Now() * 1000); }
+
+            static std::vector<UnbufferedSerial*>& _Ports()
+            {
+                static std::vector<UnbufferedSerial*>* ports = new std::vector<UnbufferedSerial*>();
+
+                return *ports;
+            }
+
+            PinName mTx;
+            int mBaud;
+            std::function<void()> mTxIrq;
+            uint64_t mTxFree;           /**< Virtual time the TX line is free [ns]. */
+            uint64_t mTxIrqStart;       /**< Virtual time the TX interrupt was attached [ns]. */
+            uint64_t mIrqTime;          /**< Virtual time of the TX interrupt being run [ns]. */
+            bool mIsInIrq;
+            uint64_t mTxBusy;
+            std::deque<LineByte> mTxLine;
+            uint64_t mRxFree;           /**< Virtual time the RX line is free [ns]. */
+            uint64_t mRxBusy;
+            std::deque<LineByte> mRxLine;
+    };
+
+    /**
+    * @brief Analog input reading a level set by the host program.
+    */
+    class AnalogIn
+    {
+        public:
+
+            AnalogIn(PinName pin) : mPin(pin) {}
+
+            float read() { return _Levels()[mPin]; }
+
+            unsigned short read_u16() { return (unsigned short) (read() * 65535.0f); }
+
+            /**
+            * @brief Sets the level read from a pin, from 0 to 1 of the reference voltage.
+            */
+            static void HostSet(PinName pin, float level) { _Levels()[pin] = level; }
+
+        private:
+
+            static float* _Levels()
+            {
+                static float levels[NC + 1] = {};
+
+                return levels;
+            }
+
+            PinName mPin;
+    };
+
+} // namespace mbed
+
+inline void core_util_critical_section_enter() {}
+
+inline void core_util_critical_section_exit() {}
+
+inline void thread_sleep_for(uint32_t ms) { mbed::HostClock::Advance(mbed::HostClock::Now() + (ms * 1000ULL)); }
+
+inline uint32_t us_ticker_read() { return (uint32_t) mbed::HostClock::Now(); }
+
+using namespace mbed;
+using namespace std;
+
+#endif // MBED_H
@@ -0,0 +1,6 @@
+/*!****************************************************************************
+ * @file util.h
+ * @brief Host stand-in for the target util.h. Nothing in it is used on the host.
+ * @author Gonzalo Puy
+ * @date Jun 2025
+ *******************************************************************************/
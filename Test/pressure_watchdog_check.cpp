@@ -0,0 +1,190 @@
+/****************************************************************************//**
+ * @file pressure_watchdog_check.cpp
+ * @author Gonzalo Puy.
+ * @date Jun 2025
+ * @brief Host checks of the low pressure threshold watchdog, on its stand-in.
+ *
+ * Samples are fed to the gauge of the tank monitor as the ADC would convert
+ * them, and the crossings are taken by TankMonitor::checkThreshold() as the
+ * superloop does. Checks that the window flips on every crossing, that the
+ * hysteresis keeps a level just over the threshold from crossing back, and
+ * that crossings bouncing within PRESSURE_ALARM_DEBOUNCE end in a single
+ * reading and a single LOW state.
+ *
+ * Build and run from the repository root, with ArduinoJson next to the sources:
+ *   g++ -std=c++14 -O2 -ITest/host -Iarduinojson/src -ISrc -ISrc/Utils \
+ *       $(find Src/oxygen_monitor -type d -printf '-I%p ') \
+ *       Test/pressure_watchdog_check.cpp $(find Src -name '*.cpp' ! -name main.cpp) -o pressure_watchdog_check
+ *   ./pressure_watchdog_check
+ *******************************************************************************/
+
+#include <cstdio>
+#include <cstring>
+#include "mbed.h"
+#include "metrics.h"
+#include "pressure_gauge.h"
+#include "tank_estimator.h"
+#include "tank_monitor.h"
+
+static int failures = 0;
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            printf("FAILED %s:%d: %s\n", __FILE__, __LINE__, #condition); \
+            failures++; \
+        } \
+    } while (0)
+
+#define THRESHOLD           (Module::TankEstimator::THRESHOLDS[TANK_UNIT_BAR])
+#define BELOW               (THRESHOLD - 2.0f)      // [bar]
+#define IN_HYSTERESIS       (THRESHOLD + 0.5f)      // Over the threshold, under the hysteresis [bar].
+#define ABOVE               (THRESHOLD + 3.0f)      // [bar]
+#define FULL                150.0f                  // [bar]
+
+//-----------------------------------------------------------------------------
+static float voltageOf(float pressure)
+{
+    return MIN_READING_VALUE + pressure * ((MAX_READING_VALUE - MIN_READING_VALUE) / MAX_PRESS_VALUE_BAR);
+}
+
+//-----------------------------------------------------------------------------
+// Sets the level on the sensor pin, read by the next sample of update().
+static void setPressure(float pressure)
+{
+    AnalogIn::HostSet(PRESS_SENSOR_PIN, voltageOf(pressure) / 3.3f);
+}
+
+//-----------------------------------------------------------------------------
+// Level converted by the watchdog ADC between two samples of update().
+static void convert(float pressure)
+{
+    setPressure(pressure);
+    Drivers::PressureGauge::simulateWatchdogSample(voltageOf(pressure));
+}
+
+//-----------------------------------------------------------------------------
+static void advance(uint32_t milliseconds)
+{
+    HostClock::Advance(HostClock::Now() + (uint64_t) milliseconds * 1000);
+}
+
+//-----------------------------------------------------------------------------
+static uint32_t crossings()
+{
+    Module::TankMonitor::getInstance().checkThreshold();
+    return Util::Metrics::Get(METRIC_TANK_THRESHOLD_CROSSINGS);
+}
+
+//-----------------------------------------------------------------------------
+// Lets a pending crossing settle and be read.
+static void settle()
+{
+    advance(PRESSURE_ALARM_DEBOUNCE + 1);
+    Module::TankMonitor::getInstance().checkThreshold();
+}
+
+//-----------------------------------------------------------------------------
+static void checkWindow()
+{
+    uint32_t count = crossings();
+
+    convert(FULL);
+    CHECK(crossings() == count);
+
+    // Down through the threshold, then the window waits for it to come back up.
+    convert(BELOW);
+    CHECK(crossings() == ++count);
+    convert(BELOW - 1.0f);
+    CHECK(crossings() == count);
+
+    // Just over the threshold is still inside the hysteresis.
+    convert(IN_HYSTERESIS);
+    CHECK(crossings() == count);
+    convert(ABOVE);
+    CHECK(crossings() == ++count);
+
+    // Back down, no hysteresis on the way down.
+    convert(THRESHOLD - 0.5f);
+    CHECK(crossings() == ++count);
+    convert(FULL);
+    CHECK(crossings() == ++count);
+    settle();
+
+    // Samples of update() are checked as well.
+    setPressure(BELOW);
+    Module::TankMonitor::getInstance().update();
+    CHECK(crossings() == ++count);
+    setPressure(FULL);
+    Module::TankMonitor::getInstance().update();
+    CHECK(crossings() == ++count);
+    settle();
+}
+
+//-----------------------------------------------------------------------------
+// A level bouncing around the threshold is read once, when it settles.
+static void checkDebounce()
+{
+    const uint32_t count = crossings();
+    const uint32_t samples = Util::Metrics::Get(METRIC_TANK_SAMPLES);
+    const uint32_t transitions = Util::Metrics::Get(METRIC_TANK_STATE_TRANSITIONS);
+
+    CHECK(Module::TankMonitor::getInstance().getTankState() == TANK_LEVEL_OK);
+
+    for (int i = 0; i < 3; i++) {
+        convert(BELOW);
+        crossings();
+        advance(PRESSURE_ALARM_DEBOUNCE / 5);
+        convert(ABOVE);
+        crossings();
+        advance(PRESSURE_ALARM_DEBOUNCE / 5);
+    }
+    convert(BELOW);
+    CHECK(crossings() == count + 7);
+
+    // Nothing read while it bounces.
+    advance(PRESSURE_ALARM_DEBOUNCE - 1);
+    crossings();
+    CHECK(Util::Metrics::Get(METRIC_TANK_SAMPLES) == samples);
+    CHECK(Module::TankMonitor::getInstance().getTankState() == TANK_LEVEL_OK);
+
+    advance(2);
+    crossings();
+    CHECK(Util::Metrics::Get(METRIC_TANK_SAMPLES) == samples + 1);
+    CHECK(Util::Metrics::Get(METRIC_TANK_STATE_TRANSITIONS) == transitions + 1);
+    CHECK(Module::TankMonitor::getInstance().getTankState() == TANK_LEVEL_LOW);
+
+    // Settled: no more readings.
+    advance(10 * PRESSURE_ALARM_DEBOUNCE);
+    CHECK(crossings() == count + 7);
+    CHECK(Util::Metrics::Get(METRIC_TANK_SAMPLES) == samples + 1);
+}
+
+//-----------------------------------------------------------------------------
+int main()
+{
+    tank_config_t config;
+
+    memset(&config, 0, sizeof(config));
+    config.unit = TANK_UNIT_BAR;
+
+    Util::Tick::Init();
+    Module::TankMonitor::init();
+
+    // Armed with the level already read, full.
+    setPressure(FULL);
+    Module::TankMonitor::getInstance().update();
+    Module::TankMonitor::getInstance().setConfig(config);
+    Module::TankMonitor::getInstance().update();
+
+    checkWindow();
+    checkDebounce();
+
+    printf("pressure_watchdog: %u crossings\n", (unsigned) Util::Metrics::Get(METRIC_TANK_THRESHOLD_CROSSINGS));
+
+    if (failures == 0) {
+        printf("pressure_watchdog: OK\n");
+    }
+
+    return (failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,687 @@
+/*!****************************************************************************
+ * @file esp32_model.cpp
+ * @brief ESP32 bridge model of the host simulator.
+ * @author Gonzalo Puy
+ * @date Jun 2025
+ *******************************************************************************/
+
+#include "esp32_model.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <memory>
+#include "commands.h"
+
+namespace Sim {
+
+    //-----------------------------------------------------------------------------
+    static std::vector<std::string> SplitParams(const std::string& frame, char separator)
+    {
+        std::vector<std::string> params;
+        size_t start = 0;
+
+        for (;;) {
+            const size_t end = frame.find(separator, start);
+
+            params.push_back(frame.substr(start, (end == std::string::npos) ? std::string::npos : end - start));
+            if (end == std::string::npos) {
+                return params;
+            }
+            start = end + 1;
+        }
+    }
+
+    //-----------------------------------------------------------------------------
+    static bool IsReaderCommand(const std::string& command)
+    {
+        return (command == COMMAND_STATUS_STR) || (command == COMMAND_CONNECT_STR) || (command == COMMAND_BAUD_STR) ||
+               (command == COMMAND_ENDPOINT_STR) || (command == COMMAND_WEBHOOK_STR) || (command == COMMAND_HOLD_STR) ||
+               (command == COMMAND_LOG_LEVEL_STR) || (command == COMMAND_FILL_STR);
+    }
+
+    //-----------------------------------------------------------------------------
+    static bool IsWorkerCommand(const std::string& command)
+    {
+        return (command == COMMAND_POST_STR) || (command == COMMAND_GET_STR) ||
+               (command == COMMAND_BROADCAST_STR) || (command == COMMAND_TELEMETRY_STR);
+    }
+
+    //-----------------------------------------------------------------------------
+    Esp32Model::Esp32Model(EventQueue& events, HttpServer& server, uint64_t seed, const esp32_config_t& config)
+        : mEvents(events)
+        , mServer(server)
+        , mRandom(seed)
+        , mConfig(config)
+        , mPort(nullptr)
+        , mBootTime(NEVER)
+        , mBaudRate(BASE_BAUD_RATE)
+        , mPendingBaudRate(0)
+        , mIsBaudConfirmed(true)
+        , mBaudSwitchTime(0)
+        , mFrameTime(0)
+        , mReaderFree(0)
+        , mWriterFree(0)
+        , mHoldEnd(0)
+        , mWriterEvent(NEVER)
+        , mBusyWorkers(0)
+        , mWebhookPort(0)
+        , mIsApUp(true)
+        , mIsConnectRequested(false)
+        , mIsAssociating(false)
+        , mIsConnected(false)
+        , mIsLinkUpReported(false)
+        , mLinkEpoch(0)
+        , mRssi(-60)
+        , mReportedRssi(0)
+        , mHttpRequests(0)
+        , mHttpFailures(0)
+        , mJobsRefused(0)
+        , mWorkerBusy(0)
+        , mApOutages(0)
+        , mDowntime(0)
+        , mDownSince(NEVER)
+        , mBaudFallbacks(0)
+        {}
+
+    //-----------------------------------------------------------------------------
+    void Esp32Model::Start(UnbufferedSerial* port)
+    {
+        mPort = port;
+        mBootTime = HostClock::Now() + mConfig.bootTime;
+        _ScheduleOutage();
+        mEvents.At(mBootTime + RSSI_EVENT_INTERVAL, [this]() { _UpdateRssi(); });
+    }
+
+    //-----------------------------------------------------------------------------
+    void Esp32Model::Poll()
+    {
+        uint8_t value;
+        uint64_t time;
+
+        while (mPort->HostReceive(&value, mBaudRate, &time)) {
+            // Nothing reads the UART while the ESP32 boots.
+            if ((time / 1000) >= mBootTime) {
+                _Receive((char) value, time / 1000);
+            }
+        }
+
+        // A frame without stop character is given up, as readStringUntil() does.
+        if (!mFrame.empty() && (HostClock::Now() >= (mFrameTime + READ_TIMEOUT))) {
+            const std::string frame = mFrame;
+            const sim_time_t time = std::max(HostClock::Now(), mReaderFree) + mConfig.commandTime;
+
+            mFrame.clear();
+            mReaderFree = time;
+            mEvents.At(time, [this, frame]() { _HandleFrame(frame); });
+        }
+    }
+
+    //-----------------------------------------------------------------------------
+    void Esp32Model::DropAp(sim_time_t duration)
+    {
+        _ApDown();
+        mEvents.After(duration, [this]() { mIsApUp = true; });
+    }
+
+    //-----------------------------------------------------------------------------
+    bool Esp32Model::PushUpdate(const std::string& update)
+    {
+        if ((HostClock::Now() < mBootTime) || !mIsConnected || (mWebhookPort == 0)) {
+            return false;
+        }
+
+        std::string escaped;
+
+        for (char value : update) {
+            if (value == STOP_CHAR) {
+                escaped += "\\u007e";
+            } else {
+                escaped += value;
+            }
+        }
+        _QueueEvent(std::string(EVENT_UPDATE_STR) + PARAM_SEPARATOR_CHAR + escaped);
+
+        return true;
+    }
+
+    //-----------------------------------------------------------------------------
+    sim_time_t Esp32Model::GetDowntime() const
+    {
+        return mDowntime + ((mDownSince != NEVER) ? (HostClock::Now() - mDownSince) : 0);
+    }
+
+    //-----------------------------------------------------------------------------
+    void Esp32Model::_Receive(char value, sim_time_t time)
+    {
+        if (value != STOP_CHAR) {
+            mFrame += value;
+            mFrameTime = time;
+            return;
+        }
+
+        const std::string frame = mFrame;
+        const sim_time_t handleTime = std::max(time, mReaderFree) + mConfig.commandTime;
+
+        mFrame.clear();
+        mReaderFree = handleTime;
+        mEvents.At(handleTime, [this, frame]() { _HandleFrame(frame); });
+    }
+
+    //-----------------------------------------------------------------------------
+    void Esp32Model::_HandleFrame(std::string frame)
+    {
+        std::string id;
+
+        if (!frame.empty() && (frame[0] == REQUEST_ID_CHAR)) {
+            const size_t index = std::min(frame.find(PARAM_SEPARATOR_CHAR), frame.length());
+
+            id = frame.substr(1, index - 1);
+            frame = (index < frame.length()) ? frame.substr(index + 1) : "";
+        }
+
+        const std::vector<std::string> params = SplitParams(frame, PARAM_SEPARATOR_CHAR);
+
+        if (IsReaderCommand(params[0])) {
+            sim_time_t holdTime = 0;
+            bool isBaudSwitch = false;
+
+            mIsBaudConfirmed = true;
+
+            const std::string result = _RunCommand(params, &holdTime, &isBaudSwitch);
+
+            _QueueResponse(id, result, holdTime, isBaudSwitch);
+        } else if (IsWorkerCommand(params[0])) {
+            mIsBaudConfirmed = true;
+
+            if (mJobs.size() == JOB_QUEUE_SIZE) {
+                mJobsRefused++;
+                _QueueResponse(id, RESULT_ERROR);
+                return;
+            }
+            mJobs.push_back({ id, params });
+            _StartJobs();
+        } else if ((mBaudRate != BASE_BAUD_RATE) && (mPendingBaudRate == 0)) {
+            // Garbage above the base rate: the monitor restarted and talks at the base rate.
+            mBaudFallbacks++;
+            _SetBaudRate(BASE_BAUD_RATE);
+        }
+    }
+
+    //-----------------------------------------------------------------------------
+    std::string Esp32Model::_RunCommand(const std::vector<std::string>& params, sim_time_t* holdTime, bool* isBaudSwitch)
+    {
+        const std::string& command = params[0];
+        const size_t paramCount = params.size();
+
+        if ((command == COMMAND_STATUS_STR) && (paramCount == 1)) {
+            if (mIsConnected) {
+                return RESULT_CONNECTED;
+            }
+
+            return mIsConnectRequested ? RESULT_CONNECTING : RESULT_NOT_CONNECTED;
+        }
+
+        if ((command == COMMAND_CONNECT_STR) && (paramCount >= 3) && ((paramCount % 2) == 1)) {
+            if (mIsConnected) {
+                return RESULT_OK;
+            }
+
+            // Association runs in the background, the monitor polls the status.
+            mIsConnectRequested = true;
+            _Associate();
+
+            return RESULT_CONNECTING;
+        }
+
+        if ((command == COMMAND_BAUD_STR) && (paramCount == 3)) {
+            const long baudRate = atol(params[1].c_str());
+
+            if ((baudRate < BASE_BAUD_RATE) || (baudRate > 5000000)) {
+                return RESULT_ERROR;
+            }
+            mPendingBaudRate = (int) baudRate;
+            (*isBaudSwitch) = true;
+
+            return RESULT_OK;
+        }
+
+        if ((command == COMMAND_ENDPOINT_STR) && (paramCount == 3) && (params[1].length() == 1) && !params[2].empty()) {
+            const unsigned int index = params[1][0] - '0';
+
+            if (index >= mEndpoints.size()) {
+                return RESULT_ERROR;
+            }
+            mEndpoints[index] = params[2];
+
+            return RESULT_OK;
+        }
+
+        if ((command == COMMAND_WEBHOOK_STR) && ((paramCount == 2) || (paramCount == 3))) {
+            const long port = atol(params[1].c_str());
+
+            if ((port < 0) || (port > 65535)) {
+                return RESULT_ERROR;
+            }
+            mWebhookPort = (uint16_t) port;
+
+            return RESULT_OK;
+        }
+
+        if ((command == COMMAND_HOLD_STR) && (paramCount == 2)) {
+            const sim_time_t time = (sim_time_t) atol(params[1].c_str()) * MILLISECOND;
+
+            if (time > HOLD_TIME_MAX) {
+                return RESULT_ERROR;
+            }
+            if (time == 0) {
+                // Resumes right away, this acknowledge included.
+                mHoldEnd = 0;
+                _KickWriter(std::max(HostClock::Now(), mWriterFree));
+            }
+            (*holdTime) = time;
+
+            return RESULT_OK;
+        }
+
+        if ((command == COMMAND_FILL_STR) && (paramCount == 2)) {
+            const long size = atol(params[1].c_str());
+            std::string fill;
+
+            for (long i = 0; i < size; i++) {
+                fill += (char) ('a' + (i % 26));
+            }
+
+            return (size > 0) ? fill : RESULT_ERROR;
+        }
+
+        if (command == COMMAND_LOG_LEVEL_STR) {
+            return (paramCount == 2) ? RESULT_OK : RESULT_ERROR;
+        }
+
+        return RESULT_ERROR;
+    }
+
+    //-----------------------------------------------------------------------------
+    void Esp32Model::_QueueResponse(const std::string& id, const std::string& result, sim_time_t holdTime, bool isBaudSwitch)
+    {
+        std::string bytes;
+
+        if (!id.empty()) {
+            bytes = REQUEST_ID_CHAR + id + PARAM_SEPARATOR_CHAR;
+        }
+        bytes += result;
+        bytes += STOP_CHAR;
+        _QueueOutput({ bytes, holdTime, isBaudSwitch });
+    }
+
+    //-----------------------------------------------------------------------------
+    void Esp32Model::_QueueEvent(const std::string& event)
+    {
+        _QueueOutput({ EVENT_CHAR + event + STOP_CHAR, 0, false });
+    }
+
+    //-----------------------------------------------------------------------------
+    void Esp32Model::_QueueOutput(const Output& output)
+    {
+        mOutput.push_back(output);
+        _KickWriter(std::max(HostClock::Now(), std::max(mWriterFree, mHoldEnd)));
+    }
+
+    //-----------------------------------------------------------------------------
+    void Esp32Model::_KickWriter(sim_time_t time)
+    {
+        // An earlier writer event looks at the queue by itself.
+        if (mWriterEvent <= time) {
+            return;
+        }
+
+        mWriterEvent = time;
+        mEvents.At(time, [this, time]() { _Write(time); });
+    }
+
+    //-----------------------------------------------------------------------------
+    void Esp32Model::_Write(sim_time_t time)
+    {
+        // Superseded by an earlier one.
+        if (time != mWriterEvent) {
+            return;
+        }
+        mWriterEvent = NEVER;
+
+        if (mOutput.empty()) {
+            return;
+        }
+
+        const sim_time_t readyTime = std::max(mWriterFree, mHoldEnd);
+
+        if (HostClock::Now() < readyTime) {
+            _KickWriter(readyTime);
+            return;
+        }
+
+        const Output output = mOutput.front();
+        const sim_time_t endTime = (mPort->HostSend(output.bytes, mBaudRate) + 999) / 1000;
+
+        mOutput.pop_front();
+        mWriterFree = endTime;
+
+        if (output.holdTime != 0) {
+            mHoldEnd = endTime + output.holdTime;
+        }
+
+        // Only the baud command acknowledge switches the rate, once it is out.
+        if (output.isBaudSwitch) {
+            mEvents.At(endTime, [this]() {
+                if (mPendingBaudRate == 0) {
+                    return;
+                }
+
+                const sim_time_t switchTime = HostClock::Now();
+
+                _SetBaudRate(mPendingBaudRate);
+                mPendingBaudRate = 0;
+                mIsBaudConfirmed = false;
+                mBaudSwitchTime = switchTime;
+
+                // The monitor didn't follow: back to the rate it boots at.
+                mEvents.At(switchTime + BAUD_CONFIRM_TIMEOUT, [this, switchTime]() {
+                    if (!mIsBaudConfirmed && (mBaudSwitchTime == switchTime)) {
+                        mBaudFallbacks++;
+                        _SetBaudRate(BASE_BAUD_RATE);
+                        mIsBaudConfirmed = true;
+                    }
+                });
+            });
+        }
+
+        if (!mOutput.empty()) {
+            _KickWriter(std::max(mWriterFree, mHoldEnd));
+        }
+    }
+
+    //-----------------------------------------------------------------------------
+    void Esp32Model::_SetBaudRate(int baudRate)
+    {
+        mBaudRate = baudRate;
+        mFrame.clear();
+    }
+
+    //-----------------------------------------------------------------------------
+    void Esp32Model::_StartJobs()
+    {
+        while ((mBusyWorkers < WORKER_COUNT) && !mJobs.empty()) {
+            const Job job = mJobs.front();
+
+            mJobs.pop_front();
+            mBusyWorkers++;
+            _RunJob(job);
+        }
+    }
+
+    //-----------------------------------------------------------------------------
+    void Esp32Model::_RunJob(const Job& job)
+    {
+        const std::string& command = job.params[0];
+        const size_t paramCount = job.params.size();
+        const sim_time_t startTime = HostClock::Now();
+        std::string url;
+
+        if (command == COMMAND_TELEMETRY_STR) {
+            if ((paramCount != 4) || !mIsConnected) {
+                _FinishJob(job, startTime, RESULT_ERROR, "");
+                return;
+            }
+
+            // A datagram, no answer to wait for.
+            mEvents.After(2 * MILLISECOND, [this, job, startTime]() {
+                if (mTelemetrySink) {
+                    mTelemetrySink(job.params[1], (uint16_t) atoi(job.params[2].c_str()), job.params[3]);
+                }
+                _FinishJob(job, startTime, RESULT_OK, "");
+            });
+            return;
+        }
+
+        const bool isParamCountValid = ((command == COMMAND_POST_STR) && (paramCount == 3)) ||
+                                       ((command == COMMAND_GET_STR) && (paramCount == 2)) ||
+                                       ((command == COMMAND_BROADCAST_STR) && (paramCount == 4));
+
+        if (!isParamCountValid) {
+            _FinishJob(job, startTime, RESULT_ERROR, "");
+        } else if (!_ResolveServer(job.params[1], &url)) {
+            _FinishJob(job, startTime, RESULT_NO_ENDPOINT, "");
+        } else if (!mIsConnected) {
+            _FinishJob(job, startTime, RESULT_ERROR, "");
+        } else if (command == COMMAND_BROADCAST_STR) {
+            _RunBroadcast(job, url);
+        } else {
+            _RunHttp(job, url);
+        }
+    }
+
+    //-----------------------------------------------------------------------------
+    void Esp32Model::_RunHttp(const Job& job, const std::string& url)
+    {
+        const sim_time_t startTime = HostClock::Now();
+        const uint64_t epoch = mLinkEpoch;
+        const std::string body = (job.params.size() == 3) ? job.params[2] : "";
+
+        mHttpRequests++;
+
+        if (mRandom.Chance(mConfig.httpLoss)) {
+            mHttpFailures++;
+            mEvents.After(mConfig.httpTimeout, [this, job, startTime]() { _FinishJob(job, startTime, RESULT_ERROR, ""); });
+            return;
+        }
+
+        const sim_time_t tls = (sim_time_t) (mConfig.tlsMs * MILLISECOND);
+        const sim_time_t rtt = _Rtt();
+        const sim_time_t serveTime = mServer.ServeTime(url, body);
+        std::shared_ptr<std::string> response = std::make_shared<std::string>();
+
+        // The server sees the request half a round trip after the handshake.
+        mEvents.After(tls + (rtt / 2), [this, epoch, url, body, response]() {
+            if (epoch == mLinkEpoch) {
+                mServer.Serve(url, body, response.get());
+            }
+        });
+
+        mEvents.After(tls + rtt + serveTime, [this, job, startTime, epoch, response]() {
+            // The link dropped on the way: the socket times out.
+            if (epoch != mLinkEpoch) {
+                mHttpFailures++;
+                _FinishJob(job, startTime, RESULT_ERROR, "");
+                return;
+            }
+
+            const std::string length = std::to_string(response->length());
+            const std::string transferTime = std::to_string((HostClock::Now() - startTime) / MILLISECOND);
+
+            _FinishJob(job, startTime, std::string(RESULT_OK) + PARAM_SEPARATOR_CHAR + length + PARAM_SEPARATOR_CHAR +
+                       length + PARAM_SEPARATOR_CHAR + transferTime, *response);
+        });
+    }
+
+    //-----------------------------------------------------------------------------
+    void Esp32Model::_RunBroadcast(const Job& job, const std::string& url)
+    {
+        const sim_time_t startTime = HostClock::Now();
+        const uint64_t epoch = mLinkEpoch;
+        const std::vector<std::string> recipients = SplitParams(job.params[2], LIST_SEPARATOR_CHAR);
+        std::shared_ptr<std::vector<bool>> results = std::make_shared<std::vector<bool>>(recipients.size(), false);
+
+        // A single kept-alive connection: one handshake, then a round trip per recipient.
+        sim_time_t time = (sim_time_t) (mConfig.tlsMs * MILLISECOND);
+
+        for (size_t i = 0; i < recipients.size(); i++) {
+            const std::string body = "chat_id=" + recipients[i] + "&" + job.params[3];
+
+            mHttpRequests++;
+
+            if (mRandom.Chance(mConfig.httpLoss)) {
+                time += mConfig.httpTimeout;
+                continue;
+            }
+
+            const sim_time_t rtt = _Rtt();
+
+            mEvents.After(time + (rtt / 2), [this, epoch, url, body, results, i]() {
+                std::string response;
+
+                (*results)[i] = (epoch == mLinkEpoch) && mServer.Serve(url, body, &response);
+            });
+            time += rtt;
+        }
+
+        mEvents.After(time, [this, job, startTime, results]() {
+            std::string list;
+
+            for (bool isOk : (*results)) {
+                if (!list.empty()) {
+                    list += LIST_SEPARATOR_CHAR;
+                }
+                list += isOk ? RESULT_OK : RESULT_ERROR;
+                mHttpFailures += isOk ? 0 : 1;
+            }
+            _FinishJob(job, startTime, list, "");
+        });
+    }
+
+    //-----------------------------------------------------------------------------
+    void Esp32Model::_FinishJob(const Job& job, sim_time_t startTime, const std::string& result, const std::string& body)
+    {
+        // Bodies are streamed before the result, in chunks of the worker buffer.
+        for (size_t offset = 0; offset < body.length(); offset += CHUNK_SIZE) {
+            const std::string chunk = body.substr(offset, CHUNK_SIZE);
+            std::string bytes;
+
+            if (!job.id.empty()) {
+                bytes = REQUEST_ID_CHAR + job.id + PARAM_SEPARATOR_CHAR;
+            }
+            bytes += CHUNK_CHAR + std::to_string(chunk.length()) + PARAM_SEPARATOR_CHAR + chunk;
+            _QueueOutput({ bytes, 0, false });
+        }
+
+        _QueueResponse(job.id, result);
+        mWorkerBusy += HostClock::Now() - startTime;
+        mBusyWorkers--;
+        _StartJobs();
+    }
+
+    //-----------------------------------------------------------------------------
+    bool Esp32Model::_ResolveServer(const std::string& server, std::string* url)
+    {
+        if (server.empty() || (server[0] != ENDPOINT_CHAR)) {
+            (*url) = server;
+            return true;
+        }
+
+        const unsigned int index = (server.length() == 2) ? (unsigned int) (server[1] - '0') : ENDPOINT_COUNT_MAX;
+
+        if ((index >= mEndpoints.size()) || mEndpoints[index].empty()) {
+            return false;
+        }
+        (*url) = mEndpoints[index];
+
+        return true;
+    }
+
+    //-----------------------------------------------------------------------------
+    sim_time_t Esp32Model::_Rtt()
+    {
+        // Half of it fixed, the rest with a long tail.
+        return (sim_time_t) (mConfig.rttMs * (0.5 + mRandom.Exponential(0.5)) * MILLISECOND);
+    }
+
+    //-----------------------------------------------------------------------------
+    void Esp32Model::_ScheduleOutage()
+    {
+        if (mConfig.apMtbfMin <= 0) {
+            return;
+        }
+
+        mEvents.After((sim_time_t) (mRandom.Exponential(mConfig.apMtbfMin) * MINUTE), [this]() {
+            _ApDown();
+
+            mEvents.After((sim_time_t) (mRandom.Exponential(mConfig.apOutageS) * SECOND), [this]() {
+                mIsApUp = true;
+                _ScheduleOutage();
+            });
+        });
+    }
+
+    //-----------------------------------------------------------------------------
+    void Esp32Model::_ApDown()
+    {
+        mIsApUp = false;
+        mApOutages++;
+
+        if (mIsConnected) {
+            _SetConnected(false);
+            _QueueEvent(std::string(EVENT_LINK_DOWN_STR) + PARAM_SEPARATOR_CHAR + "200");
+            _Associate();
+        }
+    }
+
+    //-----------------------------------------------------------------------------
+    void Esp32Model::_Associate()
+    {
+        if (mIsConnected || mIsAssociating || !mIsConnectRequested) {
+            return;
+        }
+
+        mIsAssociating = true;
+
+        // Without AP the attempt times out, and the next one starts.
+        const sim_time_t attemptTime = mIsApUp ? (sim_time_t) (mRandom.Range(800, 2500) * MILLISECOND) : FULL_CONNECT_TIMEOUT;
+
+        mEvents.After(attemptTime, [this]() {
+            mIsAssociating = false;
+
+            if (mIsApUp) {
+                _SetConnected(true);
+            } else {
+                _Associate();
+            }
+        });
+    }
+
+    //-----------------------------------------------------------------------------
+    void Esp32Model::_SetConnected(bool isConnected)
+    {
+        mIsConnected = isConnected;
+
+        if (!isConnected) {
+            mLinkEpoch++;
+            mIsLinkUpReported = false;
+            mDownSince = HostClock::Now();
+            return;
+        }
+
+        if (mDownSince != NEVER) {
+            mDowntime += HostClock::Now() - mDownSince;
+            mDownSince = NEVER;
+        }
+
+        if (!mIsLinkUpReported) {
+            mIsLinkUpReported = true;
+            mReportedRssi = mRssi;
+            _QueueEvent(std::string(EVENT_LINK_UP_STR) + PARAM_SEPARATOR_CHAR + "192.168.1.50" + PARAM_SEPARATOR_CHAR + std::to_string(mRssi));
+        }
+    }
+
+    //-----------------------------------------------------------------------------
+    void Esp32Model::_UpdateRssi()
+    {
+        mRssi = std::min(-40, std::max(-90, mRssi + (int) std::floor(mRandom.Range(-3, 4))));
+
+        if (mIsLinkUpReported && (abs(mRssi - mReportedRssi) >= RSSI_EVENT_THRESHOLD)) {
+            mReportedRssi = mRssi;
+            _QueueEvent(std::string(EVENT_RSSI_STR) + PARAM_SEPARATOR_CHAR + std::to_string(mRssi));
+        }
+
+        mEvents.After(RSSI_EVENT_INTERVAL, [this]() { _UpdateRssi(); });
+    }
+
+} // namespace Sim
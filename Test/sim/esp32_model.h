@@ -0,0 +1,249 @@
+/*!****************************************************************************
+ * @file esp32_model.h
+ * @brief ESP32 bridge model of the host simulator, on the other end of the
+ *        WifiCom UART.
+ *
+ * Follows the bridge protocol of Esp32/esp32_main.ino: commands answered by
+ * the reader right away, HTTP commands run by two workers, a single writer
+ * for results, body chunks and events, the baud rate negotiation and the
+ * hold command. The access point drops now and then, and HTTP requests pay a
+ * TLS handshake and a round trip, and are sometimes lost.
+ *
+ * @author Gonzalo Puy
+ * @date Jun 2025
+ *******************************************************************************/
+
+#ifndef ESP32_MODEL_H
+#define ESP32_MODEL_H
+
+#include <array>
+#include <deque>
+#include <functional>
+#include <string>
+#include <vector>
+#include "mbed.h"
+#include "sim_core.h"
+
+namespace Sim {
+
+    /**
+    * @brief Servers reached by the ESP32 over HTTP.
+    */
+    class HttpServer
+    {
+        public:
+
+            virtual ~HttpServer() = default;
+
+            /**
+            * @brief Serves a POST request, or a GET request if the body is empty.
+            *
+            * @param url Full URL, with the bot token.
+            * @param body URL encoded form.
+            * @param response Body of the answer.
+            * @return true if answered with 200.
+            */
+            virtual bool Serve(const std::string& url, const std::string& body, std::string* response) = 0;
+
+            /**
+            * @brief Time the server takes to answer a request, on top of the round trip.
+            *
+            * @param url Full URL, with the bot token.
+            * @param body URL encoded form.
+            * @return sim_time_t Time [us], 0 for servers that answer at once.
+            */
+            virtual sim_time_t ServeTime(const std::string& url, const std::string& body)
+            {
+                (void) url;
+                (void) body;
+                return 0;
+            }
+    };
+
+    struct esp32_config_t
+    {
+        sim_time_t bootTime = 600 * MILLISECOND;        /**< Time from power up to the UART tasks running. */
+        sim_time_t commandTime = 2 * MILLISECOND;       /**< Reader time per command. */
+        double tlsMs = 400;                             /**< TLS handshake, once per request [ms]. */
+        double rttMs = 150;                             /**< Mean round trip to the servers [ms]. */
+        double httpLoss = 0.01;                         /**< Share of HTTP requests lost. */
+        sim_time_t httpTimeout = 5 * SECOND;            /**< Time a lost request takes to fail. */
+        double apMtbfMin = 360;                         /**< Mean time between AP outages [min], 0 for none. */
+        double apOutageS = 60;                          /**< Mean AP outage [s]. */
+    };
+
+    /**
+    * @brief ESP32 bridge, run on the event queue.
+    */
+    class Esp32Model
+    {
+        public:
+
+            typedef std::function<void(const std::string& host, uint16_t port, const std::string& frame)> telemetry_sink_t;
+
+            Esp32Model(EventQueue& events, HttpServer& server, uint64_t seed, const esp32_config_t& config);
+
+            /**
+            * @brief Powers up the ESP32 on a port of the firmware.
+            */
+            void Start(UnbufferedSerial* port);
+
+            /**
+            * @brief Reads what the firmware sent by now. Called from the main loop.
+            */
+            void Poll();
+
+            /**
+            * @brief Pushes an update to the webhook, as the LAN relay does.
+            * @return true if the ESP32 took it.
+            */
+            bool PushUpdate(const std::string& update);
+
+            /**
+            * @brief Takes the access point down now, on top of the random outages.
+            * @param duration Outage [us].
+            */
+            void DropAp(sim_time_t duration);
+
+            void SetTelemetrySink(telemetry_sink_t sink) { mTelemetrySink = sink; }
+
+            bool IsConnected() const { return mIsConnected; }
+
+            int GetBaudRate() const { return mBaudRate; }
+
+            /** @brief HTTP requests sent, one per broadcast recipient. */
+            uint64_t GetHttpRequests() const { return mHttpRequests; }
+
+            uint64_t GetHttpFailures() const { return mHttpFailures; }
+
+            /** @brief Commands refused with every worker busy and the job queue full. */
+            uint64_t GetJobsRefused() const { return mJobsRefused; }
+
+            /** @brief Time the workers spent on requests, both added [us]. */
+            sim_time_t GetWorkerBusy() const { return mWorkerBusy; }
+
+            uint64_t GetApOutages() const { return mApOutages; }
+
+            /** @brief Time the ESP32 was not associated since it first was [us]. */
+            sim_time_t GetDowntime() const;
+
+            uint64_t GetBaudFallbacks() const { return mBaudFallbacks; }
+
+        private:
+
+            static constexpr int BASE_BAUD_RATE = 115200;
+            static constexpr size_t JOB_QUEUE_SIZE = 8;
+            static constexpr int WORKER_COUNT = 2;
+            static constexpr size_t CHUNK_SIZE = 256;
+            static constexpr sim_time_t READ_TIMEOUT = SECOND;          /**< readStringUntil() gives up on a frame. */
+            static constexpr sim_time_t BAUD_CONFIRM_TIMEOUT = SECOND;
+            static constexpr sim_time_t HOLD_TIME_MAX = 10 * SECOND;
+            static constexpr sim_time_t FULL_CONNECT_TIMEOUT = 8 * SECOND;
+            static constexpr sim_time_t RSSI_EVENT_INTERVAL = 10 * SECOND;
+            static constexpr int RSSI_EVENT_THRESHOLD = 5;
+
+            /** @brief Bytes for the writer, in order. */
+            struct Output
+            {
+                std::string bytes;
+                sim_time_t holdTime;    /**< Nothing is sent for this long once out. */
+                bool isBaudSwitch;      /**< Baud command acknowledge, the rate changes once out. */
+            };
+
+            struct Job
+            {
+                std::string id;
+                std::vector<std::string> params;
+            };
+
+            void _Receive(char value, sim_time_t time);
+
+            void _HandleFrame(std::string frame);
+
+            std::string _RunCommand(const std::vector<std::string>& params, sim_time_t* holdTime, bool* isBaudSwitch);
+
+            void _QueueResponse(const std::string& id, const std::string& result, sim_time_t holdTime = 0, bool isBaudSwitch = false);
+
+            void _QueueEvent(const std::string& event);
+
+            void _QueueOutput(const Output& output);
+
+            void _KickWriter(sim_time_t time);
+
+            void _Write(sim_time_t time);
+
+            void _SetBaudRate(int baudRate);
+
+            void _StartJobs();
+
+            void _RunJob(const Job& job);
+
+            void _RunHttp(const Job& job, const std::string& url);
+
+            void _RunBroadcast(const Job& job, const std::string& url);
+
+            void _FinishJob(const Job& job, sim_time_t startTime, const std::string& result, const std::string& body);
+
+            bool _ResolveServer(const std::string& server, std::string* url);
+
+            sim_time_t _Rtt();
+
+            void _ScheduleOutage();
+
+            void _ApDown();
+
+            void _Associate();
+
+            void _SetConnected(bool isConnected);
+
+            void _UpdateRssi();
+
+            EventQueue& mEvents;
+            HttpServer& mServer;
+            Random mRandom;
+            esp32_config_t mConfig;
+            UnbufferedSerial* mPort;
+            telemetry_sink_t mTelemetrySink;
+
+            sim_time_t mBootTime;
+            int mBaudRate;
+            int mPendingBaudRate;
+            bool mIsBaudConfirmed;
+            sim_time_t mBaudSwitchTime;
+            std::string mFrame;
+            sim_time_t mFrameTime;                  /**< Last byte of the frame being read. */
+            sim_time_t mReaderFree;                 /**< The reader is done with the frames before. */
+
+            std::deque<Output> mOutput;
+            sim_time_t mWriterFree;
+            sim_time_t mHoldEnd;
+            sim_time_t mWriterEvent;                /**< Time of the writer event that counts, NEVER if none. */
+
+            std::deque<Job> mJobs;
+            int mBusyWorkers;
+
+            std::array<std::string, 8> mEndpoints;
+            uint16_t mWebhookPort;
+
+            bool mIsApUp;
+            bool mIsConnectRequested;
+            bool mIsAssociating;
+            bool mIsConnected;
+            bool mIsLinkUpReported;
+            uint64_t mLinkEpoch;                    /**< Changes on every link drop, fails the requests on the way. */
+            int mRssi;
+            int mReportedRssi;
+
+            uint64_t mHttpRequests;
+            uint64_t mHttpFailures;
+            uint64_t mJobsRefused;
+            sim_time_t mWorkerBusy;
+            uint64_t mApOutages;
+            sim_time_t mDowntime;
+            sim_time_t mDownSince;                  /**< NEVER while associated or before the first association. */
+            uint64_t mBaudFallbacks;
+    };
+
+} // namespace Sim
+
+#endif // ESP32_MODEL_H
@@ -0,0 +1,206 @@
+/*!****************************************************************************
+ * @file sim_core.h
+ * @brief Building blocks of the host simulator: random numbers, the event
+ *        queue on the virtual clock and latency samples.
+ *
+ * Everything is deterministic: a run only depends on its seed and options.
+ *
+ * @author Gonzalo Puy
+ * @date Jun 2025
+ *******************************************************************************/
+
+#ifndef SIM_CORE_H
+#define SIM_CORE_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <queue>
+#include <string>
+#include <vector>
+#include "mbed.h"
+
+namespace Sim {
+
+    /** @brief Virtual time [us], the unit of HostClock. */
+    typedef uint64_t sim_time_t;
+
+    static constexpr sim_time_t MILLISECOND = 1000;
+    static constexpr sim_time_t SECOND = 1000 * MILLISECOND;
+    static constexpr sim_time_t MINUTE = 60 * SECOND;
+    static constexpr sim_time_t HOUR = 60 * MINUTE;
+    static constexpr sim_time_t DAY = 24 * HOUR;
+    static constexpr sim_time_t NEVER = UINT64_MAX;
+
+    /**
+    * @brief Pseudo random numbers (xorshift64*). Each model owns one, so adding
+    *        draws to a model doesn't change what the others see.
+    */
+    class Random
+    {
+        public:
+
+            explicit Random(uint64_t seed) : mState((seed * 0x9E3779B97F4A7C15ULL) | 1) {}
+
+            uint64_t Next()
+            {
+                mState ^= mState >> 12;
+                mState ^= mState << 25;
+                mState ^= mState >> 27;
+
+                return mState * 0x2545F4914F6CDD1DULL;
+            }
+
+            /** @brief Uniform in [0, 1). */
+            double Uniform() { return (Next() >> 11) * (1.0 / 9007199254740992.0); }
+
+            /** @brief Uniform in [low, high). */
+            double Range(double low, double high) { return low + ((high - low) * Uniform()); }
+
+            /** @brief Exponential with the given mean, time between Poisson events. */
+            double Exponential(double mean) { return -mean * std::log(1.0 - Uniform()); }
+
+            bool Chance(double probability) { return Uniform() < probability; }
+
+        private:
+
+            uint64_t mState;
+    };
+
+    /**
+    * @brief Events of the models, run in time order on the virtual clock.
+    *
+    * Before an event runs, the clock is moved to its time, so the firmware
+    * tick and us_ticker_read() read the event time.
+    */
+    class EventQueue
+    {
+        public:
+
+            EventQueue() : mSequence(0) {}
+
+            void At(sim_time_t time, std::function<void()> action)
+            {
+                mEvents.push({ std::max(time, HostClock::Now()), mSequence++, action });
+            }
+
+            void After(sim_time_t delay, std::function<void()> action) { At(HostClock::Now() + delay, action); }
+
+            sim_time_t NextTime() const { return mEvents.empty() ? NEVER : mEvents.top().time; }
+
+            /**
+            * @brief Runs the events due up to a time, including the ones they add.
+            */
+            void RunUntil(sim_time_t time)
+            {
+                while (!mEvents.empty() && (mEvents.top().time <= time)) {
+                    const Event event = mEvents.top();
+
+                    mEvents.pop();
+                    HostClock::Advance(event.time);
+                    event.action();
+                }
+            }
+
+        private:
+
+            struct Event
+            {
+                sim_time_t time;
+                uint64_t sequence;      /**< Events at the same time run in the order they were added. */
+                std::function<void()> action;
+
+                bool operator>(const Event& other) const
+                {
+                    return (time != other.time) ? (time > other.time) : (sequence > other.sequence);
+                }
+            };
+
+            std::priority_queue<Event, std::vector<Event>, std::greater<Event>> mEvents;
+            uint64_t mSequence;
+    };
+
+    /**
+    * @brief Values kept for percentiles.
+    */
+    class Samples
+    {
+        public:
+
+            void Add(double value) { mValues.push_back(value); mIsSorted = false; }
+
+            size_t Count() const { return mValues.size(); }
+
+            /**
+            * @brief Nearest rank percentile.
+            * @param percent From 0 to 100.
+            * @return double 0 if there are no samples.
+            */
+            double Percentile(double percent)
+            {
+                if (mValues.empty()) {
+                    return 0;
+                }
+                if (!mIsSorted) {
+                    std::sort(mValues.begin(), mValues.end());
+                    mIsSorted = true;
+                }
+
+                const size_t rank = (size_t) std::ceil((percent / 100.0) * mValues.size());
+
+                return mValues[std::min(std::max<size_t>(rank, 1), mValues.size()) - 1];
+            }
+
+            double Max() { return Percentile(100); }
+
+        private:
+
+            std::vector<double> mValues;
+            bool mIsSorted = true;
+    };
+
+    //-----------------------------------------------------------------------------
+    inline std::string UrlDecode(const std::string& text)
+    {
+        std::string decoded;
+
+        for (size_t i = 0; i < text.length(); i++) {
+            if ((text[i] == '%') && ((i + 2) < text.length())) {
+                decoded += (char) strtol(text.substr(i + 1, 2).c_str(), nullptr, 16);
+                i += 2;
+            } else {
+                decoded += (text[i] == '+') ? ' ' : text[i];
+            }
+        }
+
+        return decoded;
+    }
+
+    /**
+    * @brief Reads a field of an URL encoded form, decoded.
+    * @return std::string Empty if the field is missing.
+    */
+    inline std::string FormField(const std::string& form, const std::string& key)
+    {
+        size_t start = 0;
+
+        while (start <= form.length()) {
+            size_t end = form.find('&', start);
+
+            if (end == std::string::npos) {
+                end = form.length();
+            }
+            if (form.compare(start, key.length() + 1, key + "=") == 0) {
+                return UrlDecode(form.substr(start + key.length() + 1, end - start - key.length() - 1));
+            }
+            start = end + 1;
+        }
+
+        return "";
+    }
+
+} // namespace Sim
+
+#endif // SIM_CORE_H
@@ -0,0 +1,58 @@
+/*!****************************************************************************
+ * @file tank_model.cpp
+ * @brief Oxygen tank model of the host simulator.
+ * @author Gonzalo Puy
+ * @date Jun 2025
+ *******************************************************************************/
+
+#include "tank_model.h"
+
+#include <algorithm>
+#include "pressure_gauge.h"
+#include "tank_types.h"
+
+namespace Sim {
+
+    static constexpr double ADC_REFERENCE = 3.3;     /**< Reference of the PressureGauge reads [V]. */
+
+    //-----------------------------------------------------------------------------
+    TankModel::TankModel(EventQueue& events, uint64_t seed, const tank_model_config_t& config)
+        : mEvents(events)
+        , mRandom(seed)
+        , mConfig(config)
+        , mPressure(config.startBar)
+        , mIsLow(false)
+        {}
+
+    //-----------------------------------------------------------------------------
+    void TankModel::Start()
+    {
+        _Step();
+    }
+
+    //-----------------------------------------------------------------------------
+    void TankModel::_Step()
+    {
+        mPressure = std::max(0.0, mPressure - ((mConfig.flowLpm / mConfig.litresPerBar) * ((double) mConfig.step / MINUTE)));
+
+        if ((mPressure < PRESSURE_THRESHOLD_BAR) && !mIsLow) {
+            mIsLow = true;
+            mEpisodes.push_back({ HostClock::Now(), NEVER });
+
+            mEvents.After((sim_time_t) (mConfig.refillMin * MINUTE), [this]() {
+                mPressure = mConfig.fullBar;
+                mIsLow = false;
+                mEpisodes.back().refillTime = HostClock::Now();
+            });
+        }
+
+        // Gauge output through the voltage divider, as a share of the ADC reference.
+        const double reading = std::max(0.0, mPressure + mRandom.Range(-mConfig.noiseBar, mConfig.noiseBar));
+        const double voltage = MIN_READING_VALUE + (reading * ((MAX_READING_VALUE - MIN_READING_VALUE) / MAX_PRESS_VALUE_BAR));
+
+        AnalogIn::HostSet(PRESS_SENSOR_PIN, (float) (voltage / ADC_REFERENCE));
+
+        mEvents.After(mConfig.step, [this]() { _Step(); });
+    }
+
+} // namespace Sim
@@ -0,0 +1,70 @@
+/*!****************************************************************************
+ * @file tank_model.h
+ * @brief Oxygen tank model of the host simulator.
+ *
+ * The tank empties at a constant flow and is refilled a while after it goes
+ * below the low pressure threshold. The gauge reading, with some noise, is
+ * fed to the analog input of the pressure sensor.
+ *
+ * @author Gonzalo Puy
+ * @date Jun 2025
+ *******************************************************************************/
+
+#ifndef TANK_MODEL_H
+#define TANK_MODEL_H
+
+#include <vector>
+#include "sim_core.h"
+
+namespace Sim {
+
+    struct tank_model_config_t
+    {
+        double startBar = 60;           /**< Pressure at start [bar]. */
+        double fullBar = 150;           /**< Pressure after a refill [bar]. */
+        double flowLpm = 6;             /**< Gas flow [L/min]. */
+        double litresPerBar = 35;       /**< Gas per bar of the tank, type H [L/bar]. */
+        double refillMin = 30;          /**< Time from going low to the refill [min]. */
+        double noiseBar = 0.2;          /**< Gauge noise, uniform within +- this [bar]. */
+        sim_time_t step = SECOND;       /**< Time between two gauge updates. */
+    };
+
+    /**
+    * @brief Time the pressure went below the threshold, and the refill after it.
+    */
+    struct tank_episode_t
+    {
+        sim_time_t lowTime;
+        sim_time_t refillTime;          /**< NEVER if not refilled yet. */
+    };
+
+    class TankModel
+    {
+        public:
+
+            TankModel(EventQueue& events, uint64_t seed, const tank_model_config_t& config);
+
+            /**
+            * @brief Starts emptying the tank.
+            */
+            void Start();
+
+            double GetPressure() const { return mPressure; }
+
+            const std::vector<tank_episode_t>& GetEpisodes() const { return mEpisodes; }
+
+        private:
+
+            void _Step();
+
+            EventQueue& mEvents;
+            Random mRandom;
+            tank_model_config_t mConfig;
+            double mPressure;       /**< Actual pressure [bar]. */
+            bool mIsLow;
+            std::vector<tank_episode_t> mEpisodes;
+    };
+
+} // namespace Sim
+
+#endif // TANK_MODEL_H
@@ -0,0 +1,251 @@
+/*!****************************************************************************
+ * @file telegram_model.cpp
+ * @brief Telegram model of the host simulator.
+ * @author Gonzalo Puy
+ * @date Jun 2025
+ *******************************************************************************/
+
+#include "telegram_model.h"
+
+#include <cstdio>
+#include "telegram_bot_lib.h"
+
+namespace Sim {
+
+    static constexpr uint64_t FIRST_UPDATE_ID = 815000000;
+    static constexpr uint64_t FIRST_USER_ID = 540000000;
+    static constexpr uint64_t EPOCH_DATE = 1750000000;     /**< Unix time of the simulation start. */
+
+    //-----------------------------------------------------------------------------
+    static bool EndsWith(const std::string& text, const std::string& suffix)
+    {
+        return (text.length() >= suffix.length()) && (text.compare(text.length() - suffix.length(), suffix.length(), suffix) == 0);
+    }
+
+    //-----------------------------------------------------------------------------
+    static std::string JsonEscape(const std::string& text)
+    {
+        std::string escaped;
+
+        for (char value : text) {
+            if (value == '\n') {
+                escaped += "\\n";
+            } else if ((value == '"') || (value == '\\')) {
+                escaped += '\\';
+                escaped += value;
+            } else {
+                escaped += value;
+            }
+        }
+
+        return escaped;
+    }
+
+    //-----------------------------------------------------------------------------
+    TelegramModel::TelegramModel(EventQueue& events, uint64_t seed, const telegram_config_t& config)
+        : mEvents(events)
+        , mRandom(seed)
+        , mConfig(config)
+        , mNextUpdateId(FIRST_UPDATE_ID)
+        , mPolls(0)
+        , mMessageId(0)
+        {}
+
+    //-----------------------------------------------------------------------------
+    void TelegramModel::Start()
+    {
+        char tank[48];
+
+        snprintf(tank, sizeof(tank), "%s type H gflow %g", COMMAND_TANK_STR, mConfig.gasFlow);
+
+        for (int i = 0; i < mConfig.users; i++) {
+            User user;
+
+            user.id = std::to_string(FIRST_USER_ID + (7919 * (i + 1)));
+            user.name = "User" + std::to_string(i + 1);
+            user.script.push_back(COMMAND_START_STR);
+            if (i == 0) {
+                user.script.push_back(std::string(COMMAND_SET_UNIT_STR) + " bar");
+                user.script.push_back(tank);
+            }
+            user.scriptStep = 0;
+            user.pending = -1;
+            user.registerTime = NEVER;
+            mUsers.push_back(user);
+        }
+
+        for (int i = 0; i < mConfig.users; i++) {
+            _SendNext(i, (sim_time_t) (mRandom.Range(5, 60) * SECOND));
+        }
+    }
+
+    //-----------------------------------------------------------------------------
+    bool TelegramModel::Serve(const std::string& url, const std::string& body, std::string* response)
+    {
+        if (EndsWith(url, "/getUpdates")) {
+            mPolls++;
+
+            // offset=-1: the last update only, the ones before it are confirmed unread.
+            if (mUpdates.empty()) {
+                (*response) = "{\"ok\":true,\"result\":[]}";
+            } else {
+                mMessages[mUpdates.back().message].isFetched = true;
+                (*response) = "{\"ok\":true,\"result\":[" + mUpdates.back().json + "]}";
+            }
+
+            return true;
+        }
+
+        if (EndsWith(url, "/setWebhook")) {
+            (*response) = "{\"ok\":true,\"result\":true,\"description\":\"Webhook was set\"}";
+
+            return true;
+        }
+
+        if (!EndsWith(url, "/sendmessage")) {
+            (*response) = "{\"ok\":false,\"error_code\":404,\"description\":\"Not Found\"}";
+
+            return false;
+        }
+
+        const std::string chatId = FormField(body, "chat_id");
+        const std::string text = FormField(body, "text");
+        int user = -1;
+
+        for (size_t i = 0; i < mUsers.size(); i++) {
+            if (mUsers[i].id == chatId) {
+                user = (int) i;
+            }
+        }
+
+        if (user < 0) {
+            (*response) = "{\"ok\":false,\"error_code\":400,\"description\":\"Bad Request: chat not found\"}";
+
+            return false;
+        }
+
+        int kinds = 0;
+
+        kinds |= (text.find(ALERT_TANK_EMPTY) != std::string::npos) ? ALERT_LOW : 0;
+        kinds |= (text.find(ALERT_TANK_OK) != std::string::npos) ? ALERT_RECOVERED : 0;
+        kinds |= (text.find(ALERT_TANK_UNKNOWN) != std::string::npos) ? ALERT_UNKNOWN : 0;
+
+        if (kinds != 0) {
+            mAlerts.push_back({ HostClock::Now(), user, kinds });
+        } else {
+            if ((text.find("User registered correctly") == 0) && (mUsers[user].registerTime == NEVER)) {
+                mUsers[user].registerTime = HostClock::Now();
+            }
+            _Answered(user);
+        }
+
+        (*response) = "{\"ok\":true,\"result\":{\"message_id\":" + std::to_string(++mMessageId) +
+                      ",\"from\":{\"id\":7713584244,\"is_bot\":true,\"first_name\":\"O2 Monitor\",\"username\":\"o2_monitor_bot\"}" +
+                      ",\"chat\":{\"id\":" + chatId + ",\"first_name\":\"" + mUsers[user].name + "\",\"type\":\"private\"}" +
+                      ",\"date\":" + std::to_string(EPOCH_DATE + (HostClock::Now() / SECOND)) +
+                      ",\"text\":\"" + JsonEscape(text) + "\"}}";
+
+        return true;
+    }
+
+    //-----------------------------------------------------------------------------
+    void TelegramModel::_Send(int user, const std::string& text)
+    {
+        const User& sender = mUsers[user];
+        const int message = (int) mMessages.size();
+        const std::string from = "{\"id\":" + sender.id + ",\"is_bot\":false,\"first_name\":\"" + sender.name +
+                                 "\",\"username\":\"" + sender.name + "_o2\",\"language_code\":\"en\"}";
+        Update update;
+
+        update.updateId = mNextUpdateId++;
+        update.message = message;
+        update.json = "{\"update_id\":" + std::to_string(update.updateId) +
+                      ",\"message\":{\"message_id\":" + std::to_string(++mMessageId) + ",\"from\":" + from +
+                      ",\"chat\":{\"id\":" + sender.id + ",\"first_name\":\"" + sender.name + "\",\"type\":\"private\"}" +
+                      ",\"date\":" + std::to_string(EPOCH_DATE + (HostClock::Now() / SECOND)) +
+                      ",\"text\":\"" + JsonEscape(text) + "\"}}";
+
+        mMessages.push_back({ user, HostClock::Now(), false, false });
+        mUsers[user].pending = message;
+        mUpdates.push_back(update);
+
+        if (mPush) {
+            _Push(mUpdates.size() - 1);
+        }
+
+        // No answer: the user sends it again.
+        mEvents.After(mConfig.answerWait, [this, user, message, text]() {
+            if (mUsers[user].pending == message) {
+                _Send(user, text);
+            }
+        });
+    }
+
+    //-----------------------------------------------------------------------------
+    void TelegramModel::_Push(size_t update)
+    {
+        if (mPush(mUpdates[update].json)) {
+            mMessages[mUpdates[update].message].isFetched = true;
+            return;
+        }
+
+        mEvents.After(PUSH_RETRY_TIME, [this, update]() { _Push(update); });
+    }
+
+    //-----------------------------------------------------------------------------
+    void TelegramModel::_Answered(int user)
+    {
+        User& answered = mUsers[user];
+
+        if (answered.pending < 0) {
+            return;
+        }
+
+        message_t& message = mMessages[answered.pending];
+
+        message.isAnswered = true;
+        mReplyLatency.Add((double) (HostClock::Now() - message.sentTime) / MILLISECOND);
+        answered.pending = -1;
+
+        if (answered.scriptStep < answered.script.size()) {
+            answered.scriptStep++;
+        }
+
+        if (answered.scriptStep < answered.script.size()) {
+            _SendNext(user, (sim_time_t) (mRandom.Range(3, 15) * SECOND));
+        } else {
+            _SendNext(user, (sim_time_t) (mRandom.Exponential(mConfig.chatMeanMin) * MINUTE));
+        }
+    }
+
+    //-----------------------------------------------------------------------------
+    void TelegramModel::_SendNext(int user, sim_time_t delay)
+    {
+        mEvents.After(delay, [this, user]() {
+            const User& sender = mUsers[user];
+
+            _Send(user, (sender.scriptStep < sender.script.size()) ? sender.script[sender.scriptStep] : _ChatMessage());
+        });
+    }
+
+    //-----------------------------------------------------------------------------
+    std::string TelegramModel::_ChatMessage()
+    {
+        const double draw = mRandom.Uniform();
+        char gasFlow[32];
+
+        if (draw < 0.6) {
+            return COMMAND_TANK_STATUS_STR;
+        } else if (draw < 0.7) {
+            return COMMAND_UNIT_STR;
+        } else if (draw < 0.8) {
+            snprintf(gasFlow, sizeof(gasFlow), "%s %g", COMMAND_GAS_FLOW_STR, mConfig.gasFlow);
+            return gasFlow;
+        } else if (draw < 0.9) {
+            return COMMAND_NEW_TANK_STR;
+        }
+
+        return COMMAND_NEW_GAS_FLOW_STR;
+    }
+
+} // namespace Sim
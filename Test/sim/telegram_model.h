@@ -0,0 +1,137 @@
+/*!****************************************************************************
+ * @file telegram_model.h
+ * @brief Telegram model of the host simulator: the Bot API server and the
+ *        users chatting with the monitor.
+ *
+ * The server answers getUpdates with offset=-1 as Telegram does, with the
+ * last update only, so updates sent between two polls are superseded. Users
+ * register with /start, the first one sets the unit and the tank up, then
+ * they all ask for the status now and then, and send again a message that got
+ * no answer in a while.
+ *
+ * @author Gonzalo Puy
+ * @date Jun 2025
+ *******************************************************************************/
+
+#ifndef TELEGRAM_MODEL_H
+#define TELEGRAM_MODEL_H
+
+#include <functional>
+#include <string>
+#include <vector>
+#include "esp32_model.h"
+#include "sim_core.h"
+
+namespace Sim {
+
+    struct telegram_config_t
+    {
+        int users = 4;                          /**< Users chatting with the bot. */
+        double chatMeanMin = 30;                /**< Mean time between two messages of a user [min]. */
+        double gasFlow = 6;                     /**< Gas flow set by the first user [L/min]. */
+        sim_time_t answerWait = 60 * SECOND;    /**< Time a user waits for an answer before sending again. */
+    };
+
+    /** @brief Alert kinds found in a broadcast, a single one may hold several. */
+    typedef enum {
+        ALERT_LOW = 1,
+        ALERT_RECOVERED = 2,
+        ALERT_UNKNOWN = 4
+    } alert_kind_t;
+
+    struct alert_delivery_t
+    {
+        sim_time_t time;
+        int user;
+        int kinds;              /**< alert_kind_t flags. */
+    };
+
+    struct message_t
+    {
+        int user;
+        sim_time_t sentTime;
+        bool isFetched;         /**< Returned to the bot, polled or pushed. */
+        bool isAnswered;
+    };
+
+    class TelegramModel : public HttpServer
+    {
+        public:
+
+            TelegramModel(EventQueue& events, uint64_t seed, const telegram_config_t& config);
+
+            /**
+            * @brief Users start talking to the bot.
+            */
+            void Start();
+
+            /**
+            * @brief Pushes the updates to a webhook instead of keeping them for getUpdates.
+            * @param push Delivers an update, false if it has to be sent again later.
+            */
+            void SetPush(std::function<bool(const std::string&)> push) { mPush = push; }
+
+            bool Serve(const std::string& url, const std::string& body, std::string* response) override;
+
+            const std::vector<alert_delivery_t>& GetAlerts() const { return mAlerts; }
+
+            const std::vector<message_t>& GetMessages() const { return mMessages; }
+
+            /** @brief Time from message to answer [ms], answered messages only. */
+            Samples& GetReplyLatency() { return mReplyLatency; }
+
+            /** @brief Time the bot confirmed a user registration, NEVER if it didn't. */
+            sim_time_t GetRegisterTime(int user) const { return mUsers[user].registerTime; }
+
+            int GetUserCount() const { return (int) mUsers.size(); }
+
+            uint64_t GetPolls() const { return mPolls; }
+
+        private:
+
+            static constexpr sim_time_t PUSH_RETRY_TIME = 5 * SECOND;
+
+            struct User
+            {
+                std::string id;
+                std::string name;
+                std::vector<std::string> script;    /**< Messages sent in order, each after the answer to the last. */
+                size_t scriptStep;
+                int pending;                        /**< Message waiting for an answer, -1 if none. */
+                sim_time_t registerTime;
+            };
+
+            struct Update
+            {
+                uint64_t updateId;
+                std::string json;
+                int message;
+            };
+
+            void _Send(int user, const std::string& text);
+
+            void _Push(size_t update);
+
+            void _Answered(int user);
+
+            void _SendNext(int user, sim_time_t delay);
+
+            std::string _ChatMessage();
+
+            EventQueue& mEvents;
+            Random mRandom;
+            telegram_config_t mConfig;
+            std::function<bool(const std::string&)> mPush;
+            std::vector<User> mUsers;
+            std::vector<Update> mUpdates;
+            std::vector<message_t> mMessages;
+            std::vector<alert_delivery_t> mAlerts;
+            Samples mReplyLatency;
+            uint64_t mNextUpdateId;
+            uint64_t mPolls;
+            uint64_t mMessageId;
+    };
+
+} // namespace Sim
+
+#endif // TELEGRAM_MODEL_H
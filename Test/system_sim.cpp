@@ -0,0 +1,340 @@
+/****************************************************************************//**
+ * @file system_sim.cpp
+ * @author Gonzalo Puy.
+ * @date Jun 2025
+ * @brief Deterministic simulation of the whole system on the host.
+ *
+ * The firmware superloop (OxygenMonitor, WifiCom, TelegramBot, ConfigStore)
+ * runs unchanged on a virtual clock, against models of the ESP32 bridge, the
+ * Telegram Bot API with users chatting, and an emptying tank. Days of
+ * operation run in seconds, and the same seed gives the same run.
+ *
+ * Reports the latency from the tank going low to the users notified, the
+ * messages lost or left unanswered, and the use of the UART and the network.
+ *
+ * Build and run from the repository root, with ArduinoJson next to the sources:
+ *   g++ -std=c++14 -O2 -ITest/host -ITest/sim -Iarduinojson/src -ISrc -ISrc/Utils \
+ *       $(find Src/oxygen_monitor -type d -printf '-I%p ') \
+ *       Test/system_sim.cpp $(find Test/sim Src -name '*.cpp' ! -name main.cpp) -o system_sim
+ *   ./system_sim --days 7 --seed 1
+ *
+ * Firmware options go on the command line as usual, e.g. -DBOT_WEBHOOK_MODE=1
+ * for updates pushed to the ESP32 webhook instead of polled.
+ *******************************************************************************/
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "esp32_model.h"
+#include "logger.h"
+#include "metrics.h"
+#include "oxygen_monitor.h"
+#include "sim_core.h"
+#include "tank_model.h"
+#include "telegram_bot.h"
+#include "telegram_model.h"
+#include "telemetry.h"
+#include "wifi_com.h"
+
+using namespace Sim;
+
+#define METRIC_NAME(name, exportedName, help) exportedName,
+static const char* const COUNTER_NAMES[] = { METRIC_COUNTERS(METRIC_NAME) };
+
+/** @brief Low alerts delivered this long before the crossing are taken as on time: the gauge noise crossed first. */
+static constexpr sim_time_t ALERT_EARLY_WINDOW = 5 * MINUTE;
+
+struct sim_options_t
+{
+    double days = 7;
+    uint64_t seed = 1;
+    sim_time_t idleStep = 10 * MILLISECOND;     /**< Superloop pace with nothing on the UART. */
+    sim_time_t busyStep = 200;                  /**< Superloop pace with bytes on the UART [us]. */
+    bool isVerbose = false;
+    esp32_config_t esp32;
+    telegram_config_t telegram;
+    tank_model_config_t tank;
+};
+
+//-----------------------------------------------------------------------------
+static void printUsage()
+{
+    printf("Usage: system_sim [options]\n"
+           "  --days N          Simulated time (7)\n"
+           "  --seed N          Random seed (1)\n"
+           "  --users N         Telegram users (4)\n"
+           "  --chat-min N      Mean time between two messages of a user [min] (30)\n"
+           "  --flow N          Gas flow [L/min] (6)\n"
+           "  --refill-min N    Time from low to refill [min] (30)\n"
+           "  --start-bar N     Pressure at start [bar] (60)\n"
+           "  --noise-bar N     Gauge noise [bar] (0.2)\n"
+           "  --http-loss N     Share of HTTP requests lost (0.01)\n"
+           "  --rtt-ms N        Mean round trip to Telegram [ms] (150)\n"
+           "  --tls-ms N        TLS handshake [ms] (400)\n"
+           "  --ap-mtbf-min N   Mean time between AP outages [min], 0 for none (360)\n"
+           "  --ap-outage-s N   Mean AP outage [s] (60)\n"
+           "  --idle-step-ms N  Superloop pace when idle [ms] (10)\n"
+           "  --busy-step-us N  Superloop pace with UART traffic [us] (200)\n"
+           "  --verbose         Firmware logs\n");
+}
+
+//-----------------------------------------------------------------------------
+static bool parseOptions(int argc, char** argv, sim_options_t& options)
+{
+    for (int i = 1; i < argc; i++) {
+        const char* name = argv[i];
+
+        if (strcmp(name, "--verbose") == 0) {
+            options.isVerbose = true;
+            continue;
+        }
+        if ((i + 1) == argc) {
+            return false;
+        }
+
+        const double value = atof(argv[++i]);
+
+        if (strcmp(name, "--days") == 0) {
+            options.days = value;
+        } else if (strcmp(name, "--seed") == 0) {
+            options.seed = strtoull(argv[i], nullptr, 10);
+        } else if (strcmp(name, "--users") == 0) {
+            options.telegram.users = std::min((int) value, MAX_USER_COUNT);
+        } else if (strcmp(name, "--chat-min") == 0) {
+            options.telegram.chatMeanMin = value;
+        } else if (strcmp(name, "--flow") == 0) {
+            options.telegram.gasFlow = value;
+            options.tank.flowLpm = value;
+        } else if (strcmp(name, "--refill-min") == 0) {
+            options.tank.refillMin = value;
+        } else if (strcmp(name, "--start-bar") == 0) {
+            options.tank.startBar = value;
+        } else if (strcmp(name, "--noise-bar") == 0) {
+            options.tank.noiseBar = value;
+        } else if (strcmp(name, "--http-loss") == 0) {
+            options.esp32.httpLoss = value;
+        } else if (strcmp(name, "--rtt-ms") == 0) {
+            options.esp32.rttMs = value;
+        } else if (strcmp(name, "--tls-ms") == 0) {
+            options.esp32.tlsMs = value;
+        } else if (strcmp(name, "--ap-mtbf-min") == 0) {
+            options.esp32.apMtbfMin = value;
+        } else if (strcmp(name, "--ap-outage-s") == 0) {
+            options.esp32.apOutageS = value;
+        } else if (strcmp(name, "--idle-step-ms") == 0) {
+            options.idleStep = (sim_time_t) (value * MILLISECOND);
+        } else if (strcmp(name, "--busy-step-us") == 0) {
+            options.busyStep = (sim_time_t) value;
+        } else {
+            return false;
+        }
+    }
+
+    return (options.days > 0) && (options.idleStep > 0) && (options.busyStep > 0);
+}
+
+//-----------------------------------------------------------------------------
+static void printPercentiles(const char* name, Samples& samples, const char* unit)
+{
+    if (samples.Count() == 0) {
+        printf("  %-30s no samples\n", name);
+        return;
+    }
+
+    printf("  %-30s p50 %7.1f  p90 %7.1f  p99 %7.1f  max %7.1f %s  (%zu)\n", name,
+           samples.Percentile(50), samples.Percentile(90), samples.Percentile(99), samples.Max(), unit, samples.Count());
+}
+
+//-----------------------------------------------------------------------------
+// From each low pressure crossing to the users registered by then being told.
+static void reportAlerts(const TankModel& tank, TelegramModel& telegram)
+{
+    const std::vector<alert_delivery_t>& alerts = telegram.GetAlerts();
+    Samples userLatency;
+    Samples allLatency;
+    int episodes = 0;
+    int missed = 0;
+    int lowDeliveries = 0;
+    int falseRecoveries = 0;
+
+    for (const tank_episode_t& episode : tank.GetEpisodes()) {
+        if (episode.refillTime == NEVER) {
+            continue;
+        }
+
+        sim_time_t lastLatency = 0;
+        bool isEveryoneTold = true;
+        bool hasUsers = false;
+
+        episodes++;
+
+        for (int user = 0; user < telegram.GetUserCount(); user++) {
+            if (telegram.GetRegisterTime(user) > episode.lowTime) {
+                continue;
+            }
+            hasUsers = true;
+
+            sim_time_t toldTime = NEVER;
+
+            for (const alert_delivery_t& alert : alerts) {
+                if ((alert.user == user) && (alert.kinds & ALERT_LOW) && ((alert.time + ALERT_EARLY_WINDOW) >= episode.lowTime) &&
+                    (alert.time < episode.refillTime) && (toldTime == NEVER)) {
+                    toldTime = alert.time;
+                }
+            }
+
+            if (toldTime == NEVER) {
+                missed++;
+                isEveryoneTold = false;
+                continue;
+            }
+
+            const sim_time_t latency = (toldTime > episode.lowTime) ? (toldTime - episode.lowTime) : 0;
+
+            userLatency.Add((double) latency / SECOND);
+            lastLatency = std::max(lastLatency, latency);
+        }
+
+        if (hasUsers && isEveryoneTold) {
+            allLatency.Add((double) lastLatency / SECOND);
+        }
+
+        // The pressure is still low: the notice comes from noise around the threshold.
+        for (const alert_delivery_t& alert : alerts) {
+            if ((alert.time > episode.lowTime) && (alert.time < episode.refillTime)) {
+                lowDeliveries += (alert.kinds & ALERT_LOW) ? 1 : 0;
+                falseRecoveries += (alert.kinds & ALERT_RECOVERED) ? 1 : 0;
+            }
+        }
+    }
+
+    printf("Alerts, %d low pressure episodes\n", episodes);
+    printPercentiles("crossing to a user told", userLatency, "s");
+    printPercentiles("crossing to every user told", allLatency, "s");
+    printf("  missed (user never told)       %d\n", missed);
+    printf("  low alerts while low, repeats  %d\n", lowDeliveries);
+    printf("  back to normal while low       %d\n", falseRecoveries);
+}
+
+//-----------------------------------------------------------------------------
+static void reportMessages(TelegramModel& telegram, sim_time_t endTime, sim_time_t answerWait)
+{
+    int sent = 0;
+    int answered = 0;
+    int superseded = 0;
+    int unanswered = 0;
+    int inFlight = 0;
+
+    for (const message_t& message : telegram.GetMessages()) {
+        sent++;
+
+        if (message.isAnswered) {
+            answered++;
+        } else if ((message.sentTime + answerWait) > endTime) {
+            inFlight++;
+        } else if (!message.isFetched) {
+            superseded++;
+        } else {
+            unanswered++;
+        }
+    }
+
+    printf("Messages\n");
+    printf("  sent %d, answered %d (%.1f%%), in flight at the end %d\n", sent, answered,
+           (sent > 0) ? (100.0 * answered / sent) : 0.0, inFlight);
+    printf("  never read by the bot          %d\n", superseded);
+    printf("  read, reply lost               %d\n", unanswered);
+    printPercentiles("message to answer", telegram.GetReplyLatency(), "ms");
+}
+
+//-----------------------------------------------------------------------------
+static void reportLink(UnbufferedSerial* port, const Esp32Model& esp32, sim_time_t endTime)
+{
+    const double lineTime = (double) endTime * 1000;
+    const sim_time_t downtime = esp32.GetDowntime();
+
+    printf("Link\n");
+    printf("  UART to the ESP32 %.3f%%, from the ESP32 %.3f%%, at %d baud (%llu fallbacks)\n",
+           100.0 * port->HostTxBusy() / lineTime, 100.0 * port->HostRxBusy() / lineTime, port->HostBaud(),
+           (unsigned long long) esp32.GetBaudFallbacks());
+    printf("  HTTP requests %llu, failed %llu (%.2f%%), workers busy %.2f%%, commands refused %llu\n",
+           (unsigned long long) esp32.GetHttpRequests(), (unsigned long long) esp32.GetHttpFailures(),
+           (esp32.GetHttpRequests() > 0) ? (100.0 * esp32.GetHttpFailures() / esp32.GetHttpRequests()) : 0.0,
+           100.0 * esp32.GetWorkerBusy() / (2.0 * endTime), (unsigned long long) esp32.GetJobsRefused());
+    printf("  AP outages %llu, WiFi down %.1f min (%.3f%%)\n", (unsigned long long) esp32.GetApOutages(),
+           (double) downtime / MINUTE, 100.0 * downtime / endTime);
+}
+
+//-----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+    sim_options_t options;
+
+    if (!parseOptions(argc, argv, options)) {
+        printUsage();
+        return 2;
+    }
+
+    for (int module = 0; module < LOG_MODULE_COUNT; module++) {
+        Util::Log::SetLevel((log_module_t) module, options.isVerbose ? LOG_LEVEL_INFO : LOG_LEVEL_NONE);
+    }
+
+    // A seed per model, so a change in one model doesn't move what the others draw.
+    EventQueue events;
+    TelegramModel telegram(events, options.seed * 3 + 1, options.telegram);
+    Esp32Model esp32(events, telegram, options.seed * 3 + 2, options.esp32);
+    TankModel tank(events, options.seed * 3 + 3, options.tank);
+    uint64_t telemetryFrames = 0;
+
+#if BOT_WEBHOOK_MODE
+    telegram.SetPush([&esp32](const std::string& update) { return esp32.PushUpdate(update); });
+#endif
+    esp32.SetTelemetrySink([&telemetryFrames](const std::string&, uint16_t, const std::string&) { telemetryFrames++; });
+
+    const auto wallStart = std::chrono::steady_clock::now();
+    const sim_time_t endTime = (sim_time_t) (options.days * DAY);
+
+    Module::OxygenMonitor::init();
+
+    UnbufferedSerial* port = UnbufferedSerial::HostFind(WIFI_PIN_TX);
+
+    esp32.Start(port);
+    tank.Start();
+#if !GATEWAY_MODE
+    // No bot on a gateway, the frames go to the aggregator instead.
+    telegram.Start();
+#endif
+
+    while (HostClock::Now() < endTime) {
+        Module::OxygenMonitor::getInstance().update();
+        port->HostService();
+        esp32.Poll();
+
+        const sim_time_t step = port->HostIsActive() ? options.busyStep : options.idleStep;
+        const sim_time_t next = std::min(std::min(HostClock::Now() + step, events.NextTime()), endTime);
+
+        events.RunUntil(next);
+        HostClock::Advance(next);
+    }
+
+    const double wallTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+
+    printf("Simulated %.2f days in %.1f s (x%.0f), seed %llu, %d users\n", options.days, wallTime,
+           ((double) endTime / SECOND) / wallTime, (unsigned long long) options.seed, telegram.GetUserCount());
+    reportAlerts(tank, telegram);
+    reportMessages(telegram, endTime, options.telegram.answerWait);
+    reportLink(port, esp32, endTime);
+#if GATEWAY_MODE
+    printf("  telemetry frames %llu\n", (unsigned long long) telemetryFrames);
+#endif
+
+    printf("Firmware counters\n");
+    for (int counter = 0; counter < METRIC_COUNTER_COUNT; counter++) {
+        if (Util::Metrics::Get((metric_counter_t) counter) != 0) {
+            printf("  %-34s %lu\n", COUNTER_NAMES[counter], (unsigned long) Util::Metrics::Get((metric_counter_t) counter));
+        }
+    }
+
+    return 0;
+}
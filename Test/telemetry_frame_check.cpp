@@ -0,0 +1,92 @@
+/****************************************************************************//**
+ * @file telemetry_frame_check.cpp
+ * @author Gonzalo Puy.
+ * @date Jun 2025
+ * @brief Host check of the telemetry frame codec.
+ *
+ * Build and run from the repository root:
+ *   g++ -std=c++14 -ISrc/Utils -ISrc/oxygen_monitor/Modules/telemetry \
+ *       Test/telemetry_frame_check.cpp Src/oxygen_monitor/Modules/telemetry/telemetry_frame.cpp \
+ *       Src/Utils/text_writer.cpp -o telemetry_frame_check
+ *   ./telemetry_frame_check
+ *******************************************************************************/
+
+#include <cstdio>
+#include <cstring>
+#include "telemetry_frame.h"
+
+static int failures = 0;
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            printf("FAILED %s:%d: %s\n", __FILE__, __LINE__, #condition); \
+            failures++; \
+        } \
+    } while (0)
+
+//-----------------------------------------------------------------------------
+// What a monitor encodes, the gateway reads back unchanged.
+static void checkRoundTrip()
+{
+    Util::TextBuffer<64> text;
+    telemetry_frame_t sent = {};
+    telemetry_frame_t received = {};
+
+    sent.deviceId = 7;
+    sent.sequence = 123456;
+    sent.state = 1;
+    sent.tankRegistered = true;
+    sent.unit = 'B';
+    sent.pressureCenti = 15025;
+    sent.gasFlowCenti = -250;
+    sent.timeLeft = -1;
+
+    CHECK(Module::TelemetryFrame::encode(sent, text));
+    CHECK(Module::TelemetryFrame::parse(text.c_str(), received));
+
+    CHECK(received.deviceId == sent.deviceId);
+    CHECK(received.sequence == sent.sequence);
+    CHECK(received.state == sent.state);
+    CHECK(received.tankRegistered == sent.tankRegistered);
+    CHECK(received.unit == sent.unit);
+    CHECK(received.pressureCenti == sent.pressureCenti);
+    CHECK(received.gasFlowCenti == sent.gasFlowCenti);
+    CHECK(received.timeLeft == sent.timeLeft);
+}
+
+//-----------------------------------------------------------------------------
+// Malformed frames are refused instead of read half way.
+static void checkRejected()
+{
+    Util::TextBuffer<64> text;
+    telemetry_frame_t frame = {};
+    char wrong[64];
+
+    CHECK(Module::TelemetryFrame::encode(frame, text));
+
+    snprintf(wrong, sizeof(wrong), "%s,1", text.c_str());
+    CHECK(!Module::TelemetryFrame::parse(wrong, frame));
+
+    snprintf(wrong, sizeof(wrong), "%s", text.c_str());
+    *strrchr(wrong, TELEMETRY_FRAME_SEPARATOR) = '\0';
+    CHECK(!Module::TelemetryFrame::parse(wrong, frame));
+
+    snprintf(wrong, sizeof(wrong), "%sx", text.c_str());
+    CHECK(!Module::TelemetryFrame::parse(wrong, frame));
+
+    wrong[0] = (char) ('0' + TELEMETRY_FRAME_VERSION + 1);
+    snprintf(wrong + 1, sizeof(wrong) - 1, "%s", text.c_str() + 1);
+    CHECK(!Module::TelemetryFrame::parse(wrong, frame));
+}
+
+//-----------------------------------------------------------------------------
+int main()
+{
+    checkRoundTrip();
+    checkRejected();
+
+    printf("%s\n", (failures == 0) ? "telemetry_frame: OK" : "telemetry_frame: FAILED");
+
+    return (failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,184 @@
+/****************************************************************************//**
+ * @file text_writer_check.cpp
+ * @author Gonzalo Puy.
+ * @date Jun 2025
+ * @brief Host check of the text writer: URL encoding and float formatting.
+ *
+ * Build and run from the repository root:
+ *   g++ -std=c++14 -ISrc/Utils Test/text_writer_check.cpp Src/Utils/text_writer.cpp -o text_writer_check
+ *   ./text_writer_check
+ *******************************************************************************/
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include "text_writer.h"
+
+static int failures = 0;
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            printf("FAILED %s:%d: %s\n", __FILE__, __LINE__, #condition); \
+            failures++; \
+        } \
+    } while (0)
+
+#define CHECK_TEXT(writer, expected) \
+    do { \
+        if (strcmp((writer).c_str(), (expected)) != 0) { \
+            printf("FAILED %s:%d: \"%s\" != \"%s\"\n", __FILE__, __LINE__, (writer).c_str(), (expected)); \
+            failures++; \
+        } \
+    } while (0)
+
+//-----------------------------------------------------------------------------
+// Reserved characters are escaped, spaces become '+', unreserved ones are kept.
+static void checkUrlEncoding()
+{
+    char buffer[64];
+    Util::TextWriter writer(buffer, sizeof(buffer));
+
+    writer.SetUrlEncoding(true);
+    writer.Append("a-b_c.d ~|/?&=");
+    CHECK_TEXT(writer, "a-b_c.d+%7E%7C%2F%3F%26%3D");
+    CHECK(!writer.IsOverflowed());
+
+    writer.Append((char) 0xC3);
+    CHECK(strcmp(writer.c_str() + writer.Length() - 3, "%C3") == 0);
+
+    writer.SetUrlEncoding(false);
+    writer.Append('|');
+    CHECK(writer.c_str()[writer.Length() - 1] == '|');
+}
+
+//-----------------------------------------------------------------------------
+// An escape that does not fit is dropped whole, never cut after '%' or a digit.
+static void checkEscapeNotTruncated()
+{
+    for (size_t size = 1; size <= 8; size++)
+    {
+        char buffer[8];
+        Util::TextWriter writer(buffer, size);
+
+        writer.SetUrlEncoding(true);
+        writer.Append("ab|");
+
+        const char* escape = strchr(writer.c_str(), '%');
+        CHECK((escape == nullptr) || (strcmp(escape, "%7C") == 0));
+        CHECK(writer.IsOverflowed() == (size < 6));
+        CHECK(writer.Length() < size);
+    }
+
+    // A dropped escape leaves no stray '%' behind the characters that do fit.
+    char buffer[5];
+    Util::TextWriter writer(buffer, sizeof(buffer));
+    writer.SetUrlEncoding(true);
+    writer.Append("ab|c");
+    CHECK(writer.IsOverflowed());
+    CHECK(strncmp(writer.c_str(), "ab", 2) == 0);
+    CHECK(strchr(writer.c_str(), '%') == nullptr);
+}
+
+//-----------------------------------------------------------------------------
+static void checkFloatSpecialValues()
+{
+    char buffer[32];
+    Util::TextWriter writer(buffer, sizeof(buffer));
+
+    writer.AppendFloat(std::numeric_limits<float>::quiet_NaN(), 2);
+    CHECK_TEXT(writer, "nan");
+
+    writer.Clear();
+    writer.AppendFloat(std::numeric_limits<float>::infinity(), 2);
+    CHECK_TEXT(writer, "inf");
+
+    writer.Clear();
+    writer.AppendFloat(-std::numeric_limits<float>::infinity(), 2);
+    CHECK_TEXT(writer, "-inf");
+}
+
+//-----------------------------------------------------------------------------
+static void checkFloatRounding()
+{
+    char buffer[32];
+    Util::TextWriter writer(buffer, sizeof(buffer));
+
+    writer.AppendFloat(1.005f, 0);
+    CHECK_TEXT(writer, "1");
+
+    writer.Clear();
+    writer.AppendFloat(0.999f, 2);
+    CHECK_TEXT(writer, "1.00");
+
+    writer.Clear();
+    writer.AppendFloat(-12.5f, 1);
+    CHECK_TEXT(writer, "-12.5");
+
+    writer.Clear();
+    writer.AppendFloat(3.25f, 9);
+    CHECK_TEXT(writer, "3.250000");
+}
+
+//-----------------------------------------------------------------------------
+// From 2^32 up the exponent form is used, and a mantissa rounded up to 10
+// moves to the next power.
+static void checkFloatExponent()
+{
+    char buffer[32];
+    Util::TextWriter writer(buffer, sizeof(buffer));
+
+    writer.AppendFloat(1.5e10f, 2);
+    CHECK_TEXT(writer, "1.50e+10");
+
+    writer.Clear();
+    writer.AppendFloat(9.999e9f, 2);
+    CHECK_TEXT(writer, "1.00e+10");
+
+    writer.Clear();
+    writer.AppendFloat(-4294967296.0f, 1);
+    CHECK_TEXT(writer, "-4.3e+09");
+
+    writer.Clear();
+    writer.AppendFloat(3.0e38f, 0);
+    CHECK_TEXT(writer, "3e+38");
+}
+
+//-----------------------------------------------------------------------------
+// Text past the buffer is dropped, the buffer stays null terminated.
+static void checkOverflow()
+{
+    char buffer[6];
+    Util::TextWriter writer(buffer, sizeof(buffer));
+
+    writer.AppendFloat(123.456f, 3);
+    CHECK(writer.IsOverflowed());
+    CHECK_TEXT(writer, "123.4");
+
+    writer.Clear();
+    CHECK(!writer.IsOverflowed());
+    writer.AppendInt(-2147483647 - 1);
+    CHECK(writer.IsOverflowed());
+    CHECK(writer.Length() == sizeof(buffer) - 1);
+
+    static constexpr Util::MessageTemplate<int, float> message("%d/%.1f%%");
+    char wide[16];
+    Util::TextWriter formatter(wide, sizeof(wide));
+    formatter.Format(message, 7, 2.25f);
+    CHECK_TEXT(formatter, "7/2.3%");
+}
+
+//-----------------------------------------------------------------------------
+int main()
+{
+    checkUrlEncoding();
+    checkEscapeNotTruncated();
+    checkFloatSpecialValues();
+    checkFloatRounding();
+    checkFloatExponent();
+    checkOverflow();
+
+    printf("text_writer_check: %s\n", (failures == 0) ? "OK" : "FAILED");
+    return (failures == 0) ? 0 : 1;
+}
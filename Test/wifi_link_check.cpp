@@ -0,0 +1,293 @@
+/****************************************************************************//**
+ * @file wifi_link_check.cpp
+ * @author Gonzalo Puy.
+ * @date Jun 2025
+ * @brief Host checks of the WifiCom link to the ESP32 bridge, against a mock
+ *        HTTP server.
+ *
+ * The WifiCom driver runs unchanged on the virtual clock, with the bridge
+ * model of the simulator on the other end of the UART. Checks that answers
+ * to POST and GET requests are matched to their request by ID, that a slow
+ * server answer fails the request at WIFI_REQUEST_TIMEOUT and is dropped as
+ * stale when it comes in after the next request went out, that the link
+ * comes back up after the access point drops with a request on the way, and
+ * that a broadcast reaches every recipient.
+ *
+ * The keep-alive and reconnect of the HTTPClient connection inside the
+ * bridge are not covered: they belong to the arduino-esp32 core and lwIP,
+ * which don't build on the host, and a stand-in would only check itself.
+ *
+ * Build and run from the repository root, with ArduinoJson next to the sources:
+ *   g++ -std=c++14 -O2 -ITest/host -ITest/sim -Iarduinojson/src -ISrc -ISrc/Utils \
+ *       $(find Src/oxygen_monitor -type d -printf '-I%p ') \
+ *       Test/wifi_link_check.cpp $(find Test/sim Src -name '*.cpp' ! -name main.cpp) -o wifi_link_check
+ *   ./wifi_link_check [seed]
+ *******************************************************************************/
+
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <string>
+#include <vector>
+#include "commands.h"
+#include "esp32_model.h"
+#include "logger.h"
+#include "metrics.h"
+#include "sim_core.h"
+#include "wifi_com.h"
+
+using namespace Sim;
+
+static int failures = 0;
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            printf("FAILED %s:%d: %s\n", __FILE__, __LINE__, #condition); \
+            failures++; \
+        } \
+    } while (0)
+
+#define SEND_URL            "https://api.telegram.org/botTOKEN/sendMessage"
+#define GET_URL             "https://api.telegram.org/botTOKEN/getMe"
+#define SLOW_BODY           "text=slow"
+#define SLOW_SERVE_TIME     (4 * SECOND)    // Longer than WIFI_REQUEST_TIMEOUT.
+#define NEXT_BODY           "text=next"
+#define NEXT_SERVE_TIME     (2 * SECOND)    // Still on the way when the slow answer comes in.
+
+//-----------------------------------------------------------------------------
+// Echoes the requests back, and takes its time with the slow ones.
+class MockServer : public HttpServer
+{
+    public:
+
+        bool Serve(const std::string& url, const std::string& body, std::string* response) override
+        {
+            mUrls.push_back(url);
+            mBodies.push_back(body);
+            (*response) = "answer:" + body;
+            return true;
+        }
+
+        sim_time_t ServeTime(const std::string&, const std::string& body) override
+        {
+            if (body == SLOW_BODY) {
+                return SLOW_SERVE_TIME;
+            }
+            return (body == NEXT_BODY) ? NEXT_SERVE_TIME : 0;
+        }
+
+        const std::vector<std::string>& GetUrls() const { return mUrls; }
+
+        const std::vector<std::string>& GetBodies() const { return mBodies; }
+
+    private:
+
+        std::vector<std::string> mUrls;
+        std::vector<std::string> mBodies;
+};
+
+static EventQueue events;
+static MockServer server;
+static Esp32Model* esp32;
+static UnbufferedSerial* port;
+
+//-----------------------------------------------------------------------------
+// Runs the driver and the bridge until the condition holds, checked after
+// every update of the driver, or until the time is over.
+static bool runUntil(const std::function<bool()>& condition, sim_time_t timeout)
+{
+    const sim_time_t endTime = HostClock::Now() + timeout;
+
+    while (HostClock::Now() < endTime) {
+        Drivers::WifiCom::getInstance().update();
+        if (condition()) {
+            return true;
+        }
+        port->HostService();
+        esp32->Poll();
+
+        const sim_time_t step = port->HostIsActive() ? 200 : MILLISECOND;
+        const sim_time_t next = std::min(std::min(HostClock::Now() + step, events.NextTime()), endTime);
+
+        events.RunUntil(next);
+        HostClock::Advance(next);
+    }
+
+    return false;
+}
+
+//-----------------------------------------------------------------------------
+static void run(sim_time_t duration)
+{
+    runUntil([]() { return false; }, duration);
+}
+
+//-----------------------------------------------------------------------------
+static bool isIdle()
+{
+    return !Drivers::WifiCom::getInstance().isBusy();
+}
+
+//-----------------------------------------------------------------------------
+// Waits for the answer of the request just sent.
+static std::string waitPostResponse(sim_time_t timeout)
+{
+    std::string response;
+
+    if (!runUntil([&response]() { return Drivers::WifiCom::getInstance().getPostResponse(&response); }, timeout)) {
+        return "NONE";
+    }
+    runUntil(isIdle, SECOND);
+
+    return response;
+}
+
+//-----------------------------------------------------------------------------
+static std::string post(uint8_t endpoint, const char* body)
+{
+    Drivers::WifiCom::getInstance().post(endpoint, body);
+    return waitPostResponse(WIFI_BROADCAST_TIMEOUT * MILLISECOND);
+}
+
+//-----------------------------------------------------------------------------
+static std::string get(const std::string& url)
+{
+    std::string response;
+
+    Drivers::WifiCom::getInstance().request(url);
+    if (!runUntil([&response]() { return Drivers::WifiCom::getInstance().getGetResponse(&response); },
+                  WIFI_BROADCAST_TIMEOUT * MILLISECOND)) {
+        return "NONE";
+    }
+    runUntil(isIdle, SECOND);
+
+    return response;
+}
+
+//-----------------------------------------------------------------------------
+static void checkLinkUp()
+{
+    Drivers::WifiCom& wifi = Drivers::WifiCom::getInstance();
+
+    CHECK(runUntil([&wifi]() { return wifi.isLinkUp() && !wifi.isBusy(); }, 30 * SECOND));
+    CHECK(wifi.getBaudRate() == WIFI_BAUD_RATE_FAST);
+    CHECK(esp32->IsConnected());
+}
+
+//-----------------------------------------------------------------------------
+// Answers go to their request, the token stays on the ESP32.
+static void checkRequests(uint8_t endpoint)
+{
+    CHECK(post(endpoint, "text=one") == "answer:text=one");
+    CHECK(post(endpoint, "text=two") == "answer:text=two");
+    CHECK(!server.GetUrls().empty() && (server.GetUrls().back() == SEND_URL));
+    CHECK(get(GET_URL) == "answer:");
+    CHECK(server.GetUrls().back() == GET_URL);
+}
+
+//-----------------------------------------------------------------------------
+// The slow answer comes in while the next request is on the way, on the other
+// worker of the bridge, and must not be taken as its answer.
+static void checkSlowServer(uint8_t endpoint)
+{
+    Drivers::WifiCom& wifi = Drivers::WifiCom::getInstance();
+    const uint32_t timeouts = Util::Metrics::Get(METRIC_WIFI_TIMEOUT_POST);
+    const uint32_t stale = Util::Metrics::Get(METRIC_WIFI_STALE_RESPONSES);
+    const sim_time_t startTime = HostClock::Now();
+
+    wifi.post(endpoint, SLOW_BODY);
+    CHECK(waitPostResponse(10 * SECOND) == RESULT_ERROR);
+
+    const sim_time_t waited = HostClock::Now() - startTime;
+
+    // Within a tick of the timeout.
+    CHECK(waited >= (sim_time_t) (WIFI_REQUEST_TIMEOUT - 1) * MILLISECOND);
+    CHECK(waited < (sim_time_t) (WIFI_REQUEST_TIMEOUT + 100) * MILLISECOND);
+    CHECK(Util::Metrics::Get(METRIC_WIFI_TIMEOUT_POST) == timeouts + 1);
+    CHECK(wifi.isLinkUp());
+
+    wifi.post(endpoint, NEXT_BODY);
+    CHECK(waitPostResponse(10 * SECOND) == "answer:" NEXT_BODY);
+    CHECK(Util::Metrics::Get(METRIC_WIFI_STALE_RESPONSES) == stale + 1);
+    CHECK(server.GetBodies().back() == NEXT_BODY);
+
+    // Nothing left over for the request after.
+    CHECK(post(endpoint, "text=after") == "answer:text=after");
+}
+
+//-----------------------------------------------------------------------------
+// The access point drops with a request on the way: the request fails, the
+// link is reported down, and comes back up once the access point does.
+static void checkReconnect(uint8_t endpoint)
+{
+    Drivers::WifiCom& wifi = Drivers::WifiCom::getInstance();
+    const uint32_t connections = Util::Metrics::Get(METRIC_WIFI_CONNECTIONS);
+
+    wifi.post(endpoint, "text=lost");
+    run(100 * MILLISECOND);
+    esp32->DropAp(20 * SECOND);
+    CHECK(waitPostResponse(10 * SECOND) == RESULT_ERROR);
+    CHECK(!wifi.isLinkUp());
+
+    CHECK(runUntil([&wifi]() { return wifi.isLinkUp() && !wifi.isBusy(); }, 60 * SECOND));
+    CHECK(Util::Metrics::Get(METRIC_WIFI_CONNECTIONS) > connections);
+    CHECK(post(endpoint, "text=back") == "answer:text=back");
+}
+
+//-----------------------------------------------------------------------------
+static void checkBroadcast(uint8_t endpoint)
+{
+    Drivers::WifiCom& wifi = Drivers::WifiCom::getInstance();
+    const size_t served = server.GetBodies().size();
+
+    wifi.broadcast(endpoint, "11,22,33", "text=all");
+    CHECK(waitPostResponse(WIFI_BROADCAST_TIMEOUT * MILLISECOND) == "OK,OK,OK");
+    CHECK(server.GetBodies().size() == served + 3);
+    if (server.GetBodies().size() == served + 3) {
+        CHECK(server.GetBodies()[served] == "chat_id=11&text=all");
+        CHECK(server.GetBodies()[served + 2] == "chat_id=33&text=all");
+    }
+}
+
+//-----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+    const uint64_t seed = (argc > 1) ? strtoull(argv[1], nullptr, 0) : 1;
+    esp32_config_t config;
+
+    // Nothing random but the round trips: every request gets through.
+    config.httpLoss = 0;
+    config.apMtbfMin = 0;
+
+    for (int module = 0; module < LOG_MODULE_COUNT; module++) {
+        Util::Log::SetLevel((log_module_t) module, LOG_LEVEL_NONE);
+    }
+
+    Esp32Model bridge(events, server, seed, config);
+
+    esp32 = &bridge;
+    Util::Tick::Init();
+    Drivers::WifiCom::init();
+    port = UnbufferedSerial::HostFind(WIFI_PIN_TX);
+    esp32->Start(port);
+
+    const int endpoint = Drivers::WifiCom::getInstance().registerEndpoint(SEND_URL);
+
+    CHECK(endpoint >= 0);
+
+    checkLinkUp();
+    checkRequests((uint8_t) endpoint);
+    checkSlowServer((uint8_t) endpoint);
+    checkReconnect((uint8_t) endpoint);
+    checkBroadcast((uint8_t) endpoint);
+
+    printf("wifi_link: %llu HTTP requests, %llu failed\n", (unsigned long long) esp32->GetHttpRequests(),
+           (unsigned long long) esp32->GetHttpFailures());
+
+    if (failures == 0) {
+        printf("wifi_link: OK\n");
+    }
+
+    return (failures == 0) ? 0 : 1;
+}
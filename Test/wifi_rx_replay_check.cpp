@@ -0,0 +1,219 @@
+/****************************************************************************//**
+ * @file wifi_rx_replay_check.cpp
+ * @author Gonzalo Puy.
+ * @date Jun 2025
+ * @brief Host replay of update events through the WifiCom receive path.
+ *
+ * Recorded webhook updates are replayed byte by byte on the UART as the ESP32
+ * bridge frames them, with the link up against the bridge model of the
+ * simulator. Checks that updates up to WIFI_BODY_MAX come out of getUpdate()
+ * intact, that a frame longer than WIFI_RX_FRAME_MAX is dropped and counted
+ * in METRIC_WIFI_RX_FRAMES_DROPPED, and that the frames after it, updates
+ * and command responses alike, are read again from its stop character on.
+ *
+ * Build and run from the repository root, with ArduinoJson next to the sources:
+ *   g++ -std=c++14 -O2 -ITest/host -ITest/sim -Iarduinojson/src -ISrc -ISrc/Utils \
+ *       $(find Src/oxygen_monitor -type d -printf '-I%p ') \
+ *       Test/wifi_rx_replay_check.cpp $(find Test/sim Src -name '*.cpp' ! -name main.cpp) -o wifi_rx_replay_check
+ *   ./wifi_rx_replay_check
+ *******************************************************************************/
+
+#include <cstdio>
+#include <functional>
+#include <string>
+#include "commands.h"
+#include "esp32_model.h"
+#include "logger.h"
+#include "metrics.h"
+#include "sim_core.h"
+#include "wifi_com.h"
+
+using namespace Sim;
+
+static int failures = 0;
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            printf("FAILED %s:%d: %s\n", __FILE__, __LINE__, #condition); \
+            failures++; \
+        } \
+    } while (0)
+
+#define SEND_URL            "https://api.telegram.org/botTOKEN/sendMessage"
+
+// Updates as the bridge forwarded them, '~' already escaped by it.
+static const char* const RECORDED_UPDATES[] = {
+    "{\"update_id\":712004417,\"message\":{\"message_id\":1893,\"from\":{\"id\":51234567,\"is_bot\":false,"
+    "\"first_name\":\"Ana\",\"language_code\":\"es\"},\"chat\":{\"id\":51234567,\"first_name\":\"Ana\","
+    "\"type\":\"private\"},\"date\":1718964212,\"text\":\"/status\",\"entities\":[{\"offset\":0,"
+    "\"length\":7,\"type\":\"bot_command\"}]}}",
+
+    "{\"update_id\":712004418,\"message\":{\"message_id\":1894,\"from\":{\"id\":51234567,\"is_bot\":false,"
+    "\"first_name\":\"Ana\"},\"chat\":{\"id\":51234567,\"type\":\"private\"},\"date\":1718964263,"
+    "\"text\":\"tanque 2 \\u007e 40 bar | revisar ma\\u00f1ana\"}}",
+
+    "{\"update_id\":712004419,\"callback_query\":{\"id\":\"220045178812994013\",\"from\":{\"id\":51234567,"
+    "\"is_bot\":false,\"first_name\":\"Ana\"},\"message\":{\"message_id\":1895,\"chat\":{\"id\":51234567,"
+    "\"type\":\"private\"},\"date\":1718964270,\"text\":\"Alarm LOW\"},\"chat_instance\":\"-81123\","
+    "\"data\":\"ack:low\"}}",
+};
+
+static EventQueue events;
+static Esp32Model* esp32;
+static UnbufferedSerial* port;
+
+//-----------------------------------------------------------------------------
+// Answers every request with OK.
+class OkServer : public HttpServer
+{
+    public:
+
+        bool Serve(const std::string&, const std::string&, std::string* response) override
+        {
+            (*response) = "OK";
+            return true;
+        }
+};
+
+//-----------------------------------------------------------------------------
+static bool runUntil(const std::function<bool()>& condition, sim_time_t timeout)
+{
+    const sim_time_t endTime = HostClock::Now() + timeout;
+
+    while (HostClock::Now() < endTime) {
+        Drivers::WifiCom::getInstance().update();
+        if (condition()) {
+            return true;
+        }
+        port->HostService();
+        esp32->Poll();
+
+        const sim_time_t step = port->HostIsActive() ? 200 : MILLISECOND;
+        const sim_time_t next = std::min(std::min(HostClock::Now() + step, events.NextTime()), endTime);
+
+        events.RunUntil(next);
+        HostClock::Advance(next);
+    }
+
+    return false;
+}
+
+//-----------------------------------------------------------------------------
+// Sends a frame as the bridge does, at the rate of the link.
+static void replay(const std::string& frame)
+{
+    port->HostSend(frame + STOP_CHAR, port->HostBaud());
+}
+
+//-----------------------------------------------------------------------------
+static std::string updateFrame(const std::string& update)
+{
+    return std::string(1, EVENT_CHAR) + EVENT_UPDATE_STR + PARAM_SEPARATOR_CHAR + update;
+}
+
+//-----------------------------------------------------------------------------
+static std::string nextUpdate()
+{
+    std::string update;
+
+    if (!runUntil([&update]() { return Drivers::WifiCom::getInstance().getUpdate(&update); }, SECOND)) {
+        return "NONE";
+    }
+
+    return update;
+}
+
+//-----------------------------------------------------------------------------
+// Update padded to the given length, as the ESP32 forwards long messages.
+static std::string paddedUpdate(size_t length)
+{
+    std::string update = "{\"update_id\":712004420,\"message\":{\"text\":\"";
+
+    update.append(length - update.length() - 3, 'x');
+    return update + "\"}}";
+}
+
+//-----------------------------------------------------------------------------
+static void checkRecorded()
+{
+    const uint32_t dropped = Util::Metrics::Get(METRIC_WIFI_RX_FRAMES_DROPPED);
+
+    for (const char* update : RECORDED_UPDATES) {
+        replay(updateFrame(update));
+        CHECK(nextUpdate() == update);
+    }
+
+    // Largest body the bridge forwards.
+    replay(updateFrame(paddedUpdate(WIFI_BODY_MAX)));
+    CHECK(nextUpdate() == paddedUpdate(WIFI_BODY_MAX));
+    CHECK(Util::Metrics::Get(METRIC_WIFI_RX_FRAMES_DROPPED) == dropped);
+}
+
+//-----------------------------------------------------------------------------
+// An overlong frame is dropped up to its stop character, and the frames
+// behind it, sent back to back, are read.
+static void checkOverlong()
+{
+    const uint32_t dropped = Util::Metrics::Get(METRIC_WIFI_RX_FRAMES_DROPPED);
+
+    replay(updateFrame(paddedUpdate(2 * WIFI_RX_FRAME_MAX)));
+    replay(updateFrame(RECORDED_UPDATES[0]));
+    CHECK(nextUpdate() == RECORDED_UPDATES[0]);
+    CHECK(nextUpdate() == "NONE");
+    CHECK(Util::Metrics::Get(METRIC_WIFI_RX_FRAMES_DROPPED) == dropped + 1);
+
+    // One byte over: dropped as well.
+    replay(std::string(WIFI_RX_FRAME_MAX + 1, 'x'));
+    replay(updateFrame(RECORDED_UPDATES[1]));
+    CHECK(nextUpdate() == RECORDED_UPDATES[1]);
+    CHECK(Util::Metrics::Get(METRIC_WIFI_RX_FRAMES_DROPPED) == dropped + 2);
+
+    // Command responses go on as well.
+    Drivers::WifiCom& wifi = Drivers::WifiCom::getInstance();
+    std::string response;
+
+    replay(std::string(3 * WIFI_RX_FRAME_MAX, 'x'));
+    wifi.post(0, "text=after");
+    CHECK(runUntil([&wifi, &response]() { return wifi.getPostResponse(&response); }, 5 * SECOND));
+    CHECK(response == "OK");
+    CHECK(Util::Metrics::Get(METRIC_WIFI_RX_FRAMES_DROPPED) == dropped + 3);
+    CHECK(wifi.isLinkUp());
+}
+
+//-----------------------------------------------------------------------------
+int main()
+{
+    esp32_config_t config;
+    OkServer okServer;
+
+    config.httpLoss = 0;
+    config.apMtbfMin = 0;
+
+    for (int module = 0; module < LOG_MODULE_COUNT; module++) {
+        Util::Log::SetLevel((log_module_t) module, LOG_LEVEL_NONE);
+    }
+
+    Esp32Model bridge(events, okServer, 1, config);
+
+    esp32 = &bridge;
+    Util::Tick::Init();
+    Drivers::WifiCom::init();
+    port = UnbufferedSerial::HostFind(WIFI_PIN_TX);
+    esp32->Start(port);
+
+    CHECK(Drivers::WifiCom::getInstance().registerEndpoint(SEND_URL) == 0);
+    CHECK(runUntil([]() { return Drivers::WifiCom::getInstance().isLinkUp() && !Drivers::WifiCom::getInstance().isBusy(); },
+                   30 * SECOND));
+
+    checkRecorded();
+    checkOverlong();
+
+    printf("wifi_rx_replay: %u frames dropped\n", (unsigned) Util::Metrics::Get(METRIC_WIFI_RX_FRAMES_DROPPED));
+
+    if (failures == 0) {
+        printf("wifi_rx_replay: OK\n");
+    }
+
+    return (failures == 0) ? 0 : 1;
+}